@@ -0,0 +1,64 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+// Matches InstanceData in src/Renderer/InstanceRenderer.hpp
+struct InstanceData {
+    vec4 rows[3];
+    vec4 color;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer Draws {
+    DrawCommand draws[];
+};
+
+layout(std430, set = 0, binding = 2) buffer DrawCount {
+    uint drawCount;
+};
+
+// Matches CullParams in src/Renderer/GpuCulling.cpp
+layout(push_constant) uniform CullParams {
+    vec4 planes[6];
+    vec4 boundingSphere; // mesh space center, radius
+    uint firstInstance;
+    uint instanceCount;
+    uint indexCount;
+} params;
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= params.instanceCount) {
+        return;
+    }
+    uint instanceId = params.firstInstance + index;
+    InstanceData instance = instances[instanceId];
+
+    vec4 localCenter = vec4(params.boundingSphere.xyz, 1.0);
+    vec3 center = vec3(dot(instance.rows[0], localCenter), dot(instance.rows[1], localCenter), dot(instance.rows[2], localCenter));
+    float scale = max(max(length(vec3(instance.rows[0].x, instance.rows[1].x, instance.rows[2].x)),
+                          length(vec3(instance.rows[0].y, instance.rows[1].y, instance.rows[2].y))),
+                      length(vec3(instance.rows[0].z, instance.rows[1].z, instance.rows[2].z)));
+    float radius = params.boundingSphere.w * scale;
+
+    for (int i = 0; i < 6; i++) {
+        if (dot(params.planes[i].xyz, center) + params.planes[i].w < -radius) {
+            return;
+        }
+    }
+
+    uint slot = atomicAdd(drawCount, 1);
+    draws[slot] = DrawCommand(params.indexCount, 1, 0, 0, instanceId);
+}
@@ -1,20 +1,36 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// PackedVertex in src/Renderer/MeshFormat.hpp: unorm16 position inside the mesh bounds,
+// octahedral snorm16 normal, unorm8 color
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec4 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-        vec2(0.0, -0.5),
-        vec2(0.5, 0.5),
-        vec2(-0.5, 0.5)
-    );
+// Matches InstanceData in src/Renderer/InstanceRenderer.hpp
+struct InstanceData {
+    vec4 rows[3];
+    vec4 color;
+};
+
+// Bindless storage buffers (src/Renderer/BindlessTable.hpp)
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+} buffers[];
 
-vec3 colors[3] = vec3[](
-        vec3(1.0, 0.0, 0.0),
-        vec3(0.0, 1.0, 0.0),
-        vec3(0.0, 0.0, 1.0)
-    );
+// Matches DrawConstants in src/Renderer/InstanceRenderer.hpp
+layout(push_constant) uniform Draw {
+    uint instanceBuffer;
+    // MeshConstants in src/Renderer/Mesh.hpp
+    layout(offset = 16) vec4 positionScale;
+    vec4 positionOffset;
+} draw;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    InstanceData instance = buffers[draw.instanceBuffer].instances[gl_InstanceIndex];
+    vec4 position = vec4(draw.positionOffset.xyz + inPosition.xyz * draw.positionScale.xyz, 1.0);
+    gl_Position = vec4(dot(instance.rows[0], position), dot(instance.rows[1], position), dot(instance.rows[2], position), 1.0);
+    fragColor = inColor.rgb * instance.color.rgb;
 }
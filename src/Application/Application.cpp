@@ -1,6 +1,8 @@
 #include "Log/log.hpp"
 #include "core.hpp"
 #include <Application/Application.hpp>
+#include <Shaders/shaderFrag.hpp>
+#include <Shaders/shaderVert.hpp>
 
 #include <fcntl.h>
 #include <string>
@@ -8,19 +10,6 @@
 #include <vulkan/vulkan_beta.h> // Add this if needed for beta features or portability extensions
 #include <vulkan/vulkan_core.h>
 
-static std::vector<char> readFile(const std::string& filename)
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    VKP_ASSERT(file.is_open(), "UNABLE TO OPEN FILE " + filename);
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    return buffer;
-}
-
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
 {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
@@ -48,6 +37,9 @@ static const bool enableValidationLayers = false;
 static const bool enableValidationLayers = true;
 #endif
 
+// How often --pacing-stats logs the frame pacing report
+static constexpr u32 PACING_REPORT_FRAMES = 600;
+
 namespace VulkanProj {
 
 // Validation Layer Callback
@@ -108,13 +100,17 @@ static bool validationSupported()
     return true;
 }
 
-static std::vector<const char*> getRequiredExtensions()
+static std::vector<const char*> getRequiredExtensions(bool headless)
 {
-    u32 glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+
+    // Surface extensions would fail to load on machines without a window system
+    if (!headless) {
+        u32 glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -127,19 +123,69 @@ void Application::run()
 {
     initVulkan();
     setupDebugCallbacks();
-    createSurface();
+    if (!m_Spec.headless) {
+        createSurface();
+    }
     pickPhysicalDevice();
     setupLogicalDevice();
-    createSwapChain();
+    VKP_TRACK_INIT(m_Instance, m_PhysicalDevice, m_LogicalDevice, m_MemoryBudgetEnabled, enableValidationLayers);
+    m_Allocator.init(m_PhysicalDevice, m_LogicalDevice);
+    m_FrameTimeline.init(m_LogicalDevice);
+    {
+        FramePacer::Spec pacing;
+        pacing.mode = m_Spec.pacing;
+        pacing.targetFps = m_Spec.targetFps;
+        pacing.presentWait = m_PresentWaitEnabled;
+        m_Pacer.init(m_PhysicalDevice, m_LogicalDevice, m_Queues.graphicsFamily, m_Spec.framesInFlight, pacing);
+    }
+    m_DeletionQueue.init(m_LogicalDevice, m_Allocator);
+    m_UploadQueue.init(m_LogicalDevice, m_Allocator, m_TransferQueue, m_Queues.transferFamily, m_Queues.graphicsFamily);
+    m_PipelineCache.init(m_PhysicalDevice, m_LogicalDevice, m_Spec.pipelineCachePath);
+    m_ShaderLibrary.init(m_LogicalDevice);
+    m_DescriptorLayouts.init(m_LogicalDevice);
+    m_FrameDescriptors.init(m_LogicalDevice, m_Spec.framesInFlight);
+    m_Bindless.init(m_PhysicalDevice, m_LogicalDevice, m_DescriptorLayouts, m_Spec.framesInFlight);
+    {
+        TextureStreamer::Spec streaming;
+        streaming.budgetBytes = (VkDeviceSize)m_Spec.textureBudgetMiB << 20;
+        streaming.memoryBudget = m_MemoryBudgetEnabled;
+        m_Textures.init(m_PhysicalDevice, m_LogicalDevice, m_Allocator, m_UploadQueue, m_Bindless, m_DeletionQueue, m_FrameTimeline, streaming);
+        for (const std::string& path : m_Spec.texturePaths) {
+            TextureHandle texture = m_Textures.load(path);
+            if (texture != INVALID_TEXTURE) {
+                m_TextureHandles.push_back(texture);
+            }
+        }
+    }
+    createScene();
+    if (m_Spec.headless) {
+        createOffscreenTargets();
+    } else {
+        createSwapChain();
+    }
     createImageViews();
-    createRenderPass();
+    m_RenderGraph.init(m_LogicalDevice, m_Allocator, m_Spec.framesInFlight);
     createGraphicsPipeline();
-    createFrameBuffers();
-    createCommandPool();
-    createCommandBuffer();
+    if (m_Spec.gpuCulling) {
+        m_Culling.init(m_LogicalDevice, m_Allocator, m_ShaderLibrary, m_DescriptorLayouts, m_PipelineCache.getHandle(), m_Instances,
+            m_Spec.framesInFlight);
+    }
+    if (m_Spec.shaderHotReload) {
+        setupShaderHotReload();
+    }
+    createCommandPools();
+    createCommandBuffers();
     createSynchObjects();
+    VKP_PROFILE_GPU_INIT(m_PhysicalDevice, m_LogicalDevice, m_Queues.graphicsFamily, m_Spec.framesInFlight);
 
-    mainLoop();
+    if (!m_Spec.microBenchmark.empty()) {
+        runMicroBenchmark(m_Spec.microBenchmark);
+    } else {
+        mainLoop();
+    }
+    if (!m_Spec.readbackPath.empty()) {
+        writeReadbackImage(m_Spec.readbackPath);
+    }
     cleanup();
 }
 
@@ -179,10 +225,7 @@ void Application::createInstance()
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
-    u32 glfwExtensionCount = 0;
-    const char** glfwExtensions;
-
-    auto extensions = getRequiredExtensions();
+    auto extensions = getRequiredExtensions(m_Spec.headless);
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -199,51 +242,55 @@ void Application::createInstance()
         createInfo.pNext = nullptr;
     }
 
-    VkResult res = vkCreateInstance(&createInfo, nullptr, &m_Instance);
+    VkResult res = vkCreateInstance(&createInfo, VKP_ALLOCATION_CALLBACKS, &m_Instance);
     VKP_ASSERT(res == VK_SUCCESS, "Unable to create Vulkan Instance");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_INSTANCE, m_Instance, "Instance");
 }
 
 void Application::initVulkan()
 {
+    if (m_Spec.headless) {
+        // Without a window the loop needs another way to end
+        if (m_Spec.frameLimit == 0 && m_Spec.benchmarkFrames == 0) {
+            m_Spec.frameLimit = 1;
+        }
+        createInstance();
+        return;
+    }
+
     int success = glfwInit();
     VKP_ASSERT(success, "Failed to init glfw");
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     m_NativeWindow = glfwCreateWindow(m_Width, m_Height, "VulkanProj", nullptr, nullptr);
+    glfwSetWindowUserPointer(m_NativeWindow, this);
+    glfwSetFramebufferSizeCallback(m_NativeWindow, [](GLFWwindow* window, int width, int height) {
+        auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+        app->m_FramebufferResized = true;
+    });
     createInstance();
 }
 
 void Application::pickPhysicalDevice()
 {
-    uint32_t deviceCount = 0;
-    vkEnumeratePhysicalDevices(m_Instance, &deviceCount, nullptr);
-    if (deviceCount == 0) {
-        VKP_ASSERT(false, "No Graphics Devices With Vulkan Support Found");
-    }
+    DeviceRequirements requirements;
+    requirements.surface = m_Surface;
+    requirements.indirectCount = m_Spec.gpuCulling;
+    requirements.preferred = m_Spec.preferredDevice;
 
-    std::vector<VkPhysicalDevice> devices(deviceCount);
-    vkEnumeratePhysicalDevices(m_Instance, &deviceCount, devices.data());
+    std::vector<DeviceCandidate> candidates = rankPhysicalDevices(m_Instance, requirements);
+    logDeviceSelection(candidates, requirements);
+    VKP_ASSERT(!candidates.empty() && candidates.front().rejection.empty(), "No Graphics Devices With Vulkan Support Found");
 
-    for (VkPhysicalDevice d : devices) {
-        if (isUsableDevice(d, m_Surface)) {
-            m_PhysicalDevice = d;
-            break;
-        }
-    }
-    if (m_PhysicalDevice == VK_NULL_HANDLE) {
-        VKP_ASSERT(false, "No Graphics Devices With Vulkan Support Found");
-    }
+    m_PhysicalDevice = candidates.front().device;
+    m_Queues = candidates.front().queues;
 }
 
 void Application::setupLogicalDevice()
 {
-    QueueFamilyIndices indices = findQueueFamilies(m_PhysicalDevice, m_Surface);
-
-    std::set<u32> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-
     float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    for (u32 qFam : uniqueQueueFamilies) {
+    for (u32 qFam : m_Queues.getUniqueFamilies()) {
         VkDeviceQueueCreateInfo qInfo {};
         qInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         qInfo.queueFamilyIndex = qFam;
@@ -252,16 +299,124 @@ void Application::setupLogicalDevice()
         queueCreateInfos.push_back(qInfo);
     }
 
+    VkPhysicalDeviceVulkan13Features supported13 {};
+    supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceVulkan12Features supported12 {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported12.pNext = &supported13;
+    VkPhysicalDeviceFeatures2 supportedFeatures {};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supported12;
+    vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures {};
+#ifdef VKP_PROFILE
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.features.pipelineStatisticsQuery;
+    deviceFeatures.inheritedQueries = supportedFeatures.features.inheritedQueries;
+#endif
+
+    // Uploads signal a timeline semaphore the graphics queue waits on
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+
+    // Bindless table: runtime-sized, partially bound arrays updated while frames are in flight,
+    // indexed with push constants
+    VKP_ASSERT(supported12.runtimeDescriptorArray && supported12.descriptorBindingPartiallyBound
+            && supported12.descriptorBindingStorageBufferUpdateAfterBind && supported12.descriptorBindingSampledImageUpdateAfterBind
+            && supported12.descriptorBindingUpdateUnusedWhilePending
+            && supportedFeatures.features.shaderStorageBufferArrayDynamicIndexing
+            && supportedFeatures.features.shaderSampledImageArrayDynamicIndexing,
+        "DEVICE DOES NOT SUPPORT THE DESCRIPTOR INDEXING FEATURES THE BINDLESS TABLE NEEDS");
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = supported12.shaderSampledImageArrayNonUniformIndexing;
+    deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    // Streamed textures are BC or ASTC, whichever the device samples
+    deviceFeatures.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+
+    // GPU culling writes one indirect command per visible instance, each with its own firstInstance
+    if (m_Spec.gpuCulling) {
+        VKP_ASSERT(supported12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect
+                && supportedFeatures.features.drawIndirectFirstInstance,
+            "GPU CULLING NEEDS drawIndirectCount, multiDrawIndirect AND drawIndirectFirstInstance");
+        features12.drawIndirectCount = VK_TRUE;
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+
+    // The render graph records passes with dynamic rendering and synchronization2 barriers
+    VKP_ASSERT(supported13.dynamicRendering && supported13.synchronization2, "DEVICE DOES NOT SUPPORT DYNAMIC RENDERING AND SYNCHRONIZATION2");
+    VkPhysicalDeviceVulkan13Features features13 {};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+    features12.pNext = &features13;
+
+    std::vector<const char*> extensions = m_Spec.headless ? std::vector<const char*>() : deviceExtensions;
+
+    // Lets texture streaming size itself to what the driver will actually give us
+    m_MemoryBudgetEnabled = hasDeviceExtension(m_PhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (m_MemoryBudgetEnabled) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // Low-latency pacing waits for presents to reach the screen. Optional, the other modes never need it
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures {};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures {};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (!m_Spec.headless && hasDeviceExtension(m_PhysicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+        && hasDeviceExtension(m_PhysicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        VkPhysicalDeviceFeatures2 presentFeatures {};
+        presentFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        presentFeatures.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &presentFeatures);
+
+        m_PresentWaitEnabled = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+        if (m_PresentWaitEnabled) {
+            extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            features13.pNext = &presentIdFeatures;
+        }
+    }
+
+    // Pipeline variants link from shared, precompiled parts instead of compiling from scratch
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures {};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if (m_Spec.pipelineLibrary && hasDeviceExtension(m_PhysicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+        && hasDeviceExtension(m_PhysicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 libraryFeatures {};
+        libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        libraryFeatures.pNext = &pipelineLibraryFeatures;
+        vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &libraryFeatures);
+
+        m_PipelineLibraryEnabled = pipelineLibraryFeatures.graphicsPipelineLibrary;
+        if (m_PipelineLibraryEnabled) {
+            extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+            pipelineLibraryFeatures.pNext = features13.pNext;
+            features13.pNext = &pipelineLibraryFeatures;
+        }
+    }
 
     VkDeviceCreateInfo devCreateInfo {};
     devCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    devCreateInfo.pNext = &features12;
     devCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     devCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
     devCreateInfo.pEnabledFeatures = &deviceFeatures;
 
-    devCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
-    devCreateInfo.enabledExtensionCount = (u32)(deviceExtensions.size());
+    // Headless devices may not expose VK_KHR_swapchain at all, so it is only requested with a window
+    devCreateInfo.ppEnabledExtensionNames = extensions.data();
+    devCreateInfo.enabledExtensionCount = (u32)(extensions.size());
 
     if (enableValidationLayers) {
         devCreateInfo.enabledLayerCount = static_cast<u32>(validationLayers.size());
@@ -270,18 +425,22 @@ void Application::setupLogicalDevice()
         devCreateInfo.enabledLayerCount = 0;
     }
 
-    VkResult res = vkCreateDevice(m_PhysicalDevice, &devCreateInfo, nullptr, &m_LogicalDevice);
+    VkResult res = vkCreateDevice(m_PhysicalDevice, &devCreateInfo, VKP_ALLOCATION_CALLBACKS, &m_LogicalDevice);
     VKP_ASSERT(res == VK_SUCCESS, "Unable to create Logical Device");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_DEVICE, m_LogicalDevice, "Logical device");
 
-    vkGetDeviceQueue(m_LogicalDevice, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
-    vkGetDeviceQueue(m_LogicalDevice, indices.presentFamily.value(), 0, &m_PresentQueue);
+    vkGetDeviceQueue(m_LogicalDevice, m_Queues.graphicsFamily, 0, &m_GraphicsQueue);
+    vkGetDeviceQueue(m_LogicalDevice, m_Queues.transferFamily, 0, &m_TransferQueue);
+    if (!m_Spec.headless) {
+        vkGetDeviceQueue(m_LogicalDevice, m_Queues.presentFamily, 0, &m_PresentQueue);
+    }
 }
 
 void Application::createSwapChain()
 {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_PhysicalDevice, m_Surface);
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = choosePacingPresentMode(m_Pacer.getMode(), swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, m_NativeWindow);
 
     u32 imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -300,10 +459,9 @@ void Application::createSwapChain()
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     // createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT; // Use for rendering to a seperate texture before presenting
 
-    QueueFamilyIndices indices = findQueueFamilies(m_PhysicalDevice, m_Surface);
-    uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    uint32_t queueFamilyIndices[] = { m_Queues.graphicsFamily, m_Queues.presentFamily };
 
-    if (indices.graphicsFamily != indices.presentFamily) {
+    if (m_Queues.graphicsFamily != m_Queues.presentFamily) {
         createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
         createInfo.queueFamilyIndexCount = 2;
         createInfo.pQueueFamilyIndices = queueFamilyIndices;
@@ -319,291 +477,261 @@ void Application::createSwapChain()
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Handing over the old swapchain lets the driver reuse its resources and keep presenting meanwhile
+    createInfo.oldSwapchain = m_SwapChain;
 
-    VkResult res = vkCreateSwapchainKHR(m_LogicalDevice, &createInfo, nullptr, &m_SwapChain);
+    VkSwapchainKHR newSwapChain;
+    VkResult res = vkCreateSwapchainKHR(m_LogicalDevice, &createInfo, VKP_ALLOCATION_CALLBACKS, &newSwapChain);
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SWAPCHAIN");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SWAPCHAIN_KHR, newSwapChain, "Swapchain");
+    m_SwapChain = newSwapChain;
 
     vkGetSwapchainImagesKHR(m_LogicalDevice, m_SwapChain, &imageCount, nullptr);
     m_SwapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(m_LogicalDevice, m_SwapChain, &imageCount, m_SwapChainImages.data());
 
+    VKP_ASSERT(m_GraphicsPipeline == VK_NULL_HANDLE || surfaceFormat.format == m_SwapChainImageFormat, "SWAPCHAIN FORMAT CHANGED ON RECREATION");
     m_SwapChainImageFormat = surfaceFormat.format;
     m_SwapChainExtent = extent;
+    m_Width = extent.width;
+    m_Height = extent.height;
 }
 
-void Application::createImageViews()
+void Application::recreateSwapChain()
 {
-    m_SwapChainImageViews.resize(m_SwapChainImages.size());
-    for (u32 i = 0; i < m_SwapChainImageViews.size(); i++) {
-        VkImageViewCreateInfo createInfo {};
-        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.image = m_SwapChainImages[i];
-        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        createInfo.format = m_SwapChainImageFormat;
+    VKP_PROFILE_FUNCTION();
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_NativeWindow, &width, &height);
+    if (width == 0 || height == 0) {
+        // Minimized: a zero-sized swapchain is invalid, wait until the window is visible again
+        m_SwapChainPendingRecreate = true;
+        return;
+    }
+    m_SwapChainPendingRecreate = false;
+    m_FramebufferResized = false;
 
-        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    // The old swapchain and everything built on it go once the last frame that may reference it completes,
+    // so recreation never needs vkDeviceWaitIdle
+    VkSwapchainKHR oldSwapChain = m_SwapChain;
+    std::vector<VkImageView> oldImageViews = std::exchange(m_SwapChainImageViews, {});
+    std::vector<VkSemaphore> oldSemaphores = std::exchange(m_RenderFinishedSemaphores, {});
 
-        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        createInfo.subresourceRange.baseMipLevel = 0;
-        createInfo.subresourceRange.levelCount = 1;
-        createInfo.subresourceRange.baseArrayLayer = 0;
-        createInfo.subresourceRange.layerCount = 1;
+    createSwapChain();
+    createImageViews();
+    createRenderFinishedSemaphores();
+    m_Pacer.onSwapchainRecreated();
+
+    m_DeletionQueue.retire(
+        [this, oldSwapChain, oldImageViews, oldSemaphores]() {
+            for (VkImageView imageView : oldImageViews) {
+                VKP_UNTRACK(imageView);
+                vkDestroyImageView(m_LogicalDevice, imageView, VKP_ALLOCATION_CALLBACKS);
+            }
+            for (VkSemaphore semaphore : oldSemaphores) {
+                VKP_UNTRACK(semaphore);
+                vkDestroySemaphore(m_LogicalDevice, semaphore, VKP_ALLOCATION_CALLBACKS);
+            }
+            VKP_UNTRACK(oldSwapChain);
+            vkDestroySwapchainKHR(m_LogicalDevice, oldSwapChain, VKP_ALLOCATION_CALLBACKS);
+        },
+        m_FrameTimeline.getLastSubmitted());
+    m_SwapChainRecreations++;
+}
+
+void Application::createOffscreenTargets()
+{
+    // One target per frame slot so frames in flight never render into an image still being read
+    u32 imageCount = m_Spec.framesInFlight;
+    m_SwapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    m_SwapChainExtent = { m_Width, m_Height };
 
-        VkResult res = vkCreateImageView(m_LogicalDevice, &createInfo, nullptr, &m_SwapChainImageViews[i]);
-        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE IMAGE VIEW" + std::to_string(i));
+    m_SwapChainImages.resize(imageCount);
+    m_OffscreenImageAllocations.resize(imageCount);
+    for (u32 i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageInfo {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_SwapChainImageFormat;
+        imageInfo.extent = { m_SwapChainExtent.width, m_SwapChainExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkResult res = vkCreateImage(m_LogicalDevice, &imageInfo, VKP_ALLOCATION_CALLBACKS, &m_SwapChainImages[i]);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE OFFSCREEN IMAGE " + std::to_string(i));
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_IMAGE, m_SwapChainImages[i], "Offscreen target");
+
+        m_OffscreenImageAllocations[i] = m_Allocator.allocateForImage(m_SwapChainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VKP_ASSERT(m_OffscreenImageAllocations[i] != nullptr, "FAILED TO ALLOCATE OFFSCREEN IMAGE MEMORY " + std::to_string(i));
+    }
+}
+
+void Application::createImageViews()
+{
+    m_SwapChainImageViews.resize(m_SwapChainImages.size());
+    for (u32 i = 0; i < m_SwapChainImageViews.size(); i++) {
+        m_SwapChainImageViews[i] = createImageView2D(m_LogicalDevice, m_SwapChainImages[i], m_SwapChainImageFormat, 1, "Swapchain image view");
     }
 }
 
 void Application::createSurface()
 {
-    VkResult res = glfwCreateWindowSurface(m_Instance, m_NativeWindow, nullptr, &m_Surface);
+    VkResult res = glfwCreateWindowSurface(m_Instance, m_NativeWindow, VKP_ALLOCATION_CALLBACKS, &m_Surface);
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE WINDOW SURFACE");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SURFACE_KHR, m_Surface, "Window surface");
 }
 
 void Application::createGraphicsPipeline()
 {
-    auto vertexCode = readFile("shaders/vert.spv");
-    auto fragCode = readFile("shaders/frag.spv");
-
-    VkShaderModule vertModule = createShaderModule(vertexCode);
-    VkShaderModule fragModule = createShaderModule(fragCode);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo {};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertModule;
-    vertShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo {};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragModule;
-    fragShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-    static std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-
-    VkPipelineDynamicStateCreateInfo dynamicState {};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = (u32)dynamicStates.size();
-    dynamicState.pDynamicStates = dynamicStates.data();
-
-    VkPipelineVertexInputStateCreateInfo vInputInfo {};
-    vInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vInputInfo.vertexBindingDescriptionCount = 0;
-    vInputInfo.pVertexBindingDescriptions = nullptr;
-    vInputInfo.vertexAttributeDescriptionCount = 0;
-    vInputInfo.pVertexAttributeDescriptions = nullptr;
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    // VkViewport viewport {};
-    // viewport.x = 0.0f;
-    // viewport.y = 0.0f;
-    // viewport.width = (float)m_SwapChainExtent.width;
-    // viewport.height = (float)m_SwapChainExtent.height;
-    // viewport.minDepth = 0.0f;
-    // viewport.maxDepth = 1.0f;
-    //
-    // VkRect2D scissor {};
-    // scissor.offset = { 0, 0 };
-    // scissor.extent = m_SwapChainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer {};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f;
-    rasterizer.depthBiasClamp = 0.0f;
-    rasterizer.depthBiasSlopeFactor = 0.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisampling {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f;
-    multisampling.pSampleMask = nullptr;
-    multisampling.alphaToCoverageEnable = VK_FALSE;
-    multisampling.alphaToOneEnable = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending {};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-
     VkPipelineLayoutCreateInfo pipeCreateInfo {};
     pipeCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeCreateInfo.setLayoutCount = 0;
-    pipeCreateInfo.pSetLayouts = nullptr;
-    pipeCreateInfo.pushConstantRangeCount = 0;
-    pipeCreateInfo.pPushConstantRanges = nullptr;
-
-    VkResult res = vkCreatePipelineLayout(m_LogicalDevice, &pipeCreateInfo, nullptr, &m_PipelineLayout);
+    // Everything the shaders read comes through the bindless set, draws only push indices and
+    // the mesh dequantization
+    VkDescriptorSetLayout setLayout = m_Bindless.getSetLayout();
+    // Reflected by the build, only the vertex stage reads push constants
+    VkPushConstantRange pushRange = Shaders::shaderVert.pushConstants;
+    VKP_ASSERT(pushRange.offset == 0 && pushRange.size == sizeof(DrawConstants), "DRAW CONSTANTS DO NOT MATCH shaderVert.glsl");
+    VKP_ASSERT(Shaders::shaderFrag.pushConstants.size == 0, "shaderFrag.glsl MAY NOT USE PUSH CONSTANTS");
+    pipeCreateInfo.setLayoutCount = 1;
+    pipeCreateInfo.pSetLayouts = &setLayout;
+    pipeCreateInfo.pushConstantRangeCount = 1;
+    pipeCreateInfo.pPushConstantRanges = &pushRange;
+
+    VkResult res = vkCreatePipelineLayout(m_LogicalDevice, &pipeCreateInfo, VKP_ALLOCATION_CALLBACKS, &m_PipelineLayout);
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE PIPELINE");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE_LAYOUT, m_PipelineLayout, "Main pipeline layout");
+
+    VkShaderModule vertModule = m_ShaderLibrary.load(Shaders::shaderVert);
+    VkShaderModule fragModule = m_ShaderLibrary.load(Shaders::shaderFrag);
+
+    m_Pipelines.init(m_LogicalDevice, m_PipelineCache.getHandle(), m_PipelineLibraryEnabled);
+    m_MainPipelineKey.program = m_Pipelines.registerProgram(vertModule, fragModule, m_PipelineLayout);
+    m_MainPipelineKey.colorFormat = m_SwapChainImageFormat;
+
+    // Every variant the frame may ask for is built up front, in parallel, so none of them
+    // stalls a frame on first use. The main pass comes first, the rest are debug views
+    std::vector<PipelineKey> variants = { m_MainPipelineKey };
+    for (BlendMode blend : { BlendMode::Opaque, BlendMode::Alpha, BlendMode::Additive, BlendMode::Premultiplied }) {
+        for (VkCullModeFlags cullMode : { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_NONE }) {
+            PipelineKey variant = m_MainPipelineKey;
+            variant.blend = blend;
+            variant.cullMode = (u8)cullMode;
+            if (!(variant == m_MainPipelineKey)) {
+                variants.push_back(variant);
+            }
+        }
+    }
 
-    VkGraphicsPipelineCreateInfo pInfo {};
-    pInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pInfo.stageCount = 2;
-    pInfo.pStages = shaderStages;
-    pInfo.pVertexInputState = &vInputInfo;
-    pInfo.pInputAssemblyState = &inputAssembly;
-    pInfo.pViewportState = &viewportState;
-    pInfo.pRasterizationState = &rasterizer;
-    pInfo.pMultisampleState = &multisampling;
-    pInfo.pDepthStencilState = nullptr;
-    pInfo.pColorBlendState = &colorBlending;
-    pInfo.pDynamicState = &dynamicState;
-    pInfo.layout = m_PipelineLayout;
-    pInfo.renderPass = m_RenderPass;
-    pInfo.subpass = 0;
-    pInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pInfo.basePipelineIndex = -1;
-
-    res = vkCreateGraphicsPipelines(m_LogicalDevice, VK_NULL_HANDLE, 1, &pInfo, nullptr, &m_GraphicsPipeline);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE GRAPHICS PIPELINE");
-
-    vkDestroyShaderModule(m_LogicalDevice, fragModule, nullptr);
-    vkDestroyShaderModule(m_LogicalDevice, vertModule, nullptr);
+    BenchTimer pipelineTimer;
+    m_Pipelines.prewarm(variants);
+    m_GraphicsPipeline = m_Pipelines.get(m_MainPipelineKey);
+    VKP_ASSERT(m_GraphicsPipeline != VK_NULL_HANDLE, "FAILED TO CREATE GRAPHICS PIPELINE");
+    VKP_INFO("Graphics pipelines created in {:.3f}ms ({} pipeline cache)", pipelineTimer.elapsedMs(), m_PipelineCache.isWarm() ? "warm" : "cold");
 }
 
-VkShaderModule Application::createShaderModule(std::vector<char>& shaderCode)
+void Application::setupShaderHotReload()
 {
-    VkShaderModuleCreateInfo createInfo {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = shaderCode.size();
-    createInfo.pCode = reinterpret_cast<const u32*>(shaderCode.data());
+    // Watches the sources in the source tree, the build embeds them again on the next compile
+    const std::string directory = VKP_SHADER_SOURCE_DIR;
+    m_ShaderReload.init(m_LogicalDevice, directory);
+    if (!m_ShaderReload.isActive()) {
+        return;
+    }
 
-    VkShaderModule shaderModule;
-    VkResult res = vkCreateShaderModule(m_LogicalDevice, &createInfo, nullptr, &shaderModule);
-    VKP_ASSERT(res == VK_SUCCESS, "UNABLE TO CREATE SHADER MODULE");
-    return shaderModule;
+    // The old pipeline may still be in use by frames in flight, it goes once they retire
+    m_ShaderReload.watchPipeline("graphics",
+        { { directory + "/shaderVert.glsl", VK_SHADER_STAGE_VERTEX_BIT }, { directory + "/shaderFrag.glsl", VK_SHADER_STAGE_FRAGMENT_BIT } },
+        [this](const std::vector<VkShaderModule>& modules) { return m_Pipelines.createStandalone(m_MainPipelineKey, modules[0], modules[1]); },
+        [this](VkPipeline pipeline) {
+            // The prewarmed pipeline belongs to the registry, only earlier reloads are ours to retire
+            if (m_GraphicsPipeline != m_Pipelines.get(m_MainPipelineKey)) {
+                m_DeletionQueue.retirePipeline(m_GraphicsPipeline, m_FrameTimeline.getLastSubmitted());
+            }
+            m_GraphicsPipeline = pipeline;
+        });
+    if (m_Spec.gpuCulling) {
+        m_ShaderReload.watchPipeline("culling", { { directory + "/shaderCull.glsl", VK_SHADER_STAGE_COMPUTE_BIT } },
+            [this](const std::vector<VkShaderModule>& modules) { return m_Culling.buildPipeline(modules[0], m_PipelineCache.getHandle()); },
+            [this](VkPipeline pipeline) { m_DeletionQueue.retirePipeline(m_Culling.swapPipeline(pipeline), m_FrameTimeline.getLastSubmitted()); });
+    }
 }
 
-void Application::createRenderPass()
+void Application::createCommandPools()
 {
-    VkAttachmentDescription colorAttachment {};
-    colorAttachment.format = m_SwapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkRenderPassCreateInfo rpInfo {};
-    rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    rpInfo.attachmentCount = 1;
-    rpInfo.pAttachments = &colorAttachment;
-    rpInfo.subpassCount = 1;
-    rpInfo.pSubpasses = &subpass;
-
-    VkSubpassDependency dependency {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    rpInfo.dependencyCount = 1;
-    rpInfo.pDependencies = &dependency;
-
-    VkResult res = vkCreateRenderPass(m_LogicalDevice, &rpInfo, nullptr, &m_RenderPass);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE RENDERPASS");
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // Each frame resets its whole pool, so individual buffer resets are never needed
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_Queues.graphicsFamily;
+
+    m_Frames.resize(m_Spec.framesInFlight);
+    for (u32 i = 0; i < m_Frames.size(); i++) {
+        VkResult res = vkCreateCommandPool(m_LogicalDevice, &poolInfo, VKP_ALLOCATION_CALLBACKS, &m_Frames[i].commandPool);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE COMMAND POOL " + std::to_string(i));
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_COMMAND_POOL, m_Frames[i].commandPool, "Frame command pool");
+    }
+    m_Recorder.init(m_LogicalDevice, m_Queues.graphicsFamily, m_Spec.framesInFlight);
 }
 
-void Application::createFrameBuffers()
+void Application::createCommandBuffers()
 {
-    m_SwapChainFramebuffers.resize(m_SwapChainImageViews.size());
-    for (size_t i = 0; i < m_SwapChainImageViews.size(); i++) {
-        VkImageView attachments[] = { m_SwapChainImageViews[i] };
-
-        VkFramebufferCreateInfo framebufferInfo {};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = m_RenderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_SwapChainExtent.width;
-        framebufferInfo.height = m_SwapChainExtent.height;
-        framebufferInfo.layers = 1;
-
-        VkResult res = vkCreateFramebuffer(m_LogicalDevice, &framebufferInfo, nullptr, &m_SwapChainFramebuffers[i]);
-        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE FRAMEBUFFER " + std::to_string(i));
-    };
+    for (u32 i = 0; i < m_Frames.size(); i++) {
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_Frames[i].commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult res = vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, &m_Frames[i].commandBuffer);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE COMMAND BUFFER " + std::to_string(i));
+    }
 }
 
-void Application::createCommandPool()
+void Application::createScene()
 {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_PhysicalDevice, m_Surface);
+    m_Instances.init(m_LogicalDevice, m_Allocator, m_Bindless, m_Spec.framesInFlight, std::max(1u, m_Spec.instanceCount));
+
+    bool meshLoaded = false;
+    if (!m_Spec.meshPackPath.empty()) {
+        MeshPack pack;
+        if (pack.open(m_Spec.meshPackPath)) {
+            u32 index = m_Spec.meshName.empty() ? 0 : pack.findMesh(m_Spec.meshName);
+            if (index < pack.getMeshCount()) {
+                pack.createMesh(index, m_Allocator, m_UploadQueue, m_Mesh);
+                meshLoaded = true;
+            } else {
+                VKP_ERROR("Mesh pack {} has no mesh '{}'", m_Spec.meshPackPath, m_Spec.meshName);
+            }
+        }
+        if (!meshLoaded) {
+            VKP_WARN("Falling back to the built-in triangle");
+        }
+    }
 
-    VkCommandPoolCreateInfo poolInfo {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    if (!meshLoaded) {
+        const std::vector<Vertex> vertices = {
+            { { 0.0f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+            { { 0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+            { { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        };
+        const std::vector<u32> indices = { 0, 1, 2 };
+        m_Mesh.create(m_Allocator, m_UploadQueue, vertices, indices);
+    }
 
-    VkResult res = vkCreateCommandPool(m_LogicalDevice, &poolInfo, nullptr, &m_CommandPool);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE COMMAND POOL");
+    // Load time, the first frame should already have geometry
+    m_UploadQueue.waitIdle();
 }
-void Application::createCommandBuffer()
-{
-    VkCommandBufferAllocateInfo allocInfo {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_CommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
 
-    VkResult res = vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, &m_CommandBuffer);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE COMMAND BUFFER");
+void Application::updateInstances()
+{
+    m_Instances.beginFrame(m_CurrentFrame);
+    InstanceData* instances = m_Instances.allocate(m_Spec.instanceCount, m_FirstInstance);
+    fillInstanceGrid(instances, m_Spec.instanceCount, m_Spec.sceneExtent);
 }
 
 void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageIndex)
@@ -615,21 +743,40 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageIn
 
     VkResult res = vkBeginCommandBuffer(commandBuffer, &beginInfo);
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO BEGIN RECORDING COMMAND BUFFER");
+    VKP_PROFILE_GPU_FRAME_BEGIN(commandBuffer, m_CurrentFrame);
+    m_Pacer.writeFrameBegin(commandBuffer);
+
+    m_UploadWaitValue = m_UploadQueue.recordAcquires(commandBuffer);
+    const bool meshResident = m_Mesh.isResident(m_UploadQueue);
+    const bool culling = m_Spec.gpuCulling && meshResident;
+
+    m_RenderGraph.reset(m_CurrentFrame);
+
+    // The acquire semaphore is waited at the color attachment stage, offscreen targets are free once the slot's fence signaled
+    RGImportState backbufferState {};
+    backbufferState.stages = m_Spec.headless ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // Offscreen targets are only ever consumed by readback copies
+    RGResource backbuffer = m_RenderGraph.importImage("Backbuffer", m_SwapChainImages[imageIndex], m_SwapChainImageViews[imageIndex],
+        { m_SwapChainImageFormat, m_SwapChainExtent }, backbufferState,
+        m_Spec.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    RGResource cullDraws = 0;
+    RGResource cullCount = 0;
+    if (culling) {
+        cullDraws = m_RenderGraph.importBuffer("CullDraws", m_Culling.getDrawBuffer(), false);
+        cullCount = m_RenderGraph.importBuffer("CullCount", m_Culling.getCountBuffer(), false);
+        m_RenderGraph.addPass("Cull")
+            .write(cullCount, RGUsage::TransferDst)
+            .write(cullCount, RGUsage::StorageWriteCompute)
+            .write(cullDraws, RGUsage::StorageWriteCompute)
+            .execute([&](const RGPassContext& ctx) {
+                // The test scene is authored directly in clip space
+                m_Culling.recordCull(ctx.commandBuffer, glm::mat4(1.0f), m_Mesh.getBoundingSphere(), m_FirstInstance, m_Spec.instanceCount,
+                    m_Mesh.getIndexCount());
+            });
+    }
 
-    VkRenderPassBeginInfo renderPassInfo {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_RenderPass;
-    renderPassInfo.framebuffer = m_SwapChainFramebuffers[imageIndex];
-
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = m_SwapChainExtent;
-
-    VkClearValue clearColor = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+    // Dynamic state is not inherited, every secondary sets its own
     VkViewport viewport {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -637,14 +784,47 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageIn
     viewport.height = static_cast<float>(m_SwapChainExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     VkRect2D scissor = {};
     scissor.offset = { 0, 0 };
-    scissor.extent = { m_Width, m_Height };
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    scissor.extent = m_SwapChainExtent;
 
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-    vkCmdEndRenderPass(commandBuffer);
+    RGPassBuilder mainPass = m_RenderGraph.addPass("MainPass");
+    mainPass.color(backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } }).secondaryCommandBuffers();
+    if (culling) {
+        mainPass.read(cullDraws, RGUsage::IndirectRead).read(cullCount, RGUsage::IndirectRead);
+    }
+    mainPass.execute([&](const RGPassContext& ctx) {
+        // Direct draws split the instances into chunks, each drawing its range with one instanced draw.
+        // The culling pass writes a single indirect draw, which goes out as one chunk
+        const u32 itemCount = !meshResident ? 0 : m_Spec.gpuCulling ? 1 : m_Spec.instanceCount;
+        m_Recorder.record(ctx.commandBuffer, *ctx.inheritance, itemCount, m_Spec.instancesPerChunk,
+            [&](VkCommandBuffer secondary, u32 first, u32 count) {
+                vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+                vkCmdSetViewport(secondary, 0, 1, &viewport);
+                vkCmdSetScissor(secondary, 0, 1, &scissor);
+                m_Instances.bind(secondary, m_PipelineLayout);
+                if (m_Spec.gpuCulling) {
+                    m_Mesh.bind(secondary, m_PipelineLayout);
+                    m_Culling.recordDraw(secondary);
+                } else {
+                    m_Instances.draw(secondary, m_PipelineLayout, m_Mesh, m_FirstInstance + first, count);
+                }
+            });
+    });
+
+    if (culling) {
+        // Only kept when someone looks at the counts, the graph culls it otherwise
+        RGResource readback = m_RenderGraph.importBuffer("CullReadback", m_Culling.getReadbackBuffer(), m_Spec.cullStats);
+        m_RenderGraph.addPass("CullStats")
+            .read(cullCount, RGUsage::TransferSrc)
+            .write(readback, RGUsage::TransferDst)
+            .execute([&](const RGPassContext& ctx) { m_Culling.recordStatsReadback(ctx.commandBuffer); });
+    }
+
+    m_RenderGraph.compile();
+    m_RenderGraph.execute(commandBuffer);
+    m_Pacer.writeFrameEnd(commandBuffer);
+    VKP_PROFILE_GPU_FRAME_END(commandBuffer);
 
     res = vkEndCommandBuffer(commandBuffer);
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO END FRAMEBUFFER");
@@ -655,53 +835,135 @@ void Application::createSynchObjects()
     VkSemaphoreCreateInfo semaphoreInfo {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for (FrameContext& frame : m_Frames) {
+        VkResult res = vkCreateSemaphore(m_LogicalDevice, &semaphoreInfo, VKP_ALLOCATION_CALLBACKS, &frame.imageAvailableSemaphore);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SYNCH OBJECT");
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SEMAPHORE, frame.imageAvailableSemaphore, "Image available");
+    }
 
-    VkResult res = vkCreateSemaphore(m_LogicalDevice, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphore);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SYNCH OBJECT");
-    res = vkCreateSemaphore(m_LogicalDevice, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphore);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SYNCH OBJECT");
+    if (!m_Spec.headless) {
+        createRenderFinishedSemaphores();
+    }
+}
+
+void Application::createRenderFinishedSemaphores()
+{
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    res = vkCreateFence(m_LogicalDevice, &fenceInfo, nullptr, &m_InFlightFence);
-    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SYNCH OBJECT");
+    m_RenderFinishedSemaphores.resize(m_SwapChainImages.size());
+    for (VkSemaphore& semaphore : m_RenderFinishedSemaphores) {
+        VkResult res = vkCreateSemaphore(m_LogicalDevice, &semaphoreInfo, VKP_ALLOCATION_CALLBACKS, &semaphore);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE SYNCH OBJECT");
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SEMAPHORE, semaphore, "Render finished");
+    }
 }
 
 void Application::drawFrame()
 {
-    vkWaitForFences(m_LogicalDevice, 1, &m_InFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_LogicalDevice, 1, &m_InFlightFence);
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_LogicalDevice, m_SwapChain, UINT64_MAX, m_ImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    VKP_PROFILE_FRAME();
+    FrameContext& frame = m_Frames[m_CurrentFrame];
+
+    m_Pacer.throttle(m_SwapChain);
+
+    // Only blocks if the GPU is still framesInFlight frames behind
+    BenchTimer waitTimer;
+    m_FrameTimeline.wait(frame.submitValue);
+    m_Pacer.addCpuWait(waitTimer.elapsedMs());
+    m_Pacer.beginFrame(m_CurrentFrame);
+    m_DeletionQueue.collect(m_FrameTimeline.getCompleted());
+    // Rebuilt pipelines only come in here, between frames, never while commands are recorded
+    m_ShaderReload.poll();
+
+    if (m_Spec.gpuCulling) {
+        m_Culling.beginFrame(m_CurrentFrame, m_FrameNumber);
+        const GpuCulling::Stats& stats = m_Culling.getLastStats();
+        if (m_Spec.cullStats && stats.valid && m_FrameNumber % 60 == 0) {
+            VKP_INFO("Culling (frame {}): {} tested, {} drawn, {} culled", stats.frame, stats.tested, stats.drawn, stats.tested - stats.drawn);
+        }
+    }
 
-    vkResetCommandBuffer(m_CommandBuffer, 0);
+    uint32_t imageIndex = m_CurrentFrame;
+    if (!m_Spec.headless) {
+        VKP_PROFILE_SCOPE("Acquire");
+        BenchTimer acquireTimer;
+        VkResult acquireRes = vkAcquireNextImageKHR(m_LogicalDevice, m_SwapChain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        m_Pacer.addCpuWait(acquireTimer.elapsedMs());
+        if (acquireRes == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Nothing was submitted for this slot, so retrying with it next frame cannot deadlock
+            recreateSwapChain();
+            return;
+        }
+        // Suboptimal images are still presentable, recreation happens after present
+        VKP_ASSERT(acquireRes == VK_SUCCESS || acquireRes == VK_SUBOPTIMAL_KHR, "FAILED TO ACQUIRE SWAPCHAIN IMAGE");
+    }
 
-    recordCommandBuffer(m_CommandBuffer, imageIndex);
+    {
+        VKP_PROFILE_SCOPE("StreamTextures");
+        // No material system yet: every texture is treated as covering the whole view
+        const u32 viewPixels = std::max(m_SwapChainExtent.width, m_SwapChainExtent.height);
+        for (TextureHandle texture : m_TextureHandles) {
+            m_Textures.requestResolution(texture, viewPixels);
+        }
+        m_Textures.update();
+    }
 
-    VkSubmitInfo submitInfo {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    {
+        VKP_PROFILE_SCOPE("FlushUploads");
+        m_UploadQueue.flush();
+    }
 
-    VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_CommandBuffer;
+    vkResetCommandPool(m_LogicalDevice, frame.commandPool, 0);
+    m_Recorder.beginFrame(m_CurrentFrame);
+    m_FrameDescriptors.beginFrame(m_CurrentFrame);
+    m_Bindless.beginFrame(m_CurrentFrame);
+    {
+        VKP_PROFILE_SCOPE("UpdateInstances");
+        updateInstances();
+    }
 
-    VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphore };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    {
+        VKP_PROFILE_SCOPE("RecordCommandBuffer");
+        recordCommandBuffer(frame.commandBuffer, imageIndex);
+    }
 
-    VkResult res = vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_InFlightFence);
+    // Binary acquire semaphore first, then the upload timeline when this frame consumed uploads
+    SubmitBatch submit;
+    if (!m_Spec.headless) {
+        submit.wait(frame.imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+    if (m_UploadWaitValue > 0) {
+        submit.wait(m_UploadQueue.getTimelineSemaphore(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, m_UploadWaitValue);
+    }
+
+    // The frame timeline always, plus the binary semaphore present waits on
+    frame.submitValue = m_FrameTimeline.advance();
+    submit.signal(m_FrameTimeline.getSemaphore(), frame.submitValue);
+    if (!m_Spec.headless) {
+        submit.signal(m_RenderFinishedSemaphores[imageIndex]);
+    }
+    submit.commandBuffer(frame.commandBuffer);
+
+    VkResult res;
+    {
+        VKP_PROFILE_SCOPE("Submit");
+        res = submit.submit(m_GraphicsQueue);
+    }
     VKP_ASSERT(res == VK_SUCCESS, "FAILED TO SUBMIT QUEUE");
 
+    m_LastImageIndex = imageIndex;
+    m_CurrentFrame = (m_CurrentFrame + 1) % (u32)m_Frames.size();
+    m_FrameNumber++;
+    if (m_Spec.headless) {
+        m_Pacer.endFrame(false);
+        return;
+    }
+
     VkPresentInfoKHR presentInfo {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &m_RenderFinishedSemaphores[imageIndex];
 
     VkSwapchainKHR swapChains[] = { m_SwapChain };
     presentInfo.swapchainCount = 1;
@@ -710,50 +972,342 @@ void Application::drawFrame()
 
     presentInfo.pResults = nullptr;
 
-    vkQueuePresentKHR(m_PresentQueue, &presentInfo);
+    // Lets the pacer wait for this image to reach the screen
+    VkPresentIdKHR presentId {};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    u64 presentIdValue = m_Pacer.nextPresentId();
+    if (presentIdValue != 0) {
+        presentId.swapchainCount = 1;
+        presentId.pPresentIds = &presentIdValue;
+        presentInfo.pNext = &presentId;
+    }
+
+    VkResult presentRes;
+    {
+        VKP_PROFILE_SCOPE("Present");
+        presentRes = vkQueuePresentKHR(m_PresentQueue, &presentInfo);
+    }
+    m_Pacer.endFrame(true);
+    if (presentRes == VK_ERROR_OUT_OF_DATE_KHR || presentRes == VK_SUBOPTIMAL_KHR || m_FramebufferResized) {
+        recreateSwapChain();
+    } else {
+        VKP_ASSERT(presentRes == VK_SUCCESS, "FAILED TO PRESENT SWAPCHAIN IMAGE");
+    }
+}
+
+void Application::readbackImage(u32 imageIndex, std::vector<u8>& pixels)
+{
+    VkDeviceSize size = (VkDeviceSize)m_SwapChainExtent.width * m_SwapChainExtent.height * 4;
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    Allocation* staging = m_Allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Readback staging");
+    VKP_ASSERT(staging != nullptr, "FAILED TO CREATE READBACK BUFFER");
+
+    // The device is idle here, so any frame's pool can be borrowed for the copy
+    FrameContext& frame = m_Frames[0];
+    vkResetCommandPool(m_LogicalDevice, frame.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+    // Make the render pass color writes visible to the transfer stage
+    VkImageMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_SwapChainImages[imageIndex];
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { m_SwapChainExtent.width, m_SwapChainExtent.height, 1 };
+    vkCmdCopyImageToBuffer(frame.commandBuffer, m_SwapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging->buffer, 1, &region);
+
+    VkResult res = vkEndCommandBuffer(frame.commandBuffer);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO END READBACK COMMAND BUFFER");
+
+    u64 readbackValue = m_FrameTimeline.advance();
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &readbackValue;
+
+    VkSemaphore timeline = m_FrameTimeline.getSemaphore();
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+
+    res = vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO SUBMIT READBACK");
+    m_FrameTimeline.wait(readbackValue);
+    frame.submitValue = readbackValue;
+
+    pixels.resize(size);
+    memcpy(pixels.data(), staging->mapped, size);
+
+    m_Allocator.destroyBuffer(staging);
+}
+
+void Application::runMicroBenchmark(const std::string& name)
+{
+    // One regular frame first, so load-time uploads are acquired by the graphics queue
+    drawFrame();
+    vkDeviceWaitIdle(m_LogicalDevice);
+
+    BenchContext context;
+    context.physicalDevice = m_PhysicalDevice;
+    context.device = m_LogicalDevice;
+    context.graphicsQueue = m_GraphicsQueue;
+    context.graphicsFamily = m_Queues.graphicsFamily;
+    context.colorImage = m_SwapChainImages[0];
+    context.colorView = m_SwapChainImageViews[0];
+    context.colorFormat = m_SwapChainImageFormat;
+    context.colorLayout = m_Spec.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    context.pipeline = m_GraphicsPipeline;
+    context.pipelineLayout = m_PipelineLayout;
+    context.vertexShader = m_ShaderLibrary.load(Shaders::shaderVert);
+    context.fragmentShader = m_ShaderLibrary.load(Shaders::shaderFrag);
+    context.pipelineLibrary = m_PipelineLibraryEnabled;
+    context.allocator = &m_Allocator;
+    context.bindless = &m_Bindless;
+    context.mesh = &m_Mesh;
+    context.extent = m_SwapChainExtent;
+
+    if (name == "jobs") {
+        runJobSystemBench(context);
+    } else if (name == "instancing") {
+        runInstancingBench(context);
+    } else if (name == "pipelines") {
+        runPipelineBench(context);
+    } else {
+        VKP_ERROR("Unknown micro benchmark '{}'", name);
+    }
+    vkDeviceWaitIdle(m_LogicalDevice);
+}
+
+void Application::writeReadbackImage(const std::string& path)
+{
+    if (!m_Spec.headless) {
+        VKP_WARN("Readback is only supported in headless mode, skipping '{}'", path);
+        return;
+    }
+
+    readbackImage(m_LastImageIndex, m_ReadbackPixels);
+
+    // Binary PPM: trivial to diff against golden images without an image library
+    std::ofstream file(path, std::ios::binary);
+    VKP_ASSERT(file.is_open(), "UNABLE TO OPEN FILE " + path);
+    file << "P6\n"
+         << m_SwapChainExtent.width << " " << m_SwapChainExtent.height << "\n255\n";
+    for (size_t i = 0; i < m_ReadbackPixels.size(); i += 4) {
+        file.write(reinterpret_cast<const char*>(&m_ReadbackPixels[i]), 3);
+    }
+    VKP_INFO("Wrote {}x{} readback to {}", m_SwapChainExtent.width, m_SwapChainExtent.height, path);
 }
 
 void Application::mainLoop()
 {
+    const bool stressingResize = m_Spec.resizeStressFrames > 0 && !m_Spec.headless;
+    if (stressingResize && m_Spec.benchmarkFrames == 0) {
+        m_Spec.benchmarkFrames = m_Spec.resizeStressFrames;
+    }
+    const bool benchmarking = m_Spec.benchmarkFrames > 0;
+    // Let the ring fill and the driver settle before sampling
+    const u32 warmupFrames = benchmarking ? std::max(m_Spec.benchmarkFrames / 10, 16u) : 0;
+    u32 frameCount = 0;
+    if (benchmarking) {
+        m_FrameTimes.reserve(m_Spec.benchmarkFrames);
+    }
+
+    u32 renderedFrames = 0;
+    BenchTimer frameTimer;
+    u64 resizeSeed = 0x9e3779b97f4a7c15ull;
     while (m_Running) {
-        glfwPollEvents();
+        if (!m_Spec.headless) {
+            glfwPollEvents();
+            if (glfwWindowShouldClose(m_NativeWindow)) {
+                stopEngine();
+                continue;
+            }
+        }
+        if (m_SwapChainPendingRecreate) {
+            // Minimized: sleep until the window changes instead of spinning
+            glfwWaitEvents();
+            recreateSwapChain();
+            frameTimer.reset();
+            continue;
+        }
+
+        // Cycle through pseudo-random sizes so every recreation path gets exercised
+        if (stressingResize && frameCount % 8 == 0) {
+            resizeSeed = resizeSeed * 6364136223846793005ull + 1442695040888963407ull;
+            int width = 320 + (int)((resizeSeed >> 33) % 1280);
+            int height = 240 + (int)((resizeSeed >> 17) % 720);
+            glfwSetWindowSize(m_NativeWindow, width, height);
+        }
+
         drawFrame();
-        if (glfwGetKey(m_NativeWindow, GLFW_KEY_ESCAPE)) {
+        if (!m_Spec.headless && glfwGetKey(m_NativeWindow, GLFW_KEY_ESCAPE)) {
             stopEngine();
         }
+        if (m_Spec.frameLimit > 0 && ++renderedFrames >= m_Spec.frameLimit) {
+            stopEngine();
+        }
+        if (m_Spec.pacingStats && m_FrameNumber % PACING_REPORT_FRAMES == 0) {
+            m_Pacer.logReport(fmt::format("last {} frames", PACING_REPORT_FRAMES));
+        }
+
+        if (benchmarking) {
+            f64 frameMs = frameTimer.elapsedMs();
+            frameTimer.reset();
+            if (++frameCount > warmupFrames) {
+                m_FrameTimes.push_back(frameMs);
+            }
+            if (m_FrameTimes.size() >= m_Spec.benchmarkFrames) {
+                stopEngine();
+            }
+        }
     }
     vkDeviceWaitIdle(m_LogicalDevice);
+
+    if (benchmarking) {
+        m_FrameTimeSummary = summarizeSamples(m_FrameTimes);
+        logBenchSummary("frame time (frames in flight = " + std::to_string(m_Frames.size()) + ")", m_FrameTimeSummary);
+        m_Pacer.logReport("benchmark");
+    }
+
+    if (stressingResize) {
+        // A hitch is a frame over twice the median. Recreation may cost one such frame, never a run of them
+        const f64 hitchThreshold = m_FrameTimeSummary.p50 * 2.0;
+        u32 longestRun = 0, run = 0, hitches = 0;
+        for (f64 frameMs : m_FrameTimes) {
+            run = frameMs > hitchThreshold ? run + 1 : 0;
+            hitches += frameMs > hitchThreshold ? 1 : 0;
+            longestRun = std::max(longestRun, run);
+        }
+        VKP_INFO("[BENCH] resize stress: {} recreations, {} hitch frames (> {:.3f}ms), longest hitch {} frame(s), max {:.3f}ms: {}",
+            m_SwapChainRecreations, hitches, hitchThreshold, longestRun, m_FrameTimeSummary.max, longestRun <= 1 ? "PASS" : "FAIL");
+    }
 }
 
 void Application::cleanup()
 {
-    vkDestroySemaphore(m_LogicalDevice, m_ImageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(m_LogicalDevice, m_RenderFinishedSemaphore, nullptr);
-    vkDestroyFence(m_LogicalDevice, m_InFlightFence, nullptr);
-    vkDestroyCommandPool(m_LogicalDevice, m_CommandPool, nullptr);
-    for (auto framebuffer : m_SwapChainFramebuffers) {
-        vkDestroyFramebuffer(m_LogicalDevice, framebuffer, nullptr);
+    VKP_PROFILE_GPU_SHUTDOWN();
+    VKP_PROFILE_LOG_SUMMARY();
+    // Taken before anything is destroyed, so the snapshot shows everything a running frame holds
+    if (!m_Spec.resourceSnapshotPath.empty()) {
+        VKP_TRACK_SNAPSHOT(m_Spec.resourceSnapshotPath);
+    }
+    VKP_TRACK_LOG_SUMMARY();
+
+    // The watcher thread builds with the device and pipeline cache, stop it before anything goes
+    m_ShaderReload.destroy();
+    // Everything submitted has completed, whatever is still queued for deletion can go
+    m_FrameTimeline.wait(m_FrameTimeline.getLastSubmitted());
+    m_Textures.logStats();
+    m_Textures.destroy();
+    m_DeletionQueue.destroy();
+
+    for (FrameContext& frame : m_Frames) {
+        VKP_UNTRACK(frame.imageAvailableSemaphore);
+        vkDestroySemaphore(m_LogicalDevice, frame.imageAvailableSemaphore, VKP_ALLOCATION_CALLBACKS);
+        VKP_UNTRACK(frame.commandPool);
+        vkDestroyCommandPool(m_LogicalDevice, frame.commandPool, VKP_ALLOCATION_CALLBACKS);
     }
-    vkDestroyPipeline(m_LogicalDevice, m_GraphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(m_LogicalDevice, m_PipelineLayout, nullptr);
-    vkDestroyRenderPass(m_LogicalDevice, m_RenderPass, nullptr);
+    m_Frames.clear();
+    m_Recorder.destroy();
+    for (VkSemaphore semaphore : m_RenderFinishedSemaphores) {
+        VKP_UNTRACK(semaphore);
+        vkDestroySemaphore(m_LogicalDevice, semaphore, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_RenderFinishedSemaphores.clear();
+    if (m_GraphicsPipeline != m_Pipelines.get(m_MainPipelineKey)) {
+        VKP_UNTRACK(m_GraphicsPipeline);
+        vkDestroyPipeline(m_LogicalDevice, m_GraphicsPipeline, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_Pipelines.logStats();
+    m_Pipelines.destroy();
+    m_PipelineCache.save();
+    m_PipelineCache.destroy();
+    m_ShaderLibrary.destroy();
+    VKP_UNTRACK(m_PipelineLayout);
+    vkDestroyPipelineLayout(m_LogicalDevice, m_PipelineLayout, VKP_ALLOCATION_CALLBACKS);
+    m_RenderGraph.destroy();
     for (auto imageView : m_SwapChainImageViews) {
-        vkDestroyImageView(m_LogicalDevice, imageView, nullptr);
+        VKP_UNTRACK(imageView);
+        vkDestroyImageView(m_LogicalDevice, imageView, VKP_ALLOCATION_CALLBACKS);
     }
 
-    vkDestroySwapchainKHR(m_LogicalDevice, m_SwapChain, nullptr);
+    if (m_Spec.headless) {
+        for (u32 i = 0; i < m_SwapChainImages.size(); i++) {
+            VKP_UNTRACK(m_SwapChainImages[i]);
+            vkDestroyImage(m_LogicalDevice, m_SwapChainImages[i], VKP_ALLOCATION_CALLBACKS);
+            m_Allocator.free(m_OffscreenImageAllocations[i]);
+        }
+        m_OffscreenImageAllocations.clear();
+    } else {
+        VKP_UNTRACK(m_SwapChain);
+        vkDestroySwapchainKHR(m_LogicalDevice, m_SwapChain, VKP_ALLOCATION_CALLBACKS);
+    }
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
     }
 
-    vkDestroyDevice(m_LogicalDevice, nullptr);
-
-    vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+    if (m_Spec.gpuCulling) {
+        m_Culling.destroy();
+    }
+    m_Mesh.destroy();
+    m_Instances.destroy();
+    m_Bindless.destroy();
+    m_FrameDescriptors.destroy();
+    m_DescriptorLayouts.destroy();
+    m_UploadQueue.destroy();
+    m_Pacer.destroy();
+    m_FrameTimeline.destroy();
+    m_Allocator.logStats();
+    m_Allocator.destroy();
+
+    VKP_UNTRACK(m_LogicalDevice);
+    vkDestroyDevice(m_LogicalDevice, VKP_ALLOCATION_CALLBACKS);
+
+    if (m_Surface != VK_NULL_HANDLE) {
+        VKP_UNTRACK(m_Surface);
+        vkDestroySurfaceKHR(m_Instance, m_Surface, VKP_ALLOCATION_CALLBACKS);
+    }
 
-    vkDestroyInstance(m_Instance, nullptr);
+    VKP_UNTRACK(m_Instance);
+    vkDestroyInstance(m_Instance, VKP_ALLOCATION_CALLBACKS);
+    // Anything still tracked here was never destroyed
+    VKP_TRACK_SHUTDOWN();
 
-    glfwDestroyWindow(m_NativeWindow);
-    glfwTerminate();
+    if (!m_Spec.headless) {
+        glfwDestroyWindow(m_NativeWindow);
+        glfwTerminate();
+    }
 }
 }
@@ -8,109 +8,37 @@
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
 #include "core.hpp"
+#include <Bench/Bench.hpp>
+#include <Bench/MicroBenchmarks.hpp>
+#include <Profiler/Profiler.hpp>
+#include <Profiler/ResourceTracker.hpp>
+#include <Renderer/BindlessTable.hpp>
+#include <Renderer/DeletionQueue.hpp>
+#include <Renderer/DescriptorAllocator.hpp>
+#include <Renderer/DeviceAllocator.hpp>
+#include <Renderer/DeviceSelector.hpp>
+#include <Renderer/FramePacer.hpp>
+#include <Renderer/GpuCulling.hpp>
+#include <Renderer/GpuTimeline.hpp>
+#include <Renderer/InstanceRenderer.hpp>
+#include <Renderer/Mesh.hpp>
+#include <Renderer/MeshPack.hpp>
+#include <Renderer/ParallelRecorder.hpp>
+#include <Renderer/PipelineCache.hpp>
+#include <Renderer/PipelineRegistry.hpp>
+#include <Renderer/RenderGraph.hpp>
+#include <Renderer/ShaderHotReload.hpp>
+#include <Renderer/ShaderLibrary.hpp>
+#include <Renderer/SubmitBatch.hpp>
+#include <Renderer/TextureStreamer.hpp>
+#include <Renderer/UploadQueue.hpp>
 #include <vulkan/vulkan_core.h>
 namespace VulkanProj {
 
-struct SwapChainSupportDetails {
-    VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
-};
-
-inline SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
-{
-    SwapChainSupportDetails details;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-    uint32_t formatCount;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-    if (formatCount != 0) {
-        details.formats.resize(formatCount);
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-    }
-
-    uint32_t presentModeCount;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-    if (presentModeCount != 0) {
-        details.presentModes.resize(presentModeCount);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-    }
-
-    return details;
-}
-
-struct QueueFamilyIndices {
-    std::optional<u32> graphicsFamily;
-    std::optional<u32> presentFamily;
-
-    bool isComplete()
-    {
-        return graphicsFamily.has_value() && presentFamily.has_value();
-    }
-};
-
 static const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
-inline QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
-{
-    QueueFamilyIndices ind;
-
-    u32 queueFamilyCount;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-
-    std::vector<VkQueueFamilyProperties> properties(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, properties.data());
-
-    for (i32 i = 0; i < queueFamilyCount; i++) {
-        if (properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            ind.graphicsFamily = i;
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-            if (presentSupport) {
-                ind.presentFamily = i;
-            }
-        }
-    }
-
-    return ind;
-}
-
-inline bool checkDeviceExtensionSupport(VkPhysicalDevice device)
-{
-    u32 extCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extCount, nullptr);
-
-    std::vector<VkExtensionProperties> availableExt;
-    availableExt.resize(extCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extCount, availableExt.data());
-
-    std::set<std::string> reqExt(deviceExtensions.begin(), deviceExtensions.end());
-    for (const auto& ext : availableExt) {
-        reqExt.erase(ext.extensionName);
-    }
-
-    return reqExt.empty();
-}
-inline bool isUsableDevice(VkPhysicalDevice device, VkSurfaceKHR surface)
-{
-
-    QueueFamilyIndices indices = findQueueFamilies(device, surface);
-
-    bool extensionsSupported = checkDeviceExtensionSupport(device);
-
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
-        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
-    }
-
-    return indices.isComplete() && extensionsSupported && swapChainAdequate;
-}
-
 inline VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
     for (const auto& availableFormat : availableFormats) {
@@ -138,26 +66,104 @@ inline VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities,
     }
 }
 
-inline VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
-{
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-    }
+constexpr u32 MIN_FRAMES_IN_FLIGHT = 1;
+constexpr u32 MAX_FRAMES_IN_FLIGHT = 4;
+
+struct ApplicationSpec {
+    u32 width = 1280;
+    u32 height = 720;
+
+    // Depth of the frame context ring. 1 serializes CPU and GPU work, 2-4 let the CPU run ahead
+    u32 framesInFlight = 2;
+
+    // When non-zero, render this many frames, then stop and report frame times
+    u32 benchmarkFrames = 0;
+
+    // Present mode and CPU throttling, see PacingMode
+    PacingMode pacing = PacingMode::LowLatency;
+    // Frame rate PacingMode::Limited holds
+    u32 targetFps = 60;
+    // Periodically log CPU wait, GPU time and present-to-present intervals
+    bool pacingStats = false;
+
+    // Render into device-local images instead of a swapchain. No window, surface or present
+    bool headless = false;
+    // Stop after this many frames (0 = until the window closes, or a single frame when headless)
+    u32 frameLimit = 0;
+    // When non-zero, resize the window every few frames for this many frames and report hitches
+    u32 resizeStressFrames = 0;
+
+    // When set, the last rendered image is copied back to the host and written here as a PPM
+    std::string readbackPath;
+    // When set, every tracked Vulkan object and heap total is written here as JSON before cleanup
+    std::string resourceSnapshotPath;
+
+    // Run the named CPU/driver micro benchmark after initialization instead of the main loop
+    std::string microBenchmark;
+
+    // Instances of the test mesh drawn every frame with a single instanced draw
+    u32 instanceCount = 1;
+    // Half size of the instance grid in clip space. Above 1 part of the scene is off screen
+    f32 sceneExtent = 1.0f;
+    // Cull instances in a compute pass and draw the survivors with vkCmdDrawIndexedIndirectCount
+    bool gpuCulling = false;
+    // Log the culling pass's tested/drawn counts, read back without stalling
+    bool cullStats = false;
+
+    // Instances per secondary command buffer. Each chunk draws its range of instances with one
+    // instanced draw, chunks are recorded in parallel on the job system
+    u32 instancesPerChunk = 4096;
+
+    // On-disk VkPipelineCache. Empty disables persistence and every launch compiles cold
+    std::string pipelineCachePath = "pipeline_cache.bin";
+
+    // Physical device to use instead of the highest ranked one: name substring, UUID or index
+    std::string preferredDevice;
+
+    // KTX2 textures (BC or ASTC) to stream in at startup
+    std::vector<std::string> texturePaths;
+    // Cap on streamed texture memory in MiB, 0 leaves it to the device memory budget
+    u32 textureBudgetMiB = 0;
+
+    // Cooked .vkpm mesh pack to draw instead of the built-in triangle
+    std::string meshPackPath;
+    // Mesh to take from the pack, empty takes the first
+    std::string meshName;
+
+    // Watch shaders/ and swap in rebuilt pipelines when their GLSL changes
+    bool shaderHotReload = false;
+    // Link pipeline variants from VK_EXT_graphics_pipeline_library parts when the device has it
+    bool pipelineLibrary = true;
+};
 
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
+// Everything a single in-flight frame needs. Reused once the frame timeline reaches `submitValue`
+struct FrameContext {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    // Frame timeline value the slot's last submission signals, 0 before its first
+    u64 submitValue = 0;
+};
 
 class Application {
 public:
-    Application(u32 width = 1280, u32 height = 720)
-        : m_Width(width)
-        , m_Height(height) {};
+    Application(const ApplicationSpec& spec = {})
+        : m_Spec(spec)
+        , m_Width(spec.width)
+        , m_Height(spec.height)
+    {
+        m_Spec.framesInFlight = std::clamp(spec.framesInFlight, MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT);
+    };
     void run();
 
     void stopEngine();
 
+    // Frame-to-frame intervals collected in benchmark mode
+    const BenchSummary& getFrameTimeSummary() const { return m_FrameTimeSummary; }
+
+    // Tightly packed RGBA8 pixels of the final frame, filled when readbackPath is set
+    const std::vector<u8>& getReadbackPixels() const { return m_ReadbackPixels; }
+
 private:
     void initVulkan();
     void setupDebugCallbacks();
@@ -166,19 +172,27 @@ private:
     void createInstance();
     void createSurface();
     void createSwapChain();
+    void recreateSwapChain();
+    void createOffscreenTargets();
     void createImageViews();
     void createGraphicsPipeline();
-    void createRenderPass();
-    void createFrameBuffers();
-    void createCommandPool();
-    void createCommandBuffer();
+    // Thread safe, hot reload builds pipelines on its watcher thread
+    void setupShaderHotReload();
+    void createCommandPools();
+    void createCommandBuffers();
     void createSynchObjects();
+    void createRenderFinishedSemaphores();
 
     void drawFrame();
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageIndex);
+    void runMicroBenchmark(const std::string& name);
 
-    VkShaderModule createShaderModule(std::vector<char>& shaderCode);
+    void readbackImage(u32 imageIndex, std::vector<u8>& pixels);
+    void writeReadbackImage(const std::string& path);
+
+    void createScene();
+    void updateInstances();
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageIndex);
 
     void pickPhysicalDevice();
     void setupLogicalDevice();
@@ -188,30 +202,77 @@ private:
     VkDebugUtilsMessengerEXT m_DebugMessenger;
     VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
     VkDevice m_LogicalDevice = VK_NULL_HANDLE;
+    QueueTopology m_Queues;
+    DeviceAllocator m_Allocator;
+    UploadQueue m_UploadQueue;
     VkQueue m_GraphicsQueue;
-    VkQueue m_PresentQueue;
-    VkSurfaceKHR m_Surface;
-
-    VkSwapchainKHR m_SwapChain;
+    VkQueue m_PresentQueue = VK_NULL_HANDLE;
+    VkQueue m_TransferQueue = VK_NULL_HANDLE;
+    // VK_KHR_present_id and VK_KHR_present_wait are enabled
+    bool m_PresentWaitEnabled = false;
+    // VK_EXT_memory_budget is enabled
+    bool m_MemoryBudgetEnabled = false;
+    // VK_EXT_graphics_pipeline_library is enabled
+    bool m_PipelineLibraryEnabled = false;
+    // Upload timeline value the frame being recorded has to wait for
+    u64 m_UploadWaitValue = 0;
+    VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
+
+    VkSwapchainKHR m_SwapChain = VK_NULL_HANDLE;
     std::vector<VkImage> m_SwapChainImages;
     VkFormat m_SwapChainImageFormat;
     VkExtent2D m_SwapChainExtent;
     std::vector<VkImageView> m_SwapChainImageViews;
-    std::vector<VkFramebuffer> m_SwapChainFramebuffers;
-
-    VkRenderPass m_RenderPass;
-    VkPipelineLayout m_PipelineLayout;
-    VkPipeline m_GraphicsPipeline;
-
-    VkCommandPool m_CommandPool;
-    VkCommandBuffer m_CommandBuffer;
-
-    VkSemaphore m_ImageAvailableSemaphore;
-    VkSemaphore m_RenderFinishedSemaphore;
-    VkFence m_InFlightFence;
+    // Backing memory of the headless render targets, which stand in for swapchain images
+    std::vector<Allocation*> m_OffscreenImageAllocations;
+    u32 m_LastImageIndex = 0;
+    bool m_FramebufferResized = false;
+    bool m_SwapChainPendingRecreate = false;
+
+    // Frame passes are declared into the graph every frame, it derives their barriers
+    RenderGraph m_RenderGraph;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    PipelineRegistry m_Pipelines;
+    PipelineKey m_MainPipelineKey;
+    // The main pass variant, or the last hot reloaded build of it
+    VkPipeline m_GraphicsPipeline = VK_NULL_HANDLE;
+    PipelineCache m_PipelineCache;
+    ShaderLibrary m_ShaderLibrary;
+    ShaderHotReload m_ShaderReload;
+
+    DescriptorLayoutCache m_DescriptorLayouts;
+    // Per-frame sets for passes that need them, reset with the frame slot
+    DescriptorAllocator m_FrameDescriptors;
+    BindlessTable m_Bindless;
+    TextureStreamer m_Textures;
+    std::vector<TextureHandle> m_TextureHandles;
+
+    Mesh m_Mesh;
+    InstanceRenderer m_Instances;
+    GpuCulling m_Culling;
+    u32 m_FirstInstance = 0;
+
+    std::vector<FrameContext> m_Frames;
+    // Signaled by every graphics submission, frame slots and retired objects wait on it
+    GpuTimeline m_FrameTimeline;
+    DeletionQueue m_DeletionQueue;
+    FramePacer m_Pacer;
+    ParallelRecorder m_Recorder;
+    u32 m_CurrentFrame = 0;
+    // Total frames submitted
+    u64 m_FrameNumber = 0;
+
+    // Indexed by swapchain image: the presentation engine holds the wait until that image is reacquired
+    std::vector<VkSemaphore> m_RenderFinishedSemaphores;
+
+    ApplicationSpec m_Spec;
+    std::vector<f64> m_FrameTimes;
+    BenchSummary m_FrameTimeSummary;
+    u32 m_SwapChainRecreations = 0;
+    std::vector<u8> m_ReadbackPixels;
 
     // Window
-    GLFWwindow* m_NativeWindow;
+    GLFWwindow* m_NativeWindow = nullptr;
     u32 m_Width, m_Height;
 
     bool m_Running = true;
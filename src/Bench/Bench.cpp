@@ -0,0 +1,54 @@
+#include "Bench/Bench.hpp"
+
+#include <cmath>
+
+namespace VulkanProj {
+
+static f64 percentile(const std::vector<f64>& sorted, f64 p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    f64 rank = p * (f64)(sorted.size() - 1);
+    size_t lo = (size_t)rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    f64 t = rank - (f64)lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * t;
+}
+
+BenchSummary summarizeSamples(std::vector<f64> samples)
+{
+    BenchSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    f64 total = 0.0;
+    for (f64 s : samples) {
+        total += s;
+    }
+
+    summary.count = samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.avg = total / (f64)samples.size();
+    summary.p50 = percentile(samples, 0.50);
+    summary.p99 = percentile(samples, 0.99);
+
+    f64 squares = 0.0;
+    for (f64 s : samples) {
+        squares += (s - summary.avg) * (s - summary.avg);
+    }
+    summary.stddev = samples.size() > 1 ? std::sqrt(squares / (f64)(samples.size() - 1)) : 0.0;
+    return summary;
+}
+
+void logBenchSummary(const std::string& name, const BenchSummary& summary, const char* unit)
+{
+    VKP_INFO("[BENCH] {}: n={} min={:.3f}{} avg={:.3f}{} p50={:.3f}{} p99={:.3f}{} max={:.3f}{}",
+        name, summary.count,
+        summary.min, unit, summary.avg, unit, summary.p50, unit, summary.p99, unit, summary.max, unit);
+}
+
+}
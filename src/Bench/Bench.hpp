@@ -0,0 +1,41 @@
+#ifndef VKP_BENCH
+#define VKP_BENCH
+
+#include "core.hpp"
+#include <chrono>
+
+namespace VulkanProj {
+
+// Order statistics over a set of timing samples (milliseconds unless noted)
+struct BenchSummary {
+    u64 count = 0;
+    f64 min = 0.0;
+    f64 avg = 0.0;
+    f64 p50 = 0.0;
+    f64 p99 = 0.0;
+    f64 max = 0.0;
+    f64 stddev = 0.0;
+};
+
+BenchSummary summarizeSamples(std::vector<f64> samples);
+
+void logBenchSummary(const std::string& name, const BenchSummary& summary, const char* unit = "ms");
+
+class BenchTimer {
+public:
+    BenchTimer() { reset(); }
+
+    void reset() { m_Start = std::chrono::steady_clock::now(); }
+
+    f64 elapsedMs() const
+    {
+        return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+}
+
+#endif
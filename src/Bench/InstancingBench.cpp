@@ -0,0 +1,120 @@
+#include "Bench/Bench.hpp"
+#include "Bench/MicroBenchmarks.hpp"
+#include "Renderer/InstanceRenderer.hpp"
+#include "Renderer/RenderGraph.hpp"
+
+namespace VulkanProj {
+
+static constexpr u32 BENCH_REPETITIONS = 16;
+static constexpr u32 BENCH_WARMUP = 4;
+static constexpr u32 MAX_INSTANCES = 1000000;
+
+void runInstancingBench(const BenchContext& context)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+
+    InstanceRenderer instances;
+    instances.init(context.device, *context.allocator, *context.bindless, 1, MAX_INSTANCES);
+    RenderGraph graph;
+    graph.init(context.device, *context.allocator, 1);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = context.graphicsFamily;
+    VkCommandPool pool;
+    vkCreateCommandPool(context.device, &poolInfo, nullptr, &pool);
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(context.device, &allocInfo, &commandBuffer);
+
+    VkFenceCreateInfo fenceInfo {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    vkCreateFence(context.device, &fenceInfo, nullptr, &fence);
+
+    VkQueryPoolCreateInfo queryInfo {};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = 2;
+    VkQueryPool queryPool;
+    vkCreateQueryPool(context.device, &queryInfo, nullptr, &queryPool);
+
+    VkViewport viewport { 0.0f, 0.0f, (float)context.extent.width, (float)context.extent.height, 0.0f, 1.0f };
+    VkRect2D scissor { { 0, 0 }, context.extent };
+
+    for (u32 count = 1; count <= MAX_INSTANCES; count *= 10) {
+        std::vector<f64> cpuSamples;
+        std::vector<f64> gpuSamples;
+
+        for (u32 rep = 0; rep < BENCH_WARMUP + BENCH_REPETITIONS; rep++) {
+            // CPU side: instance data, recording and the submit call itself
+            BenchTimer cpuTimer;
+            instances.beginFrame(0);
+            u32 firstInstance;
+            fillInstanceGrid(instances.allocate(count, firstInstance), count);
+
+            vkResetCommandPool(context.device, pool, 0);
+            VkCommandBufferBeginInfo beginInfo {};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+
+            graph.reset(0);
+            RGResource color = graph.importImage("Color", context.colorImage, context.colorView, { context.colorFormat, context.extent }, {},
+                context.colorLayout);
+            graph.addPass("Instances")
+                .color(color, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+                .execute([&](const RGPassContext& ctx) {
+                    vkCmdBindPipeline(ctx.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipeline);
+                    vkCmdSetViewport(ctx.commandBuffer, 0, 1, &viewport);
+                    vkCmdSetScissor(ctx.commandBuffer, 0, 1, &scissor);
+                    instances.bind(ctx.commandBuffer, context.pipelineLayout);
+                    instances.draw(ctx.commandBuffer, context.pipelineLayout, *context.mesh, firstInstance, count);
+                });
+            graph.compile();
+            graph.execute(commandBuffer);
+
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo {};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+            vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, fence);
+            f64 cpuMs = cpuTimer.elapsedMs();
+
+            vkWaitForFences(context.device, 1, &fence, VK_TRUE, UINT64_MAX);
+            vkResetFences(context.device, 1, &fence);
+
+            u64 timestamps[2];
+            vkGetQueryPoolResults(context.device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(u64),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+            if (rep >= BENCH_WARMUP) {
+                cpuSamples.push_back(cpuMs);
+                gpuSamples.push_back((timestamps[1] - timestamps[0]) * properties.limits.timestampPeriod * 1e-6);
+            }
+        }
+
+        logBenchSummary(std::to_string(count) + " instances CPU", summarizeSamples(cpuSamples));
+        logBenchSummary(std::to_string(count) + " instances GPU", summarizeSamples(gpuSamples));
+    }
+
+    vkDestroyQueryPool(context.device, queryPool, nullptr);
+    vkDestroyFence(context.device, fence, nullptr);
+    vkDestroyCommandPool(context.device, pool, nullptr);
+    graph.destroy();
+    instances.destroy();
+}
+
+}
@@ -0,0 +1,72 @@
+#include "Bench/Bench.hpp"
+#include "Bench/MicroBenchmarks.hpp"
+#include "Core/JobSystem.hpp"
+
+#include <cmath>
+
+namespace VulkanProj {
+
+static constexpr u32 BENCH_REPETITIONS = 16;
+static constexpr u32 ITEM_COUNT = 1 << 22;
+static constexpr u32 TINY_JOB_COUNT = 100000;
+
+// Roughly the per-object cost of a transform update or a frustum test
+static f64 runParallelFor(std::vector<f32>& output)
+{
+    BenchTimer timer;
+    JobSystem::parallelFor(ITEM_COUNT, 0, [&](u32 first, u32 count) {
+        for (u32 i = first; i < first + count; i++) {
+            f32 x = (f32)i * 0.001f;
+            output[i] = std::sqrt(x * x + 1.0f) * std::sin(x) + std::cos(x * 0.5f);
+        }
+    });
+    return timer.elapsedMs();
+}
+
+// Scheduling overhead: jobs that do nearly nothing
+static f64 runTinyJobs()
+{
+    std::atomic<u32> sum { 0 };
+    JobCounter counter;
+
+    BenchTimer timer;
+    for (u32 i = 0; i < TINY_JOB_COUNT; i++) {
+        JobSystem::run([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+    }
+    JobSystem::wait(counter);
+    return timer.elapsedMs();
+}
+
+void runJobSystemBench(const BenchContext& context)
+{
+    const u32 previousThreads = JobSystem::getThreadCount();
+    const u32 maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<f32> output(ITEM_COUNT);
+
+    f64 singleThreadAvg = 0.0;
+    for (u32 threads = 1; threads <= maxThreads; threads++) {
+        JobSystem::shutdown();
+        JobSystem::init(threads);
+
+        std::vector<f64> forSamples;
+        std::vector<f64> tinySamples;
+        for (u32 rep = 0; rep < BENCH_REPETITIONS; rep++) {
+            forSamples.push_back(runParallelFor(output));
+            tinySamples.push_back(runTinyJobs() * 1e6 / TINY_JOB_COUNT);
+        }
+
+        BenchSummary forSummary = summarizeSamples(forSamples);
+        if (threads == 1) {
+            singleThreadAvg = forSummary.avg;
+        }
+        logBenchSummary("parallelFor " + std::to_string(ITEM_COUNT) + " items, " + std::to_string(threads) + " threads", forSummary);
+        VKP_INFO("[BENCH]   x{:.2f} vs 1 thread, {:.0f}% efficiency", singleThreadAvg / forSummary.avg,
+            100.0 * singleThreadAvg / (forSummary.avg * threads));
+        logBenchSummary("tiny jobs, " + std::to_string(threads) + " threads", summarizeSamples(tinySamples), "ns/job");
+    }
+
+    JobSystem::shutdown();
+    JobSystem::init(previousThreads);
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef VKP_MICROBENCHMARKS
+#define VKP_MICROBENCHMARKS
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+class BindlessTable;
+class DeviceAllocator;
+class Mesh;
+
+// Device objects a micro benchmark may use. Everything is owned by the caller
+struct BenchContext {
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    u32 graphicsFamily = 0;
+
+    // Main pass objects, for benchmarks that record draws. `colorImage` is left in `colorLayout`
+    VkImage colorImage = VK_NULL_HANDLE;
+    VkImageView colorView = VK_NULL_HANDLE;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkImageLayout colorLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    VkExtent2D extent {};
+    // VK_EXT_graphics_pipeline_library is enabled
+    bool pipelineLibrary = false;
+
+    DeviceAllocator* allocator = nullptr;
+    // Global set of `pipelineLayout`
+    BindlessTable* bindless = nullptr;
+    // Resident test mesh matching `pipeline`
+    const Mesh* mesh = nullptr;
+};
+
+// Side-by-side comparisons run against the application's own scene, swapchain and pipeline
+// library (--bench). Per-operation costs tracked from run to run live in VulkanBench
+void runJobSystemBench(const BenchContext& context);
+void runInstancingBench(const BenchContext& context);
+void runPipelineBench(const BenchContext& context);
+
+}
+
+#endif
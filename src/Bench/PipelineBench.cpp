@@ -0,0 +1,95 @@
+#include "Bench/Bench.hpp"
+#include "Bench/MicroBenchmarks.hpp"
+#include "Core/JobSystem.hpp"
+#include "Renderer/PipelineRegistry.hpp"
+
+namespace VulkanProj {
+
+static constexpr u32 BENCH_REPETITIONS = 4;
+
+// No VkPipelineCache anywhere here, every repetition compiles. Drivers with their own shader
+// cache still get faster after the first repetition, so compare min against min
+static std::vector<PipelineKey> describeVariants(u32 program, VkFormat colorFormat)
+{
+    std::vector<PipelineKey> keys;
+    for (BlendMode blend : { BlendMode::Opaque, BlendMode::Alpha, BlendMode::Additive, BlendMode::Premultiplied }) {
+        for (VkCullModeFlags cullMode : { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_NONE }) {
+            for (VkPrimitiveTopology topology : { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP }) {
+                PipelineKey key;
+                key.program = program;
+                key.colorFormat = colorFormat;
+                key.blend = blend;
+                key.cullMode = (u8)cullMode;
+                key.topology = (u8)topology;
+                keys.push_back(key);
+            }
+        }
+    }
+    return keys;
+}
+
+// Serial first uses: the total is what creating everything lazily would cost over the first
+// frames, each sample is one frame's hitch
+static void benchFirstUse(const BenchContext& context, bool pipelineLibrary, const char* name)
+{
+    std::vector<f64> totalMs;
+    std::vector<f64> firstUseMs;
+    for (u32 rep = 0; rep < BENCH_REPETITIONS; rep++) {
+        PipelineRegistry registry;
+        registry.init(context.device, VK_NULL_HANDLE, pipelineLibrary);
+        u32 program = registry.registerProgram(context.vertexShader, context.fragmentShader, context.pipelineLayout);
+
+        BenchTimer total;
+        for (const PipelineKey& key : describeVariants(program, context.colorFormat)) {
+            BenchTimer timer;
+            registry.get(key);
+            firstUseMs.push_back(timer.elapsedMs());
+        }
+        totalMs.push_back(total.elapsedMs());
+        registry.destroy();
+    }
+    logBenchSummary(std::string(name) + " first use, all variants", summarizeSamples(totalMs));
+    logBenchSummary(std::string(name) + " first use, per variant", summarizeSamples(firstUseMs));
+}
+
+static void benchPrewarm(const BenchContext& context, bool pipelineLibrary, const char* name)
+{
+    std::vector<f64> prewarmMs;
+    std::vector<f64> lookupNs;
+    for (u32 rep = 0; rep < BENCH_REPETITIONS; rep++) {
+        PipelineRegistry registry;
+        registry.init(context.device, VK_NULL_HANDLE, pipelineLibrary);
+        u32 program = registry.registerProgram(context.vertexShader, context.fragmentShader, context.pipelineLayout);
+        std::vector<PipelineKey> keys = describeVariants(program, context.colorFormat);
+
+        BenchTimer timer;
+        registry.prewarm(keys);
+        prewarmMs.push_back(timer.elapsedMs());
+
+        // What get() costs once everything exists
+        constexpr u32 lookupRounds = 10000;
+        timer.reset();
+        for (u32 i = 0; i < lookupRounds; i++) {
+            registry.get(keys[i % keys.size()]);
+        }
+        lookupNs.push_back(timer.elapsedMs() * 1e6 / lookupRounds);
+        registry.destroy();
+    }
+    logBenchSummary(std::string(name) + " prewarm on " + std::to_string(JobSystem::getThreadCount()) + " threads", summarizeSamples(prewarmMs));
+    logBenchSummary(std::string(name) + " cached lookup", summarizeSamples(lookupNs), "ns/op");
+}
+
+void runPipelineBench(const BenchContext& context)
+{
+    VKP_INFO("[BENCH] {} pipeline variants per run", describeVariants(0, context.colorFormat).size());
+    benchFirstUse(context, false, "monolithic");
+    benchPrewarm(context, false, "monolithic");
+    if (!context.pipelineLibrary) {
+        VKP_INFO("[BENCH] VK_EXT_graphics_pipeline_library is not enabled, skipping the library runs");
+        return;
+    }
+    benchFirstUse(context, true, "pipeline library");
+    benchPrewarm(context, true, "pipeline library");
+}
+
+}
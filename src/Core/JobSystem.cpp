@@ -0,0 +1,242 @@
+#include "Core/JobSystem.hpp"
+
+namespace VulkanProj {
+
+u32 JobSystem::s_ThreadCount = 0;
+std::vector<Scope<JobSystem::WorkDeque>> JobSystem::s_Deques;
+std::vector<std::thread> JobSystem::s_Threads;
+std::atomic<bool> JobSystem::s_Quit { false };
+std::atomic<u32> JobSystem::s_QueuedJobs { 0 };
+std::atomic<u32> JobSystem::s_Sleeping { 0 };
+std::mutex JobSystem::s_SleepMutex;
+std::condition_variable JobSystem::s_SleepCondition;
+
+static thread_local u32 s_ThreadIndex = JobSystem::INVALID_THREAD;
+
+// Spins before a worker goes to sleep, a new job usually shows up within a frame's worth of work
+static constexpr u32 IDLE_SPINS = 64;
+
+//----WORK DEQUE---- (Lê, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for Weak Memory Models")
+
+bool JobSystem::WorkDeque::push(Job* job)
+{
+    i64 bottom = m_Bottom.load(std::memory_order_relaxed);
+    i64 top = m_Top.load(std::memory_order_acquire);
+    if (bottom - top >= (i64)DEQUE_CAPACITY) {
+        return false;
+    }
+    m_Buffer[bottom & (DEQUE_CAPACITY - 1)].store(job, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobSystem::WorkDeque::pop()
+{
+    i64 bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+    m_Bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 top = m_Top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_Buffer[bottom & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last job, race the thieves for it
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobSystem::WorkDeque::steal()
+{
+    i64 top = m_Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 bottom = m_Bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = m_Buffer[top & (DEQUE_CAPACITY - 1)].load(std::memory_order_acquire);
+    if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+//----JOB SYSTEM----
+
+void JobSystem::init(u32 threadCount)
+{
+    VKP_ASSERT(s_ThreadCount == 0, "JOB SYSTEM ALREADY INITIALIZED");
+    s_ThreadCount = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    s_Quit = false;
+    s_QueuedJobs = 0;
+
+    for (u32 i = 0; i < s_ThreadCount; i++) {
+        s_Deques.push_back(CreateScope<WorkDeque>());
+    }
+    s_ThreadIndex = 0;
+    for (u32 i = 1; i < s_ThreadCount; i++) {
+        s_Threads.emplace_back(&JobSystem::workerLoop, i);
+    }
+    VKP_INFO("JobSystem: {} threads", s_ThreadCount);
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_SleepMutex);
+        s_Quit = true;
+    }
+    s_SleepCondition.notify_all();
+    for (std::thread& thread : s_Threads) {
+        thread.join();
+    }
+    s_Threads.clear();
+    s_Deques.clear();
+    s_ThreadCount = 0;
+    s_ThreadIndex = INVALID_THREAD;
+}
+
+u32 JobSystem::getThreadIndex()
+{
+    return s_ThreadIndex;
+}
+
+void JobSystem::run(JobFn fn, JobCounter* signal, JobCounter* dependency)
+{
+    Job* job = new Job { std::move(fn), signal };
+    if (signal != nullptr) {
+        signal->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (dependency != nullptr) {
+        std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+        if (!dependency->isDone()) {
+            dependency->m_Continuations.push_back(job);
+            return;
+        }
+    }
+    submit(job);
+}
+
+void JobSystem::submit(Job* job)
+{
+    u32 threadIndex = s_ThreadIndex;
+    VKP_ASSERT(threadIndex < s_ThreadCount, "JOBS CAN ONLY BE QUEUED FROM JOB SYSTEM THREADS");
+
+    if (!s_Deques[threadIndex]->push(job)) {
+        execute(job);
+        return;
+    }
+
+    s_QueuedJobs.fetch_add(1);
+    if (s_Sleeping.load() > 0) {
+        // Taking the lock orders us after a worker that is about to sleep
+        { std::lock_guard<std::mutex> lock(s_SleepMutex); }
+        s_SleepCondition.notify_one();
+    }
+}
+
+void JobSystem::execute(Job* job)
+{
+    job->fn();
+
+    JobCounter* counter = job->counter;
+    delete job;
+    if (counter == nullptr) {
+        return;
+    }
+
+    // Decrement under the lock, wait() takes it once more before returning so the
+    // counter cannot be destroyed while this thread still touches it
+    std::vector<Job*> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations.swap(counter->m_Continuations);
+        }
+    }
+    for (Job* continuation : continuations) {
+        submit(continuation);
+    }
+}
+
+Job* JobSystem::findJob(u32 threadIndex)
+{
+    Job* job = s_Deques[threadIndex]->pop();
+    if (job == nullptr) {
+        // Start at a different victim on every thread so thieves spread out
+        for (u32 i = 1; i < s_ThreadCount && job == nullptr; i++) {
+            job = s_Deques[(threadIndex + i) % s_ThreadCount]->steal();
+        }
+    }
+    if (job != nullptr) {
+        s_QueuedJobs.fetch_sub(1);
+    }
+    return job;
+}
+
+void JobSystem::workerLoop(u32 threadIndex)
+{
+    s_ThreadIndex = threadIndex;
+    u32 idle = 0;
+    while (!s_Quit.load(std::memory_order_relaxed)) {
+        if (Job* job = findJob(threadIndex)) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(s_SleepMutex);
+        s_Sleeping.fetch_add(1);
+        s_SleepCondition.wait(lock, [] { return s_Quit.load() || s_QueuedJobs.load() > 0; });
+        s_Sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    u32 threadIndex = s_ThreadIndex;
+    VKP_ASSERT(threadIndex < s_ThreadCount, "ONLY JOB SYSTEM THREADS CAN WAIT ON A COUNTER");
+
+    while (!counter.isDone()) {
+        if (Job* job = findJob(threadIndex)) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    std::lock_guard<std::mutex> lock(counter.m_Mutex);
+}
+
+void JobSystem::parallelFor(u32 itemCount, u32 chunkSize, const std::function<void(u32 first, u32 count)>& fn)
+{
+    if (itemCount == 0) {
+        return;
+    }
+    if (chunkSize == 0) {
+        chunkSize = std::max(1u, itemCount / (s_ThreadCount * 4));
+    }
+
+    JobCounter counter;
+    for (u32 first = 0; first < itemCount; first += chunkSize) {
+        u32 count = std::min(chunkSize, itemCount - first);
+        run([&fn, first, count] { fn(first, count); }, &counter);
+    }
+    wait(counter);
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef VKP_JOBSYSTEM
+#define VKP_JOBSYSTEM
+
+#include "core.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace VulkanProj {
+
+class JobCounter;
+
+using JobFn = std::function<void()>;
+
+struct Job {
+    JobFn fn;
+    JobCounter* counter = nullptr;
+};
+
+// Counts unfinished jobs. Jobs can be made to depend on a counter, they are only
+// queued once it reaches zero. Only destroy a counter after JobSystem::wait() on it
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<u32> m_Pending { 0 };
+    std::mutex m_Mutex;
+    std::vector<Job*> m_Continuations;
+};
+
+// Fixed pool of worker threads, each owning a Chase-Lev work-stealing deque. The thread
+// that called init() takes part as thread 0 whenever it waits on a counter
+class JobSystem {
+public:
+    // Jobs a single thread can have queued before run() falls back to executing inline
+    static constexpr u32 DEQUE_CAPACITY = 4096;
+    static constexpr u32 INVALID_THREAD = ~0u;
+
+    // threadCount includes the calling thread. 0 uses every hardware thread
+    static void init(u32 threadCount = 0);
+    static void shutdown();
+
+    // Queue `fn` on the calling thread's deque. `signal` is incremented now and decremented
+    // when the job finishes. With `dependency`, the job is held back until that counter is done
+    static void run(JobFn fn, JobCounter* signal = nullptr, JobCounter* dependency = nullptr);
+
+    // Executes queued jobs on this thread until `counter` is done
+    static void wait(JobCounter& counter);
+
+    // Calls fn(first, count) over [0, itemCount) in chunks of `chunkSize` and waits for all of
+    // them. chunkSize 0 picks a size giving every thread a few chunks to balance with
+    static void parallelFor(u32 itemCount, u32 chunkSize, const std::function<void(u32 first, u32 count)>& fn);
+
+    static u32 getThreadCount() { return s_ThreadCount; }
+    // 0 on the init() thread, 1..N-1 on workers, INVALID_THREAD elsewhere
+    static u32 getThreadIndex();
+
+private:
+    class WorkDeque {
+    public:
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+
+    private:
+        std::atomic<i64> m_Top { 0 };
+        std::atomic<i64> m_Bottom { 0 };
+        std::array<std::atomic<Job*>, DEQUE_CAPACITY> m_Buffer {};
+    };
+
+    static void submit(Job* job);
+    static void execute(Job* job);
+    static Job* findJob(u32 threadIndex);
+    static void workerLoop(u32 threadIndex);
+
+    static u32 s_ThreadCount;
+    static std::vector<Scope<WorkDeque>> s_Deques;
+    static std::vector<std::thread> s_Threads;
+    static std::atomic<bool> s_Quit;
+
+    // Sleeping workers are woken when this becomes non-zero
+    static std::atomic<u32> s_QueuedJobs;
+    static std::atomic<u32> s_Sleeping;
+    static std::mutex s_SleepMutex;
+    static std::condition_variable s_SleepCondition;
+};
+
+}
+
+#endif
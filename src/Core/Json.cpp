@@ -0,0 +1,312 @@
+#include "Core/Json.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace VulkanProj {
+
+// Deeper nesting is rejected rather than risking the stack on hostile input
+static constexpr u32 MAX_JSON_DEPTH = 256;
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+    if (m_Type != Type::Object) {
+        return nullptr;
+    }
+    for (const auto& [name, value] : m_Object) {
+        if (name == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+f64 JsonValue::getNumber(const std::string& key, f64 fallback) const
+{
+    const JsonValue* value = find(key);
+    return value != nullptr ? value->asNumber(fallback) : fallback;
+}
+
+std::string JsonValue::getString(const std::string& key, const std::string& fallback) const
+{
+    const JsonValue* value = find(key);
+    return value != nullptr && value->m_Type == Type::String ? value->m_String : fallback;
+}
+
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t size)
+        : m_Begin(text)
+        , m_Cursor(text)
+        , m_End(text + size)
+    {
+    }
+
+    bool parse(JsonValue& root, std::string& error)
+    {
+        bool ok = parseValue(root, 0);
+        if (ok) {
+            skipWhitespace();
+            if (m_Cursor != m_End) {
+                fail("trailing characters");
+                ok = false;
+            }
+        }
+        if (!ok) {
+            error = fmt::format("{} at byte {}", m_Error, m_Cursor - m_Begin);
+        }
+        return ok;
+    }
+
+private:
+    bool fail(const char* message)
+    {
+        if (m_Error.empty()) {
+            m_Error = message;
+        }
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (m_Cursor < m_End && (*m_Cursor == ' ' || *m_Cursor == '\t' || *m_Cursor == '\n' || *m_Cursor == '\r')) {
+            m_Cursor++;
+        }
+    }
+
+    bool consume(const char* literal)
+    {
+        size_t length = strlen(literal);
+        if ((size_t)(m_End - m_Cursor) < length || memcmp(m_Cursor, literal, length) != 0) {
+            return false;
+        }
+        m_Cursor += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, u32 depth)
+    {
+        if (depth > MAX_JSON_DEPTH) {
+            return fail("nesting too deep");
+        }
+        skipWhitespace();
+        if (m_Cursor == m_End) {
+            return fail("unexpected end of input");
+        }
+        switch (*m_Cursor) {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.m_Type = JsonValue::Type::String;
+            return parseString(value.m_String);
+        case 't':
+        case 'f':
+            value.m_Type = JsonValue::Type::Bool;
+            value.m_Bool = *m_Cursor == 't';
+            return consume(value.m_Bool ? "true" : "false") || fail("invalid literal");
+        case 'n':
+            value.m_Type = JsonValue::Type::Null;
+            return consume("null") || fail("invalid literal");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseObject(JsonValue& value, u32 depth)
+    {
+        value.m_Type = JsonValue::Type::Object;
+        m_Cursor++;
+        skipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == '}') {
+            m_Cursor++;
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            std::string key;
+            if (m_Cursor == m_End || *m_Cursor != '"' || !parseString(key)) {
+                return fail("expected a member name");
+            }
+            skipWhitespace();
+            if (m_Cursor == m_End || *m_Cursor != ':') {
+                return fail("expected ':'");
+            }
+            m_Cursor++;
+            value.m_Object.emplace_back(std::move(key), JsonValue());
+            if (!parseValue(value.m_Object.back().second, depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (m_Cursor < m_End && *m_Cursor == ',') {
+                m_Cursor++;
+            } else if (m_Cursor < m_End && *m_Cursor == '}') {
+                m_Cursor++;
+                return true;
+            } else {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool parseArray(JsonValue& value, u32 depth)
+    {
+        value.m_Type = JsonValue::Type::Array;
+        m_Cursor++;
+        skipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == ']') {
+            m_Cursor++;
+            return true;
+        }
+        while (true) {
+            value.m_Array.emplace_back();
+            if (!parseValue(value.m_Array.back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (m_Cursor < m_End && *m_Cursor == ',') {
+                m_Cursor++;
+            } else if (m_Cursor < m_End && *m_Cursor == ']') {
+                m_Cursor++;
+                return true;
+            } else {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseHex4(u32& codepoint)
+    {
+        if (m_End - m_Cursor < 4) {
+            return fail("truncated \\u escape");
+        }
+        auto result = std::from_chars(m_Cursor, m_Cursor + 4, codepoint, 16);
+        if (result.ptr != m_Cursor + 4) {
+            return fail("invalid \\u escape");
+        }
+        m_Cursor += 4;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, u32 codepoint)
+    {
+        if (codepoint < 0x80) {
+            out += (char)codepoint;
+        } else if (codepoint < 0x800) {
+            out += (char)(0xC0 | (codepoint >> 6));
+            out += (char)(0x80 | (codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            out += (char)(0xE0 | (codepoint >> 12));
+            out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            out += (char)(0x80 | (codepoint & 0x3F));
+        } else {
+            out += (char)(0xF0 | (codepoint >> 18));
+            out += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+            out += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            out += (char)(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool parseString(std::string& out)
+    {
+        m_Cursor++;
+        while (m_Cursor < m_End && *m_Cursor != '"') {
+            char c = *m_Cursor++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_Cursor == m_End) {
+                break;
+            }
+            char escape = *m_Cursor++;
+            switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                out += escape;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                u32 codepoint;
+                if (!parseHex4(codepoint)) {
+                    return false;
+                }
+                // Surrogate pair
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && consume("\\u")) {
+                    u32 low;
+                    if (!parseHex4(low)) {
+                        return false;
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codepoint);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        if (m_Cursor == m_End) {
+            return fail("unterminated string");
+        }
+        m_Cursor++;
+        return true;
+    }
+
+    bool parseNumber(JsonValue& value)
+    {
+        value.m_Type = JsonValue::Type::Number;
+        auto result = std::from_chars(m_Cursor, m_End, value.m_Number);
+        if (result.ec != std::errc()) {
+            return fail("invalid value");
+        }
+        m_Cursor = result.ptr;
+        return true;
+    }
+
+    const char* m_Begin;
+    const char* m_Cursor;
+    const char* m_End;
+    std::string m_Error;
+};
+
+bool parseJson(const char* text, size_t size, JsonValue& root, std::string& error)
+{
+    root = JsonValue();
+    JsonParser parser(text, size);
+    return parser.parse(root, error);
+}
+
+std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((u8)c < 0x20) {
+            escaped += fmt::format("\\u{:04x}", (u32)(u8)c);
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}
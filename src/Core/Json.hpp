@@ -0,0 +1,51 @@
+#ifndef VKP_JSON
+#define VKP_JSON
+
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// Just enough JSON for glTF and benchmark baselines: a DOM with objects kept in file order. Numbers are doubles
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type getType() const { return m_Type; }
+    bool isObject() const { return m_Type == Type::Object; }
+    bool isArray() const { return m_Type == Type::Array; }
+
+    // Member `key` of an object, nullptr when missing or not an object
+    const JsonValue* find(const std::string& key) const;
+    // Element count of an array, 0 for everything else
+    size_t size() const { return m_Type == Type::Array ? m_Array.size() : 0; }
+    const JsonValue& operator[](size_t index) const { return m_Array[index]; }
+    const std::vector<std::pair<std::string, JsonValue>>& getMembers() const { return m_Object; }
+
+    f64 asNumber(f64 fallback = 0.0) const { return m_Type == Type::Number ? m_Number : fallback; }
+    bool asBool(bool fallback = false) const { return m_Type == Type::Bool ? m_Bool : fallback; }
+    const std::string& asString() const { return m_String; }
+
+    // Shorthands for optional members
+    f64 getNumber(const std::string& key, f64 fallback) const;
+    std::string getString(const std::string& key, const std::string& fallback = {}) const;
+
+private:
+    friend class JsonParser;
+
+    Type m_Type = Type::Null;
+    bool m_Bool = false;
+    f64 m_Number = 0.0;
+    std::string m_String;
+    std::vector<JsonValue> m_Array;
+    std::vector<std::pair<std::string, JsonValue>> m_Object;
+};
+
+// Returns false and describes the first error (with its byte offset) in `error`
+bool parseJson(const char* text, size_t size, JsonValue& root, std::string& error);
+
+// `text` escaped for use inside a JSON string literal
+std::string escapeJson(const std::string& text);
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef VKP_MAPPEDFILE
+#define VKP_MAPPEDFILE
+
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// Read-only view of a whole file through the OS page cache. Nothing is copied,
+// pages are faulted in as they are touched
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_Data != nullptr; }
+    const u8* data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+
+private:
+    const u8* m_Data = nullptr;
+    size_t m_Size = 0;
+#if defined(VKP_WINDOWS)
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
+
+}
+
+#endif
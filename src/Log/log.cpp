@@ -1,13 +1,53 @@
 #include "Log/log.hpp"
 
+#include <bit>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 namespace VulkanProj {
 
 std::shared_ptr<spdlog::logger> Log::s_CoreLogger;
+std::unique_ptr<Log::Record[]> Log::s_Records;
+std::atomic<bool> Log::s_Async = false;
+std::atomic<u32> Log::s_Producers = 0;
+
+// Bounded multi-producer queue (Vyukov): each record's sequence says whether it is free for
+// ticket N (== N), published for ticket N (== N + 1) or still owned by the previous lap.
+// Producers only touch atomics, the writer thread is the single consumer
+static u64 s_Capacity = 0;
+static u64 s_Mask = 0;
+static LogOverflowPolicy s_Overflow = LogOverflowPolicy::Drop;
+
+static std::atomic<u64> s_EnqueuePos = 0;
+static std::atomic<u64> s_FlushedPos = 0;
+static std::atomic<u64> s_FlushRequest = 0;
+static std::atomic<u64> s_Dropped = 0;
+static std::atomic<bool> s_WriterSleeping = false;
+static std::atomic<bool> s_Stop = false;
 
-void Log::Init()
+static std::thread s_Writer;
+static std::mutex s_WakeMutex;
+static std::condition_variable s_WakeCv;
+static std::condition_variable s_FlushCv;
+
+// Upper bound on how long a published message can sit unwritten if a wake-up is missed
+static constexpr auto WRITER_IDLE_TIMEOUT = std::chrono::milliseconds(100);
+
+// Pairs with the seq_cst publish store: either the writer sees the new record before sleeping
+// or the producer sees it asleep
+static void wakeWriter()
+{
+    if (s_WriterSleeping.load()) {
+        std::lock_guard<std::mutex> lock(s_WakeMutex);
+        s_WakeCv.notify_one();
+    }
+}
+
+void Log::Init(const LogSpec& spec)
 {
     std::vector<spdlog::sink_ptr> logSinks;
     logSinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
@@ -19,7 +59,186 @@ void Log::Init()
     s_CoreLogger = std::make_shared<spdlog::logger>("DIMENSIONAL", begin(logSinks), end(logSinks));
     spdlog::register_logger(s_CoreLogger);
     s_CoreLogger->set_level(spdlog::level::trace);
+
+    s_Async.store(spec.async);
+    if (!spec.async) {
+        s_CoreLogger->flush_on(spdlog::level::trace);
+        return;
+    }
+
+    // The writer flushes whenever the queue drains, and Write() flushes errors before returning
+    s_CoreLogger->flush_on(spdlog::level::off);
+
+    s_Capacity = std::bit_ceil(std::max(spec.queueCapacity, 2u));
+    s_Mask = s_Capacity - 1;
+    s_Overflow = spec.overflow;
+    s_Records = std::make_unique<Record[]>(s_Capacity);
+    for (u64 i = 0; i < s_Capacity; i++) {
+        s_Records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    s_EnqueuePos.store(0, std::memory_order_relaxed);
+    s_FlushedPos.store(0, std::memory_order_relaxed);
+    s_FlushRequest.store(0, std::memory_order_relaxed);
+    s_Dropped.store(0, std::memory_order_relaxed);
+    s_Stop.store(false, std::memory_order_relaxed);
+
+    s_Writer = std::thread(&Log::writerLoop);
+}
+
+void Log::Shutdown()
+{
+    // Anything logged from here on goes straight to the sinks, so no producer can start waiting on a
+    // queue the writer is about to stop draining
+    if (!s_Async.exchange(false)) {
+        if (s_CoreLogger) {
+            s_CoreLogger->flush();
+        }
+        return;
+    }
+
+    // Producers that saw s_Async before it was cleared still write into the queue. Both sides use
+    // seq_cst, so any producer the count misses sees s_Async cleared. The writer keeps draining,
+    // so producers blocked on a full queue finish too
+    while (s_Producers.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    s_Stop.store(true);
+    {
+        std::lock_guard<std::mutex> lock(s_WakeMutex);
+        s_WakeCv.notify_one();
+    }
+    s_Writer.join();
+
+    s_Records.reset();
     s_CoreLogger->flush_on(spdlog::level::trace);
+    s_CoreLogger->flush();
+}
+
+void Log::Flush()
+{
+    if (!s_Async.load()) {
+        s_CoreLogger->flush();
+        return;
+    }
+
+    u64 target = s_EnqueuePos.load(std::memory_order_acquire);
+    u64 request = s_FlushRequest.load(std::memory_order_relaxed);
+    while (request < target && !s_FlushRequest.compare_exchange_weak(request, target, std::memory_order_relaxed)) { }
+
+    std::unique_lock<std::mutex> lock(s_WakeMutex);
+    s_WakeCv.notify_one();
+    s_FlushCv.wait(lock, [target]() { return s_FlushedPos.load(std::memory_order_acquire) >= target; });
+}
+
+Log::Record* Log::acquireRecord(spdlog::level::level_enum level)
+{
+    // Errors are rare and usually precede a crash, never drop them
+    bool mayDrop = s_Overflow == LogOverflowPolicy::Drop && level < spdlog::level::err;
+
+    u64 pos = s_EnqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Record* record = &s_Records[pos & s_Mask];
+        u64 sequence = record->sequence.load(std::memory_order_acquire);
+        i64 diff = (i64)sequence - (i64)pos;
+        if (diff == 0) {
+            if (s_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                record->ticket = pos;
+                return record;
+            }
+        } else if (diff < 0) {
+            // Full: the writer has not consumed the record from the previous lap yet
+            if (mayDrop) {
+                s_Dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            wakeWriter();
+            std::this_thread::yield();
+            pos = s_EnqueuePos.load(std::memory_order_relaxed);
+        } else {
+            pos = s_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Log::publishRecord(Record* record)
+{
+    bool flush = record->level >= spdlog::level::err;
+    record->sequence.store(record->ticket + 1);
+    wakeWriter();
+
+    // Make sure errors reach the file before a following assert traps
+    if (flush) {
+        Flush();
+    }
+}
+
+void Log::writerLoop()
+{
+    fmt::memory_buffer buffer;
+    u64 dequeuePos = 0;
+
+    auto flushSinks = [&]() {
+        s_CoreLogger->flush();
+        std::lock_guard<std::mutex> lock(s_WakeMutex);
+        s_FlushedPos.store(dequeuePos, std::memory_order_release);
+        s_FlushCv.notify_all();
+    };
+
+    while (true) {
+        Record* record = &s_Records[dequeuePos & s_Mask];
+        if (record->sequence.load(std::memory_order_acquire) == dequeuePos + 1) {
+            std::string_view text;
+            switch (record->kind) {
+            case RecordKind::Deferred:
+                buffer.clear();
+                record->formatFn(*record, buffer);
+                text = std::string_view(buffer.data(), buffer.size());
+                break;
+            case RecordKind::Inline:
+                text = std::string_view(record->payload, record->length);
+                break;
+            case RecordKind::Heap:
+                text = *record->heapText;
+                break;
+            }
+            s_CoreLogger->log(record->time, spdlog::source_loc {}, record->level, text);
+
+            if (record->kind == RecordKind::Heap) {
+                delete record->heapText;
+                record->heapText = nullptr;
+            }
+            record->sequence.store(dequeuePos + s_Capacity, std::memory_order_release);
+            dequeuePos++;
+
+            // A waiting Flush() should not have to wait for a busy queue to drain completely
+            u64 request = s_FlushRequest.load(std::memory_order_relaxed);
+            if (s_FlushedPos.load(std::memory_order_relaxed) < request && dequeuePos >= request) {
+                flushSinks();
+            }
+            continue;
+        }
+
+        // Queue drained
+        u64 dropped = s_Dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            s_CoreLogger->log(spdlog::level::warn, "Log queue full, dropped {} messages", dropped);
+        }
+        if (s_FlushedPos.load(std::memory_order_relaxed) != dequeuePos) {
+            flushSinks();
+        }
+
+        if (s_Stop.load() && s_EnqueuePos.load(std::memory_order_acquire) == dequeuePos) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(s_WakeMutex);
+        s_WriterSleeping.store(true);
+        if (record->sequence.load() != dequeuePos + 1 && !s_Stop.load()) {
+            s_WakeCv.wait_for(lock, WRITER_IDLE_TIMEOUT);
+        }
+        s_WriterSleeping.store(false, std::memory_order_relaxed);
+    }
 }
 
 }
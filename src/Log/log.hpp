@@ -2,24 +2,161 @@
 #define VKP_LOGH
 
 #define GLM_ENABLE_EXPERIMENTAL
+#include <atomic>
+#include <defines.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <memory>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h> //
+#include <tuple>
+#include <type_traits>
 
 // #include <fmt/format.h>
 #include <glm/glm.hpp>
 
+//----COMPILE-TIME LEVEL----
+// VKP_* macros below VKP_LOG_ACTIVE_LEVEL compile to nothing, arguments are not even evaluated
+
+#define VKP_LOG_LEVEL_TRACE 0
+#define VKP_LOG_LEVEL_INFO 2
+#define VKP_LOG_LEVEL_WARN 3
+#define VKP_LOG_LEVEL_ERROR 4
+#define VKP_LOG_LEVEL_CRITICAL 5
+#define VKP_LOG_LEVEL_OFF 6
+
+#ifndef VKP_LOG_ACTIVE_LEVEL
+#define VKP_LOG_ACTIVE_LEVEL VKP_LOG_LEVEL_TRACE
+#endif
+
 namespace VulkanProj {
 
+// What a full async queue does to a new message. Errors and above always block
+enum class LogOverflowPolicy {
+    Block, // wait for the writer thread, nothing is lost
+    Drop, // discard and count, the writer reports how many were lost
+};
+
+struct LogSpec {
+    // Queue messages for a background writer thread. Off formats and writes on the calling
+    // thread and flushes every message
+    bool async = true;
+    // Preallocated records in the queue, rounded up to a power of two
+    u32 queueCapacity = 8192;
+    LogOverflowPolicy overflow = LogOverflowPolicy::Drop;
+};
+
 class Log {
 public:
-    static void Init();
+    static void Init(const LogSpec& spec = {});
+    // Drains the queue and joins the writer. Safe to call more than once
+    static void Shutdown();
+    // Blocks until everything logged so far is written and the sinks are flushed
+    static void Flush();
 
     static std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_CoreLogger; }
 
+    template <typename... Args>
+    static void Write(spdlog::level::level_enum level, spdlog::format_string_t<Args...> format, Args&&... args)
+    {
+        ProducerScope producer;
+        if (!s_Async.load()) {
+            s_CoreLogger->log(level, format, std::forward<Args>(args)...);
+            return;
+        }
+        if (level < s_CoreLogger->level()) {
+            return;
+        }
+
+        Record* record = acquireRecord(level);
+        if (record == nullptr) {
+            return;
+        }
+        record->level = level;
+        record->time = spdlog::log_clock::now();
+
+        using Payload = std::tuple<std::decay_t<Args>...>;
+        if constexpr (isDeferrable<Args...>() && sizeof(Payload) <= PAYLOAD_SIZE) {
+            // Arguments are plain values, copy them and format on the writer thread
+            fmt::string_view view = format;
+            record->format = std::string_view(view.data(), view.size());
+            record->kind = RecordKind::Deferred;
+            record->formatFn = &formatDeferred<std::decay_t<Args>...>;
+            new (record->payload) Payload(std::forward<Args>(args)...);
+        } else {
+            // Format on the calling thread into the record, still no allocation
+            auto result = fmt::format_to_n(record->payload, PAYLOAD_SIZE, format, std::forward<Args>(args)...);
+            if (result.size <= PAYLOAD_SIZE) {
+                record->kind = RecordKind::Inline;
+                record->length = (u32)result.size;
+            } else {
+                // Rare oversized message (validation layer output), the only path that allocates
+                record->kind = RecordKind::Heap;
+                record->heapText = new std::string(fmt::format(format, std::forward<Args>(args)...));
+            }
+        }
+        publishRecord(record);
+    }
+
 private:
+    static constexpr size_t PAYLOAD_SIZE = 224;
+
+    enum class RecordKind : u8 {
+        Deferred,
+        Inline,
+        Heap,
+    };
+
+    struct Record;
+    using FormatFn = void (*)(const Record& record, fmt::memory_buffer& out);
+
+    struct Record {
+        std::atomic<u64> sequence;
+        u64 ticket;
+        spdlog::log_clock::time_point time;
+        spdlog::level::level_enum level;
+        RecordKind kind;
+        u32 length;
+        std::string_view format;
+        FormatFn formatFn;
+        std::string* heapText;
+        alignas(16) char payload[PAYLOAD_SIZE];
+    };
+
+    template <typename... Args>
+    static constexpr bool isDeferrable()
+    {
+        // Views and pointers are trivially copyable too, but what they point at may be gone by the time
+        // the writer formats them
+        return ((std::is_trivially_copyable_v<std::decay_t<Args>> && !std::is_pointer_v<std::decay_t<Args>>
+                    && !std::is_convertible_v<std::decay_t<Args>, std::string_view>)
+            && ...);
+    }
+
+    template <typename... Args>
+    static void formatDeferred(const Record& record, fmt::memory_buffer& out)
+    {
+        const auto& payload = *reinterpret_cast<const std::tuple<Args...>*>(record.payload);
+        std::apply([&](const auto&... args) { fmt::vformat_to(std::back_inserter(out), fmt::string_view(record.format.data(), record.format.size()), fmt::make_format_args(args...)); },
+            payload);
+    }
+
+    // Counts Write() calls in progress. Shutdown clears s_Async, then waits for the count to reach
+    // zero before stopping the writer, so no producer that saw the queue enabled outlives it
+    struct ProducerScope {
+        ProducerScope() { s_Producers.fetch_add(1); }
+        ~ProducerScope() { s_Producers.fetch_sub(1, std::memory_order_release); }
+    };
+
+    // Claim a queue slot according to the overflow policy, nullptr when the message is dropped
+    static Record* acquireRecord(spdlog::level::level_enum level);
+    static void publishRecord(Record* record);
+    static void writerLoop();
+
     static std::shared_ptr<spdlog::logger> s_CoreLogger;
+    static std::unique_ptr<Record[]> s_Records;
+    // Read by every producer, cleared by Shutdown before the writer stops
+    static std::atomic<bool> s_Async;
+    static std::atomic<u32> s_Producers;
 };
 
 }
@@ -43,9 +180,29 @@ inline OStream& operator<<(OStream& os, glm::qua<T, Q> quaternion)
 }
 
 // Core log macros
-#define VKP_TRACE(...) VulkanProj::Log::GetCoreLogger()->trace(__VA_ARGS__);
-#define VKP_INFO(...) VulkanProj::Log::GetCoreLogger()->info(__VA_ARGS__);
-#define VKP_WARN(...) VulkanProj::Log::GetCoreLogger()->warn(__VA_ARGS__);
-#define VKP_ERROR(...) VulkanProj::Log::GetCoreLogger()->error(__VA_ARGS__);
-#define VKP_CRITICAL(...) VulkanProj::Log::GetCoreLogger()->critical(__VA_ARGS__);
+#if VKP_LOG_ACTIVE_LEVEL <= VKP_LOG_LEVEL_TRACE
+#define VKP_TRACE(...) VulkanProj::Log::Write(spdlog::level::trace, __VA_ARGS__);
+#else
+#define VKP_TRACE(...) (void)0;
+#endif
+#if VKP_LOG_ACTIVE_LEVEL <= VKP_LOG_LEVEL_INFO
+#define VKP_INFO(...) VulkanProj::Log::Write(spdlog::level::info, __VA_ARGS__);
+#else
+#define VKP_INFO(...) (void)0;
+#endif
+#if VKP_LOG_ACTIVE_LEVEL <= VKP_LOG_LEVEL_WARN
+#define VKP_WARN(...) VulkanProj::Log::Write(spdlog::level::warn, __VA_ARGS__);
+#else
+#define VKP_WARN(...) (void)0;
+#endif
+#if VKP_LOG_ACTIVE_LEVEL <= VKP_LOG_LEVEL_ERROR
+#define VKP_ERROR(...) VulkanProj::Log::Write(spdlog::level::err, __VA_ARGS__);
+#else
+#define VKP_ERROR(...) (void)0;
+#endif
+#if VKP_LOG_ACTIVE_LEVEL <= VKP_LOG_LEVEL_CRITICAL
+#define VKP_CRITICAL(...) VulkanProj::Log::Write(spdlog::level::critical, __VA_ARGS__);
+#else
+#define VKP_CRITICAL(...) (void)0;
+#endif
 #endif
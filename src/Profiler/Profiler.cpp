@@ -0,0 +1,411 @@
+#include "Profiler/Profiler.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#ifdef VKP_PROFILE
+
+namespace VulkanProj {
+
+// GPU zones have no CPU thread, give them their own row in the trace viewer
+static constexpr u32 GPU_THREAD_ID = 1000;
+static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+std::mutex Profiler::s_Mutex;
+UMap<std::string, Profiler::ZoneHistory> Profiler::s_Zones;
+UMap<const char*, Profiler::ZoneHistory*> Profiler::s_ZonesByName;
+
+std::vector<ProfileEvent> Profiler::s_CaptureEvents;
+std::vector<std::pair<u64, PipelineStatistics>> Profiler::s_CaptureStatistics;
+std::string Profiler::s_CapturePath;
+u32 Profiler::s_CaptureFramesLeft = 0;
+bool Profiler::s_Capturing = false;
+static bool s_CaptureWritePending = false;
+
+VkDevice Profiler::s_Device = VK_NULL_HANDLE;
+f64 Profiler::s_TimestampPeriodNs = 1.0;
+bool Profiler::s_PipelineStatisticsSupported = false;
+std::vector<Profiler::GpuFrame> Profiler::s_GpuFrames;
+Profiler::GpuFrame* Profiler::s_CurrentGpuFrame = nullptr;
+PipelineStatistics Profiler::s_LastStatistics;
+
+static u64 s_TimestampMask = ~0ull;
+static u64 s_LastFrameNs = 0;
+static std::atomic<u32> s_NextThreadId = 0;
+
+// A thread that records zones without frames being drained (no beginFrame) stops buffering here
+static constexpr size_t MAX_PENDING_CPU_ZONES = 16384;
+
+// Zones a thread recorded since the last frame boundary. Only the owning thread appends and
+// beginFrame only swaps the vector out, so the lock is uncontended outside of frame boundaries.
+// Owned by s_ThreadZones so events of a thread that exits are still drained
+struct ThreadZones {
+    std::mutex mutex;
+    std::vector<ProfileEvent> events;
+    u32 threadId = 0;
+};
+
+// Guarded by Profiler::s_Mutex
+static std::vector<Scope<ThreadZones>> s_ThreadZones;
+static std::vector<ProfileEvent> s_DrainedZones;
+
+static u32 currentThreadId()
+{
+    thread_local u32 id = s_NextThreadId++;
+    return id;
+}
+
+u64 Profiler::nowNs()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::pushHistory(const std::string& name, f64 ms)
+{
+    s_Zones[name].push(ms);
+}
+
+void Profiler::pushHistory(const char* name, f64 ms)
+{
+    // s_Zones never erases, so pointers to its values stay valid across rehashes
+    ZoneHistory*& history = s_ZonesByName[name];
+    if (history == nullptr) {
+        history = &s_Zones[name];
+    }
+    history->push(ms);
+}
+
+void Profiler::drainCpuZones()
+{
+    for (const Scope<ThreadZones>& zones : s_ThreadZones) {
+        s_DrainedZones.clear();
+        {
+            std::lock_guard<std::mutex> lock(zones->mutex);
+            // Swap rather than copy, both vectors keep their capacity from frame to frame
+            std::swap(s_DrainedZones, zones->events);
+        }
+        for (const ProfileEvent& e : s_DrainedZones) {
+            pushHistory(e.name, (f64)e.durationNs / 1e6);
+        }
+        if (s_Capturing) {
+            s_CaptureEvents.insert(s_CaptureEvents.end(), s_DrainedZones.begin(), s_DrainedZones.end());
+        }
+    }
+}
+
+void Profiler::beginFrame()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    // Before the capture state moves on, the buffered zones belong to the frame that just ended
+    drainCpuZones();
+
+    u64 now = nowNs();
+    if (s_LastFrameNs != 0) {
+        pushHistory("Frame", (f64)(now - s_LastFrameNs) / 1e6);
+        if (s_Capturing) {
+            s_CaptureEvents.push_back({ "Frame", currentThreadId(), s_LastFrameNs, now - s_LastFrameNs });
+        }
+    }
+    s_LastFrameNs = now;
+
+    if (s_CaptureFramesLeft > 0) {
+        s_Capturing = true;
+        s_CaptureFramesLeft--;
+    } else if (s_Capturing) {
+        s_Capturing = false;
+        s_CaptureWritePending = true;
+    }
+
+    if (s_CaptureWritePending) {
+        // GPU results of the captured frames trail the CPU by up to framesInFlight frames
+        bool gpuOutstanding = std::any_of(s_GpuFrames.begin(), s_GpuFrames.end(), [](const GpuFrame& f) { return f.pending && f.captured; });
+        if (!gpuOutstanding) {
+            writeCapture();
+        }
+    }
+}
+
+void Profiler::recordCpuZone(const char* name, u64 startNs, u64 endNs)
+{
+    thread_local ThreadZones* zones = nullptr;
+    if (zones == nullptr) {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        zones = s_ThreadZones.emplace_back(CreateScope<ThreadZones>()).get();
+        zones->threadId = currentThreadId();
+    }
+
+    std::lock_guard<std::mutex> lock(zones->mutex);
+    if (zones->events.size() < MAX_PENDING_CPU_ZONES) {
+        zones->events.push_back({ name, zones->threadId, startNs, endNs - startNs });
+    }
+}
+
+void Profiler::initGpu(VkPhysicalDevice physicalDevice, VkDevice device, u32 queueFamily, u32 framesInFlight)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+    u32 queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    u32 validBits = queueFamilies[queueFamily].timestampValidBits;
+    if (validBits == 0) {
+        VKP_WARN("Profiler: queue family {} does not support timestamps, GPU zones disabled", queueFamily);
+        return;
+    }
+    s_TimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    s_TimestampPeriodNs = properties.limits.timestampPeriod;
+    // The frame's statistics query stays active across vkCmdExecuteCommands, the secondaries have to inherit it
+    s_PipelineStatisticsSupported = features.pipelineStatisticsQuery && features.inheritedQueries;
+    s_Device = device;
+
+    VkQueryPoolCreateInfo timestampInfo {};
+    timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    timestampInfo.queryCount = MAX_GPU_ZONES * 2;
+
+    VkQueryPoolCreateInfo statisticsInfo {};
+    statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statisticsInfo.queryCount = 1;
+    statisticsInfo.pipelineStatistics = PIPELINE_STATISTICS;
+
+    s_GpuFrames.resize(framesInFlight);
+    for (GpuFrame& frame : s_GpuFrames) {
+        VkResult res = vkCreateQueryPool(device, &timestampInfo, VKP_ALLOCATION_CALLBACKS, &frame.timestampPool);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE TIMESTAMP QUERY POOL");
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_QUERY_POOL, frame.timestampPool, "Profiler timestamps");
+        if (s_PipelineStatisticsSupported) {
+            res = vkCreateQueryPool(device, &statisticsInfo, VKP_ALLOCATION_CALLBACKS, &frame.statisticsPool);
+            VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE PIPELINE STATISTICS QUERY POOL");
+            VKP_TRACK_OBJECT(VK_OBJECT_TYPE_QUERY_POOL, frame.statisticsPool, "Profiler pipeline statistics");
+        }
+    }
+
+    VKP_INFO("Profiler: GPU timestamps enabled ({} valid bits, {:.2f}ns period), pipeline statistics {}",
+        validBits, s_TimestampPeriodNs, s_PipelineStatisticsSupported ? "enabled" : "unsupported");
+}
+
+void Profiler::shutdownGpu()
+{
+    if (s_Device == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Caller has idled the device, so every outstanding query is available now
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        drainCpuZones();
+        for (GpuFrame& frame : s_GpuFrames) {
+            resolveGpuFrame(frame);
+        }
+        if (s_Capturing || s_CaptureWritePending) {
+            s_Capturing = false;
+            writeCapture();
+        }
+    }
+
+    for (GpuFrame& frame : s_GpuFrames) {
+        VKP_UNTRACK(frame.timestampPool);
+        vkDestroyQueryPool(s_Device, frame.timestampPool, VKP_ALLOCATION_CALLBACKS);
+        if (frame.statisticsPool != VK_NULL_HANDLE) {
+            VKP_UNTRACK(frame.statisticsPool);
+            vkDestroyQueryPool(s_Device, frame.statisticsPool, VKP_ALLOCATION_CALLBACKS);
+        }
+    }
+    s_GpuFrames.clear();
+    s_CurrentGpuFrame = nullptr;
+    s_Device = VK_NULL_HANDLE;
+}
+
+void Profiler::resolveGpuFrame(GpuFrame& frame)
+{
+    if (!frame.pending) {
+        return;
+    }
+    frame.pending = false;
+
+    // [value, availability] pairs. No WAIT flag: a slot is only reused after its fence,
+    // so results are normally ready, and if they are not the frame is dropped rather than stalled on
+    std::array<u64, MAX_GPU_ZONES * 2 * 2> results {};
+    u32 queryCount = frame.zoneCount * 2;
+    if (queryCount > 0) {
+        vkGetQueryPoolResults(s_Device, frame.timestampPool, 0, queryCount, sizeof(u64) * 2 * queryCount, results.data(),
+            sizeof(u64) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        u64 frameOrigin = results[0] & s_TimestampMask;
+        for (u32 i = 0; i < frame.zoneCount; i++) {
+            u32 begin = i * 2;
+            u32 end = begin + 1;
+            if (results[begin * 2 + 1] == 0 || results[end * 2 + 1] == 0) {
+                continue;
+            }
+            u64 beginTicks = results[begin * 2] & s_TimestampMask;
+            u64 endTicks = results[end * 2] & s_TimestampMask;
+            u64 durationNs = (u64)((f64)(endTicks - beginTicks) * s_TimestampPeriodNs);
+
+            pushHistory(std::string("GPU ") + frame.zoneNames[i], (f64)durationNs / 1e6);
+            if (frame.captured) {
+                // GPU clock domain is unrelated to ours, anchor the frame at its submit time
+                u64 offsetNs = (u64)((f64)(beginTicks - frameOrigin) * s_TimestampPeriodNs);
+                s_CaptureEvents.push_back({ frame.zoneNames[i], GPU_THREAD_ID, frame.cpuSubmitNs + offsetNs, durationNs });
+            }
+        }
+    }
+
+    if (frame.statisticsPool != VK_NULL_HANDLE) {
+        std::array<u64, 5> stats {};
+        VkResult res = vkGetQueryPoolResults(s_Device, frame.statisticsPool, 0, 1, sizeof(stats), stats.data(), sizeof(stats),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (res == VK_SUCCESS && stats[4] != 0) {
+            s_LastStatistics = { stats[0], stats[1], stats[2], stats[3] };
+            if (frame.captured) {
+                s_CaptureStatistics.emplace_back(frame.cpuSubmitNs, s_LastStatistics);
+            }
+        }
+    }
+    frame.captured = false;
+}
+
+void Profiler::beginGpuFrame(VkCommandBuffer commandBuffer, u32 frameSlot)
+{
+    if (s_Device == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    GpuFrame& frame = s_GpuFrames[frameSlot];
+    resolveGpuFrame(frame);
+
+    frame.zoneCount = 0;
+    frame.captured = s_Capturing;
+    s_CurrentGpuFrame = &frame;
+
+    vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, MAX_GPU_ZONES * 2);
+    if (frame.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, 1);
+        vkCmdBeginQuery(commandBuffer, frame.statisticsPool, 0, 0);
+    }
+}
+
+VkQueryPipelineStatisticFlags Profiler::getInheritedStatistics()
+{
+    return s_PipelineStatisticsSupported ? PIPELINE_STATISTICS : 0;
+}
+
+void Profiler::endGpuFrame(VkCommandBuffer commandBuffer)
+{
+    if (s_CurrentGpuFrame == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    GpuFrame& frame = *s_CurrentGpuFrame;
+    if (frame.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdEndQuery(commandBuffer, frame.statisticsPool, 0);
+    }
+    frame.cpuSubmitNs = nowNs();
+    frame.pending = true;
+    s_CurrentGpuFrame = nullptr;
+}
+
+u32 Profiler::beginGpuZone(VkCommandBuffer commandBuffer, const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (s_CurrentGpuFrame == nullptr || s_CurrentGpuFrame->zoneCount >= MAX_GPU_ZONES) {
+        return UINT32_MAX;
+    }
+
+    u32 zone = s_CurrentGpuFrame->zoneCount++;
+    s_CurrentGpuFrame->zoneNames[zone] = name;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_CurrentGpuFrame->timestampPool, zone * 2);
+    return zone;
+}
+
+void Profiler::endGpuZone(VkCommandBuffer commandBuffer, u32 zone)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (s_CurrentGpuFrame == nullptr || zone == UINT32_MAX) {
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_CurrentGpuFrame->timestampPool, zone * 2 + 1);
+}
+
+void Profiler::requestCapture(u32 frames, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_CaptureEvents.clear();
+    s_CaptureStatistics.clear();
+    s_CaptureFramesLeft = frames;
+    s_CapturePath = path;
+    s_CaptureWritePending = false;
+}
+
+void Profiler::writeCapture()
+{
+    s_CaptureWritePending = false;
+
+    std::ofstream file(s_CapturePath);
+    if (!file.is_open()) {
+        VKP_ERROR("Profiler: unable to open capture file {}", s_CapturePath);
+        return;
+    }
+
+    // Chrome trace-event format, loadable in chrome://tracing or ui.perfetto.dev
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPU_THREAD_ID << ",\"args\":{\"name\":\"GPU\"}}";
+    for (const ProfileEvent& e : s_CaptureEvents) {
+        file << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << (e.threadId == GPU_THREAD_ID ? "gpu" : "cpu")
+             << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.threadId
+             << ",\"ts\":" << fmt::format("{:.3f}", (f64)e.startNs / 1e3)
+             << ",\"dur\":" << fmt::format("{:.3f}", (f64)e.durationNs / 1e3) << "}";
+    }
+    for (const auto& [timeNs, stats] : s_CaptureStatistics) {
+        file << ",\n{\"name\":\"Pipeline statistics\",\"ph\":\"C\",\"pid\":0,\"ts\":" << fmt::format("{:.3f}", (f64)timeNs / 1e3)
+             << ",\"args\":{\"vertices\":" << stats.inputAssemblyVertices
+             << ",\"vertexInvocations\":" << stats.vertexShaderInvocations
+             << ",\"clippingPrimitives\":" << stats.clippingPrimitives
+             << ",\"fragmentInvocations\":" << stats.fragmentShaderInvocations << "}}";
+    }
+    file << "\n]}\n";
+
+    VKP_INFO("Profiler: wrote {} events to {}", s_CaptureEvents.size(), s_CapturePath);
+    s_CaptureEvents.clear();
+    s_CaptureStatistics.clear();
+}
+
+void Profiler::logSummary()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    drainCpuZones();
+
+    // Sorted so consecutive runs are easy to compare
+    std::map<std::string, const ZoneHistory*> sorted;
+    for (const auto& [name, history] : s_Zones) {
+        sorted[name] = &history;
+    }
+
+    VKP_INFO("Profiler: last {} samples per zone", HISTORY_LENGTH);
+    for (const auto& [name, history] : sorted) {
+        std::vector<f64> samples(history->samples.begin(), history->samples.begin() + history->count);
+        BenchSummary summary = summarizeSamples(samples);
+        VKP_INFO("  {:<24} min {:8.3f}ms  avg {:8.3f}ms  p99 {:8.3f}ms", name, summary.min, summary.avg, summary.p99);
+    }
+    if (s_PipelineStatisticsSupported) {
+        VKP_INFO("  last frame: {} vertices, {} VS invocations, {} primitives, {} FS invocations",
+            s_LastStatistics.inputAssemblyVertices, s_LastStatistics.vertexShaderInvocations,
+            s_LastStatistics.clippingPrimitives, s_LastStatistics.fragmentShaderInvocations);
+    }
+}
+
+}
+
+#endif
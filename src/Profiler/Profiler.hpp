@@ -0,0 +1,175 @@
+#ifndef VKP_PROFILER
+#define VKP_PROFILER
+
+// Frame profiler. Everything below is compiled out unless VKP_PROFILE is defined,
+// the VKP_PROFILE_* macros expand to nothing in that case.
+
+#ifdef VKP_PROFILE
+
+#include "core.hpp"
+#include <Bench/Bench.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+struct ProfileEvent {
+    const char* name;
+    u32 threadId;
+    u64 startNs;
+    u64 durationNs;
+};
+
+struct PipelineStatistics {
+    u64 inputAssemblyVertices = 0;
+    u64 vertexShaderInvocations = 0;
+    u64 clippingPrimitives = 0;
+    u64 fragmentShaderInvocations = 0;
+};
+
+class Profiler {
+public:
+    // Number of samples each zone histogram keeps
+    static constexpr u32 HISTORY_LENGTH = 256;
+    // Timestamp zones a single frame may open on the GPU
+    static constexpr u32 MAX_GPU_ZONES = 64;
+
+    static u64 nowNs();
+
+    // CPU side. beginFrame marks a frame boundary for histograms and captures
+    static void beginFrame();
+    static void recordCpuZone(const char* name, u64 startNs, u64 endNs);
+
+    // GPU side. One query pool set per frame slot, resolved when the slot comes around again
+    static void initGpu(VkPhysicalDevice physicalDevice, VkDevice device, u32 queueFamily, u32 framesInFlight);
+    static void shutdownGpu();
+    static void beginGpuFrame(VkCommandBuffer commandBuffer, u32 frameSlot);
+    static void endGpuFrame(VkCommandBuffer commandBuffer);
+    // For VkCommandBufferInheritanceInfo::pipelineStatistics of secondaries executed inside a GPU frame
+    static VkQueryPipelineStatisticFlags getInheritedStatistics();
+    static u32 beginGpuZone(VkCommandBuffer commandBuffer, const char* name);
+    static void endGpuZone(VkCommandBuffer commandBuffer, u32 zone);
+
+    // Record the next `frames` frames and write them as Chrome trace-event JSON to `path`
+    static void requestCapture(u32 frames, const std::string& path);
+
+    static void logSummary();
+
+private:
+    struct ZoneHistory {
+        std::array<f64, HISTORY_LENGTH> samples {};
+        u32 next = 0;
+        u32 count = 0;
+
+        void push(f64 ms)
+        {
+            samples[next] = ms;
+            next = (next + 1) % HISTORY_LENGTH;
+            count = std::min(count + 1, HISTORY_LENGTH);
+        }
+    };
+
+    struct GpuFrame {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+        std::array<const char*, MAX_GPU_ZONES> zoneNames {};
+        u32 zoneCount = 0;
+        u64 cpuSubmitNs = 0;
+        bool pending = false;
+        bool captured = false;
+    };
+
+    static void pushHistory(const std::string& name, f64 ms);
+    static void pushHistory(const char* name, f64 ms);
+    // Moves every thread's buffered CPU zones into the histories and the capture
+    static void drainCpuZones();
+    static void resolveGpuFrame(GpuFrame& frame);
+    static void writeCapture();
+
+    static std::mutex s_Mutex;
+    static UMap<std::string, ZoneHistory> s_Zones;
+    // Zone names are string literals, so CPU zones find their history by pointer after the first sample
+    static UMap<const char*, ZoneHistory*> s_ZonesByName;
+
+    static std::vector<ProfileEvent> s_CaptureEvents;
+    static std::vector<std::pair<u64, PipelineStatistics>> s_CaptureStatistics;
+    static std::string s_CapturePath;
+    static u32 s_CaptureFramesLeft;
+    static bool s_Capturing;
+
+    static VkDevice s_Device;
+    static f64 s_TimestampPeriodNs;
+    static bool s_PipelineStatisticsSupported;
+    static std::vector<GpuFrame> s_GpuFrames;
+    static GpuFrame* s_CurrentGpuFrame;
+    static PipelineStatistics s_LastStatistics;
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name)
+        : m_Name(name)
+        , m_Start(Profiler::nowNs())
+    {
+    }
+    ~ProfileScope() { Profiler::recordCpuZone(m_Name, m_Start, Profiler::nowNs()); }
+
+private:
+    const char* m_Name;
+    u64 m_Start;
+};
+
+class GpuProfileScope {
+public:
+    GpuProfileScope(VkCommandBuffer commandBuffer, const char* name)
+        : m_CommandBuffer(commandBuffer)
+        , m_Zone(Profiler::beginGpuZone(commandBuffer, name))
+    {
+    }
+    ~GpuProfileScope() { Profiler::endGpuZone(m_CommandBuffer, m_Zone); }
+
+private:
+    VkCommandBuffer m_CommandBuffer;
+    u32 m_Zone;
+};
+
+}
+
+#define VKP_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VKP_PROFILE_CONCAT(a, b) VKP_PROFILE_CONCAT_IMPL(a, b)
+
+#define VKP_PROFILE_FRAME() VulkanProj::Profiler::beginFrame()
+#define VKP_PROFILE_SCOPE(name) VulkanProj::ProfileScope VKP_PROFILE_CONCAT(vkpProfileScope, __LINE__)(name)
+#define VKP_PROFILE_FUNCTION() VKP_PROFILE_SCOPE(__func__)
+
+#define VKP_PROFILE_GPU_INIT(physicalDevice, device, queueFamily, framesInFlight) VulkanProj::Profiler::initGpu(physicalDevice, device, queueFamily, framesInFlight)
+#define VKP_PROFILE_GPU_SHUTDOWN() VulkanProj::Profiler::shutdownGpu()
+#define VKP_PROFILE_GPU_FRAME_BEGIN(commandBuffer, frameSlot) VulkanProj::Profiler::beginGpuFrame(commandBuffer, frameSlot)
+#define VKP_PROFILE_GPU_FRAME_END(commandBuffer) VulkanProj::Profiler::endGpuFrame(commandBuffer)
+#define VKP_PROFILE_INHERITED_STATISTICS() VulkanProj::Profiler::getInheritedStatistics()
+#define VKP_PROFILE_GPU_SCOPE(commandBuffer, name) VulkanProj::GpuProfileScope VKP_PROFILE_CONCAT(vkpGpuProfileScope, __LINE__)(commandBuffer, name)
+
+#define VKP_PROFILE_CAPTURE(frames, path) VulkanProj::Profiler::requestCapture(frames, path)
+#define VKP_PROFILE_LOG_SUMMARY() VulkanProj::Profiler::logSummary()
+
+#else
+
+#define VKP_PROFILE_FRAME()
+#define VKP_PROFILE_SCOPE(name)
+#define VKP_PROFILE_FUNCTION()
+
+#define VKP_PROFILE_GPU_INIT(physicalDevice, device, queueFamily, framesInFlight)
+#define VKP_PROFILE_GPU_SHUTDOWN()
+#define VKP_PROFILE_GPU_FRAME_BEGIN(commandBuffer, frameSlot)
+#define VKP_PROFILE_GPU_FRAME_END(commandBuffer)
+#define VKP_PROFILE_INHERITED_STATISTICS() 0
+#define VKP_PROFILE_GPU_SCOPE(commandBuffer, name)
+
+#define VKP_PROFILE_CAPTURE(frames, path) VKP_WARN("Profiler is compiled out, ignoring capture of {} frames to {}", frames, path)
+#define VKP_PROFILE_LOG_SUMMARY()
+
+#endif
+
+#endif
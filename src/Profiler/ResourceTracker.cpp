@@ -0,0 +1,461 @@
+#include "Profiler/ResourceTracker.hpp"
+
+#ifdef VKP_TRACK_RESOURCES
+
+#include "Core/Json.hpp"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+namespace VulkanProj {
+
+static constexpr u32 SNAPSHOT_VERSION = 1;
+
+std::array<ResourceTracker::Shard, ResourceTracker::SHARD_COUNT> ResourceTracker::s_Shards;
+std::array<ResourceTracker::HeapCounters, VK_MAX_MEMORY_HEAPS> ResourceTracker::s_Heaps;
+std::atomic<u32> ResourceTracker::s_ObjectCount = 0;
+
+VkInstance ResourceTracker::s_Instance = VK_NULL_HANDLE;
+VkPhysicalDevice ResourceTracker::s_PhysicalDevice = VK_NULL_HANDLE;
+VkDevice ResourceTracker::s_Device = VK_NULL_HANDLE;
+VkPhysicalDeviceMemoryProperties ResourceTracker::s_MemoryProperties {};
+bool ResourceTracker::s_MemoryBudget = false;
+PFN_vkSetDebugUtilsObjectNameEXT ResourceTracker::s_SetObjectName = nullptr;
+
+// Host allocations are counted with relaxed atomics only, drivers allocate from any thread
+static std::array<std::atomic<u64>, HostMemoryStats::SCOPE_COUNT> s_HostBytes;
+static std::array<std::atomic<u64>, HostMemoryStats::SCOPE_COUNT> s_HostAllocations;
+static std::atomic<u64> s_HostTotalBytes = 0;
+static std::atomic<u64> s_HostPeakBytes = 0;
+static std::atomic<u64> s_HostInternalBytes = 0;
+
+static void raisePeak(std::atomic<u64>& peak, u64 value)
+{
+    u64 current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Sits right before every block handed to the driver, frees and reallocations need the size and scope
+struct HostAllocationHeader {
+    void* base;
+    size_t size;
+    VkSystemAllocationScope scope;
+};
+
+static void countHostAllocation(VkSystemAllocationScope scope, size_t size)
+{
+    s_HostBytes[scope].fetch_add(size, std::memory_order_relaxed);
+    s_HostAllocations[scope].fetch_add(1, std::memory_order_relaxed);
+    raisePeak(s_HostPeakBytes, s_HostTotalBytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+static void countHostFree(VkSystemAllocationScope scope, size_t size)
+{
+    s_HostBytes[scope].fetch_sub(size, std::memory_order_relaxed);
+    s_HostAllocations[scope].fetch_sub(1, std::memory_order_relaxed);
+    s_HostTotalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static void* VKAPI_PTR hostAllocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    alignment = std::max(alignment, alignof(HostAllocationHeader));
+    u8* base = static_cast<u8*>(std::malloc(size + sizeof(HostAllocationHeader) + alignment));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    uintptr_t data = ((uintptr_t)(base + sizeof(HostAllocationHeader)) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    HostAllocationHeader* header = reinterpret_cast<HostAllocationHeader*>(data) - 1;
+    header->base = base;
+    header->size = size;
+    header->scope = scope;
+    countHostAllocation(scope, size);
+    return reinterpret_cast<void*>(data);
+}
+
+static void VKAPI_PTR hostFree(void* userData, void* memory)
+{
+    if (memory == nullptr) {
+        return;
+    }
+    HostAllocationHeader* header = static_cast<HostAllocationHeader*>(memory) - 1;
+    countHostFree(header->scope, header->size);
+    std::free(header->base);
+}
+
+static void* VKAPI_PTR hostReallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (original == nullptr) {
+        return hostAllocate(userData, size, alignment, scope);
+    }
+    if (size == 0) {
+        hostFree(userData, original);
+        return nullptr;
+    }
+    void* memory = hostAllocate(userData, size, alignment, scope);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    const HostAllocationHeader* header = static_cast<HostAllocationHeader*>(original) - 1;
+    std::memcpy(memory, original, std::min(size, header->size));
+    hostFree(userData, original);
+    return memory;
+}
+
+static void VKAPI_PTR hostInternalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+    s_HostInternalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void VKAPI_PTR hostInternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+    s_HostInternalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static const VkAllocationCallbacks s_AllocationCallbacks = {
+    nullptr,
+    hostAllocate,
+    hostReallocate,
+    hostFree,
+    hostInternalAllocation,
+    hostInternalFree,
+};
+
+u64 HostMemoryStats::totalBytes() const
+{
+    u64 total = 0;
+    for (u64 scopeBytes : bytes) {
+        total += scopeBytes;
+    }
+    return total;
+}
+
+static const char* objectTypeName(VkObjectType type)
+{
+    switch (type) {
+    case VK_OBJECT_TYPE_INSTANCE:
+        return "instance";
+    case VK_OBJECT_TYPE_DEVICE:
+        return "device";
+    case VK_OBJECT_TYPE_SEMAPHORE:
+        return "semaphore";
+    case VK_OBJECT_TYPE_FENCE:
+        return "fence";
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        return "device memory";
+    case VK_OBJECT_TYPE_BUFFER:
+        return "buffer";
+    case VK_OBJECT_TYPE_IMAGE:
+        return "image";
+    case VK_OBJECT_TYPE_QUERY_POOL:
+        return "query pool";
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        return "image view";
+    case VK_OBJECT_TYPE_SHADER_MODULE:
+        return "shader module";
+    case VK_OBJECT_TYPE_PIPELINE_CACHE:
+        return "pipeline cache";
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        return "pipeline layout";
+    case VK_OBJECT_TYPE_PIPELINE:
+        return "pipeline";
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+        return "descriptor set layout";
+    case VK_OBJECT_TYPE_SAMPLER:
+        return "sampler";
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        return "descriptor pool";
+    case VK_OBJECT_TYPE_COMMAND_POOL:
+        return "command pool";
+    case VK_OBJECT_TYPE_SURFACE_KHR:
+        return "surface";
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        return "swapchain";
+    default:
+        return "other";
+    }
+}
+
+static std::string siteName(const TrackedObject& object)
+{
+    return fmt::format("{}:{}", std::filesystem::path(object.file).filename().string(), object.line);
+}
+
+void ResourceTracker::init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudget, bool debugNames)
+{
+    s_Instance = instance;
+    s_PhysicalDevice = physicalDevice;
+    s_Device = device;
+    s_MemoryBudget = memoryBudget;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &s_MemoryProperties);
+
+    // Only loaded when VK_EXT_debug_utils is enabled, names then show up in validation messages and captures
+    if (debugNames) {
+        s_SetObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT");
+    }
+}
+
+u32 ResourceTracker::shutdown()
+{
+    std::vector<TrackedObject> leaked = collectObjects();
+    if (!leaked.empty()) {
+        VKP_WARN("ResourceTracker: {} Vulkan objects still alive at shutdown", leaked.size());
+        for (const TrackedObject& object : leaked) {
+            VKP_WARN("  {} '{}' (0x{:x}) created at {}", objectTypeName(object.type), object.name, object.handle, siteName(object));
+        }
+    }
+
+    // Everything was created with these callbacks, so with the instance gone nothing should remain
+    HostMemoryStats host = getHostMemoryStats();
+    if (host.totalBytes() > 0) {
+        VKP_WARN("ResourceTracker: driver still holds {} bytes of host memory in {} allocations", host.totalBytes(),
+            std::accumulate(host.allocations.begin(), host.allocations.end(), (u64)0));
+    }
+
+    s_SetObjectName = nullptr;
+    s_Device = VK_NULL_HANDLE;
+    s_PhysicalDevice = VK_NULL_HANDLE;
+    s_Instance = VK_NULL_HANDLE;
+    return (u32)leaked.size();
+}
+
+const VkAllocationCallbacks* ResourceTracker::getAllocationCallbacks()
+{
+    return &s_AllocationCallbacks;
+}
+
+ResourceTracker::Shard& ResourceTracker::getShard(u64 handle)
+{
+    // Handles are often aligned pointers, mix the bits before picking a shard
+    return s_Shards[(handle * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(SHARD_COUNT))];
+}
+
+void ResourceTracker::registerObject(TrackedObject object, const char* name)
+{
+    // Named before the object is published, only the creating thread can see it yet
+    if (s_SetObjectName != nullptr && name != nullptr) {
+        VkDebugUtilsObjectNameInfoEXT nameInfo {};
+        nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+        nameInfo.objectType = object.type;
+        nameInfo.objectHandle = object.handle;
+        nameInfo.pObjectName = name;
+        s_SetObjectName(s_Device, &nameInfo);
+    }
+
+    u64 handle = object.handle;
+    Shard& shard = getShard(handle);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.objects.try_emplace(handle, std::move(object));
+    if (!inserted) {
+        // Non-dispatchable handles are not guaranteed unique, keep the newest record
+        VKP_WARN("ResourceTracker: {} 0x{:x} tracked twice, first created at {}", objectTypeName(it->second.type), handle, siteName(it->second));
+        it->second = std::move(object);
+        return;
+    }
+    s_ObjectCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ResourceTracker::trackObject(VkObjectType type, u64 handle, const char* name, std::source_location site)
+{
+    if (handle == 0) {
+        return;
+    }
+
+    TrackedObject object;
+    object.type = type;
+    object.handle = handle;
+    object.name = name != nullptr ? name : "";
+    object.file = site.file_name();
+    object.line = site.line();
+    registerObject(std::move(object), name);
+}
+
+void ResourceTracker::trackMemory(VkDeviceMemory memory, VkDeviceSize size, u32 memoryType, const char* name, std::source_location site)
+{
+    if (memory == VK_NULL_HANDLE) {
+        return;
+    }
+    VKP_ASSERT(s_Device != VK_NULL_HANDLE, "RESOURCE TRACKER MUST BE INITIALIZED BEFORE DEVICE MEMORY IS TRACKED");
+
+    TrackedObject object;
+    object.type = VK_OBJECT_TYPE_DEVICE_MEMORY;
+    object.handle = (u64)memory;
+    object.name = name != nullptr ? name : "";
+    object.file = site.file_name();
+    object.line = site.line();
+    object.size = size;
+    object.heap = s_MemoryProperties.memoryTypes[memoryType].heapIndex;
+
+    HeapCounters& counters = s_Heaps[object.heap];
+    raisePeak(counters.peakBytes, counters.bytes.fetch_add(size, std::memory_order_relaxed) + size);
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    registerObject(std::move(object), name);
+}
+
+void ResourceTracker::untrack(u64 handle)
+{
+    if (handle == 0) {
+        return;
+    }
+
+    TrackedObject object;
+    {
+        Shard& shard = getShard(handle);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.objects.find(handle);
+        if (it == shard.objects.end()) {
+            VKP_WARN("ResourceTracker: destroying untracked handle 0x{:x}", handle);
+            return;
+        }
+        object = std::move(it->second);
+        shard.objects.erase(it);
+    }
+    s_ObjectCount.fetch_sub(1, std::memory_order_relaxed);
+
+    if (object.type == VK_OBJECT_TYPE_DEVICE_MEMORY) {
+        HeapCounters& counters = s_Heaps[object.heap];
+        counters.bytes.fetch_sub(object.size, std::memory_order_relaxed);
+        counters.allocations.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+u32 ResourceTracker::getObjectCount()
+{
+    return s_ObjectCount.load(std::memory_order_relaxed);
+}
+
+std::vector<TrackedHeap> ResourceTracker::getHeaps()
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (s_MemoryBudget) {
+        VkPhysicalDeviceMemoryProperties2 properties {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(s_PhysicalDevice, &properties);
+    }
+
+    std::vector<TrackedHeap> heaps(s_MemoryProperties.memoryHeapCount);
+    for (u32 i = 0; i < heaps.size(); i++) {
+        TrackedHeap& heap = heaps[i];
+        heap.heapSize = s_MemoryProperties.memoryHeaps[i].size;
+        heap.deviceLocal = s_MemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        heap.trackedBytes = s_Heaps[i].bytes.load(std::memory_order_relaxed);
+        heap.peakBytes = s_Heaps[i].peakBytes.load(std::memory_order_relaxed);
+        heap.allocationCount = s_Heaps[i].allocations.load(std::memory_order_relaxed);
+        heap.budgetBytes = budgetProperties.heapBudget[i];
+        heap.usageBytes = budgetProperties.heapUsage[i];
+    }
+    return heaps;
+}
+
+HostMemoryStats ResourceTracker::getHostMemoryStats()
+{
+    HostMemoryStats stats;
+    for (u32 i = 0; i < HostMemoryStats::SCOPE_COUNT; i++) {
+        stats.bytes[i] = s_HostBytes[i].load(std::memory_order_relaxed);
+        stats.allocations[i] = s_HostAllocations[i].load(std::memory_order_relaxed);
+    }
+    stats.peakBytes = s_HostPeakBytes.load(std::memory_order_relaxed);
+    stats.internalBytes = s_HostInternalBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<TrackedObject> ResourceTracker::collectObjects()
+{
+    std::vector<TrackedObject> objects;
+    objects.reserve(getObjectCount());
+    for (Shard& shard : s_Shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [handle, object] : shard.objects) {
+            objects.push_back(object);
+        }
+    }
+    // Largest memory first, then grouped by type, so reports diff cleanly between runs
+    std::sort(objects.begin(), objects.end(), [](const TrackedObject& a, const TrackedObject& b) {
+        if (a.size != b.size) {
+            return a.size > b.size;
+        }
+        if (a.type != b.type) {
+            return a.type < b.type;
+        }
+        return a.name < b.name;
+    });
+    return objects;
+}
+
+bool ResourceTracker::writeSnapshot(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        VKP_ERROR("ResourceTracker: unable to open snapshot file {}", path);
+        return false;
+    }
+
+    std::vector<TrackedObject> objects = collectObjects();
+    std::vector<TrackedHeap> heaps = getHeaps();
+    HostMemoryStats host = getHostMemoryStats();
+
+    file << "{\n  \"version\": " << SNAPSHOT_VERSION << ",\n";
+
+    file << "  \"heaps\": [";
+    for (size_t i = 0; i < heaps.size(); i++) {
+        const TrackedHeap& heap = heaps[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << fmt::format("    {{\"index\": {}, \"size\": {}, \"deviceLocal\": {}, \"trackedBytes\": {}, \"peakBytes\": {}, "
+                            "\"allocations\": {}, \"budgetBytes\": {}, \"usageBytes\": {}}}",
+            i, heap.heapSize, heap.deviceLocal, heap.trackedBytes, heap.peakBytes, heap.allocationCount, heap.budgetBytes, heap.usageBytes);
+    }
+    file << "\n  ],\n";
+
+    file << fmt::format("  \"host\": {{\"totalBytes\": {}, \"peakBytes\": {}, \"internalBytes\": {}, \"scopes\": {{"
+                        "\"command\": {}, \"object\": {}, \"cache\": {}, \"device\": {}, \"instance\": {}}}}},\n",
+        host.totalBytes(), host.peakBytes, host.internalBytes, host.bytes[VK_SYSTEM_ALLOCATION_SCOPE_COMMAND],
+        host.bytes[VK_SYSTEM_ALLOCATION_SCOPE_OBJECT], host.bytes[VK_SYSTEM_ALLOCATION_SCOPE_CACHE],
+        host.bytes[VK_SYSTEM_ALLOCATION_SCOPE_DEVICE], host.bytes[VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE]);
+
+    file << "  \"objects\": [";
+    for (size_t i = 0; i < objects.size(); i++) {
+        const TrackedObject& object = objects[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << fmt::format("    {{\"type\": \"{}\", \"handle\": \"0x{:x}\", \"name\": \"{}\", \"site\": \"{}\"", objectTypeName(object.type),
+            object.handle, escapeJson(object.name), escapeJson(siteName(object)));
+        if (object.type == VK_OBJECT_TYPE_DEVICE_MEMORY) {
+            file << fmt::format(", \"size\": {}, \"heap\": {}", object.size, object.heap);
+        }
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+
+    VKP_INFO("ResourceTracker: wrote {} objects to {}", objects.size(), path);
+    return true;
+}
+
+void ResourceTracker::logSummary()
+{
+    std::map<std::string, u32> typeCounts;
+    for (const TrackedObject& object : collectObjects()) {
+        typeCounts[objectTypeName(object.type)]++;
+    }
+
+    VKP_INFO("ResourceTracker: {} live Vulkan objects", getObjectCount());
+    for (const auto& [type, count] : typeCounts) {
+        VKP_INFO("  {:<24} {}", type, count);
+    }
+    std::vector<TrackedHeap> heaps = getHeaps();
+    for (u32 i = 0; i < heaps.size(); i++) {
+        const TrackedHeap& heap = heaps[i];
+        VKP_INFO("  heap {}{}: {:.1f} MiB in {} allocations (peak {:.1f} MiB), budget {:.1f} MiB, process usage {:.1f} MiB", i,
+            heap.deviceLocal ? " (device local)" : "", heap.trackedBytes / (1024.0 * 1024.0), heap.allocationCount,
+            heap.peakBytes / (1024.0 * 1024.0), heap.budgetBytes / (1024.0 * 1024.0), heap.usageBytes / (1024.0 * 1024.0));
+    }
+    HostMemoryStats host = getHostMemoryStats();
+    VKP_INFO("  driver host memory: {:.1f} KiB (peak {:.1f} KiB), {:.1f} KiB internal", host.totalBytes() / 1024.0, host.peakBytes / 1024.0,
+        host.internalBytes / 1024.0);
+}
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef VKP_RESOURCETRACKER
+#define VKP_RESOURCETRACKER
+
+// Vulkan object and memory tracking. Every object the engine creates is registered with its type,
+// debug name and creation site, device memory also with its size and heap, and driver host memory
+// is counted through VkAllocationCallbacks. Compiled out unless VKP_TRACK_RESOURCES is defined,
+// the VKP_TRACK_* macros then expand to nothing and VKP_ALLOCATION_CALLBACKS to nullptr.
+
+#ifdef VKP_TRACK_RESOURCES
+
+#include "core.hpp"
+#include <atomic>
+#include <mutex>
+#include <source_location>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+struct TrackedObject {
+    VkObjectType type = VK_OBJECT_TYPE_UNKNOWN;
+    u64 handle = 0;
+    std::string name;
+    const char* file = "";
+    u32 line = 0;
+    // Device memory only
+    VkDeviceSize size = 0;
+    u32 heap = 0;
+};
+
+struct TrackedHeap {
+    VkDeviceSize heapSize = 0;
+    bool deviceLocal = false;
+    // Device memory the engine holds in this heap, and the most it has held at once
+    VkDeviceSize trackedBytes = 0;
+    VkDeviceSize peakBytes = 0;
+    u32 allocationCount = 0;
+    // What VK_EXT_memory_budget reports for the whole process, 0 without the extension
+    VkDeviceSize budgetBytes = 0;
+    VkDeviceSize usageBytes = 0;
+};
+
+// Driver host memory allocated through the tracker's callbacks, indexed by VkSystemAllocationScope
+struct HostMemoryStats {
+    static constexpr u32 SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    std::array<u64, SCOPE_COUNT> bytes {};
+    std::array<u64, SCOPE_COUNT> allocations {};
+    u64 peakBytes = 0;
+    // Reported by the driver through pfnInternalAllocation, it allocated this memory itself
+    u64 internalBytes = 0;
+
+    u64 totalBytes() const;
+};
+
+class ResourceTracker {
+public:
+    // Power of two, handles are spread over this many independently locked maps
+    static constexpr u32 SHARD_COUNT = 16;
+
+    // Objects may be tracked before init, device memory and debug names need it
+    static void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudget, bool debugNames);
+    // Logs whatever is still tracked and host memory the driver has not returned. Call once every
+    // object, the device and the instance are destroyed. Returns the number of leaked objects
+    static u32 shutdown();
+
+    // Pass to every vkCreate*/vkDestroy* pair so the driver's host allocations are attributed
+    static const VkAllocationCallbacks* getAllocationCallbacks();
+
+    static void trackObject(VkObjectType type, u64 handle, const char* name, std::source_location site = std::source_location::current());
+    static void trackMemory(VkDeviceMemory memory, VkDeviceSize size, u32 memoryType, const char* name,
+        std::source_location site = std::source_location::current());
+    static void untrack(u64 handle);
+
+    static u32 getObjectCount();
+    static std::vector<TrackedHeap> getHeaps();
+    static HostMemoryStats getHostMemoryStats();
+
+    // Every live object, per-heap totals, budgets and host memory as JSON
+    static bool writeSnapshot(const std::string& path);
+    static void logSummary();
+
+private:
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        UMap<u64, TrackedObject> objects;
+    };
+
+    struct alignas(64) HeapCounters {
+        std::atomic<u64> bytes = 0;
+        std::atomic<u64> peakBytes = 0;
+        std::atomic<u32> allocations = 0;
+    };
+
+    static Shard& getShard(u64 handle);
+    static void registerObject(TrackedObject object, const char* name);
+    static std::vector<TrackedObject> collectObjects();
+
+    static std::array<Shard, SHARD_COUNT> s_Shards;
+    static std::array<HeapCounters, VK_MAX_MEMORY_HEAPS> s_Heaps;
+    static std::atomic<u32> s_ObjectCount;
+
+    static VkInstance s_Instance;
+    static VkPhysicalDevice s_PhysicalDevice;
+    static VkDevice s_Device;
+    static VkPhysicalDeviceMemoryProperties s_MemoryProperties;
+    static bool s_MemoryBudget;
+    static PFN_vkSetDebugUtilsObjectNameEXT s_SetObjectName;
+};
+
+}
+
+// Handles are pointers or u64 depending on the platform, the C cast takes either
+#define VKP_TRACK_INIT(instance, physicalDevice, device, memoryBudget, debugNames) VulkanProj::ResourceTracker::init(instance, physicalDevice, device, memoryBudget, debugNames)
+#define VKP_TRACK_SHUTDOWN() VulkanProj::ResourceTracker::shutdown()
+#define VKP_TRACK_OBJECT(type, handle, name) VulkanProj::ResourceTracker::trackObject(type, (u64)(handle), name)
+#define VKP_TRACK_MEMORY(memory, size, memoryType, name) VulkanProj::ResourceTracker::trackMemory(memory, size, memoryType, name)
+#define VKP_UNTRACK(handle) VulkanProj::ResourceTracker::untrack((u64)(handle))
+#define VKP_TRACK_SNAPSHOT(path) VulkanProj::ResourceTracker::writeSnapshot(path)
+#define VKP_TRACK_LOG_SUMMARY() VulkanProj::ResourceTracker::logSummary()
+#define VKP_ALLOCATION_CALLBACKS VulkanProj::ResourceTracker::getAllocationCallbacks()
+
+#else
+
+#define VKP_TRACK_INIT(instance, physicalDevice, device, memoryBudget, debugNames)
+#define VKP_TRACK_SHUTDOWN()
+#define VKP_TRACK_OBJECT(type, handle, name)
+#define VKP_TRACK_MEMORY(memory, size, memoryType, name)
+#define VKP_UNTRACK(handle)
+#define VKP_TRACK_SNAPSHOT(path) VKP_WARN("Resource tracking is compiled out, ignoring snapshot to {}", path)
+#define VKP_TRACK_LOG_SUMMARY()
+#define VKP_ALLOCATION_CALLBACKS nullptr
+
+#endif
+
+#endif
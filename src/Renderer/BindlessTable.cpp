@@ -0,0 +1,177 @@
+#include "Renderer/BindlessTable.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace VulkanProj {
+
+u32 BindlessTable::IndexPool::take()
+{
+    if (!free.empty()) {
+        u32 index = free.back();
+        free.pop_back();
+        return index;
+    }
+    VKP_ASSERT(next < capacity, "BINDLESS TABLE IS FULL");
+    return next++;
+}
+
+void BindlessTable::init(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorLayoutCache& layouts, u32 framesInFlight,
+    u32 maxBuffers, u32 maxTextures)
+{
+    m_Device = device;
+
+    VkPhysicalDeviceVulkan12Properties properties12 {};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    m_Buffers.capacity = std::min({ maxBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+    m_Textures.capacity = std::min({ maxTextures, properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+        properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    m_Buffers.retired.resize(framesInFlight);
+    m_Textures.retired.resize(framesInFlight);
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings {};
+    bindings[0].binding = STORAGE_BUFFER_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = m_Buffers.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = TEXTURE_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = m_Textures.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Unwritten elements are fine as long as shaders never index them, and elements pending
+    // command buffers don't use may be written while those command buffers execute
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags;
+    bindingFlags.fill(VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+        | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo {};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = (u32)bindingFlags.size();
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = (u32)bindings.size();
+    layoutInfo.pBindings = bindings.data();
+    m_SetLayout = layouts.get(layoutInfo);
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes = { {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Buffers.capacity },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_Textures.capacity },
+    } };
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = (u32)poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    VkResult res = vkCreateDescriptorPool(m_Device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &m_Pool);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE BINDLESS DESCRIPTOR POOL");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_Pool, "Bindless descriptor pool");
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_Pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_SetLayout;
+    res = vkAllocateDescriptorSets(m_Device, &allocInfo, &m_Set);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE BINDLESS DESCRIPTOR SET");
+
+    VKP_INFO("Bindless table: {} storage buffers, {} textures", m_Buffers.capacity, m_Textures.capacity);
+}
+
+void BindlessTable::destroy()
+{
+    // The layout belongs to the cache
+    VKP_UNTRACK(m_Pool);
+    vkDestroyDescriptorPool(m_Device, m_Pool, VKP_ALLOCATION_CALLBACKS);
+    m_Pool = VK_NULL_HANDLE;
+    m_Set = VK_NULL_HANDLE;
+    m_Buffers = {};
+    m_Textures = {};
+}
+
+void BindlessTable::beginFrame(u32 frameSlot)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FrameSlot = frameSlot;
+    for (IndexPool* pool : { &m_Buffers, &m_Textures }) {
+        std::vector<u32>& retired = pool->retired[frameSlot];
+        pool->free.insert(pool->free.end(), retired.begin(), retired.end());
+        retired.clear();
+    }
+}
+
+u32 BindlessTable::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    u32 index = m_Buffers.take();
+
+    VkDescriptorBufferInfo bufferInfo { buffer, offset, range };
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_Set;
+    write.dstBinding = STORAGE_BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+    return index;
+}
+
+u32 BindlessTable::registerTexture(VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    u32 index;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        index = m_Textures.take();
+    }
+    updateTexture(index, view, sampler, layout);
+    return index;
+}
+
+void BindlessTable::updateTexture(u32 index, VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    VkDescriptorImageInfo imageInfo { sampler, view, layout };
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_Set;
+    write.dstBinding = TEXTURE_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+}
+
+void BindlessTable::releaseBuffer(u32 index)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Buffers.retired[m_FrameSlot].push_back(index);
+}
+
+void BindlessTable::releaseTexture(u32 index)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Textures.retired[m_FrameSlot].push_back(index);
+}
+
+void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, u32 setIndex) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, setIndex, 1, &m_Set, 0, nullptr);
+}
+
+}
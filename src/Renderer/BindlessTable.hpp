@@ -0,0 +1,72 @@
+#ifndef VKP_BINDLESSTABLE
+#define VKP_BINDLESSTABLE
+
+#include "Renderer/DescriptorAllocator.hpp"
+#include "core.hpp"
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// One global descriptor set holding every long-lived resource the shaders read. Buffers and
+// textures are registered once and addressed by index (push constants, material data), so a
+// frame binds this set once per command buffer and draws never bind or allocate descriptors.
+// The arrays are partially bound, update-after-bind and update-unused-while-pending: writing an
+// index that no in-flight frame reads is legal, so registration never waits on the GPU.
+class BindlessTable {
+public:
+    static constexpr u32 STORAGE_BUFFER_BINDING = 0;
+    static constexpr u32 TEXTURE_BINDING = 1;
+    static constexpr u32 INVALID_INDEX = ~0u;
+
+    // Array sizes are clamped to the device's update-after-bind limits
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorLayoutCache& layouts, u32 framesInFlight,
+        u32 maxBuffers = 4096, u32 maxTextures = 4096);
+    void destroy();
+
+    // Indices released during this slot's previous frame become reusable. The slot's previous
+    // submission must have completed
+    void beginFrame(u32 frameSlot);
+
+    // Thread safe
+    u32 registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    u32 registerTexture(VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Repoints an existing index, e.g. when a streamed texture gets a higher mip resident
+    void updateTexture(u32 index, VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // The index is recycled once frames that may still read it are done
+    void releaseBuffer(u32 index);
+    void releaseTexture(u32 index);
+
+    void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, u32 setIndex = 0) const;
+
+    VkDescriptorSetLayout getSetLayout() const { return m_SetLayout; }
+    VkDescriptorSet getSet() const { return m_Set; }
+    u32 getBufferCapacity() const { return m_Buffers.capacity; }
+    u32 getTextureCapacity() const { return m_Textures.capacity; }
+
+private:
+    struct IndexPool {
+        u32 capacity = 0;
+        u32 next = 0;
+        std::vector<u32> free;
+        // Released per frame slot, waiting for that slot to come around again
+        std::vector<std::vector<u32>> retired;
+
+        u32 take();
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_Pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_Set = VK_NULL_HANDLE;
+    u32 m_FrameSlot = 0;
+
+    // Guards the index pools and writes to m_Set, which must be externally synchronized
+    mutable std::mutex m_Mutex;
+    IndexPool m_Buffers;
+    IndexPool m_Textures;
+};
+
+}
+
+#endif
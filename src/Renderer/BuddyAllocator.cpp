@@ -0,0 +1,88 @@
+#include "Renderer/BuddyAllocator.hpp"
+
+#include <bit>
+
+namespace VulkanProj {
+
+BuddyAllocator::BuddyAllocator(u64 capacity, u64 minBlockSize)
+    : m_Capacity(capacity)
+    , m_MinBlockSize(minBlockSize)
+{
+    VKP_ASSERT(std::has_single_bit(capacity) && std::has_single_bit(minBlockSize) && minBlockSize <= capacity,
+        "BUDDY CAPACITY AND BLOCK SIZE MUST BE POWERS OF TWO");
+
+    m_MaxOrder = (u32)std::countr_zero(capacity / minBlockSize);
+    m_FreeLists.resize(m_MaxOrder + 1);
+    m_FreeLists[m_MaxOrder].insert(0);
+}
+
+u32 BuddyAllocator::orderForSize(u64 size) const
+{
+    u64 blocks = (std::max(size, m_MinBlockSize) + m_MinBlockSize - 1) / m_MinBlockSize;
+    return (u32)std::bit_width(blocks - 1);
+}
+
+u64 BuddyAllocator::allocate(u64 size, u64 alignment)
+{
+    // Blocks of order n start at multiples of their own size, so a large enough block is also aligned
+    u32 order = orderForSize(std::max(size, alignment));
+    if (size == 0 || order > m_MaxOrder) {
+        return INVALID_OFFSET;
+    }
+
+    u32 available = order;
+    while (available <= m_MaxOrder && m_FreeLists[available].empty()) {
+        available++;
+    }
+    if (available > m_MaxOrder) {
+        return INVALID_OFFSET;
+    }
+
+    auto it = m_FreeLists[available].begin();
+    u64 offset = *it;
+    m_FreeLists[available].erase(it);
+
+    // Split down to the requested order, keeping the upper halves free
+    while (available > order) {
+        available--;
+        m_FreeLists[available].insert(offset + blockSize(available));
+    }
+
+    m_AllocatedOrders[offset] = order;
+    m_UsedBytes += blockSize(order);
+    return offset;
+}
+
+void BuddyAllocator::free(u64 offset)
+{
+    auto it = m_AllocatedOrders.find(offset);
+    VKP_ASSERT(it != m_AllocatedOrders.end(), "FREEING UNKNOWN BUDDY OFFSET");
+    if (it == m_AllocatedOrders.end()) {
+        return;
+    }
+
+    u32 order = it->second;
+    m_AllocatedOrders.erase(it);
+    m_UsedBytes -= blockSize(order);
+
+    // Merge with the buddy for as long as it is free as well
+    while (order < m_MaxOrder) {
+        u64 buddy = offset ^ blockSize(order);
+        auto buddyIt = m_FreeLists[order].find(buddy);
+        if (buddyIt == m_FreeLists[order].end()) {
+            break;
+        }
+        m_FreeLists[order].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    m_FreeLists[order].insert(offset);
+}
+
+u64 BuddyAllocator::getAllocationSize(u64 offset) const
+{
+    auto it = m_AllocatedOrders.find(offset);
+    return it == m_AllocatedOrders.end() ? 0 : blockSize(it->second);
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef VKP_BUDDYALLOCATOR
+#define VKP_BUDDYALLOCATOR
+
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// Power-of-two buddy sub-allocator over an abstract [0, capacity) range. Knows nothing
+// about Vulkan, DeviceAllocator maps ranges onto VkDeviceMemory blocks
+class BuddyAllocator {
+public:
+    static constexpr u64 INVALID_OFFSET = ~0ull;
+
+    BuddyAllocator() = default;
+    // capacity and minBlockSize must be powers of two
+    BuddyAllocator(u64 capacity, u64 minBlockSize);
+
+    // Returned offsets are aligned to the block size, which is >= max(size, alignment)
+    u64 allocate(u64 size, u64 alignment = 1);
+    void free(u64 offset);
+
+    // Size actually reserved for the allocation at `offset`
+    u64 getAllocationSize(u64 offset) const;
+
+    u64 getCapacity() const { return m_Capacity; }
+    u64 getUsedBytes() const { return m_UsedBytes; }
+    u32 getAllocationCount() const { return (u32)m_AllocatedOrders.size(); }
+    bool isEmpty() const { return m_AllocatedOrders.empty(); }
+
+private:
+    u32 orderForSize(u64 size) const;
+    u64 blockSize(u32 order) const { return m_MinBlockSize << order; }
+
+    u64 m_Capacity = 0;
+    u64 m_MinBlockSize = 0;
+    u32 m_MaxOrder = 0;
+    u64 m_UsedBytes = 0;
+
+    // Free blocks per order; a set so the buddy can be found and removed in O(1) on merge
+    std::vector<std::unordered_set<u64>> m_FreeLists;
+    UMap<u64, u32> m_AllocatedOrders;
+};
+
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include "Renderer/DeletionQueue.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+void DeletionQueue::init(VkDevice device, DeviceAllocator& allocator)
+{
+    m_Device = device;
+    m_Allocator = &allocator;
+}
+
+void DeletionQueue::destroy()
+{
+    collect(UINT64_MAX);
+}
+
+void DeletionQueue::retireBuffer(Allocation* buffer, u64 lastUse)
+{
+    if (buffer == nullptr) {
+        return;
+    }
+    Entry entry;
+    entry.lastUse = lastUse;
+    entry.kind = Kind::Buffer;
+    entry.allocation = buffer;
+    push(std::move(entry));
+}
+
+void DeletionQueue::retireImage(VkImage image, Allocation* memory, u64 lastUse)
+{
+    Entry entry;
+    entry.lastUse = lastUse;
+    entry.kind = Kind::Image;
+    entry.image = image;
+    entry.allocation = memory;
+    push(std::move(entry));
+}
+
+void DeletionQueue::retireImageView(VkImageView view, u64 lastUse)
+{
+    Entry entry;
+    entry.lastUse = lastUse;
+    entry.kind = Kind::ImageView;
+    entry.view = view;
+    push(std::move(entry));
+}
+
+void DeletionQueue::retirePipeline(VkPipeline pipeline, u64 lastUse)
+{
+    Entry entry;
+    entry.lastUse = lastUse;
+    entry.kind = Kind::Pipeline;
+    entry.pipeline = pipeline;
+    push(std::move(entry));
+}
+
+void DeletionQueue::retire(std::function<void()> fn, u64 lastUse)
+{
+    Entry entry;
+    entry.lastUse = lastUse;
+    entry.kind = Kind::Callback;
+    entry.fn = std::move(fn);
+    push(std::move(entry));
+}
+
+void DeletionQueue::push(Entry&& entry)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Retirements almost always come in timeline order, the search only runs for stragglers
+    if (m_Entries.empty() || m_Entries.back().lastUse <= entry.lastUse) {
+        m_Entries.push_back(std::move(entry));
+        return;
+    }
+    auto it = std::upper_bound(m_Entries.begin(), m_Entries.end(), entry.lastUse,
+        [](u64 value, const Entry& other) { return value < other.lastUse; });
+    m_Entries.insert(it, std::move(entry));
+}
+
+void DeletionQueue::release(Entry& entry)
+{
+    switch (entry.kind) {
+    case Kind::Buffer:
+        m_Allocator->destroyBuffer(entry.allocation);
+        break;
+    case Kind::Image:
+        VKP_UNTRACK(entry.image);
+        vkDestroyImage(m_Device, entry.image, VKP_ALLOCATION_CALLBACKS);
+        if (entry.allocation != nullptr) {
+            m_Allocator->free(entry.allocation);
+        }
+        break;
+    case Kind::ImageView:
+        VKP_UNTRACK(entry.view);
+        vkDestroyImageView(m_Device, entry.view, VKP_ALLOCATION_CALLBACKS);
+        break;
+    case Kind::Pipeline:
+        VKP_UNTRACK(entry.pipeline);
+        vkDestroyPipeline(m_Device, entry.pipeline, VKP_ALLOCATION_CALLBACKS);
+        break;
+    case Kind::Callback:
+        entry.fn();
+        break;
+    }
+}
+
+u32 DeletionQueue::collect(u64 completed)
+{
+    // Destroy outside the lock, callbacks may retire further objects
+    std::vector<Entry> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        while (!m_Entries.empty() && m_Entries.front().lastUse <= completed) {
+            ready.push_back(std::move(m_Entries.front()));
+            m_Entries.pop_front();
+        }
+    }
+    for (Entry& entry : ready) {
+        release(entry);
+    }
+    return (u32)ready.size();
+}
+
+u32 DeletionQueue::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return (u32)m_Entries.size();
+}
+
+}
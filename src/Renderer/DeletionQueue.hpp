@@ -0,0 +1,67 @@
+#ifndef VKP_DELETIONQUEUE
+#define VKP_DELETIONQUEUE
+
+#include "Renderer/DeviceAllocator.hpp"
+#include "core.hpp"
+#include <deque>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Defers destruction of GPU objects until the submissions that may still reference them have
+// completed. Every object is tagged with the GpuTimeline value of its last possible use and
+// collect() destroys whatever the completed value has passed, so nothing waits on the device
+class DeletionQueue {
+public:
+    void init(VkDevice device, DeviceAllocator& allocator);
+    // Destroys everything still queued. The device must be idle
+    void destroy();
+
+    // `lastUse` is the timeline value of the last submission that may use the object. Thread safe
+    void retireBuffer(Allocation* buffer, u64 lastUse);
+    // `memory` may be null for images whose memory is owned elsewhere
+    void retireImage(VkImage image, Allocation* memory, u64 lastUse);
+    void retireImageView(VkImageView view, u64 lastUse);
+    void retirePipeline(VkPipeline pipeline, u64 lastUse);
+    // Anything else, e.g. a swapchain together with its views and semaphores
+    void retire(std::function<void()> fn, u64 lastUse);
+
+    // Destroys every object whose last use is at or below `completed`. Returns how many went
+    u32 collect(u64 completed);
+
+    u32 getPendingCount() const;
+
+private:
+    enum class Kind : u8 {
+        Buffer,
+        Image,
+        ImageView,
+        Pipeline,
+        Callback,
+    };
+
+    struct Entry {
+        u64 lastUse = 0;
+        Kind kind = Kind::Callback;
+        Allocation* allocation = nullptr;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        std::function<void()> fn;
+    };
+
+    void push(Entry&& entry);
+    void release(Entry& entry);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+
+    mutable std::mutex m_Mutex;
+    // Ordered by lastUse, so collect() only ever looks at the front
+    std::deque<Entry> m_Entries;
+};
+
+}
+
+#endif
@@ -0,0 +1,263 @@
+#include "Renderer/DescriptorAllocator.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace VulkanProj {
+
+// Descriptors reserved per set in a transient pool, by type. Covers the sets the renderer allocates
+// without tracking per-layout counts
+static constexpr std::array<std::pair<VkDescriptorType, u32>, 5> POOL_RATIOS = { {
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+    { VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+} };
+
+//----LAYOUT CACHE----
+
+void DescriptorLayoutCache::init(VkDevice device)
+{
+    m_Device = device;
+}
+
+void DescriptorLayoutCache::destroy()
+{
+    for (auto& [hash, entries] : m_Layouts) {
+        for (Entry& entry : entries) {
+            VKP_UNTRACK(entry.layout);
+            vkDestroyDescriptorSetLayout(m_Device, entry.layout, VKP_ALLOCATION_CALLBACKS);
+        }
+    }
+    m_Layouts.clear();
+    m_LayoutCount = 0;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(const VkDescriptorSetLayoutCreateInfo& info)
+{
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo* bindingFlags = nullptr;
+    for (auto* next = static_cast<const VkBaseInStructure*>(info.pNext); next != nullptr; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) {
+            bindingFlags = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+        }
+    }
+
+    // Normalize to binding order so the same layout written differently still matches
+    m_Scratch.clear();
+    for (u32 i = 0; i < info.bindingCount; i++) {
+        VKP_ASSERT(info.pBindings[i].pImmutableSamplers == nullptr, "IMMUTABLE SAMPLERS ARE NOT SUPPORTED BY THE LAYOUT CACHE");
+        VkDescriptorBindingFlags flags = bindingFlags != nullptr && bindingFlags->bindingCount > 0 ? bindingFlags->pBindingFlags[i] : 0;
+        m_Scratch.push_back({ info.pBindings[i], flags });
+    }
+    std::sort(m_Scratch.begin(), m_Scratch.end(), [](const Binding& a, const Binding& b) { return a.binding.binding < b.binding.binding; });
+
+    Hash hash = hashBytes(&info.flags, sizeof(info.flags));
+    for (const Binding& binding : m_Scratch) {
+        hash = hashBytes(&binding.binding.binding, sizeof(u32), hash);
+        hash = hashBytes(&binding.binding.descriptorType, sizeof(VkDescriptorType), hash);
+        hash = hashBytes(&binding.binding.descriptorCount, sizeof(u32), hash);
+        hash = hashBytes(&binding.binding.stageFlags, sizeof(VkShaderStageFlags), hash);
+        hash = hashBytes(&binding.flags, sizeof(VkDescriptorBindingFlags), hash);
+    }
+
+    auto matches = [&](const Entry& entry) {
+        if (entry.flags != info.flags || entry.bindings.size() != m_Scratch.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < m_Scratch.size(); i++) {
+            const Binding& a = entry.bindings[i];
+            const Binding& b = m_Scratch[i];
+            if (a.binding.binding != b.binding.binding || a.binding.descriptorType != b.binding.descriptorType
+                || a.binding.descriptorCount != b.binding.descriptorCount || a.binding.stageFlags != b.binding.stageFlags
+                || a.flags != b.flags) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<Entry>& bucket = m_Layouts[hash];
+    for (const Entry& entry : bucket) {
+        if (matches(entry)) {
+            return entry.layout;
+        }
+    }
+
+    VkDescriptorSetLayout layout;
+    VkResult res = vkCreateDescriptorSetLayout(m_Device, &info, VKP_ALLOCATION_CALLBACKS, &layout);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE DESCRIPTOR SET LAYOUT");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, layout, nullptr);
+    bucket.push_back({ info.flags, m_Scratch, layout });
+    m_LayoutCount++;
+    return layout;
+}
+
+//----TRANSIENT ALLOCATOR----
+
+void DescriptorAllocator::init(VkDevice device, u32 framesInFlight)
+{
+    m_Device = device;
+    m_Frames.resize(framesInFlight);
+    m_FrameSlot = 0;
+    m_NextPoolSets = INITIAL_SETS_PER_POOL;
+}
+
+void DescriptorAllocator::destroy()
+{
+    for (u32 i = 0; i < m_Frames.size(); i++) {
+        beginFrame(i);
+    }
+    for (VkDescriptorPool pool : m_FreePools) {
+        VKP_UNTRACK(pool);
+        vkDestroyDescriptorPool(m_Device, pool, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_FreePools.clear();
+    m_Frames.clear();
+    m_PoolCount = 0;
+}
+
+void DescriptorAllocator::beginFrame(u32 frameSlot)
+{
+    m_FrameSlot = frameSlot;
+    FramePools& frame = m_Frames[frameSlot];
+    if (frame.current != VK_NULL_HANDLE) {
+        frame.full.push_back(frame.current);
+        frame.current = VK_NULL_HANDLE;
+    }
+    for (VkDescriptorPool pool : frame.full) {
+        vkResetDescriptorPool(m_Device, pool, 0);
+        m_FreePools.push_back(pool);
+    }
+    frame.full.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::takePool()
+{
+    if (!m_FreePools.empty()) {
+        VkDescriptorPool pool = m_FreePools.back();
+        m_FreePools.pop_back();
+        return pool;
+    }
+
+    std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> sizes;
+    for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+        sizes[i].type = POOL_RATIOS[i].first;
+        sizes[i].descriptorCount = POOL_RATIOS[i].second * m_NextPoolSets;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = m_NextPoolSets;
+    poolInfo.poolSizeCount = (u32)sizes.size();
+    poolInfo.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    VkResult res = vkCreateDescriptorPool(m_Device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &pool);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE DESCRIPTOR POOL");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_DESCRIPTOR_POOL, pool, "Transient descriptor pool");
+    m_PoolCount++;
+
+    // Running out means the frame needs more than we guessed, grow the next pool
+    m_NextPoolSets = std::min(m_NextPoolSets + m_NextPoolSets / 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    FramePools& frame = m_Frames[m_FrameSlot];
+    if (frame.current == VK_NULL_HANDLE) {
+        frame.current = takePool();
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = frame.current;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult res = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+    if (res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL) {
+        frame.full.push_back(frame.current);
+        frame.current = takePool();
+        allocInfo.descriptorPool = frame.current;
+        res = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+    }
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE DESCRIPTOR SET");
+    return set;
+}
+
+//----WRITER----
+
+DescriptorWriter& DescriptorWriter::writeBuffer(u32 binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset,
+    VkDeviceSize range, u32 arrayElement)
+{
+    m_BufferInfos.push_back({ buffer, offset, range });
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    m_Pending.push_back({ write, (u32)m_BufferInfos.size() - 1, false });
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::writeImage(u32 binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+    VkImageLayout layout, u32 arrayElement)
+{
+    m_ImageInfos.push_back({ sampler, view, layout });
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstBinding = binding;
+    write.dstArrayElement = arrayElement;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    m_Pending.push_back({ write, (u32)m_ImageInfos.size() - 1, true });
+    return *this;
+}
+
+void DescriptorWriter::stage(VkDescriptorSet set)
+{
+    for (u32 i = m_StagedCount; i < m_Pending.size(); i++) {
+        m_Pending[i].write.dstSet = set;
+    }
+    m_StagedCount = (u32)m_Pending.size();
+}
+
+void DescriptorWriter::flush(VkDevice device)
+{
+    VKP_ASSERT(m_StagedCount == m_Pending.size(), "DESCRIPTOR WRITES WITHOUT A TARGET SET");
+
+    // Info pointers are resolved only now, the info vectors may have reallocated while writing
+    m_Writes.clear();
+    for (u32 i = 0; i < m_StagedCount; i++) {
+        VkWriteDescriptorSet write = m_Pending[i].write;
+        if (m_Pending[i].isImage) {
+            write.pImageInfo = &m_ImageInfos[m_Pending[i].infoIndex];
+        } else {
+            write.pBufferInfo = &m_BufferInfos[m_Pending[i].infoIndex];
+        }
+        m_Writes.push_back(write);
+    }
+    if (!m_Writes.empty()) {
+        vkUpdateDescriptorSets(device, (u32)m_Writes.size(), m_Writes.data(), 0, nullptr);
+    }
+
+    m_Pending.clear();
+    m_BufferInfos.clear();
+    m_ImageInfos.clear();
+    m_StagedCount = 0;
+}
+
+void DescriptorWriter::update(VkDevice device, VkDescriptorSet set)
+{
+    stage(set);
+    flush(device);
+}
+
+}
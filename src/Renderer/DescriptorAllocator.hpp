@@ -0,0 +1,111 @@
+#ifndef VKP_DESCRIPTORALLOCATOR
+#define VKP_DESCRIPTORALLOCATOR
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Deduplicates descriptor set layouts. Two create infos with the same flags, bindings and binding
+// flags (in any binding order) return the same handle, so pipelines built by different systems
+// end up with compatible layouts
+class DescriptorLayoutCache {
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    // Layout matching `info`, created on first use. Owned by the cache. Honors a
+    // VkDescriptorSetLayoutBindingFlagsCreateInfo in the pNext chain
+    VkDescriptorSetLayout get(const VkDescriptorSetLayoutCreateInfo& info);
+
+    u32 getLayoutCount() const { return m_LayoutCount; }
+
+private:
+    struct Binding {
+        VkDescriptorSetLayoutBinding binding;
+        VkDescriptorBindingFlags flags;
+    };
+
+    struct Entry {
+        VkDescriptorSetLayoutCreateFlags flags;
+        std::vector<Binding> bindings;
+        VkDescriptorSetLayout layout;
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    // Hash of the normalized description, collisions share a bucket
+    UMap<Hash, std::vector<Entry>> m_Layouts;
+    std::vector<Binding> m_Scratch;
+    u32 m_LayoutCount = 0;
+};
+
+// Transient descriptor sets, valid for one frame. Each frame slot allocates from a chain of pools:
+// when the current pool reports VK_ERROR_OUT_OF_POOL_MEMORY (or fragmentation) the next one is
+// taken from a shared free list, or created larger than the last. beginFrame() resets every pool
+// the slot used with one vkResetDescriptorPool each, individual sets are never freed.
+// Not thread safe, allocate before handing work to recording threads
+class DescriptorAllocator {
+public:
+    static constexpr u32 INITIAL_SETS_PER_POOL = 256;
+    static constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+    void init(VkDevice device, u32 framesInFlight);
+    void destroy();
+
+    // The slot's previous submission must have completed
+    void beginFrame(u32 frameSlot);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    u32 getPoolCount() const { return m_PoolCount; }
+
+private:
+    struct FramePools {
+        std::vector<VkDescriptorPool> full;
+        VkDescriptorPool current = VK_NULL_HANDLE;
+    };
+
+    VkDescriptorPool takePool();
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    std::vector<FramePools> m_Frames;
+    std::vector<VkDescriptorPool> m_FreePools;
+    u32 m_FrameSlot = 0;
+    u32 m_NextPoolSets = INITIAL_SETS_PER_POOL;
+    u32 m_PoolCount = 0;
+};
+
+// Batches descriptor writes into a single vkUpdateDescriptorSets call. Storage is kept between
+// updates, so a long-lived writer stops allocating once it has seen its largest batch
+class DescriptorWriter {
+public:
+    DescriptorWriter& writeBuffer(u32 binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0,
+        VkDeviceSize range = VK_WHOLE_SIZE, u32 arrayElement = 0);
+    DescriptorWriter& writeImage(u32 binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+        VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, u32 arrayElement = 0);
+
+    // Targets the writes made since the last stage() at `set`, without submitting them yet.
+    // Lets many sets go out in one flush()
+    void stage(VkDescriptorSet set);
+    // Submits everything staged so far and clears it
+    void flush(VkDevice device);
+    // stage() + flush()
+    void update(VkDevice device, VkDescriptorSet set);
+
+private:
+    struct PendingWrite {
+        VkWriteDescriptorSet write;
+        u32 infoIndex;
+        bool isImage;
+    };
+
+    std::vector<PendingWrite> m_Pending;
+    std::vector<VkDescriptorBufferInfo> m_BufferInfos;
+    std::vector<VkDescriptorImageInfo> m_ImageInfos;
+    std::vector<VkWriteDescriptorSet> m_Writes;
+    u32 m_StagedCount = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,455 @@
+#include "Renderer/DeviceAllocator.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <bit>
+
+namespace VulkanProj {
+
+void DeviceAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+    VKP_ASSERT(std::has_single_bit(blockSize), "ALLOCATOR BLOCK SIZE MUST BE A POWER OF TWO");
+
+    m_PhysicalDevice = physicalDevice;
+    m_Device = device;
+    m_BlockSize = blockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_MaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    m_Pools.resize(m_MemoryProperties.memoryTypeCount * 2);
+}
+
+void DeviceAllocator::destroy()
+{
+    if (!m_Allocations.empty()) {
+        VKP_WARN("DeviceAllocator: {} allocations still alive at shutdown", m_Allocations.size());
+    }
+    for (auto& allocation : m_Allocations) {
+        if (allocation->dedicated) {
+            VKP_UNTRACK(allocation->memory);
+            vkFreeMemory(m_Device, allocation->memory, VKP_ALLOCATION_CALLBACKS);
+        }
+    }
+    m_Allocations.clear();
+    m_AllocationIndices.clear();
+
+    for (MemoryPool& pool : m_Pools) {
+        for (auto& block : pool.blocks) {
+            VKP_UNTRACK(block->memory);
+            vkFreeMemory(m_Device, block->memory, VKP_ALLOCATION_CALLBACKS);
+        }
+        pool.blocks.clear();
+    }
+    m_DeviceMemoryCount = 0;
+}
+
+u32 DeviceAllocator::findMemoryTypeIndex(u32 typeBits, VkMemoryPropertyFlags properties) const
+{
+    for (u32 i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    VKP_ASSERT(false, "FAILED TO FIND SUITABLE MEMORY TYPE");
+    return 0;
+}
+
+MemoryBlock* DeviceAllocator::createBlock(u32 memoryType, VkDeviceSize size)
+{
+    VKP_ASSERT(m_DeviceMemoryCount < m_MaxAllocationCount, "EXCEEDED maxMemoryAllocationCount");
+
+    VkMemoryAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    auto block = CreateScope<MemoryBlock>();
+    VkResult res = vkAllocateMemory(m_Device, &allocInfo, VKP_ALLOCATION_CALLBACKS, &block->memory);
+    if (res != VK_SUCCESS) {
+        return nullptr;
+    }
+    m_DeviceMemoryCount++;
+    VKP_TRACK_MEMORY(block->memory, size, memoryType, "DeviceAllocator block");
+
+    block->size = size;
+    block->buddy = BuddyAllocator(size, MIN_SUBALLOCATION);
+    // Host-visible blocks are mapped once for their whole lifetime
+    if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data;
+        vkMapMemory(m_Device, block->memory, 0, VK_WHOLE_SIZE, 0, &data);
+        block->mapped = static_cast<u8*>(data);
+    }
+    return block.release();
+}
+
+void DeviceAllocator::destroyBlock(MemoryBlock* block)
+{
+    VKP_UNTRACK(block->memory);
+    vkFreeMemory(m_Device, block->memory, VKP_ALLOCATION_CALLBACKS);
+    m_DeviceMemoryCount--;
+}
+
+void DeviceAllocator::releaseEmptyBlocks(MemoryPool& pool)
+{
+    // Keep one block around so a pool that oscillates around empty does not thrash vkAllocateMemory
+    bool keptOne = false;
+    std::erase_if(pool.blocks, [&](const Scope<MemoryBlock>& block) {
+        if (!block->buddy.isEmpty()) {
+            return false;
+        }
+        if (!keptOne) {
+            keptOne = true;
+            return false;
+        }
+        destroyBlock(block.get());
+        return true;
+    });
+}
+
+Allocation* DeviceAllocator::trackAllocation(Scope<Allocation> allocation)
+{
+    Allocation* raw = allocation.get();
+    m_AllocationIndices[raw] = m_Allocations.size();
+    m_Allocations.push_back(std::move(allocation));
+    return raw;
+}
+
+Allocation* DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind, bool dedicated)
+{
+    return allocateInternal(requirements, properties, kind, dedicated, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+Allocation* DeviceAllocator::allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind,
+    bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage)
+{
+    u32 memoryType = findMemoryTypeIndex(requirements.memoryTypeBits, properties);
+    bool hostVisible = m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+    auto allocation = CreateScope<Allocation>();
+    allocation->size = requirements.size;
+    allocation->alignment = requirements.alignment;
+    allocation->memoryType = memoryType;
+    allocation->kind = kind;
+
+    // Anything over half a block would waste most of a buddy block, give it its own memory
+    if (dedicated || requirements.size > m_BlockSize / 2) {
+        VKP_ASSERT(m_DeviceMemoryCount < m_MaxAllocationCount, "EXCEEDED maxMemoryAllocationCount");
+
+        VkMemoryDedicatedAllocateInfo dedicatedInfo {};
+        dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicatedInfo.buffer = dedicatedBuffer;
+        dedicatedInfo.image = dedicatedImage;
+
+        VkMemoryAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = (dedicatedBuffer != VK_NULL_HANDLE || dedicatedImage != VK_NULL_HANDLE) ? &dedicatedInfo : nullptr;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkResult res = vkAllocateMemory(m_Device, &allocInfo, VKP_ALLOCATION_CALLBACKS, &allocation->memory);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE DEDICATED MEMORY");
+        if (res != VK_SUCCESS) {
+            return nullptr;
+        }
+        m_DeviceMemoryCount++;
+        VKP_TRACK_MEMORY(allocation->memory, requirements.size, memoryType, "DeviceAllocator dedicated");
+
+        if (hostVisible) {
+            vkMapMemory(m_Device, allocation->memory, 0, VK_WHOLE_SIZE, 0, &allocation->mapped);
+        }
+        allocation->dedicated = true;
+        return trackAllocation(std::move(allocation));
+    }
+
+    MemoryPool& pool = getPool(memoryType, kind);
+    MemoryBlock* block = nullptr;
+    u64 offset = BuddyAllocator::INVALID_OFFSET;
+    for (auto& candidate : pool.blocks) {
+        offset = candidate->buddy.allocate(requirements.size, requirements.alignment);
+        if (offset != BuddyAllocator::INVALID_OFFSET) {
+            block = candidate.get();
+            break;
+        }
+    }
+
+    if (block == nullptr) {
+        block = createBlock(memoryType, m_BlockSize);
+        VKP_ASSERT(block != nullptr, "FAILED TO ALLOCATE MEMORY BLOCK");
+        if (block == nullptr) {
+            return nullptr;
+        }
+        pool.blocks.emplace_back(block);
+        offset = block->buddy.allocate(requirements.size, requirements.alignment);
+    }
+
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->block = block;
+    allocation->mapped = block->mapped ? block->mapped + offset : nullptr;
+    return trackAllocation(std::move(allocation));
+}
+
+void DeviceAllocator::free(Allocation* allocation)
+{
+    if (allocation == nullptr) {
+        return;
+    }
+
+    auto it = m_AllocationIndices.find(allocation);
+    VKP_ASSERT(it != m_AllocationIndices.end(), "FREEING UNKNOWN ALLOCATION");
+    if (it == m_AllocationIndices.end()) {
+        return;
+    }
+
+    if (allocation->dedicated) {
+        VKP_UNTRACK(allocation->memory);
+        vkFreeMemory(m_Device, allocation->memory, VKP_ALLOCATION_CALLBACKS);
+        m_DeviceMemoryCount--;
+    } else {
+        allocation->block->buddy.free(allocation->offset);
+        if (allocation->block->buddy.isEmpty()) {
+            releaseEmptyBlocks(getPool(allocation->memoryType, allocation->kind));
+        }
+    }
+
+    // Swap-and-pop keeps removal O(1)
+    size_t index = it->second;
+    m_AllocationIndices.erase(it);
+    if (index != m_Allocations.size() - 1) {
+        std::swap(m_Allocations[index], m_Allocations.back());
+        m_AllocationIndices[m_Allocations[index].get()] = index;
+    }
+    m_Allocations.pop_back();
+}
+
+Allocation* DeviceAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+    VkMemoryDedicatedRequirements dedicatedRequirements {};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+
+    VkBufferMemoryRequirementsInfo2 info {};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    info.buffer = buffer;
+    vkGetBufferMemoryRequirements2(m_Device, &info, &requirements);
+
+    bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+    Allocation* allocation = allocateInternal(requirements.memoryRequirements, properties, AllocationKind::Linear, dedicated, buffer, VK_NULL_HANDLE);
+    if (allocation != nullptr) {
+        vkBindBufferMemory(m_Device, buffer, allocation->memory, allocation->offset);
+    }
+    return allocation;
+}
+
+Allocation* DeviceAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling)
+{
+    VkMemoryDedicatedRequirements dedicatedRequirements {};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+
+    VkImageMemoryRequirementsInfo2 info {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.image = image;
+    vkGetImageMemoryRequirements2(m_Device, &info, &requirements);
+
+    // Large render targets get their own memory: drivers can place them better and they never fragment a block
+    bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation
+        || requirements.memoryRequirements.size >= m_BlockSize / 4;
+    AllocationKind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear;
+    Allocation* allocation = allocateInternal(requirements.memoryRequirements, properties, kind, dedicated, VK_NULL_HANDLE, image);
+    if (allocation != nullptr) {
+        vkBindImageMemory(m_Device, image, allocation->memory, allocation->offset);
+    }
+    return allocation;
+}
+
+Allocation* DeviceAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, const char* name)
+{
+    VkBufferCreateInfo info = bufferInfo;
+    // Relocation copies buffer to buffer
+    info.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VkBuffer buffer;
+    VkResult res = vkCreateBuffer(m_Device, &info, VKP_ALLOCATION_CALLBACKS, &buffer);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE BUFFER");
+    if (res != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    Allocation* allocation = allocateForBuffer(buffer, properties);
+    if (allocation == nullptr) {
+        vkDestroyBuffer(m_Device, buffer, VKP_ALLOCATION_CALLBACKS);
+        return nullptr;
+    }
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_BUFFER, buffer, name);
+    allocation->buffer = buffer;
+    allocation->name = name;
+    // Concurrent sharing references caller-owned queue family arrays, those buffers stay put
+    if (info.sharingMode == VK_SHARING_MODE_EXCLUSIVE && info.pNext == nullptr) {
+        allocation->bufferInfo = info;
+    }
+    return allocation;
+}
+
+void DeviceAllocator::destroyBuffer(Allocation* allocation)
+{
+    if (allocation == nullptr) {
+        return;
+    }
+    VKP_UNTRACK(allocation->buffer);
+    vkDestroyBuffer(m_Device, allocation->buffer, VKP_ALLOCATION_CALLBACKS);
+    free(allocation);
+}
+
+const std::vector<DefragMove>& DeviceAllocator::beginDefragmentation(VkCommandBuffer commandBuffer, VkDeviceSize maxBytes)
+{
+    VKP_ASSERT(m_PendingMoves.empty(), "DEFRAGMENTATION PASS ALREADY IN PROGRESS");
+
+    // Whatever last wrote the buffers must land before they are copied
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkDeviceSize movedBytes = 0;
+    for (MemoryPool& pool : m_Pools) {
+        if (pool.blocks.size() < 2 || movedBytes >= maxBytes) {
+            continue;
+        }
+
+        // Emptying the least used block is what eventually lets it be released
+        MemoryBlock* source = nullptr;
+        for (auto& block : pool.blocks) {
+            if (!block->buddy.isEmpty() && (source == nullptr || block->buddy.getUsedBytes() < source->buddy.getUsedBytes())) {
+                source = block.get();
+            }
+        }
+        if (source == nullptr) {
+            continue;
+        }
+
+        for (auto& allocation : m_Allocations) {
+            if (movedBytes >= maxBytes) {
+                break;
+            }
+            bool movable = allocation->block == source && allocation->buffer != VK_NULL_HANDLE && allocation->bufferInfo.sType != 0;
+            if (!movable) {
+                continue;
+            }
+
+            MemoryBlock* target = nullptr;
+            u64 offset = BuddyAllocator::INVALID_OFFSET;
+            for (auto& block : pool.blocks) {
+                if (block.get() == source) {
+                    continue;
+                }
+                offset = block->buddy.allocate(allocation->size, allocation->alignment);
+                if (offset != BuddyAllocator::INVALID_OFFSET) {
+                    target = block.get();
+                    break;
+                }
+            }
+            // Other blocks are full, growing the pool would defeat the purpose
+            if (target == nullptr) {
+                break;
+            }
+
+            VkBuffer newBuffer;
+            VkResult res = vkCreateBuffer(m_Device, &allocation->bufferInfo, VKP_ALLOCATION_CALLBACKS, &newBuffer);
+            if (res != VK_SUCCESS) {
+                target->buddy.free(offset);
+                break;
+            }
+            vkBindBufferMemory(m_Device, newBuffer, target->memory, offset);
+
+            VkBufferCopy region {};
+            region.size = allocation->bufferInfo.size;
+            vkCmdCopyBuffer(commandBuffer, allocation->buffer, newBuffer, 1, &region);
+
+            m_PendingMoves.push_back({ allocation.get(), newBuffer, target, offset });
+            movedBytes += allocation->size;
+        }
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    return m_PendingMoves;
+}
+
+void DeviceAllocator::endDefragmentation()
+{
+    for (const DefragMove& move : m_PendingMoves) {
+        Allocation* allocation = move.allocation;
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_BUFFER, move.newBuffer, allocation->name);
+        VKP_UNTRACK(allocation->buffer);
+        vkDestroyBuffer(m_Device, allocation->buffer, VKP_ALLOCATION_CALLBACKS);
+        allocation->block->buddy.free(allocation->offset);
+
+        allocation->buffer = move.newBuffer;
+        allocation->block = move.newBlock;
+        allocation->memory = move.newBlock->memory;
+        allocation->offset = move.newOffset;
+        allocation->mapped = move.newBlock->mapped ? move.newBlock->mapped + move.newOffset : nullptr;
+    }
+    if (!m_PendingMoves.empty()) {
+        VKP_TRACE("DeviceAllocator: committed {} defragmentation moves", m_PendingMoves.size());
+    }
+    m_PendingMoves.clear();
+
+    for (MemoryPool& pool : m_Pools) {
+        releaseEmptyBlocks(pool);
+    }
+}
+
+std::vector<HeapStats> DeviceAllocator::getHeapStats() const
+{
+    std::vector<HeapStats> stats(m_MemoryProperties.memoryHeapCount);
+    for (u32 i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+        stats[i].heapSize = m_MemoryProperties.memoryHeaps[i].size;
+    }
+
+    for (u32 i = 0; i < m_Pools.size(); i++) {
+        HeapStats& heap = stats[m_MemoryProperties.memoryTypes[i / 2].heapIndex];
+        for (const auto& block : m_Pools[i].blocks) {
+            heap.blockCount++;
+            heap.reservedBytes += block->size;
+            heap.usedBytes += block->buddy.getUsedBytes();
+            heap.allocationCount += block->buddy.getAllocationCount();
+        }
+    }
+    for (const auto& allocation : m_Allocations) {
+        if (allocation->dedicated) {
+            HeapStats& heap = stats[m_MemoryProperties.memoryTypes[allocation->memoryType].heapIndex];
+            heap.dedicatedCount++;
+            heap.allocationCount++;
+            heap.reservedBytes += allocation->size;
+            heap.usedBytes += allocation->size;
+        }
+    }
+    return stats;
+}
+
+void DeviceAllocator::logStats() const
+{
+    std::vector<HeapStats> stats = getHeapStats();
+    VKP_INFO("DeviceAllocator: {} device memory objects (limit {})", m_DeviceMemoryCount, m_MaxAllocationCount);
+    for (u32 i = 0; i < stats.size(); i++) {
+        const HeapStats& heap = stats[i];
+        VKP_INFO("  heap {}: {:.1f}/{:.1f} MiB used/reserved of {:.1f} MiB, {} blocks, {} dedicated, {} allocations", i,
+            heap.usedBytes / (1024.0 * 1024.0), heap.reservedBytes / (1024.0 * 1024.0), heap.heapSize / (1024.0 * 1024.0),
+            heap.blockCount, heap.dedicatedCount, heap.allocationCount);
+    }
+}
+
+}
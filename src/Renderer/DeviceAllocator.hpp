@@ -0,0 +1,123 @@
+#ifndef VKP_DEVICEALLOCATOR
+#define VKP_DEVICEALLOCATOR
+
+#include "Renderer/BuddyAllocator.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Linear (buffers, linear images) and optimal-tiling images never share a block, which
+// satisfies bufferImageGranularity without padding every allocation to it
+enum class AllocationKind : u8 {
+    Linear,
+    Optimal
+};
+
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    u8* mapped = nullptr;
+    BuddyAllocator buddy;
+};
+
+// Owned by the DeviceAllocator, the pointer stays valid until free(). Defragmentation may
+// change memory/offset/mapped/buffer, so read them from here rather than caching them
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    VkDeviceSize alignment = 1;
+    // Persistently mapped pointer for host-visible memory, nullptr otherwise
+    void* mapped = nullptr;
+    u32 memoryType = 0;
+    AllocationKind kind = AllocationKind::Linear;
+    bool dedicated = false;
+
+    // Set for buffers created through DeviceAllocator::createBuffer, which makes them movable
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkBufferCreateInfo bufferInfo {};
+    // Debug name of that buffer, a string literal so relocated copies can reuse it
+    const char* name = nullptr;
+
+    MemoryBlock* block = nullptr;
+};
+
+struct HeapStats {
+    VkDeviceSize heapSize = 0;
+    VkDeviceSize reservedBytes = 0; // requested from the driver
+    VkDeviceSize usedBytes = 0; // handed out to resources
+    u32 blockCount = 0;
+    u32 dedicatedCount = 0;
+    u32 allocationCount = 0;
+};
+
+// A buffer move recorded by beginDefragmentation. `allocation->buffer` keeps pointing at the
+// old buffer until endDefragmentation swaps in the new one
+struct DefragMove {
+    Allocation* allocation;
+    VkBuffer newBuffer;
+    MemoryBlock* newBlock;
+    VkDeviceSize newOffset;
+};
+
+class DeviceAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize MIN_SUBALLOCATION = 256;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    void destroy();
+
+    Allocation* allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind, bool dedicated = false);
+    void free(Allocation* allocation);
+
+    // Query requirements (including dedicated preference), allocate and bind
+    Allocation* allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+    Allocation* allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+
+    // Buffers created here are tracked and can be relocated by defragmentation. `name` must be a string literal
+    Allocation* createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, const char* name = nullptr);
+    void destroyBuffer(Allocation* allocation);
+
+    // Incremental compaction. Picks the emptiest block of each pool and records copies of up to
+    // `maxBytes` of its buffers into other blocks. Submit `commandBuffer`, and once it has completed
+    // and no frame references the old buffers call endDefragmentation to commit the moves
+    const std::vector<DefragMove>& beginDefragmentation(VkCommandBuffer commandBuffer, VkDeviceSize maxBytes);
+    void endDefragmentation();
+
+    std::vector<HeapStats> getHeapStats() const;
+    void logStats() const;
+
+    VkDeviceSize getBlockSize() const { return m_BlockSize; }
+
+private:
+    struct MemoryPool {
+        std::vector<Scope<MemoryBlock>> blocks;
+    };
+
+    MemoryPool& getPool(u32 memoryType, AllocationKind kind) { return m_Pools[memoryType * 2 + (u32)kind]; }
+    Allocation* allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind,
+        bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+    Allocation* trackAllocation(Scope<Allocation> allocation);
+    MemoryBlock* createBlock(u32 memoryType, VkDeviceSize size);
+    void destroyBlock(MemoryBlock* block);
+    void releaseEmptyBlocks(MemoryPool& pool);
+    u32 findMemoryTypeIndex(u32 typeBits, VkMemoryPropertyFlags properties) const;
+
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties {};
+    VkDeviceSize m_BlockSize = DEFAULT_BLOCK_SIZE;
+    u32 m_MaxAllocationCount = 0;
+    u32 m_DeviceMemoryCount = 0;
+
+    std::vector<MemoryPool> m_Pools;
+    std::vector<Scope<Allocation>> m_Allocations;
+    UMap<Allocation*, size_t> m_AllocationIndices;
+    std::vector<DefragMove> m_PendingMoves;
+};
+
+}
+
+#endif
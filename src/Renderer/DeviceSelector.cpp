@@ -0,0 +1,364 @@
+#include "Renderer/DeviceSelector.hpp"
+
+#include <cctype>
+#include <cstring>
+
+namespace VulkanProj {
+
+// Score weights. Device type dominates, everything else only orders devices of the same type
+static constexpr i64 SCORE_DISCRETE = 100000;
+static constexpr i64 SCORE_INTEGRATED = 50000;
+static constexpr i64 SCORE_VIRTUAL = 20000;
+static constexpr i64 SCORE_CPU = 1000;
+static constexpr VkDeviceSize SCORE_BYTES_PER_POINT = 16ull * 1024 * 1024;
+static constexpr i64 SCORE_ASYNC_COMPUTE = 2000;
+static constexpr i64 SCORE_DEDICATED_TRANSFER = 1000;
+static constexpr i64 SCORE_OPTIONAL_FEATURE = 100;
+
+std::vector<u32> QueueTopology::getUniqueFamilies() const
+{
+    std::vector<u32> families;
+    for (u32 family : { graphicsFamily, presentFamily, transferFamily }) {
+        if (family != INVALID_QUEUE_FAMILY && std::find(families.begin(), families.end(), family) == families.end()) {
+            families.push_back(family);
+        }
+    }
+    return families;
+}
+
+QueueTopology discoverQueueTopology(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+    u32 familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+    QueueTopology topology;
+    u32 anyTransfer = INVALID_QUEUE_FAMILY;
+    for (u32 i = 0; i < familyCount; i++) {
+        const VkQueueFlags flags = families[i].queueFlags;
+        const bool graphics = flags & VK_QUEUE_GRAPHICS_BIT;
+        const bool compute = flags & VK_QUEUE_COMPUTE_BIT;
+        const bool transfer = flags & VK_QUEUE_TRANSFER_BIT;
+
+        VkBool32 present = VK_FALSE;
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present);
+        }
+
+        // First graphics family, unless a later one can also present and saves the sharing
+        if (graphics) {
+            bool better = topology.graphicsFamily == INVALID_QUEUE_FAMILY
+                || (present && topology.presentFamily != topology.graphicsFamily);
+            if (better) {
+                topology.graphicsFamily = i;
+                if (present) {
+                    topology.presentFamily = i;
+                }
+            }
+        }
+        if (present && topology.presentFamily == INVALID_QUEUE_FAMILY) {
+            topology.presentFamily = i;
+        }
+        if (compute && !graphics && topology.computeFamily == INVALID_QUEUE_FAMILY) {
+            topology.computeFamily = i;
+        }
+        // Graphics and compute families implicitly support transfer
+        if (transfer && !graphics && !compute && topology.transferFamily == INVALID_QUEUE_FAMILY) {
+            topology.transferFamily = i;
+        }
+        if ((transfer || compute) && !graphics && anyTransfer == INVALID_QUEUE_FAMILY) {
+            anyTransfer = i;
+        }
+    }
+
+    if (topology.transferFamily == INVALID_QUEUE_FAMILY) {
+        topology.transferFamily = anyTransfer != INVALID_QUEUE_FAMILY ? anyTransfer : topology.graphicsFamily;
+    }
+    if (topology.computeFamily == INVALID_QUEUE_FAMILY) {
+        topology.computeFamily = topology.graphicsFamily;
+    }
+    return topology;
+}
+
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
+{
+    SwapChainSupportDetails details;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+    u32 formatCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+    if (formatCount != 0) {
+        details.formats.resize(formatCount);
+        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+    }
+
+    u32 presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+    if (presentModeCount != 0) {
+        details.presentModes.resize(presentModeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+    }
+
+    return details;
+}
+
+const char* deviceTypeName(VkPhysicalDeviceType type)
+{
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return "cpu";
+    default:
+        return "other";
+    }
+}
+
+static std::string formatUuid(const u8* uuid)
+{
+    std::string text;
+    for (u32 i = 0; i < VK_UUID_SIZE; i++) {
+        text += fmt::format("{:02x}", uuid[i]);
+    }
+    return text;
+}
+
+static std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+static bool matchesPreference(const DeviceCandidate& candidate, const std::string& preferred)
+{
+    std::string wanted = toLower(preferred);
+    std::string uuidQuery;
+    std::copy_if(wanted.begin(), wanted.end(), std::back_inserter(uuidQuery), [](char c) { return c != '-'; });
+
+    if (uuidQuery == candidate.uuid) {
+        return true;
+    }
+    if (!wanted.empty() && wanted.size() <= 4 && std::all_of(wanted.begin(), wanted.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return std::stoul(wanted) == candidate.index;
+    }
+    return toLower(candidate.properties.deviceName).find(wanted) != std::string::npos;
+}
+
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name)
+{
+    u32 count = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+    for (const VkExtensionProperties& extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fills `rejection` with the first requirement the device misses
+static void checkRequirements(DeviceCandidate& candidate, const DeviceRequirements& requirements, const VkPhysicalDeviceFeatures2& features,
+    const VkPhysicalDeviceVulkan12Features& features12, const VkPhysicalDeviceVulkan13Features& features13)
+{
+    const u32 api = candidate.properties.apiVersion;
+    if (api < VK_API_VERSION_1_3) {
+        candidate.rejection = fmt::format("Vulkan {}.{} only, 1.3 required", VK_API_VERSION_MAJOR(api), VK_API_VERSION_MINOR(api));
+        return;
+    }
+    if (candidate.queues.graphicsFamily == INVALID_QUEUE_FAMILY) {
+        candidate.rejection = "no graphics queue";
+        return;
+    }
+
+    if (requirements.surface != VK_NULL_HANDLE) {
+        if (candidate.queues.presentFamily == INVALID_QUEUE_FAMILY) {
+            candidate.rejection = "cannot present to the window surface";
+            return;
+        }
+        if (!hasDeviceExtension(candidate.device, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+            candidate.rejection = "no " VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+            return;
+        }
+        u32 formatCount = 0;
+        u32 presentModeCount = 0;
+        vkGetPhysicalDeviceSurfaceFormatsKHR(candidate.device, requirements.surface, &formatCount, nullptr);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(candidate.device, requirements.surface, &presentModeCount, nullptr);
+        if (formatCount == 0 || presentModeCount == 0) {
+            candidate.rejection = "no surface formats or present modes";
+            return;
+        }
+    }
+
+    // Mirrors what Application::setupLogicalDevice enables unconditionally
+    std::pair<bool, const char*> required[] = {
+        { features13.dynamicRendering, "dynamicRendering" },
+        { features13.synchronization2, "synchronization2" },
+        { features12.timelineSemaphore, "timelineSemaphore" },
+        { features12.runtimeDescriptorArray, "runtimeDescriptorArray" },
+        { features12.descriptorBindingPartiallyBound, "descriptorBindingPartiallyBound" },
+        { features12.descriptorBindingStorageBufferUpdateAfterBind, "descriptorBindingStorageBufferUpdateAfterBind" },
+        { features12.descriptorBindingSampledImageUpdateAfterBind, "descriptorBindingSampledImageUpdateAfterBind" },
+        { features12.descriptorBindingUpdateUnusedWhilePending, "descriptorBindingUpdateUnusedWhilePending" },
+        { features.features.shaderStorageBufferArrayDynamicIndexing, "shaderStorageBufferArrayDynamicIndexing" },
+        { features.features.shaderSampledImageArrayDynamicIndexing, "shaderSampledImageArrayDynamicIndexing" },
+        { !requirements.indirectCount || features12.drawIndirectCount, "drawIndirectCount" },
+        { !requirements.indirectCount || features.features.multiDrawIndirect, "multiDrawIndirect" },
+        { !requirements.indirectCount || features.features.drawIndirectFirstInstance, "drawIndirectFirstInstance" },
+    };
+    for (const auto& [supported, name] : required) {
+        if (!supported) {
+            candidate.rejection = fmt::format("missing {}", name);
+            return;
+        }
+    }
+}
+
+static void scoreCandidate(DeviceCandidate& candidate, const VkPhysicalDeviceFeatures2& features,
+    const VkPhysicalDeviceVulkan12Features& features12, const VkPhysicalDeviceVulkan12Properties& properties12)
+{
+    auto add = [&](i64 points, std::string reason) {
+        if (points != 0) {
+            candidate.score += points;
+            candidate.reasons.push_back(fmt::format("{} +{}", reason, points));
+        }
+    };
+
+    switch (candidate.properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        add(SCORE_DISCRETE, "discrete");
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        add(SCORE_INTEGRATED, "integrated");
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        add(SCORE_VIRTUAL, "virtual");
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        add(SCORE_CPU, "cpu");
+        break;
+    default:
+        break;
+    }
+
+    add((i64)(candidate.deviceLocalBytes / SCORE_BYTES_PER_POINT), fmt::format("{} MiB device-local", candidate.deviceLocalBytes >> 20));
+    add(candidate.queues.hasAsyncCompute() ? SCORE_ASYNC_COMPUTE : 0, "async compute");
+    add(candidate.queues.hasDedicatedTransfer() ? SCORE_DEDICATED_TRANSFER : 0, "dedicated transfer");
+
+    // Optional features the engine uses when present
+    add(features.features.pipelineStatisticsQuery ? SCORE_OPTIONAL_FEATURE : 0, "pipelineStatisticsQuery");
+    add(features12.shaderSampledImageArrayNonUniformIndexing ? SCORE_OPTIONAL_FEATURE : 0, "non-uniform texture indexing");
+    add(features12.drawIndirectCount ? SCORE_OPTIONAL_FEATURE : 0, "drawIndirectCount");
+
+    // Limits that cap how much the bindless table and render targets can hold
+    const VkPhysicalDeviceLimits& limits = candidate.properties.limits;
+    add(limits.maxImageDimension2D >= 16384 ? SCORE_OPTIONAL_FEATURE : 0, "16k images");
+    add(std::min<i64>(properties12.maxPerStageDescriptorUpdateAfterBindSampledImages / 10000, SCORE_OPTIONAL_FEATURE),
+        fmt::format("{} bindless textures", properties12.maxPerStageDescriptorUpdateAfterBindSampledImages));
+}
+
+std::vector<DeviceCandidate> rankPhysicalDevices(VkInstance instance, const DeviceRequirements& requirements)
+{
+    u32 deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    std::vector<DeviceCandidate> candidates(deviceCount);
+    for (u32 i = 0; i < deviceCount; i++) {
+        DeviceCandidate& candidate = candidates[i];
+        candidate.device = devices[i];
+        candidate.index = i;
+
+        VkPhysicalDeviceIDProperties idProperties {};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceVulkan12Properties properties12 {};
+        properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        properties12.pNext = &idProperties;
+        VkPhysicalDeviceProperties2 properties {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &properties12;
+        vkGetPhysicalDeviceProperties2(devices[i], &properties);
+        candidate.properties = properties.properties;
+        candidate.uuid = formatUuid(idProperties.deviceUUID);
+
+        VkPhysicalDeviceMemoryProperties memory;
+        vkGetPhysicalDeviceMemoryProperties(devices[i], &memory);
+        for (u32 heap = 0; heap < memory.memoryHeapCount; heap++) {
+            if (memory.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                candidate.deviceLocalBytes += memory.memoryHeaps[heap].size;
+            }
+        }
+
+        VkPhysicalDeviceVulkan13Features features13 {};
+        features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        VkPhysicalDeviceVulkan12Features features12 {};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.pNext = &features13;
+        VkPhysicalDeviceFeatures2 features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(devices[i], &features);
+
+        candidate.queues = discoverQueueTopology(devices[i], requirements.surface);
+        checkRequirements(candidate, requirements, features, features12, features13);
+        scoreCandidate(candidate, features, features12, properties12);
+        candidate.preferred = !requirements.preferred.empty() && candidate.rejection.empty() && matchesPreference(candidate, requirements.preferred);
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const DeviceCandidate& a, const DeviceCandidate& b) {
+        if (a.rejection.empty() != b.rejection.empty()) {
+            return a.rejection.empty();
+        }
+        if (a.preferred != b.preferred) {
+            return a.preferred;
+        }
+        return a.score > b.score;
+    });
+    return candidates;
+}
+
+void logDeviceSelection(const std::vector<DeviceCandidate>& candidates, const DeviceRequirements& requirements)
+{
+    VKP_INFO("Physical devices ({}):", candidates.size());
+    for (const DeviceCandidate& candidate : candidates) {
+        if (!candidate.rejection.empty()) {
+            VKP_INFO("  [{}] {} ({}) unusable: {}", candidate.index, candidate.properties.deviceName,
+                deviceTypeName(candidate.properties.deviceType), candidate.rejection);
+        } else {
+            std::string reasons;
+            for (const std::string& reason : candidate.reasons) {
+                reasons += (reasons.empty() ? "" : ", ") + reason;
+            }
+            VKP_INFO("  [{}] {} ({}) score {}: {}", candidate.index, candidate.properties.deviceName,
+                deviceTypeName(candidate.properties.deviceType), candidate.score, reasons);
+        }
+    }
+
+    if (candidates.empty() || !candidates.front().rejection.empty()) {
+        return;
+    }
+    const DeviceCandidate& chosen = candidates.front();
+    if (!requirements.preferred.empty() && !chosen.preferred) {
+        VKP_WARN("No usable device matches '{}', falling back to the ranking", requirements.preferred);
+    }
+
+    const u32 api = chosen.properties.apiVersion;
+    VKP_INFO("Selected [{}] {} ({}), Vulkan {}.{}.{}, UUID {}: {}", chosen.index, chosen.properties.deviceName,
+        deviceTypeName(chosen.properties.deviceType), VK_API_VERSION_MAJOR(api), VK_API_VERSION_MINOR(api), VK_API_VERSION_PATCH(api),
+        chosen.uuid, chosen.preferred ? "requested explicitly" : "highest score");
+
+    const QueueTopology& queues = chosen.queues;
+    VKP_INFO("Queue families: graphics {}, present {}, compute {}{}, transfer {}{}", queues.graphicsFamily,
+        queues.presentFamily == INVALID_QUEUE_FAMILY ? std::string("none") : std::to_string(queues.presentFamily), queues.computeFamily,
+        queues.hasAsyncCompute() ? " (async)" : " (shared with graphics)", queues.transferFamily,
+        queues.hasDedicatedTransfer() ? " (dedicated)" : " (shared with graphics)");
+}
+
+}
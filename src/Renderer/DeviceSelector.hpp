@@ -0,0 +1,76 @@
+#ifndef VKP_DEVICESELECTOR
+#define VKP_DEVICESELECTOR
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+static constexpr u32 INVALID_QUEUE_FAMILY = ~0u;
+
+// Queue families the engine can target. When a device has no dedicated family for a role, the
+// role falls back to the graphics family, so every family is always valid except present when headless
+struct QueueTopology {
+    u32 graphicsFamily = INVALID_QUEUE_FAMILY;
+    u32 presentFamily = INVALID_QUEUE_FAMILY;
+    // Compute without graphics, runs alongside the graphics queue
+    u32 computeFamily = INVALID_QUEUE_FAMILY;
+    // Transfer only (the DMA engine) if available, else any transfer family without graphics
+    u32 transferFamily = INVALID_QUEUE_FAMILY;
+
+    bool hasAsyncCompute() const { return computeFamily != graphicsFamily; }
+    bool hasDedicatedTransfer() const { return transferFamily != graphicsFamily; }
+    // Every family the engine creates a queue for, each once. Compute only counts toward the ranking
+    // until something submits to it
+    std::vector<u32> getUniqueFamilies() const;
+};
+
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
+// "discrete", "integrated", "virtual", "cpu" or "other"
+const char* deviceTypeName(VkPhysicalDeviceType type);
+
+// Headless when `surface` is VK_NULL_HANDLE, present is then left invalid
+QueueTopology discoverQueueTopology(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+struct SwapChainSupportDetails {
+    VkSurfaceCapabilitiesKHR capabilities;
+    std::vector<VkSurfaceFormatKHR> formats;
+    std::vector<VkPresentModeKHR> presentModes;
+};
+
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+struct DeviceRequirements {
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    // drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance
+    bool indirectCount = false;
+    // Device name (case-insensitive substring), UUID (hex, dashes optional) or enumeration index.
+    // Wins over the ranking as long as the device is usable
+    std::string preferred;
+};
+
+struct DeviceCandidate {
+    VkPhysicalDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties {};
+    std::string uuid;
+    u32 index = 0;
+    QueueTopology queues;
+    VkDeviceSize deviceLocalBytes = 0;
+    // Empty when the device can run the engine, otherwise the first missing requirement
+    std::string rejection;
+    i64 score = 0;
+    // What the score is made of, for the log
+    std::vector<std::string> reasons;
+    bool preferred = false;
+};
+
+// Every physical device, usable ones first and ordered best first. An explicitly preferred
+// usable device is moved to the front
+std::vector<DeviceCandidate> rankPhysicalDevices(VkInstance instance, const DeviceRequirements& requirements);
+
+// Logs every candidate and why the first one was chosen
+void logDeviceSelection(const std::vector<DeviceCandidate>& candidates, const DeviceRequirements& requirements);
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef VKP_EMBEDDEDSHADER
+#define VKP_EMBEDDEDSHADER
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// One descriptor a shader declares
+struct ShaderBinding {
+    u32 set;
+    u32 binding;
+    VkDescriptorType type;
+    // Array size, 0 for runtime sized (bindless) arrays
+    u32 count;
+};
+
+// A shader compiled and reflected by the build (vkp_add_shader in CMakeLists.txt). Each one is
+// generated into Shaders/<source name>.hpp as Shaders::<source name>, SPIR-V included
+struct EmbeddedShader {
+    const char* name;
+    VkShaderStageFlagBits stage;
+    // 4-byte aligned, ready for vkCreateShaderModule
+    const u32* code;
+    size_t codeSize;
+    // Sorted by set, then binding
+    const ShaderBinding* bindings;
+    u32 bindingCount;
+    // Size 0 when the stage has no push constants
+    VkPushConstantRange pushConstants;
+};
+
+}
+
+#endif
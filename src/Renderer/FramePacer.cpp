@@ -0,0 +1,269 @@
+#include "Renderer/FramePacer.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <thread>
+
+namespace VulkanProj {
+
+// Presents allowed to be queued but not yet on screen when a low-latency frame starts
+static constexpr u64 LOW_LATENCY_QUEUED_PRESENTS = 1;
+// Bounds the present wait, a hidden or occluded window may never present
+static constexpr u64 PRESENT_WAIT_TIMEOUT_NS = 100ull * 1000 * 1000;
+// The limiter sleeps until this close to the deadline, then spins. Sleep granularity is far coarser
+static constexpr std::chrono::microseconds LIMITER_SPIN_WINDOW(1000);
+// Per-stream sample cap between reports, the oldest half goes when it is reached
+static constexpr size_t MAX_PACING_SAMPLES = 1 << 16;
+
+static void pushSample(std::vector<f64>& samples, f64 value)
+{
+    if (samples.size() >= MAX_PACING_SAMPLES) {
+        samples.erase(samples.begin(), samples.begin() + MAX_PACING_SAMPLES / 2);
+    }
+    samples.push_back(value);
+}
+
+const char* pacingModeName(PacingMode mode)
+{
+    switch (mode) {
+    case PacingMode::LowLatency:
+        return "low-latency";
+    case PacingMode::VSync:
+        return "vsync";
+    case PacingMode::Uncapped:
+        return "uncapped";
+    case PacingMode::Limited:
+        return "limited";
+    }
+    return "unknown";
+}
+
+bool parsePacingMode(const std::string& name, PacingMode& mode)
+{
+    for (PacingMode candidate : { PacingMode::LowLatency, PacingMode::VSync, PacingMode::Uncapped, PacingMode::Limited }) {
+        if (name == pacingModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+VkPresentModeKHR choosePacingPresentMode(PacingMode mode, const std::vector<VkPresentModeKHR>& available)
+{
+    auto supports = [&](VkPresentModeKHR presentMode) {
+        return std::find(available.begin(), available.end(), presentMode) != available.end();
+    };
+
+    switch (mode) {
+    case PacingMode::Uncapped:
+        if (supports(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        return supports(VK_PRESENT_MODE_MAILBOX_KHR) ? VK_PRESENT_MODE_MAILBOX_KHR : VK_PRESENT_MODE_FIFO_KHR;
+    case PacingMode::LowLatency:
+    case PacingMode::Limited:
+        // The limiter sets the rate, FIFO would clamp it to the refresh rate
+        return supports(VK_PRESENT_MODE_MAILBOX_KHR) ? VK_PRESENT_MODE_MAILBOX_KHR : VK_PRESENT_MODE_FIFO_KHR;
+    case PacingMode::VSync:
+        break;
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+const char* presentModeName(VkPresentModeKHR mode)
+{
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "FIFO_RELAXED";
+    default:
+        return "OTHER";
+    }
+}
+
+void FramePacer::init(VkPhysicalDevice physicalDevice, VkDevice device, u32 graphicsFamily, u32 framesInFlight, const Spec& spec)
+{
+    m_Device = device;
+    m_Spec = spec;
+    m_Spec.targetFps = std::max(1u, m_Spec.targetFps);
+    m_NextDeadline = std::chrono::steady_clock::now();
+
+    if (m_Spec.presentWait) {
+        m_WaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    u32 queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    u32 validBits = queueFamilies[graphicsFamily].timestampValidBits;
+    if (validBits == 0) {
+        VKP_WARN("Frame pacer: queue family {} does not support timestamps, GPU frame time unavailable", graphicsFamily);
+    } else {
+        m_TimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+        m_TimestampPeriodNs = properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo poolInfo {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2;
+
+        m_GpuSlots.resize(framesInFlight);
+        for (GpuSlot& slot : m_GpuSlots) {
+            VkResult res = vkCreateQueryPool(device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &slot.pool);
+            VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE FRAME TIMESTAMP QUERY POOL");
+            VKP_TRACK_OBJECT(VK_OBJECT_TYPE_QUERY_POOL, slot.pool, "Frame pacing timestamps");
+        }
+    }
+
+    VKP_INFO("Frame pacing: {}{}, present wait {}", pacingModeName(m_Spec.mode),
+        m_Spec.mode == PacingMode::Limited ? fmt::format(" at {} fps", m_Spec.targetFps) : std::string(),
+        m_WaitForPresent != nullptr ? "enabled" : "unavailable");
+}
+
+void FramePacer::destroy()
+{
+    for (GpuSlot& slot : m_GpuSlots) {
+        VKP_UNTRACK(slot.pool);
+        vkDestroyQueryPool(m_Device, slot.pool, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_GpuSlots.clear();
+    m_CurrentSlot = nullptr;
+    m_WaitForPresent = nullptr;
+}
+
+void FramePacer::throttle(VkSwapchainKHR swapchain)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    if (m_Spec.mode == PacingMode::Limited) {
+        VKP_PROFILE_SCOPE("FrameLimiter");
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<f64>(1.0 / m_Spec.targetFps));
+        if (m_NextDeadline > start) {
+            if (m_NextDeadline - start > LIMITER_SPIN_WINDOW) {
+                std::this_thread::sleep_until(m_NextDeadline - LIMITER_SPIN_WINDOW);
+            }
+            while (Clock::now() < m_NextDeadline) {
+                std::this_thread::yield();
+            }
+            m_NextDeadline += period;
+        } else {
+            // Running behind: restart the cadence instead of bursting frames to catch up
+            m_NextDeadline = start + period;
+        }
+    }
+
+    // Frame N may start once N-2 is on screen, so at most N-1 is queued behind the display
+    if (m_Spec.mode == PacingMode::LowLatency && m_WaitForPresent != nullptr && swapchain != VK_NULL_HANDLE
+        && m_PresentId >= m_SwapchainFirstPresentId + LOW_LATENCY_QUEUED_PRESENTS) {
+        VKP_PROFILE_SCOPE("WaitForPresent");
+        // Timeouts and out of date swapchains are fine, the acquire that follows deals with the latter
+        m_WaitForPresent(m_Device, swapchain, m_PresentId - LOW_LATENCY_QUEUED_PRESENTS, PRESENT_WAIT_TIMEOUT_NS);
+    }
+
+    m_FrameCpuWaitMs += std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+}
+
+void FramePacer::beginFrame(u32 frameIndex)
+{
+    if (m_GpuSlots.empty()) {
+        return;
+    }
+    m_CurrentSlot = &m_GpuSlots[frameIndex];
+    resolveSlot(*m_CurrentSlot);
+}
+
+void FramePacer::writeFrameBegin(VkCommandBuffer commandBuffer)
+{
+    if (m_CurrentSlot == nullptr) {
+        return;
+    }
+    vkCmdResetQueryPool(commandBuffer, m_CurrentSlot->pool, 0, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_CurrentSlot->pool, 0);
+}
+
+void FramePacer::writeFrameEnd(VkCommandBuffer commandBuffer)
+{
+    if (m_CurrentSlot == nullptr) {
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_CurrentSlot->pool, 1);
+    m_CurrentSlot->pending = true;
+}
+
+void FramePacer::resolveSlot(GpuSlot& slot)
+{
+    if (!slot.pending) {
+        return;
+    }
+    slot.pending = false;
+
+    // [value, availability] pairs. The slot's submission has completed, so the results are
+    // normally ready and a frame that is not gets dropped rather than waited on
+    std::array<u64, 4> results {};
+    vkGetQueryPoolResults(m_Device, slot.pool, 0, 2, sizeof(results), results.data(), sizeof(u64) * 2,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (results[1] == 0 || results[3] == 0) {
+        return;
+    }
+    u64 ticks = ((results[2] & m_TimestampMask) - (results[0] & m_TimestampMask)) & m_TimestampMask;
+    pushSample(m_GpuMs, (f64)ticks * m_TimestampPeriodNs / 1e6);
+}
+
+u64 FramePacer::nextPresentId()
+{
+    return m_WaitForPresent != nullptr ? ++m_PresentId : 0;
+}
+
+void FramePacer::endFrame(bool presented)
+{
+    pushSample(m_CpuWaitMs, m_FrameCpuWaitMs);
+    m_FrameCpuWaitMs = 0.0;
+
+    if (!presented) {
+        return;
+    }
+    // Present-to-present as the CPU sees it. Blocking presents and acquires make this converge
+    // on the display cadence in FIFO, in the other modes it is the submission rate
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (m_HasPresented) {
+        pushSample(m_PresentIntervalMs, std::chrono::duration<f64, std::milli>(now - m_LastPresent).count());
+    }
+    m_LastPresent = now;
+    m_HasPresented = true;
+}
+
+void FramePacer::onSwapchainRecreated()
+{
+    m_SwapchainFirstPresentId = m_PresentId + 1;
+    // The recreation pause is not a present interval
+    m_HasPresented = false;
+}
+
+void FramePacer::logReport(const std::string& label)
+{
+    BenchSummary cpuWait = summarizeSamples(m_CpuWaitMs);
+    BenchSummary gpu = summarizeSamples(m_GpuMs);
+    BenchSummary present = summarizeSamples(m_PresentIntervalMs);
+
+    VKP_INFO("Pacing {} ({}): cpu wait avg {:.3f}ms p99 {:.3f}ms | gpu avg {:.3f}ms p99 {:.3f}ms | present interval avg {:.3f}ms p99 {:.3f}ms ({:.1f} fps)",
+        label, pacingModeName(m_Spec.mode), cpuWait.avg, cpuWait.p99, gpu.avg, gpu.p99, present.avg, present.p99,
+        present.avg > 0.0 ? 1000.0 / present.avg : 0.0);
+
+    m_CpuWaitMs.clear();
+    m_GpuMs.clear();
+    m_PresentIntervalMs.clear();
+}
+
+}
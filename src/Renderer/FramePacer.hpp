@@ -0,0 +1,105 @@
+#ifndef VKP_FRAMEPACER
+#define VKP_FRAMEPACER
+
+#include "Bench/Bench.hpp"
+#include "core.hpp"
+#include <chrono>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+enum class PacingMode : u8 {
+    // MAILBOX where available. With present_wait the CPU also stays at most one presented frame
+    // ahead, so input is sampled as late as possible
+    LowLatency,
+    // FIFO, one image per refresh and never tears
+    VSync,
+    // IMMEDIATE where available, for benchmarks and throughput measurements
+    Uncapped,
+    // Tear-free present mode, throttled on the CPU to a fixed frame rate
+    Limited,
+};
+
+const char* pacingModeName(PacingMode mode);
+// Accepts the lower case names pacingModeName returns. False for anything else
+bool parsePacingMode(const std::string& name, PacingMode& mode);
+
+// Best present mode for `mode` out of what the surface supports. FIFO is always available
+VkPresentModeKHR choosePacingPresentMode(PacingMode mode, const std::vector<VkPresentModeKHR>& available);
+const char* presentModeName(VkPresentModeKHR mode);
+
+// Throttles the CPU for the selected pacing mode and measures where frame time goes: CPU time
+// spent blocked (frame slot, acquire, present wait, limiter), GPU execution time of every frame
+// and the interval between consecutive presents
+class FramePacer {
+public:
+    struct Spec {
+        PacingMode mode = PacingMode::LowLatency;
+        // Only used by PacingMode::Limited
+        u32 targetFps = 60;
+        // VK_KHR_present_id and VK_KHR_present_wait are enabled on the device
+        bool presentWait = false;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, u32 graphicsFamily, u32 framesInFlight, const Spec& spec);
+    void destroy();
+
+    // Call before the frame samples input or waits for its slot. Sleeps for the limiter and,
+    // in low-latency mode, waits until the presented queue has drained
+    void throttle(VkSwapchainKHR swapchain);
+    // Accounts CPU time blocked outside of throttle(), e.g. on the frame timeline or acquire
+    void addCpuWait(f64 ms) { m_FrameCpuWaitMs += ms; }
+
+    // Call once the slot's previous submission has completed, collects its GPU time
+    void beginFrame(u32 frameIndex);
+    // Bracket the frame's command buffer. Both are no-ops when the queue has no timestamps
+    void writeFrameBegin(VkCommandBuffer commandBuffer);
+    void writeFrameEnd(VkCommandBuffer commandBuffer);
+
+    // ID for VkPresentIdKHR, 0 when present_id is unavailable
+    u64 nextPresentId();
+    // Call once per frame after submit, and after vkQueuePresentKHR when the frame presented
+    void endFrame(bool presented);
+    // Present IDs belong to a swapchain, waits must not target IDs queued to the old one
+    void onSwapchainRecreated();
+
+    // Logs the samples collected since the last report, then clears them
+    void logReport(const std::string& label);
+
+    PacingMode getMode() const { return m_Spec.mode; }
+    bool isPresentWaitEnabled() const { return m_WaitForPresent != nullptr; }
+
+private:
+    struct GpuSlot {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        bool pending = false;
+    };
+
+    void resolveSlot(GpuSlot& slot);
+
+    Spec m_Spec;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    PFN_vkWaitForPresentKHR m_WaitForPresent = nullptr;
+
+    std::vector<GpuSlot> m_GpuSlots;
+    GpuSlot* m_CurrentSlot = nullptr;
+    u64 m_TimestampMask = ~0ull;
+    f64 m_TimestampPeriodNs = 1.0;
+
+    std::chrono::steady_clock::time_point m_NextDeadline;
+    std::chrono::steady_clock::time_point m_LastPresent;
+    bool m_HasPresented = false;
+
+    u64 m_PresentId = 0;
+    // First ID presented to the current swapchain
+    u64 m_SwapchainFirstPresentId = 1;
+
+    f64 m_FrameCpuWaitMs = 0.0;
+    std::vector<f64> m_CpuWaitMs;
+    std::vector<f64> m_GpuMs;
+    std::vector<f64> m_PresentIntervalMs;
+};
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "Renderer/GpuCulling.hpp"
+#include "Profiler/ResourceTracker.hpp"
+#include "Shaders/shaderCull.hpp"
+
+namespace VulkanProj {
+
+static constexpr u32 CULL_GROUP_SIZE = 64;
+
+// Push constants of shaders/shaderCull.glsl
+struct CullParams {
+    glm::vec4 planes[6];
+    glm::vec4 boundingSphere;
+    u32 firstInstance;
+    u32 instanceCount;
+    u32 indexCount;
+};
+
+// Gribb/Hartmann plane extraction for a 0..1 depth range, normalized so distances are in world units
+static void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+    planes[0] = row(3) + row(0);
+    planes[1] = row(3) - row(0);
+    planes[2] = row(3) + row(1);
+    planes[3] = row(3) - row(1);
+    planes[4] = row(2);
+    planes[5] = row(3) - row(2);
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+void GpuCulling::init(VkDevice device, DeviceAllocator& allocator, ShaderLibrary& shaders, DescriptorLayoutCache& layouts,
+    VkPipelineCache pipelineCache, const InstanceRenderer& instances, u32 framesInFlight)
+{
+    m_Device = device;
+    m_Allocator = &allocator;
+    m_MaxDraws = instances.getCapacity();
+
+    // The set layout and push range come from the build's reflection of shaderCull.glsl
+    const EmbeddedShader& shader = Shaders::shaderCull;
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings {};
+    VKP_ASSERT(shader.bindingCount == bindings.size(), "shaderCull.glsl MUST DECLARE 3 BINDINGS");
+    for (u32 i = 0; i < bindings.size(); i++) {
+        const ShaderBinding& reflected = shader.bindings[i];
+        VKP_ASSERT(reflected.set == 0 && reflected.binding == i && reflected.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            "shaderCull.glsl BINDINGS DO NOT MATCH THE CULLING DESCRIPTOR SET");
+        bindings[i].binding = reflected.binding;
+        bindings[i].descriptorType = reflected.type;
+        bindings[i].descriptorCount = reflected.count;
+        bindings[i].stageFlags = shader.stage;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = (u32)bindings.size();
+    layoutInfo.pBindings = bindings.data();
+    m_SetLayout = layouts.get(layoutInfo);
+
+    VkPushConstantRange pushRange = shader.pushConstants;
+    VKP_ASSERT(pushRange.offset == 0 && pushRange.size == sizeof(CullParams), "CullParams DO NOT MATCH shaderCull.glsl");
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_SetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    VkResult res = vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, VKP_ALLOCATION_CALLBACKS, &m_PipelineLayout);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE CULLING PIPELINE LAYOUT");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE_LAYOUT, m_PipelineLayout, "Culling pipeline layout");
+
+    m_Pipeline = buildPipeline(shaders.load(shader), pipelineCache);
+    VKP_ASSERT(m_Pipeline != VK_NULL_HANDLE, "FAILED TO CREATE CULLING PIPELINE");
+
+    VkDescriptorPoolSize poolSize {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight * (u32)bindings.size();
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    res = vkCreateDescriptorPool(m_Device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &m_DescriptorPool);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE CULLING DESCRIPTOR POOL");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_DescriptorPool, "Culling descriptor pool");
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_Frames.resize(framesInFlight);
+    for (u32 slot = 0; slot < framesInFlight; slot++) {
+        FrameResources& frame = m_Frames[slot];
+
+        bufferInfo.size = (VkDeviceSize)m_MaxDraws * sizeof(VkDrawIndexedIndirectCommand);
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        frame.drawBuffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Culling draws");
+
+        bufferInfo.size = sizeof(u32);
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        frame.countBuffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Culling draw count");
+
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        frame.readbackBuffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Culling stats readback");
+        VKP_ASSERT(frame.drawBuffer && frame.countBuffer && frame.readbackBuffer, "FAILED TO CREATE CULLING BUFFERS");
+
+        VkDescriptorSetAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_DescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &m_SetLayout;
+        res = vkAllocateDescriptorSets(m_Device, &allocInfo, &frame.set);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE CULLING DESCRIPTOR SET");
+
+        std::array<VkDescriptorBufferInfo, 3> buffers = { {
+            { instances.getBuffer(slot), 0, VK_WHOLE_SIZE },
+            { frame.drawBuffer->buffer, 0, VK_WHOLE_SIZE },
+            { frame.countBuffer->buffer, 0, VK_WHOLE_SIZE },
+        } };
+        std::array<VkWriteDescriptorSet, 3> writes {};
+        for (u32 i = 0; i < writes.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = frame.set;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &buffers[i];
+        }
+        vkUpdateDescriptorSets(m_Device, (u32)writes.size(), writes.data(), 0, nullptr);
+    }
+}
+
+VkPipeline GpuCulling::buildPipeline(VkShaderModule module, VkPipelineCache pipelineCache) const
+{
+    VkComputePipelineCreateInfo pipelineInfo {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_PipelineLayout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateComputePipelines(m_Device, pipelineCache, 1, &pipelineInfo, VKP_ALLOCATION_CALLBACKS, &pipeline);
+    if (res != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE, pipeline, "Culling pipeline");
+    return pipeline;
+}
+
+VkPipeline GpuCulling::swapPipeline(VkPipeline pipeline)
+{
+    std::swap(m_Pipeline, pipeline);
+    return pipeline;
+}
+
+void GpuCulling::destroy()
+{
+    for (FrameResources& frame : m_Frames) {
+        m_Allocator->destroyBuffer(frame.drawBuffer);
+        m_Allocator->destroyBuffer(frame.countBuffer);
+        m_Allocator->destroyBuffer(frame.readbackBuffer);
+    }
+    m_Frames.clear();
+    VKP_UNTRACK(m_Pipeline);
+    vkDestroyPipeline(m_Device, m_Pipeline, VKP_ALLOCATION_CALLBACKS);
+    VKP_UNTRACK(m_PipelineLayout);
+    vkDestroyPipelineLayout(m_Device, m_PipelineLayout, VKP_ALLOCATION_CALLBACKS);
+    VKP_UNTRACK(m_DescriptorPool);
+    vkDestroyDescriptorPool(m_Device, m_DescriptorPool, VKP_ALLOCATION_CALLBACKS);
+}
+
+void GpuCulling::beginFrame(u32 frameSlot, u64 frameNumber)
+{
+    m_FrameSlot = frameSlot;
+    FrameResources& frame = m_Frames[frameSlot];
+    if (frame.pending) {
+        m_LastStats.tested = frame.tested;
+        m_LastStats.drawn = *static_cast<const u32*>(frame.readbackBuffer->mapped);
+        m_LastStats.frame = frame.frame;
+        m_LastStats.valid = true;
+        frame.pending = false;
+    }
+    frame.frame = frameNumber;
+}
+
+void GpuCulling::recordCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const glm::vec4& boundingSphere,
+    u32 firstInstance, u32 instanceCount, u32 indexCount)
+{
+    FrameResources& frame = m_Frames[m_FrameSlot];
+    frame.tested = instanceCount;
+
+    vkCmdFillBuffer(commandBuffer, frame.countBuffer->buffer, 0, sizeof(u32), 0);
+
+    VkMemoryBarrier clearBarrier {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    // Also orders the dispatch after last frame's indirect reads of the same slot
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    CullParams params {};
+    extractFrustumPlanes(viewProjection, params.planes);
+    params.boundingSphere = boundingSphere;
+    params.firstInstance = firstInstance;
+    params.instanceCount = std::min(instanceCount, m_MaxDraws);
+    params.indexCount = indexCount;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &frame.set, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParams), &params);
+    vkCmdDispatch(commandBuffer, (params.instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer commandBuffer) const
+{
+    const FrameResources& frame = m_Frames[m_FrameSlot];
+    vkCmdDrawIndexedIndirectCount(commandBuffer, frame.drawBuffer->buffer, 0, frame.countBuffer->buffer, 0, m_MaxDraws,
+        sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuCulling::recordStatsReadback(VkCommandBuffer commandBuffer)
+{
+    FrameResources& frame = m_Frames[m_FrameSlot];
+
+    VkBufferCopy region { 0, 0, sizeof(u32) };
+    vkCmdCopyBuffer(commandBuffer, frame.countBuffer->buffer, frame.readbackBuffer->buffer, 1, &region);
+
+    VkMemoryBarrier hostBarrier {};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0,
+        nullptr);
+    frame.pending = true;
+}
+
+}
@@ -0,0 +1,82 @@
+#ifndef VKP_GPUCULLING
+#define VKP_GPUCULLING
+
+#include "Renderer/DescriptorAllocator.hpp"
+#include "Renderer/DeviceAllocator.hpp"
+#include "Renderer/InstanceRenderer.hpp"
+#include "Renderer/ShaderLibrary.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Frustum culling on the GPU. A compute pass tests every instance's bounding sphere and
+// appends one VkDrawIndexedIndirectCommand per survivor, the graphics pass draws them with
+// vkCmdDrawIndexedIndirectCount. CPU cost per frame does not depend on the instance count
+class GpuCulling {
+public:
+    struct Stats {
+        u32 tested = 0;
+        u32 drawn = 0;
+        // Frame the numbers belong to, they arrive framesInFlight frames late
+        u64 frame = 0;
+        bool valid = false;
+    };
+
+    // Reads instances from `instances`, one descriptor set per frame slot
+    void init(VkDevice device, DeviceAllocator& allocator, ShaderLibrary& shaders, DescriptorLayoutCache& layouts,
+        VkPipelineCache pipelineCache, const InstanceRenderer& instances, u32 framesInFlight);
+    void destroy();
+
+    // Collects the draw count the slot's previous frame wrote. Its fence must have been waited
+    void beginFrame(u32 frameSlot, u64 frameNumber);
+
+    // Outside a render pass. Culls [firstInstance, firstInstance + instanceCount) against the
+    // frustum of `viewProjection`. `boundingSphere` is xyz center and w radius in mesh space.
+    // Writes the draw and count buffers, the render graph orders the draw after it
+    void recordCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const glm::vec4& boundingSphere, u32 firstInstance,
+        u32 instanceCount, u32 indexCount);
+    // Inside the render pass, with the mesh, pipeline and instances bound
+    void recordDraw(VkCommandBuffer commandBuffer) const;
+    // After the render pass. Copies the draw count to host memory for beginFrame() to pick up
+    void recordStatsReadback(VkCommandBuffer commandBuffer);
+
+    // The current slot's buffers, for declaring the passes that touch them
+    VkBuffer getDrawBuffer() const { return m_Frames[m_FrameSlot].drawBuffer->buffer; }
+    VkBuffer getCountBuffer() const { return m_Frames[m_FrameSlot].countBuffer->buffer; }
+    VkBuffer getReadbackBuffer() const { return m_Frames[m_FrameSlot].readbackBuffer->buffer; }
+
+    const Stats& getLastStats() const { return m_LastStats; }
+
+    // The culling pipeline for another build of shaders/shaderCull.glsl. Safe from any thread
+    VkPipeline buildPipeline(VkShaderModule module, VkPipelineCache pipelineCache) const;
+    // Between frames. Returns the previous pipeline, which the caller retires
+    VkPipeline swapPipeline(VkPipeline pipeline);
+
+private:
+    struct FrameResources {
+        Allocation* drawBuffer = nullptr;
+        Allocation* countBuffer = nullptr;
+        Allocation* readbackBuffer = nullptr;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        u32 tested = 0;
+        u64 frame = 0;
+        bool pending = false;
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_Pipeline = VK_NULL_HANDLE;
+
+    std::vector<FrameResources> m_Frames;
+    u32 m_FrameSlot = 0;
+    u32 m_MaxDraws = 0;
+    Stats m_LastStats;
+};
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "Renderer/GpuTimeline.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+void GpuTimeline::init(VkDevice device)
+{
+    m_Device = device;
+
+    VkSemaphoreTypeCreateInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+    VkResult res = vkCreateSemaphore(m_Device, &semaphoreInfo, VKP_ALLOCATION_CALLBACKS, &m_Semaphore);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE FRAME TIMELINE SEMAPHORE");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SEMAPHORE, m_Semaphore, "Frame timeline");
+}
+
+void GpuTimeline::destroy()
+{
+    VKP_UNTRACK(m_Semaphore);
+    vkDestroySemaphore(m_Device, m_Semaphore, VKP_ALLOCATION_CALLBACKS);
+    m_Semaphore = VK_NULL_HANDLE;
+    m_LastSubmitted = 0;
+    m_Completed = 0;
+}
+
+u64 GpuTimeline::getCompleted()
+{
+    if (m_Completed < m_LastSubmitted) {
+        vkGetSemaphoreCounterValue(m_Device, m_Semaphore, &m_Completed);
+    }
+    return m_Completed;
+}
+
+void GpuTimeline::wait(u64 value)
+{
+    VKP_ASSERT(value <= m_LastSubmitted, "WAITING ON A TIMELINE VALUE THAT WAS NEVER SUBMITTED");
+    if (getCompleted() >= value) {
+        return;
+    }
+
+    VKP_PROFILE_SCOPE("WaitForTimeline");
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Semaphore;
+    waitInfo.pValues = &value;
+    VkResult res = vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO WAIT ON FRAME TIMELINE");
+    m_Completed = std::max(m_Completed, value);
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef VKP_GPUTIMELINE
+#define VKP_GPUTIMELINE
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Timeline semaphore every graphics submission signals with the next value, so value N is
+// reached once the N-th submission has completed. Frame slots, retired resources and readbacks
+// all wait on it instead of per-submission fences
+class GpuTimeline {
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    // Reserves the value the next submission signals
+    u64 advance() { return ++m_LastSubmitted; }
+    u64 getLastSubmitted() const { return m_LastSubmitted; }
+
+    // Queries the semaphore. Cheap, never blocks
+    u64 getCompleted();
+    // Blocks until `value` has been reached. Returns immediately if it already has
+    void wait(u64 value);
+
+    VkSemaphore getSemaphore() const { return m_Semaphore; }
+
+private:
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkSemaphore m_Semaphore = VK_NULL_HANDLE;
+    u64 m_LastSubmitted = 0;
+    // Last value read back from the semaphore, saves the query while the GPU is ahead
+    u64 m_Completed = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "Renderer/InstanceRenderer.hpp"
+#include "Core/JobSystem.hpp"
+
+namespace VulkanProj {
+
+void InstanceRenderer::init(VkDevice device, DeviceAllocator& allocator, BindlessTable& bindless, u32 framesInFlight, u32 maxInstances)
+{
+    m_Device = device;
+    m_Allocator = &allocator;
+    m_Bindless = &bindless;
+    m_Capacity = maxInstances;
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = (VkDeviceSize)maxInstances * sizeof(InstanceData);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    m_Frames.resize(framesInFlight);
+    for (FrameBuffer& frame : m_Frames) {
+        frame.buffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Instance data");
+        VKP_ASSERT(frame.buffer != nullptr && frame.buffer->mapped != nullptr, "FAILED TO CREATE INSTANCE BUFFER");
+        frame.bindlessIndex = bindless.registerBuffer(frame.buffer->buffer);
+    }
+}
+
+void InstanceRenderer::destroy()
+{
+    for (FrameBuffer& frame : m_Frames) {
+        m_Bindless->releaseBuffer(frame.bindlessIndex);
+        m_Allocator->destroyBuffer(frame.buffer);
+    }
+    m_Frames.clear();
+}
+
+void InstanceRenderer::beginFrame(u32 frameSlot)
+{
+    m_FrameSlot = frameSlot;
+    m_Count = 0;
+}
+
+InstanceData* InstanceRenderer::allocate(u32 count, u32& firstInstance)
+{
+    VKP_ASSERT(m_Count + count <= m_Capacity, "INSTANCE BUFFER OVERFLOW");
+    firstInstance = m_Count;
+    m_Count += count;
+    return static_cast<InstanceData*>(m_Frames[m_FrameSlot].buffer->mapped) + firstInstance;
+}
+
+void InstanceRenderer::bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const
+{
+    m_Bindless->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0);
+    u32 instanceBuffer = m_Frames[m_FrameSlot].bindlessIndex;
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(DrawConstants, instanceBuffer), sizeof(u32), &instanceBuffer);
+}
+
+void InstanceRenderer::draw(VkCommandBuffer commandBuffer, VkPipelineLayout layout, const Mesh& mesh, u32 firstInstance, u32 instanceCount) const
+{
+    mesh.bind(commandBuffer, layout);
+    vkCmdDrawIndexed(commandBuffer, mesh.getIndexCount(), instanceCount, 0, 0, firstInstance);
+}
+
+void fillInstanceGrid(InstanceData* instances, u32 count, f32 extent)
+{
+    // A single instance keeps the mesh untransformed
+    if (count == 1 && extent == 1.0f) {
+        instances[0] = { { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) }, glm::vec4(1.0f) };
+        return;
+    }
+
+    const u32 side = (u32)std::ceil(std::sqrt((f64)count));
+    const f32 cell = 2.0f * extent / side;
+    JobSystem::parallelFor(count, 0, [=](u32 first, u32 chunk) {
+        for (u32 i = first; i < first + chunk; i++) {
+            f32 x = -extent + cell * ((i % side) + 0.5f);
+            f32 y = -extent + cell * ((i / side) + 0.5f);
+            f32 t = (f32)i / count;
+            instances[i].rows[0] = glm::vec4(cell, 0.0f, 0.0f, x);
+            instances[i].rows[1] = glm::vec4(0.0f, cell, 0.0f, y);
+            instances[i].rows[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+            instances[i].color = glm::vec4(0.5f + 0.5f * t, 1.0f - 0.5f * t, 1.0f, 1.0f);
+        }
+    });
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef VKP_INSTANCERENDERER
+#define VKP_INSTANCERENDERER
+
+#include "Renderer/BindlessTable.hpp"
+#include "Renderer/DeviceAllocator.hpp"
+#include "Renderer/Mesh.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// std430 layout of one element of the instance storage buffer (shaders/shaderVert.glsl)
+struct InstanceData {
+    // Rows of a 3x4 affine transform, the implicit last row is (0, 0, 0, 1)
+    glm::vec4 rows[3];
+    glm::vec4 color;
+};
+
+// Push constants of shaders/shaderVert.glsl
+struct DrawConstants {
+    // Bindless storage buffer holding this frame's InstanceData
+    u32 instanceBuffer;
+    u32 padding[3];
+    // Pushed by Mesh::bind
+    MeshConstants mesh;
+};
+static_assert(offsetof(DrawConstants, mesh) == MESH_CONSTANTS_OFFSET, "Mesh::bind pushes MeshConstants at MESH_CONSTANTS_OFFSET");
+
+// Per-instance data in a storage buffer indexed with gl_InstanceIndex. One persistently mapped
+// buffer per frame slot, so the CPU fills the next frame while the GPU reads the previous one.
+// The buffers live in the bindless table, drawing pipelines take it as set 0 and DrawConstants
+// as their vertex push constants
+class InstanceRenderer {
+public:
+    void init(VkDevice device, DeviceAllocator& allocator, BindlessTable& bindless, u32 framesInFlight, u32 maxInstances);
+    void destroy();
+
+    // Start filling `frameSlot`. The slot's previous submission must have completed
+    void beginFrame(u32 frameSlot);
+
+    // Reserve `count` consecutive instances in this frame, returns where to write them.
+    // `firstInstance` is what draw() expects
+    InstanceData* allocate(u32 count, u32& firstInstance);
+
+    // Binds the bindless set and points the shader at this frame's buffer
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const;
+    // Binds `mesh` and draws `instanceCount` instances of it with a single indexed draw
+    void draw(VkCommandBuffer commandBuffer, VkPipelineLayout layout, const Mesh& mesh, u32 firstInstance, u32 instanceCount) const;
+
+    u32 getCapacity() const { return m_Capacity; }
+    VkBuffer getBuffer(u32 frameSlot) const { return m_Frames[frameSlot].buffer->buffer; }
+
+private:
+    struct FrameBuffer {
+        Allocation* buffer = nullptr;
+        u32 bindlessIndex = BindlessTable::INVALID_INDEX;
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+    BindlessTable* m_Bindless = nullptr;
+    std::vector<FrameBuffer> m_Frames;
+    u32 m_FrameSlot = 0;
+    u32 m_Capacity = 0;
+    u32 m_Count = 0;
+};
+
+// Test scene: lays `count` instances out on a square grid spanning [-extent, extent] in
+// clip space, in parallel. Extents above 1 put part of the grid outside the view
+void fillInstanceGrid(InstanceData* instances, u32 count, f32 extent = 1.0f);
+
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "Renderer/Ktx2.hpp"
+
+#include <cstring>
+
+namespace VulkanProj {
+
+static constexpr u8 KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static constexpr size_t KTX2_HEADER_SIZE = 80;
+static constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+struct BlockInfo {
+    u32 width;
+    u32 height;
+    u32 bytes;
+};
+
+static bool getBlockInfo(VkFormat format, BlockInfo& info)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        info = { 4, 4, 8 };
+        return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        info = { 4, 4, 16 };
+        return true;
+    // Every ASTC block is 16 bytes, only its footprint varies
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        info = { 4, 4, 16 };
+        return true;
+    case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+        info = { 5, 4, 16 };
+        return true;
+    case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+        info = { 5, 5, 16 };
+        return true;
+    case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+        info = { 6, 5, 16 };
+        return true;
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+        info = { 6, 6, 16 };
+        return true;
+    case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+        info = { 8, 5, 16 };
+        return true;
+    case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+        info = { 8, 6, 16 };
+        return true;
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        info = { 8, 8, 16 };
+        return true;
+    case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+        info = { 10, 5, 16 };
+        return true;
+    case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+        info = { 10, 6, 16 };
+        return true;
+    case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+        info = { 10, 8, 16 };
+        return true;
+    case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+        info = { 10, 10, 16 };
+        return true;
+    case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+        info = { 12, 10, 16 };
+        return true;
+    case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+        info = { 12, 12, 16 };
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The container is little endian, like every platform this runs on
+template <typename T>
+static T readField(const u8* data, size_t offset)
+{
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+bool parseKtx2(const std::string& name, const u8* data, size_t size, Ktx2Image& image)
+{
+    if (size < KTX2_HEADER_SIZE || memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        VKP_ERROR("Texture {} is not a KTX2 container", name);
+        return false;
+    }
+
+    const u32 vkFormat = readField<u32>(data, 12);
+    const u32 width = readField<u32>(data, 20);
+    const u32 height = readField<u32>(data, 24);
+    const u32 depth = readField<u32>(data, 28);
+    const u32 layerCount = readField<u32>(data, 32);
+    const u32 faceCount = readField<u32>(data, 36);
+    // 0 asks the loader to generate mips, which compressed data cannot have
+    const u32 levelCount = std::max(1u, readField<u32>(data, 40));
+    const u32 supercompression = readField<u32>(data, 44);
+
+    if (supercompression != 0) {
+        VKP_ERROR("Texture {} uses supercompression scheme {}, only uncompressed containers are supported", name, supercompression);
+        return false;
+    }
+    if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1) {
+        VKP_ERROR("Texture {} is not a single 2D image ({}x{}x{}, {} layers, {} faces)", name, width, height, depth, layerCount, faceCount);
+        return false;
+    }
+    BlockInfo block;
+    if (!getBlockInfo((VkFormat)vkFormat, block)) {
+        VKP_ERROR("Texture {} has format {}, expected a BC or ASTC format", name, vkFormat);
+        return false;
+    }
+    if (levelCount > 32 || (std::max(width, height) >> (levelCount - 1)) == 0) {
+        VKP_ERROR("Texture {} declares {} levels for {}x{}", name, levelCount, width, height);
+        return false;
+    }
+    if (KTX2_HEADER_SIZE + (size_t)levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE > size) {
+        VKP_ERROR("Texture {} is truncated inside its level index", name);
+        return false;
+    }
+
+    image.format = (VkFormat)vkFormat;
+    image.width = width;
+    image.height = height;
+    image.blockWidth = block.width;
+    image.blockHeight = block.height;
+    image.blockBytes = block.bytes;
+    image.levels.resize(levelCount);
+    for (u32 i = 0; i < levelCount; i++) {
+        const size_t entry = KTX2_HEADER_SIZE + (size_t)i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        Ktx2Level& level = image.levels[i];
+        level.offset = readField<u64>(data, entry);
+        level.size = readField<u64>(data, entry + 8);
+        level.width = std::max(1u, width >> i);
+        level.height = std::max(1u, height >> i);
+
+        const u64 expected = (u64)((level.width + block.width - 1) / block.width) * ((level.height + block.height - 1) / block.height) * block.bytes;
+        if (level.size != expected || level.offset > size || level.size > size - level.offset) {
+            VKP_ERROR("Texture {} level {} is {} bytes at offset {}, expected {} bytes inside the {} byte file", name, i, level.size,
+                level.offset, expected, size);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
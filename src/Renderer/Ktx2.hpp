@@ -0,0 +1,36 @@
+#ifndef VKP_KTX2
+#define VKP_KTX2
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+struct Ktx2Level {
+    // Byte range of the level inside the container
+    u64 offset = 0;
+    u64 size = 0;
+    u32 width = 0;
+    u32 height = 0;
+};
+
+// Layout of a KTX2 container holding a single 2D block-compressed (BC or ASTC) texture. The
+// level data is not copied, it is addressed by byte range in the buffer that was parsed
+struct Ktx2Image {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    u32 width = 0;
+    u32 height = 0;
+    u32 blockWidth = 0;
+    u32 blockHeight = 0;
+    u32 blockBytes = 0;
+    // Level 0 is full resolution, every following level halves it
+    std::vector<Ktx2Level> levels;
+};
+
+// Validates the header and level index against `size`. Supercompressed containers, arrays,
+// cube maps and 3D textures are rejected. Logs why and returns false on failure
+bool parseKtx2(const std::string& name, const u8* data, size_t size, Ktx2Image& image);
+
+}
+
+#endif
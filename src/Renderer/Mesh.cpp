@@ -0,0 +1,114 @@
+#include "Renderer/Mesh.hpp"
+
+namespace VulkanProj {
+
+VkVertexInputBindingDescription getVertexBindingDescription()
+{
+    VkVertexInputBindingDescription binding {};
+    binding.binding = 0;
+    binding.stride = sizeof(PackedVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return binding;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> getVertexAttributeDescriptions()
+{
+    std::array<VkVertexInputAttributeDescription, 3> attributes {};
+    attributes[0].binding = 0;
+    attributes[0].location = 0;
+    attributes[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    attributes[0].offset = offsetof(PackedVertex, position);
+
+    attributes[1].binding = 0;
+    attributes[1].location = 1;
+    attributes[1].format = VK_FORMAT_R16G16_SNORM;
+    attributes[1].offset = offsetof(PackedVertex, normal);
+
+    attributes[2].binding = 0;
+    attributes[2].location = 2;
+    attributes[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributes[2].offset = offsetof(PackedVertex, color);
+    return attributes;
+}
+
+// Splits uploads larger than the staging ring. Returns the last token, tokens complete in order
+static UploadToken uploadChunked(UploadQueue& uploads, VkBuffer buffer, const void* data, VkDeviceSize size)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    UploadToken token = 0;
+    for (VkDeviceSize offset = 0; offset < size;) {
+        VkDeviceSize chunk = std::min(size - offset, uploads.getRingSize());
+        token = uploads.uploadBuffer(buffer, offset, bytes + offset, chunk);
+        offset += chunk;
+    }
+    return token;
+}
+
+void Mesh::create(DeviceAllocator& allocator, UploadQueue& uploads, const std::vector<Vertex>& vertices, const std::vector<u32>& indices)
+{
+    glm::vec3 minimum(std::numeric_limits<f32>::max());
+    glm::vec3 maximum(std::numeric_limits<f32>::lowest());
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices) {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+        positions.push_back(vertex.position);
+    }
+    MeshQuantization quantization = computeQuantization(minimum, maximum);
+
+    std::vector<PackedVertex> packed;
+    packed.reserve(vertices.size());
+    for (const Vertex& vertex : vertices) {
+        packed.push_back(packVertex(vertex.position, vertex.normal, glm::vec4(vertex.color, 1.0f), quantization));
+    }
+
+    create(allocator, uploads, packed.data(), (u32)packed.size(), indices.data(), (u32)indices.size(), quantization,
+        computeBoundingSphere(positions.data(), positions.size()));
+}
+
+void Mesh::create(DeviceAllocator& allocator, UploadQueue& uploads, const PackedVertex* vertices, u32 vertexCount, const u32* indices,
+    u32 indexCount, const MeshQuantization& quantization, const glm::vec4& boundingSphere)
+{
+    m_Allocator = &allocator;
+    m_IndexCount = indexCount;
+    m_BoundingSphere = boundingSphere;
+    m_Constants.positionScale = glm::vec4(quantization.scale, 0.0f);
+    m_Constants.positionOffset = glm::vec4(quantization.offset, 0.0f);
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    bufferInfo.size = (VkDeviceSize)vertexCount * sizeof(PackedVertex);
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    m_VertexBuffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Mesh vertices");
+
+    bufferInfo.size = (VkDeviceSize)indexCount * sizeof(u32);
+    bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    m_IndexBuffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Mesh indices");
+    VKP_ASSERT(m_VertexBuffer != nullptr && m_IndexBuffer != nullptr, "FAILED TO CREATE MESH BUFFERS");
+
+    // The upload queue copies into staging (or its deferred list) right away, the source may go
+    // away after this returns. Tokens complete in order, the index upload covers both
+    uploadChunked(uploads, m_VertexBuffer->buffer, vertices, (VkDeviceSize)vertexCount * sizeof(PackedVertex));
+    m_UploadToken = uploadChunked(uploads, m_IndexBuffer->buffer, indices, (VkDeviceSize)indexCount * sizeof(u32));
+}
+
+void Mesh::destroy()
+{
+    m_Allocator->destroyBuffer(m_VertexBuffer);
+    m_Allocator->destroyBuffer(m_IndexBuffer);
+    m_VertexBuffer = nullptr;
+    m_IndexBuffer = nullptr;
+}
+
+void Mesh::bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer->buffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, MESH_CONSTANTS_OFFSET, sizeof(MeshConstants), &m_Constants);
+}
+
+}
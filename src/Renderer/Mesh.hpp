@@ -0,0 +1,62 @@
+#ifndef VKP_MESH
+#define VKP_MESH
+
+#include "Renderer/DeviceAllocator.hpp"
+#include "Renderer/MeshFormat.hpp"
+#include "Renderer/UploadQueue.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Full precision vertex for geometry built at runtime, packed into PackedVertex on upload
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec3 normal { 0.0f, 0.0f, -1.0f };
+};
+
+// Vertex input state of PackedVertex at binding 0: position, normal and color at locations 0-2
+VkVertexInputBindingDescription getVertexBindingDescription();
+std::array<VkVertexInputAttributeDescription, 3> getVertexAttributeDescriptions();
+
+// Vertex push constants following DrawConstants::instanceBuffer (InstanceRenderer.hpp)
+struct MeshConstants {
+    // xyz, w unused. The shader computes offset + position * scale
+    glm::vec4 positionScale;
+    glm::vec4 positionOffset;
+};
+static constexpr u32 MESH_CONSTANTS_OFFSET = 16;
+
+// Indexed geometry in device-local memory, filled through the upload queue
+class Mesh {
+public:
+    // Quantizes `vertices` and uploads them
+    void create(DeviceAllocator& allocator, UploadQueue& uploads, const std::vector<Vertex>& vertices, const std::vector<u32>& indices);
+    // Uploads already packed data as is, e.g. straight out of a mapped mesh pack
+    void create(DeviceAllocator& allocator, UploadQueue& uploads, const PackedVertex* vertices, u32 vertexCount, const u32* indices,
+        u32 indexCount, const MeshQuantization& quantization, const glm::vec4& boundingSphere);
+    void destroy();
+
+    // Binds vertex buffer 0 and the index buffer and pushes the mesh's MeshConstants
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const;
+
+    // The buffers may only be drawn from once this is true
+    bool isResident(const UploadQueue& uploads) const { return uploads.isComplete(m_UploadToken); }
+    u32 getIndexCount() const { return m_IndexCount; }
+    // xyz center, w radius, in mesh space
+    const glm::vec4& getBoundingSphere() const { return m_BoundingSphere; }
+
+private:
+    DeviceAllocator* m_Allocator = nullptr;
+    Allocation* m_VertexBuffer = nullptr;
+    Allocation* m_IndexBuffer = nullptr;
+    u32 m_IndexCount = 0;
+    glm::vec4 m_BoundingSphere { 0.0f };
+    MeshConstants m_Constants {};
+    UploadToken m_UploadToken = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "Renderer/MeshFormat.hpp"
+
+namespace VulkanProj {
+
+static u16 quantizeUnorm16(f32 value)
+{
+    return (u16)std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+static i16 quantizeSnorm16(f32 value)
+{
+    return (i16)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static u8 quantizeUnorm8(f32 value)
+{
+    return (u8)std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+MeshQuantization computeQuantization(const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    MeshQuantization quantization;
+    quantization.offset = minimum;
+    // Flat axes keep a non-zero scale so packing never divides by zero
+    quantization.scale = glm::max(maximum - minimum, glm::vec3(1e-20f));
+    return quantization;
+}
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& color, const MeshQuantization& quantization)
+{
+    PackedVertex vertex {};
+    glm::vec3 unorm = (position - quantization.offset) / quantization.scale;
+    vertex.position[0] = quantizeUnorm16(unorm.x);
+    vertex.position[1] = quantizeUnorm16(unorm.y);
+    vertex.position[2] = quantizeUnorm16(unorm.z);
+
+    glm::vec2 octahedral = encodeOctahedral(normal);
+    vertex.normal[0] = quantizeSnorm16(octahedral.x);
+    vertex.normal[1] = quantizeSnorm16(octahedral.y);
+
+    for (u32 i = 0; i < 4; i++) {
+        vertex.color[i] = quantizeUnorm8(color[i]);
+    }
+    return vertex;
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3& normal)
+{
+    f32 length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec3 n = normal / length;
+    if (n.z >= 0.0f) {
+        return glm::vec2(n.x, n.y);
+    }
+    // Fold the lower hemisphere over the diagonals
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    f32 fold = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+    return glm::normalize(n);
+}
+
+glm::vec4 computeBoundingSphere(const glm::vec3* positions, size_t count)
+{
+    if (count == 0) {
+        return glm::vec4(0.0f);
+    }
+    glm::vec3 minimum(std::numeric_limits<f32>::max());
+    glm::vec3 maximum(std::numeric_limits<f32>::lowest());
+    for (size_t i = 0; i < count; i++) {
+        minimum = glm::min(minimum, positions[i]);
+        maximum = glm::max(maximum, positions[i]);
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    f32 radius = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        radius = std::max(radius, glm::length(positions[i] - center));
+    }
+    return glm::vec4(center, radius);
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef VKP_MESHFORMAT
+#define VKP_MESHFORMAT
+
+#include "core.hpp"
+
+// Vulkan-free on purpose: the offline cooker (tools/Cooker) shares these definitions
+
+namespace VulkanProj {
+
+// The only vertex format meshes have on the GPU, 16 bytes. Read as R16G16B16A16_UNORM,
+// R16G16_SNORM and R8G8B8A8_UNORM, see getVertexAttributeDescriptions in Mesh.hpp
+struct PackedVertex {
+    // Position inside the mesh's bounding box, w is padding
+    u16 position[4];
+    // Octahedral encoded unit normal
+    i16 normal[2];
+    u8 color[4];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Maps unorm16 positions back to mesh space: position = offset + unorm * scale
+struct MeshQuantization {
+    glm::vec3 offset { 0.0f };
+    glm::vec3 scale { 1.0f };
+};
+
+MeshQuantization computeQuantization(const glm::vec3& minimum, const glm::vec3& maximum);
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& color, const MeshQuantization& quantization);
+
+// Unit normal to the [-1, 1]^2 octahedral square
+glm::vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+// Centered on the bounding box, not minimal but good enough for culling. xyz center, w radius
+glm::vec4 computeBoundingSphere(const glm::vec3* positions, size_t count);
+
+// .vkpm mesh pack: header, mesh table, then the vertex and index sections. Sections start on
+// MESH_PACK_ALIGNMENT boundaries so a mapped pack hands them to the upload queue as they are,
+// nothing is parsed or converted at load. Little endian, like every platform this runs on
+static constexpr u32 MESH_PACK_MAGIC = 0x4D504B56; // "VKPM"
+static constexpr u32 MESH_PACK_VERSION = 1;
+static constexpr u64 MESH_PACK_ALIGNMENT = 4096;
+static constexpr u32 MESH_PACK_NAME_SIZE = 48;
+
+struct MeshPackHeader {
+    u32 magic;
+    u32 version;
+    u32 meshCount;
+    u32 vertexStride;
+    u64 meshTableOffset;
+    u64 vertexDataOffset;
+    u64 vertexDataSize;
+    u64 indexDataOffset;
+    u64 indexDataSize;
+    u64 reserved;
+};
+static_assert(sizeof(MeshPackHeader) == 64, "MeshPackHeader layout is part of the file format");
+
+struct MeshPackEntry {
+    // Null terminated
+    char name[MESH_PACK_NAME_SIZE];
+    // In PackedVertex units from the start of the vertex section
+    u32 firstVertex;
+    u32 vertexCount;
+    // In u32 units from the start of the index section. Indices are relative to firstVertex
+    u32 firstIndex;
+    u32 indexCount;
+    f32 positionOffset[3];
+    f32 positionScale[3];
+    f32 boundingSphere[4];
+};
+static_assert(sizeof(MeshPackEntry) == 104, "MeshPackEntry layout is part of the file format");
+
+}
+
+#endif
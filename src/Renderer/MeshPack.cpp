@@ -0,0 +1,101 @@
+#include "Renderer/MeshPack.hpp"
+
+#include <cstring>
+
+namespace VulkanProj {
+
+static bool rangeInside(u64 offset, u64 size, u64 fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool MeshPack::open(const std::string& path)
+{
+    close();
+    if (!m_File.open(path)) {
+        VKP_ERROR("Failed to map mesh pack {}", path);
+        return false;
+    }
+    m_Path = path;
+
+    const size_t size = m_File.size();
+    if (size < sizeof(MeshPackHeader)) {
+        VKP_ERROR("Mesh pack {} is too small for its header", path);
+        close();
+        return false;
+    }
+    memcpy(&m_Header, m_File.data(), sizeof(MeshPackHeader));
+    if (m_Header.magic != MESH_PACK_MAGIC || m_Header.version != MESH_PACK_VERSION || m_Header.vertexStride != sizeof(PackedVertex)) {
+        VKP_ERROR("Mesh pack {} has magic {:#x} version {} stride {}, expected {:#x} version {} stride {}. Re-cook it", path,
+            m_Header.magic, m_Header.version, m_Header.vertexStride, MESH_PACK_MAGIC, MESH_PACK_VERSION, sizeof(PackedVertex));
+        close();
+        return false;
+    }
+    if (!rangeInside(m_Header.meshTableOffset, (u64)m_Header.meshCount * sizeof(MeshPackEntry), size)
+        || !rangeInside(m_Header.vertexDataOffset, m_Header.vertexDataSize, size)
+        || !rangeInside(m_Header.indexDataOffset, m_Header.indexDataSize, size)) {
+        VKP_ERROR("Mesh pack {} has sections outside its {} bytes", path, size);
+        close();
+        return false;
+    }
+    // Sections are read in place through typed pointers into the mapping
+    if (m_Header.meshTableOffset % alignof(MeshPackEntry) != 0 || m_Header.vertexDataOffset % alignof(PackedVertex) != 0
+        || m_Header.indexDataOffset % alignof(u32) != 0) {
+        VKP_ERROR("Mesh pack {} has misaligned sections. Re-cook it", path);
+        close();
+        return false;
+    }
+    m_Entries = reinterpret_cast<const MeshPackEntry*>(m_File.data() + m_Header.meshTableOffset);
+
+    const u64 vertexCapacity = m_Header.vertexDataSize / sizeof(PackedVertex);
+    const u64 indexCapacity = m_Header.indexDataSize / sizeof(u32);
+    for (u32 i = 0; i < m_Header.meshCount; i++) {
+        const MeshPackEntry& entry = m_Entries[i];
+        if (entry.vertexCount == 0 || entry.indexCount == 0 || (u64)entry.firstVertex + entry.vertexCount > vertexCapacity || (u64)entry.firstIndex + entry.indexCount > indexCapacity
+            || memchr(entry.name, 0, MESH_PACK_NAME_SIZE) == nullptr) {
+            VKP_ERROR("Mesh pack {} entry {} points outside the pack", path, i);
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshPack::close()
+{
+    m_File.close();
+    m_Path.clear();
+    m_Header = {};
+    m_Entries = nullptr;
+}
+
+u32 MeshPack::findMesh(const std::string& name) const
+{
+    for (u32 i = 0; i < m_Header.meshCount; i++) {
+        if (name == m_Entries[i].name) {
+            return i;
+        }
+    }
+    return m_Header.meshCount;
+}
+
+void MeshPack::createMesh(u32 index, DeviceAllocator& allocator, UploadQueue& uploads, Mesh& mesh) const
+{
+    VKP_ASSERT(index < m_Header.meshCount, "MESH PACK INDEX OUT OF RANGE");
+    const MeshPackEntry& entry = m_Entries[index];
+
+    MeshQuantization quantization;
+    quantization.offset = glm::vec3(entry.positionOffset[0], entry.positionOffset[1], entry.positionOffset[2]);
+    quantization.scale = glm::vec3(entry.positionScale[0], entry.positionScale[1], entry.positionScale[2]);
+    glm::vec4 boundingSphere(entry.boundingSphere[0], entry.boundingSphere[1], entry.boundingSphere[2], entry.boundingSphere[3]);
+
+    // Sections are aligned by the cooker, so these point at naturally aligned data in the mapping
+    const u8* data = m_File.data();
+    const PackedVertex* vertices = reinterpret_cast<const PackedVertex*>(data + m_Header.vertexDataOffset) + entry.firstVertex;
+    const u32* indices = reinterpret_cast<const u32*>(data + m_Header.indexDataOffset) + entry.firstIndex;
+    mesh.create(allocator, uploads, vertices, entry.vertexCount, indices, entry.indexCount, quantization, boundingSphere);
+
+    VKP_INFO("Loaded mesh '{}' from {}: {} vertices, {} triangles", entry.name, m_Path, entry.vertexCount, entry.indexCount / 3);
+}
+
+}
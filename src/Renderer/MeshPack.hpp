@@ -0,0 +1,36 @@
+#ifndef VKP_MESHPACK
+#define VKP_MESHPACK
+
+#include "Core/MappedFile.hpp"
+#include "Renderer/Mesh.hpp"
+#include "Renderer/MeshFormat.hpp"
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// A .vkpm pack written by the offline cooker (tools/Cooker), mapped read-only. Opening only
+// validates the header and mesh table; creating a mesh hands its vertex and index ranges
+// straight from the mapping to the upload queue. Close it once the meshes are created
+class MeshPack {
+public:
+    // Logs why and returns false when the file is missing, truncated or from another version
+    bool open(const std::string& path);
+    void close();
+
+    u32 getMeshCount() const { return m_Header.meshCount; }
+    const MeshPackEntry& getEntry(u32 index) const { return m_Entries[index]; }
+    // Index of the mesh called `name`, or getMeshCount() when there is none
+    u32 findMesh(const std::string& name) const;
+
+    void createMesh(u32 index, DeviceAllocator& allocator, UploadQueue& uploads, Mesh& mesh) const;
+
+private:
+    std::string m_Path;
+    MappedFile m_File;
+    MeshPackHeader m_Header {};
+    const MeshPackEntry* m_Entries = nullptr;
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "Renderer/ParallelRecorder.hpp"
+#include "Core/JobSystem.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+void ParallelRecorder::init(VkDevice device, u32 queueFamily, u32 framesInFlight)
+{
+    m_Device = device;
+    m_WorkerCount = std::max(1u, JobSystem::getThreadCount());
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    m_Pools.resize(framesInFlight * m_WorkerCount);
+    for (WorkerPool& pool : m_Pools) {
+        VkResult res = vkCreateCommandPool(m_Device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &pool.pool);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE WORKER COMMAND POOL");
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_COMMAND_POOL, pool.pool, "Worker command pool");
+    }
+    VKP_INFO("ParallelRecorder: {} recording threads, {} pools", m_WorkerCount, m_Pools.size());
+}
+
+void ParallelRecorder::destroy()
+{
+    for (WorkerPool& pool : m_Pools) {
+        VKP_UNTRACK(pool.pool);
+        vkDestroyCommandPool(m_Device, pool.pool, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_Pools.clear();
+}
+
+void ParallelRecorder::beginFrame(u32 frameSlot)
+{
+    m_FrameSlot = frameSlot;
+    for (u32 worker = 0; worker < m_WorkerCount; worker++) {
+        WorkerPool& pool = getPool(worker);
+        vkResetCommandPool(m_Device, pool.pool, 0);
+        pool.used = 0;
+    }
+}
+
+VkCommandBuffer ParallelRecorder::acquireSecondary(u32 worker)
+{
+    WorkerPool& pool = getPool(worker);
+    if (pool.used == pool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VkResult res = vkAllocateCommandBuffers(m_Device, &allocInfo, &commandBuffer);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE SECONDARY COMMAND BUFFER");
+        pool.buffers.push_back(commandBuffer);
+    }
+    return pool.buffers[pool.used++];
+}
+
+void ParallelRecorder::recordChunk(u32 worker, u32 chunk, const VkCommandBufferInheritanceInfo& inheritance, u32 itemCount,
+    u32 chunkSize, const RecordFn& fn)
+{
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    VkCommandBuffer commandBuffer = acquireSecondary(worker);
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    u32 first = chunk * chunkSize;
+    fn(commandBuffer, first, std::min(chunkSize, itemCount - first));
+
+    vkEndCommandBuffer(commandBuffer);
+    m_Secondaries[chunk] = commandBuffer;
+}
+
+void ParallelRecorder::record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo& inheritance, u32 itemCount, u32 chunkSize,
+    const RecordFn& fn)
+{
+    if (itemCount == 0) {
+        return;
+    }
+    VKP_ASSERT(chunkSize > 0, "CHUNK SIZE MUST BE NON-ZERO");
+
+    const u32 chunkCount = (itemCount + chunkSize - 1) / chunkSize;
+    m_Secondaries.assign(chunkCount, VK_NULL_HANDLE);
+
+    // Whichever thread picks up a chunk records it with its own pool
+    JobSystem::parallelFor(chunkCount, 1, [&](u32 firstChunk, u32 count) {
+        u32 worker = JobSystem::getThreadIndex();
+        VKP_ASSERT(worker < m_WorkerCount, "JOB SYSTEM RESIZED AFTER RECORDER INIT");
+        for (u32 chunk = firstChunk; chunk < firstChunk + count; chunk++) {
+            recordChunk(worker, chunk, inheritance, itemCount, chunkSize, fn);
+        }
+    });
+
+    vkCmdExecuteCommands(primary, chunkCount, m_Secondaries.data());
+}
+
+}
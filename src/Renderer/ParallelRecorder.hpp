@@ -0,0 +1,56 @@
+#ifndef VKP_PARALLELRECORDER
+#define VKP_PARALLELRECORDER
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Records one render pass worth of draws into secondary command buffers on the job system.
+// Every job system thread owns one command pool per frame slot, so recording never shares a
+// pool across threads and a frame is recycled by resetting its pools wholesale
+class ParallelRecorder {
+public:
+    // Records items [first, first + count) into `commandBuffer`. Called concurrently from workers,
+    // must not touch shared mutable state
+    using RecordFn = std::function<void(VkCommandBuffer commandBuffer, u32 first, u32 count)>;
+
+    // Sized for the job system as it is configured at this point
+    void init(VkDevice device, u32 queueFamily, u32 framesInFlight);
+    void destroy();
+
+    // Reset all pools of `frameSlot`. The slot's previous submission must have completed
+    void beginFrame(u32 frameSlot);
+
+    // Split `itemCount` items into chunks, record every chunk into its own secondary buffer in
+    // parallel and execute them from `primary` in chunk order, so output does not depend on
+    // which thread recorded what. `primary` must be inside dynamic rendering begun with
+    // VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, `inheritance` chaining the matching
+    // VkCommandBufferInheritanceRenderingInfo (see RGPassContext::inheritance)
+    void record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo& inheritance, u32 itemCount, u32 chunkSize,
+        const RecordFn& fn);
+
+    u32 getWorkerCount() const { return m_WorkerCount; }
+
+private:
+    struct WorkerPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        u32 used = 0;
+    };
+
+    WorkerPool& getPool(u32 worker) { return m_Pools[m_FrameSlot * m_WorkerCount + worker]; }
+    VkCommandBuffer acquireSecondary(u32 worker);
+    void recordChunk(u32 worker, u32 chunk, const VkCommandBufferInheritanceInfo& inheritance, u32 itemCount, u32 chunkSize,
+        const RecordFn& fn);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    u32 m_WorkerCount = 1;
+    u32 m_FrameSlot = 0;
+    std::vector<WorkerPool> m_Pools; // [frameSlot * workerCount + worker]
+    std::vector<VkCommandBuffer> m_Secondaries; // indexed by chunk
+};
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "Renderer/PipelineCache.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+// Prefixed to the driver blob so truncated or foreign files are rejected before
+// they ever reach vkCreatePipelineCache
+struct PipelineCacheFileHeader {
+    u32 magic;
+    u32 version;
+    u32 driverVersion;
+    u32 reserved;
+    u64 dataSize;
+    Hash dataHash;
+};
+
+static constexpr u32 PIPELINE_CACHE_MAGIC = 0x43504b56; // "VKPC"
+static constexpr u32 PIPELINE_CACHE_FILE_VERSION = 1;
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+{
+    m_Device = device;
+    m_Path = path;
+    vkGetPhysicalDeviceProperties(physicalDevice, &m_Properties);
+
+    std::vector<u8> blob;
+    if (!m_Path.empty()) {
+        std::ifstream file(m_Path, std::ios::ate | std::ios::binary);
+        if (file.is_open()) {
+            size_t fileSize = (size_t)file.tellg();
+            file.seekg(0);
+
+            PipelineCacheFileHeader header {};
+            if (fileSize >= sizeof(header)) {
+                file.read(reinterpret_cast<char*>(&header), sizeof(header));
+                blob.resize(fileSize - sizeof(header));
+                file.read(reinterpret_cast<char*>(blob.data()), blob.size());
+            }
+
+            bool headerValid = header.magic == PIPELINE_CACHE_MAGIC
+                && header.version == PIPELINE_CACHE_FILE_VERSION
+                && header.driverVersion == m_Properties.driverVersion
+                && header.dataSize == blob.size()
+                && header.dataHash == hashBytes(blob.data(), blob.size());
+            if (!headerValid || !validate(blob)) {
+                VKP_WARN("Discarding pipeline cache {}: written by a different device or driver, or corrupt", m_Path);
+                blob.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = blob.size();
+    createInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+
+    VkResult res = vkCreatePipelineCache(m_Device, &createInfo, VKP_ALLOCATION_CALLBACKS, &m_Cache);
+    if (res != VK_SUCCESS && !blob.empty()) {
+        // Driver rejected data that passed our checks, start cold rather than fail
+        VKP_WARN("Driver rejected pipeline cache {}, starting cold", m_Path);
+        blob.clear();
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        res = vkCreatePipelineCache(m_Device, &createInfo, VKP_ALLOCATION_CALLBACKS, &m_Cache);
+    }
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE PIPELINE CACHE");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE_CACHE, m_Cache, "Pipeline cache");
+
+    m_Warm = !blob.empty();
+    m_LoadedHash = m_Warm ? hashBytes(blob.data(), blob.size()) : 0;
+    VKP_INFO("Pipeline cache: {} ({} bytes from {})", m_Warm ? "warm" : "cold", blob.size(), m_Path.empty() ? "<disabled>" : m_Path);
+}
+
+bool PipelineCache::validate(const std::vector<u8>& blob) const
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (blob.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, blob.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == m_Properties.vendorID
+        && header.deviceID == m_Properties.deviceID
+        && memcmp(header.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save()
+{
+    if (m_Cache == VK_NULL_HANDLE || m_Path.empty()) {
+        return;
+    }
+
+    size_t dataSize = 0;
+    vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, nullptr);
+    std::vector<u8> blob(dataSize);
+    VkResult res = vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, blob.data());
+    if (res != VK_SUCCESS || dataSize == 0) {
+        return;
+    }
+    blob.resize(dataSize);
+
+    Hash dataHash = hashBytes(blob.data(), blob.size());
+    if (dataHash == m_LoadedHash) {
+        return;
+    }
+
+    PipelineCacheFileHeader header {};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_FILE_VERSION;
+    header.driverVersion = m_Properties.driverVersion;
+    header.dataSize = blob.size();
+    header.dataHash = dataHash;
+
+    std::string tempPath = m_Path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            VKP_WARN("Unable to write pipeline cache {}", tempPath);
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+        file.flush();
+        if (!file.good()) {
+            VKP_WARN("Unable to write pipeline cache {}", tempPath);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, m_Path, ec);
+    if (ec) {
+        VKP_WARN("Unable to replace pipeline cache {}: {}", m_Path, ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    m_LoadedHash = dataHash;
+    VKP_INFO("Pipeline cache: saved {} bytes to {}", blob.size(), m_Path);
+}
+
+void PipelineCache::destroy()
+{
+    if (m_Cache != VK_NULL_HANDLE) {
+        VKP_UNTRACK(m_Cache);
+        vkDestroyPipelineCache(m_Device, m_Cache, VKP_ALLOCATION_CALLBACKS);
+        m_Cache = VK_NULL_HANDLE;
+    }
+}
+
+}
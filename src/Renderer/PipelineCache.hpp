@@ -0,0 +1,35 @@
+#ifndef VKP_PIPELINECACHE
+#define VKP_PIPELINECACHE
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// VkPipelineCache persisted between launches. The blob is only handed to the driver
+// when it was produced by the same vendor, device and driver build
+class PipelineCache {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+    // Written to a temporary file and renamed over the old one, so a crash never leaves a torn cache
+    void save();
+    void destroy();
+
+    VkPipelineCache getHandle() const { return m_Cache; }
+    // True when a valid blob was loaded from disk
+    bool isWarm() const { return m_Warm; }
+
+private:
+    bool validate(const std::vector<u8>& blob) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_Properties {};
+    std::string m_Path;
+    Hash m_LoadedHash = 0;
+    bool m_Warm = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,450 @@
+#include "Renderer/PipelineRegistry.hpp"
+#include "Bench/Bench.hpp"
+#include "Core/JobSystem.hpp"
+#include "Profiler/ResourceTracker.hpp"
+#include "Renderer/Mesh.hpp"
+
+namespace VulkanProj {
+
+static constexpr VkDynamicState DYNAMIC_STATES[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+// Graphics pipeline library parts, mixed into the hash of the state each part depends on
+enum LibraryPart : u32 {
+    LIBRARY_VERTEX_INPUT,
+    LIBRARY_PRE_RASTERIZATION,
+    LIBRARY_FRAGMENT_SHADER,
+    LIBRARY_FRAGMENT_OUTPUT,
+};
+
+static bool hasStencil(VkFormat format)
+{
+    return format == VK_FORMAT_S8_UINT || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT
+        || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+// Fixed-function state of one variant, and the storage its create infos point into
+struct VariantState {
+    VkVertexInputBindingDescription binding;
+    std::array<VkVertexInputAttributeDescription, 3> attributes;
+    VkFormat colorFormat;
+
+    VkPipelineVertexInputStateCreateInfo vertexInput {};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+    VkPipelineViewportStateCreateInfo viewport {};
+    VkPipelineRasterizationStateCreateInfo rasterizer {};
+    VkPipelineMultisampleStateCreateInfo multisampling {};
+    VkPipelineDepthStencilStateCreateInfo depthStencil {};
+    VkPipelineColorBlendAttachmentState blendAttachment {};
+    VkPipelineColorBlendStateCreateInfo colorBlending {};
+    VkPipelineDynamicStateCreateInfo dynamicState {};
+    VkPipelineRenderingCreateInfo rendering {};
+
+    explicit VariantState(const PipelineKey& key)
+        : binding(getVertexBindingDescription())
+        , attributes(getVertexAttributeDescriptions())
+        , colorFormat(key.colorFormat)
+    {
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInput.vertexBindingDescriptionCount = 1;
+        vertexInput.pVertexBindingDescriptions = &binding;
+        vertexInput.vertexAttributeDescriptionCount = (u32)attributes.size();
+        vertexInput.pVertexAttributeDescriptions = attributes.data();
+
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = (VkPrimitiveTopology)key.topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        // Viewport and scissor are dynamic, only the counts are baked in
+        viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport.viewportCount = 1;
+        viewport.scissorCount = 1;
+
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.polygonMode = (VkPolygonMode)key.polygonMode;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = key.cullMode;
+        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling.minSampleShading = 1.0f;
+
+        const bool depth = key.depthFormat != VK_FORMAT_UNDEFINED;
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = depth ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = depth ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.maxDepthBounds = 1.0f;
+
+        blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        switch (key.blend) {
+        case BlendMode::Opaque:
+            blendAttachment.blendEnable = VK_FALSE;
+            break;
+        case BlendMode::Alpha:
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            break;
+        case BlendMode::Additive:
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            break;
+        case BlendMode::Premultiplied:
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            break;
+        }
+
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.logicOp = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &blendAttachment;
+
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = (u32)std::size(DYNAMIC_STATES);
+        dynamicState.pDynamicStates = DYNAMIC_STATES;
+
+        // Dynamic rendering, pipelines only declare the attachment formats
+        rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        rendering.colorAttachmentCount = 1;
+        rendering.pColorAttachmentFormats = &colorFormat;
+        rendering.depthAttachmentFormat = key.depthFormat;
+        rendering.stencilAttachmentFormat = hasStencil(key.depthFormat) ? key.depthFormat : VK_FORMAT_UNDEFINED;
+    }
+
+    VariantState(const VariantState&) = delete;
+    VariantState& operator=(const VariantState&) = delete;
+};
+
+static VkPipelineShaderStageCreateInfo describeStage(VkShaderStageFlagBits stage, VkShaderModule module)
+{
+    VkPipelineShaderStageCreateInfo info {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage = stage;
+    info.module = module;
+    info.pName = "main";
+    return info;
+}
+
+void PipelineRegistry::init(VkDevice device, VkPipelineCache cache, bool pipelineLibrary)
+{
+    m_Device = device;
+    m_Cache = cache;
+    m_PipelineLibrary = pipelineLibrary;
+}
+
+void PipelineRegistry::destroy()
+{
+    for (Shard& shard : m_Shards) {
+        for (auto& [hash, bucket] : shard.entries) {
+            for (Scope<Entry>& entry : bucket) {
+                VKP_UNTRACK(entry->pipeline.load());
+                vkDestroyPipeline(m_Device, entry->pipeline.load(), VKP_ALLOCATION_CALLBACKS);
+            }
+        }
+        shard.entries.clear();
+    }
+    for (auto& [hash, library] : m_Libraries) {
+        VKP_UNTRACK(library->pipeline);
+        vkDestroyPipeline(m_Device, library->pipeline, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_Libraries.clear();
+    m_Programs.clear();
+}
+
+u32 PipelineRegistry::registerProgram(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkPipelineLayout layout)
+{
+    m_Programs.push_back({ vertexShader, fragmentShader, layout });
+    return (u32)m_Programs.size() - 1;
+}
+
+VkPipeline PipelineRegistry::get(const PipelineKey& key)
+{
+    return getOrCreate(key, false);
+}
+
+void PipelineRegistry::prewarm(const std::vector<PipelineKey>& keys)
+{
+    BenchTimer timer;
+    const u64 createdBefore = m_TotalCreateUs.load();
+    JobSystem::parallelFor((u32)keys.size(), 1, [&](u32 first, u32 count) {
+        for (u32 i = first; i < first + count; i++) {
+            getOrCreate(keys[i], true);
+        }
+    });
+    VKP_INFO("Prewarmed {} pipeline variants in {:.2f}ms on {} threads, {:.2f}ms of creation work ({})", keys.size(), timer.elapsedMs(),
+        JobSystem::getThreadCount(), (m_TotalCreateUs.load() - createdBefore) / 1000.0, m_PipelineLibrary ? "pipeline libraries" : "monolithic");
+}
+
+PipelineRegistry::Entry& PipelineRegistry::findOrInsert(const PipelineKey& key)
+{
+    const Hash hash = hashBytes(&key, sizeof(PipelineKey));
+    // The high bits pick the shard, the map buckets on the low ones
+    Shard& shard = m_Shards[(hash >> 32) % SHARD_COUNT];
+    auto find = [&]() -> Entry* {
+        auto it = shard.entries.find(hash);
+        if (it == shard.entries.end()) {
+            return nullptr;
+        }
+        for (Scope<Entry>& entry : it->second) {
+            if (entry->key == key) {
+                return entry.get();
+            }
+        }
+        return nullptr;
+    };
+
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        if (Entry* entry = find()) {
+            return *entry;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (Entry* entry = find()) {
+        return *entry;
+    }
+    Scope<Entry> entry = CreateScope<Entry>();
+    entry->key = key;
+    Entry& inserted = *entry;
+    shard.entries[hash].push_back(std::move(entry));
+    return inserted;
+}
+
+VkPipeline PipelineRegistry::getOrCreate(const PipelineKey& key, bool prewarming)
+{
+    Entry& entry = findOrInsert(key);
+    VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire);
+    if (pipeline != VK_NULL_HANDLE || entry.failed.load(std::memory_order_acquire)) {
+        return pipeline;
+    }
+
+    std::lock_guard<std::mutex> lock(entry.createMutex);
+    pipeline = entry.pipeline.load(std::memory_order_acquire);
+    if (pipeline != VK_NULL_HANDLE || entry.failed.load(std::memory_order_acquire)) {
+        return pipeline;
+    }
+
+    BenchTimer timer;
+    pipeline = createVariant(key, prewarming);
+    const u64 elapsedUs = (u64)(timer.elapsedMs() * 1000.0);
+    m_TotalCreateUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+    if (pipeline == VK_NULL_HANDLE) {
+        VKP_ERROR("Failed to create pipeline variant (program {}, color format {}, depth format {}, blend {}, topology {}, cull {}, polygon {})",
+            key.program, (u32)key.colorFormat, (u32)key.depthFormat, (u32)key.blend, key.topology, key.cullMode, key.polygonMode);
+        entry.failed.store(true, std::memory_order_release);
+        return VK_NULL_HANDLE;
+    }
+
+    m_VariantCount.fetch_add(1, std::memory_order_relaxed);
+    if (prewarming) {
+        m_Prewarmed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_LazyCreated.fetch_add(1, std::memory_order_relaxed);
+        u64 worst = m_WorstLazyUs.load(std::memory_order_relaxed);
+        while (elapsedUs > worst && !m_WorstLazyUs.compare_exchange_weak(worst, elapsedUs, std::memory_order_relaxed)) {
+        }
+        VKP_INFO("Pipeline variant created on first use in {:.2f}ms", elapsedUs / 1000.0);
+    }
+    entry.pipeline.store(pipeline, std::memory_order_release);
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::createVariant(const PipelineKey& key, bool optimize)
+{
+    VKP_ASSERT(key.program < m_Programs.size(), "UNKNOWN PIPELINE PROGRAM " + std::to_string(key.program));
+    if (m_PipelineLibrary) {
+        return linkLibraries(key, optimize);
+    }
+    const Program& program = m_Programs[key.program];
+    return createMonolithic(key, program.vertexShader, program.fragmentShader);
+}
+
+VkPipeline PipelineRegistry::createStandalone(const PipelineKey& key, VkShaderModule vertexShader, VkShaderModule fragmentShader) const
+{
+    VKP_ASSERT(key.program < m_Programs.size(), "UNKNOWN PIPELINE PROGRAM " + std::to_string(key.program));
+    return createMonolithic(key, vertexShader, fragmentShader);
+}
+
+VkPipeline PipelineRegistry::createMonolithic(const PipelineKey& key, VkShaderModule vertexShader, VkShaderModule fragmentShader) const
+{
+    VariantState state(key);
+    VkPipelineShaderStageCreateInfo stages[] = {
+        describeStage(VK_SHADER_STAGE_VERTEX_BIT, vertexShader),
+        describeStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader),
+    };
+
+    VkGraphicsPipelineCreateInfo info {};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.pNext = &state.rendering;
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &state.vertexInput;
+    info.pInputAssemblyState = &state.inputAssembly;
+    info.pViewportState = &state.viewport;
+    info.pRasterizationState = &state.rasterizer;
+    info.pMultisampleState = &state.multisampling;
+    info.pDepthStencilState = &state.depthStencil;
+    info.pColorBlendState = &state.colorBlending;
+    info.pDynamicState = &state.dynamicState;
+    info.layout = m_Programs[key.program].layout;
+    info.basePipelineIndex = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateGraphicsPipelines(m_Device, m_Cache, 1, &info, VKP_ALLOCATION_CALLBACKS, &pipeline);
+    if (res != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE, pipeline, "Pipeline variant");
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::getLibrary(Hash hash, const std::function<VkPipeline()>& create)
+{
+    Library* library = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_LibraryMutex);
+        Scope<Library>& slot = m_Libraries[hash];
+        if (!slot) {
+            slot = CreateScope<Library>();
+        }
+        library = slot.get();
+    }
+
+    // Only the part's own lock is held while building, other parts build in parallel
+    std::lock_guard<std::mutex> lock(library->createMutex);
+    if (library->pipeline == VK_NULL_HANDLE) {
+        library->pipeline = create();
+        if (library->pipeline != VK_NULL_HANDLE) {
+            m_LibraryCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return library->pipeline;
+}
+
+VkPipeline PipelineRegistry::linkLibraries(const PipelineKey& key, bool optimize)
+{
+    const Program& program = m_Programs[key.program];
+    VariantState state(key);
+
+    // Every part keeps what link time optimization needs, so prewarm can still link optimized
+    auto createLibrary = [&](VkGraphicsPipelineLibraryFlagsEXT part, VkGraphicsPipelineCreateInfo info) {
+        VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo {};
+        libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+        libraryInfo.pNext = &state.rendering;
+        libraryInfo.flags = part;
+
+        info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        info.pNext = &libraryInfo;
+        info.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+        info.basePipelineIndex = -1;
+
+        VkPipeline library = VK_NULL_HANDLE;
+        VkResult res = vkCreateGraphicsPipelines(m_Device, m_Cache, 1, &info, VKP_ALLOCATION_CALLBACKS, &library);
+        if (res != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE, library, "Pipeline library");
+        return library;
+    };
+
+    const u32 vertexInputKey[] = { LIBRARY_VERTEX_INPUT, key.topology };
+    VkPipeline vertexInput = getLibrary(hashBytes(vertexInputKey, sizeof(vertexInputKey)), [&]() {
+        VkGraphicsPipelineCreateInfo info {};
+        info.pVertexInputState = &state.vertexInput;
+        info.pInputAssemblyState = &state.inputAssembly;
+        return createLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, info);
+    });
+
+    const u32 preRasterizationKey[] = { LIBRARY_PRE_RASTERIZATION, key.program, key.cullMode, key.polygonMode };
+    VkPipeline preRasterization = getLibrary(hashBytes(preRasterizationKey, sizeof(preRasterizationKey)), [&]() {
+        VkPipelineShaderStageCreateInfo stage = describeStage(VK_SHADER_STAGE_VERTEX_BIT, program.vertexShader);
+        VkGraphicsPipelineCreateInfo info {};
+        info.stageCount = 1;
+        info.pStages = &stage;
+        info.pViewportState = &state.viewport;
+        info.pRasterizationState = &state.rasterizer;
+        info.pDynamicState = &state.dynamicState;
+        info.layout = program.layout;
+        return createLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, info);
+    });
+
+    const u32 fragmentShaderKey[] = { LIBRARY_FRAGMENT_SHADER, key.program, (u32)key.depthFormat };
+    VkPipeline fragmentShader = getLibrary(hashBytes(fragmentShaderKey, sizeof(fragmentShaderKey)), [&]() {
+        VkPipelineShaderStageCreateInfo stage = describeStage(VK_SHADER_STAGE_FRAGMENT_BIT, program.fragmentShader);
+        VkGraphicsPipelineCreateInfo info {};
+        info.stageCount = 1;
+        info.pStages = &stage;
+        info.pMultisampleState = &state.multisampling;
+        info.pDepthStencilState = &state.depthStencil;
+        info.layout = program.layout;
+        return createLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, info);
+    });
+
+    const u32 fragmentOutputKey[] = { LIBRARY_FRAGMENT_OUTPUT, (u32)key.blend, (u32)key.colorFormat, (u32)key.depthFormat };
+    VkPipeline fragmentOutput = getLibrary(hashBytes(fragmentOutputKey, sizeof(fragmentOutputKey)), [&]() {
+        VkGraphicsPipelineCreateInfo info {};
+        info.pMultisampleState = &state.multisampling;
+        info.pColorBlendState = &state.colorBlending;
+        return createLibrary(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, info);
+    });
+
+    if (vertexInput == VK_NULL_HANDLE || preRasterization == VK_NULL_HANDLE || fragmentShader == VK_NULL_HANDLE || fragmentOutput == VK_NULL_HANDLE) {
+        return VK_NULL_HANDLE;
+    }
+
+    const VkPipeline libraries[] = { vertexInput, preRasterization, fragmentShader, fragmentOutput };
+    VkPipelineLibraryCreateInfoKHR linkInfo {};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = (u32)std::size(libraries);
+    linkInfo.pLibraries = libraries;
+
+    // A fast link is what keeps first uses cheap, prewarming has the time to optimize
+    VkGraphicsPipelineCreateInfo info {};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.pNext = &linkInfo;
+    info.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    info.layout = program.layout;
+    info.basePipelineIndex = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateGraphicsPipelines(m_Device, m_Cache, 1, &info, VKP_ALLOCATION_CALLBACKS, &pipeline);
+    if (res != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_PIPELINE, pipeline, "Linked pipeline variant");
+    return pipeline;
+}
+
+PipelineRegistry::Stats PipelineRegistry::getStats() const
+{
+    Stats stats;
+    stats.variantCount = m_VariantCount.load();
+    stats.libraryCount = m_LibraryCount.load();
+    stats.prewarmed = m_Prewarmed.load();
+    stats.lazyCreated = m_LazyCreated.load();
+    stats.worstLazyMs = m_WorstLazyUs.load() / 1000.0;
+    stats.totalCreateMs = m_TotalCreateUs.load() / 1000.0;
+    return stats;
+}
+
+void PipelineRegistry::logStats() const
+{
+    Stats stats = getStats();
+    VKP_INFO("Pipelines: {} variants ({} prewarmed, {} on first use, worst first use {:.2f}ms), {} libraries, {:.2f}ms creating",
+        stats.variantCount, stats.prewarmed, stats.lazyCreated, stats.worstLazyMs, stats.libraryCount, stats.totalCreateMs);
+}
+
+}
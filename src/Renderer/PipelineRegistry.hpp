@@ -0,0 +1,135 @@
+#ifndef VKP_PIPELINEREGISTRY
+#define VKP_PIPELINEREGISTRY
+
+#include "core.hpp"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+enum class BlendMode : u8 {
+    Opaque,
+    Alpha,
+    Additive,
+    Premultiplied,
+};
+
+// Everything that varies between graphics pipeline variants. 16 bytes without padding, so keys
+// are hashed and compared bytewise. Vertex input (PackedVertex), front face and the dynamic
+// viewport/scissor are the same for every variant
+struct PipelineKey {
+    // From PipelineRegistry::registerProgram
+    u32 program = 0;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    // VK_FORMAT_UNDEFINED draws without depth
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    BlendMode blend = BlendMode::Alpha;
+    u8 topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    u8 cullMode = VK_CULL_MODE_BACK_BIT;
+    u8 polygonMode = VK_POLYGON_MODE_FILL;
+
+    bool operator==(const PipelineKey& other) const { return memcmp(this, &other, sizeof(PipelineKey)) == 0; }
+};
+static_assert(sizeof(PipelineKey) == 16, "PipelineKey must stay compact and free of padding");
+
+// Owns every graphics pipeline variant. Lookups go through a sharded map, readers only take a
+// shared lock on one shard, so recording threads can look pipelines up freely. A variant is
+// created on first use unless prewarm() made it already. With VK_EXT_graphics_pipeline_library
+// variants are linked from cached vertex input, pre-rasterization, fragment shader and output
+// libraries, so a first use only pays for a link instead of a full compile
+class PipelineRegistry {
+public:
+    struct Stats {
+        u32 variantCount = 0;
+        u32 libraryCount = 0;
+        u32 prewarmed = 0;
+        // Variants created by get(), each of which stalled the thread that asked for it
+        u32 lazyCreated = 0;
+        f64 worstLazyMs = 0.0;
+        f64 totalCreateMs = 0.0;
+    };
+
+    // `pipelineLibrary`: VK_EXT_graphics_pipeline_library is enabled on the device
+    void init(VkDevice device, VkPipelineCache cache, bool pipelineLibrary);
+    // The device must be idle
+    void destroy();
+
+    // Shaders and layout variants are built from. Not thread safe, register before the first get()
+    u32 registerProgram(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkPipelineLayout layout);
+
+    // The pipeline for `key`, created on first use. Thread safe, concurrent first uses of one key
+    // create it once. VK_NULL_HANDLE when creation failed, which is not retried
+    VkPipeline get(const PipelineKey& key);
+    // Creates every variant in `keys` in parallel on the job system and returns when all exist.
+    // Library builds are linked with link time optimization here, get() links fast instead
+    void prewarm(const std::vector<PipelineKey>& keys);
+
+    // A variant built from other shaders than its program's, not cached and owned by the caller.
+    // For pipelines whose modules do not outlive the call, e.g. hot reloaded ones. Thread safe
+    VkPipeline createStandalone(const PipelineKey& key, VkShaderModule vertexShader, VkShaderModule fragmentShader) const;
+
+    bool usesPipelineLibrary() const { return m_PipelineLibrary; }
+    Stats getStats() const;
+    void logStats() const;
+
+private:
+    static constexpr u32 SHARD_COUNT = 16;
+
+    struct Program {
+        VkShaderModule vertexShader;
+        VkShaderModule fragmentShader;
+        VkPipelineLayout layout;
+    };
+
+    struct Entry {
+        PipelineKey key;
+        std::atomic<VkPipeline> pipeline { VK_NULL_HANDLE };
+        std::atomic<bool> failed { false };
+        // Held while the variant is created, later users of the key wait on it
+        std::mutex createMutex;
+    };
+
+    struct Library {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        // Held while the part is built, variants sharing it wait instead of building it again
+        std::mutex createMutex;
+    };
+
+    struct Shard {
+        std::shared_mutex mutex;
+        // Collisions share a bucket
+        UMap<Hash, std::vector<Scope<Entry>>> entries;
+    };
+
+    VkPipeline getOrCreate(const PipelineKey& key, bool prewarming);
+    Entry& findOrInsert(const PipelineKey& key);
+    VkPipeline createVariant(const PipelineKey& key, bool optimize);
+    VkPipeline createMonolithic(const PipelineKey& key, VkShaderModule vertexShader, VkShaderModule fragmentShader) const;
+    VkPipeline linkLibraries(const PipelineKey& key, bool optimize);
+    VkPipeline getLibrary(Hash hash, const std::function<VkPipeline()>& create);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    bool m_PipelineLibrary = false;
+    std::vector<Program> m_Programs;
+    std::array<Shard, SHARD_COUNT> m_Shards;
+
+    // Graphics pipeline library parts, keyed by a hash of the state each one depends on
+    std::mutex m_LibraryMutex;
+    UMap<Hash, Scope<Library>> m_Libraries;
+    std::atomic<u32> m_LibraryCount { 0 };
+
+    std::atomic<u32> m_VariantCount { 0 };
+    std::atomic<u32> m_Prewarmed { 0 };
+    std::atomic<u32> m_LazyCreated { 0 };
+    // Microseconds, kept as integers so they can be atomics
+    std::atomic<u64> m_WorstLazyUs { 0 };
+    std::atomic<u64> m_TotalCreateUs { 0 };
+};
+
+}
+
+#endif
@@ -0,0 +1,699 @@
+#include "Renderer/RenderGraph.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <algorithm>
+
+namespace VulkanProj {
+
+static constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT
+    | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static constexpr u32 INVALID_PASS = ~0u;
+
+static bool isDepthFormat(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static VkImageAspectFlags aspectOf(VkFormat format)
+{
+    return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+//----PASS BUILDER----
+
+RGPassBuilder& RGPassBuilder::read(RGResource resource, RGUsage usage)
+{
+    m_Graph.addAccess(m_Pass, resource, usage, false);
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::write(RGResource resource, RGUsage usage)
+{
+    m_Graph.addAccess(m_Pass, resource, usage, true);
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::color(RGResource resource, VkAttachmentLoadOp loadOp, VkClearColorValue clear)
+{
+    m_Graph.addAccess(m_Pass, resource, RGUsage::ColorAttachment, true);
+    VkClearValue value {};
+    value.color = clear;
+    m_Graph.m_Passes[m_Pass].colorAttachments.push_back({ resource, loadOp, value });
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::depth(RGResource resource, VkAttachmentLoadOp loadOp, f32 clearDepth)
+{
+    m_Graph.addAccess(m_Pass, resource, RGUsage::DepthAttachment, true);
+    VkClearValue value {};
+    value.depthStencil = { clearDepth, 0 };
+    m_Graph.m_Passes[m_Pass].depthAttachment = { resource, loadOp, value };
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::secondaryCommandBuffers()
+{
+    m_Graph.m_Passes[m_Pass].secondary = true;
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::sideEffects()
+{
+    m_Graph.m_Passes[m_Pass].sideEffects = true;
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::execute(RGExecuteFn fn)
+{
+    m_Graph.m_Passes[m_Pass].fn = std::move(fn);
+    return *this;
+}
+
+//----GRAPH----
+
+void RenderGraph::init(VkDevice device, DeviceAllocator& allocator, u32 framesInFlight)
+{
+    m_Device = device;
+    m_Allocator = &allocator;
+    m_Transients.resize(framesInFlight);
+}
+
+void RenderGraph::destroy()
+{
+    for (TransientSet& set : m_Transients) {
+        destroyTransients(set);
+    }
+    m_Transients.clear();
+    m_Resources.clear();
+    m_Passes.clear();
+    m_PassCount = 0;
+}
+
+void RenderGraph::reset(u32 frameSlot)
+{
+    m_FrameSlot = frameSlot;
+    m_Resources.clear();
+    m_PassCount = 0;
+    m_Compiled = false;
+    m_Stats = {};
+}
+
+RGResource RenderGraph::importImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc,
+    const RGImportState& initial, VkImageLayout finalLayout)
+{
+    Resource& resource = m_Resources.emplace_back();
+    resource.name = name;
+    resource.isImage = true;
+    resource.imported = true;
+    resource.exported = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.desc = desc;
+    resource.image = image;
+    resource.view = view;
+    resource.initial = initial;
+    resource.finalLayout = finalLayout;
+    return (RGResource)m_Resources.size() - 1;
+}
+
+RGResource RenderGraph::importBuffer(const char* name, VkBuffer buffer, bool exported)
+{
+    Resource& resource = m_Resources.emplace_back();
+    resource.name = name;
+    resource.imported = true;
+    resource.exported = exported;
+    resource.buffer = buffer;
+    return (RGResource)m_Resources.size() - 1;
+}
+
+RGResource RenderGraph::createImage(const char* name, const RGImageDesc& desc)
+{
+    Resource& resource = m_Resources.emplace_back();
+    resource.name = name;
+    resource.isImage = true;
+    resource.desc = desc;
+    return (RGResource)m_Resources.size() - 1;
+}
+
+RGPassBuilder RenderGraph::addPass(const char* name)
+{
+    VKP_ASSERT(!m_Compiled, "PASSES MUST BE ADDED BEFORE COMPILE");
+    // Pass objects are recycled across frames so their vectors keep their capacity
+    if (m_PassCount == m_Passes.size()) {
+        m_Passes.emplace_back();
+    }
+    Pass& pass = m_Passes[m_PassCount];
+    pass.name = name;
+    pass.accesses.clear();
+    pass.colorAttachments.clear();
+    pass.depthAttachment = { INVALID_PASS, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {} };
+    pass.secondary = false;
+    pass.sideEffects = false;
+    pass.culled = false;
+    pass.fn = nullptr;
+    return RGPassBuilder(*this, m_PassCount++);
+}
+
+RenderGraph::UsageInfo RenderGraph::describeUsage(RGUsage usage, bool write)
+{
+    UsageInfo info;
+    switch (usage) {
+    case RGUsage::ColorAttachment:
+        info = { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+        break;
+    case RGUsage::DepthAttachment:
+        info = { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true };
+        break;
+    case RGUsage::DepthRead:
+        info = { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            false };
+        break;
+    case RGUsage::SampledFragment:
+        info = { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        break;
+    case RGUsage::SampledCompute:
+        info = { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        break;
+    case RGUsage::StorageReadGraphics:
+        info = { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false };
+        break;
+    case RGUsage::StorageReadCompute:
+        info = { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT,
+            false };
+        break;
+    case RGUsage::StorageWriteCompute:
+        info = { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true };
+        break;
+    case RGUsage::IndirectRead:
+        info = { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false };
+        break;
+    case RGUsage::TransferSrc:
+        info = { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false };
+        break;
+    case RGUsage::TransferDst:
+        info = { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT, true };
+        break;
+    }
+    VKP_ASSERT(info.write == write, "RENDER GRAPH USAGE DECLARED AS THE WRONG ACCESS TYPE");
+    return info;
+}
+
+void RenderGraph::addAccess(u32 passIndex, RGResource resource, RGUsage usage, bool write)
+{
+    VKP_ASSERT(resource < m_Resources.size(), "INVALID RENDER GRAPH RESOURCE");
+    UsageInfo info = describeUsage(usage, write);
+    VKP_ASSERT(m_Resources[resource].isImage || usage != RGUsage::ColorAttachment, "COLOR ATTACHMENT MUST BE AN IMAGE");
+
+    // Several usages of one resource in a pass merge into a single access
+    Pass& pass = m_Passes[passIndex];
+    for (Access& access : pass.accesses) {
+        if (access.resource == resource) {
+            VKP_ASSERT(!m_Resources[resource].isImage || access.usage.layout == info.layout, "CONFLICTING IMAGE LAYOUTS IN ONE PASS");
+            access.usage.stages |= info.stages;
+            access.usage.access |= info.access;
+            access.usage.imageUsage |= info.imageUsage;
+            access.usage.write |= info.write;
+            return;
+        }
+    }
+    pass.accesses.push_back({ resource, info });
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walk backwards from the outputs: a pass survives if it has side effects or writes something
+    // that is exported or used by a surviving later pass
+    std::vector<bool> needed(m_Resources.size(), false);
+    for (u32 i = 0; i < m_Resources.size(); i++) {
+        needed[i] = m_Resources[i].exported;
+    }
+
+    for (u32 p = m_PassCount; p-- > 0;) {
+        Pass& pass = m_Passes[p];
+        bool keep = pass.sideEffects;
+        for (const Access& access : pass.accesses) {
+            keep |= access.usage.write && needed[access.resource];
+        }
+        pass.culled = !keep;
+        if (pass.culled) {
+            m_Stats.culledPasses++;
+            continue;
+        }
+        for (const Access& access : pass.accesses) {
+            needed[access.resource] = true;
+        }
+    }
+    m_Stats.passes = m_PassCount - m_Stats.culledPasses;
+}
+
+void RenderGraph::computeLifetimes()
+{
+    u32 order = 0;
+    for (u32 p = 0; p < m_PassCount; p++) {
+        if (m_Passes[p].culled) {
+            continue;
+        }
+        for (const Access& access : m_Passes[p].accesses) {
+            Resource& resource = m_Resources[access.resource];
+            resource.firstPass = std::min(resource.firstPass, order);
+            resource.lastPass = std::max(resource.lastPass, order);
+            resource.imageUsage |= access.usage.imageUsage;
+        }
+        order++;
+    }
+}
+
+void RenderGraph::destroyTransients(TransientSet& set)
+{
+    for (VkImageView view : set.views) {
+        VKP_UNTRACK(view);
+        vkDestroyImageView(m_Device, view, VKP_ALLOCATION_CALLBACKS);
+    }
+    for (VkImage image : set.images) {
+        VKP_UNTRACK(image);
+        vkDestroyImage(m_Device, image, VKP_ALLOCATION_CALLBACKS);
+    }
+    for (Allocation* block : set.blocks) {
+        m_Allocator->free(block);
+    }
+    set = {};
+}
+
+void RenderGraph::buildTransients()
+{
+    std::vector<u32> transients;
+    Hash key = hashBytes(&m_PassCount, sizeof(m_PassCount));
+    for (u32 i = 0; i < m_Resources.size(); i++) {
+        const Resource& resource = m_Resources[i];
+        if (resource.imported || resource.firstPass == INVALID_PASS) {
+            continue;
+        }
+        transients.push_back(i);
+        key = hashBytes(&resource.desc, sizeof(RGImageDesc), key);
+        key = hashBytes(&resource.imageUsage, sizeof(VkImageUsageFlags), key);
+        key = hashBytes(&resource.firstPass, sizeof(u32), key);
+        key = hashBytes(&resource.lastPass, sizeof(u32), key);
+    }
+
+    TransientSet& set = m_Transients[m_FrameSlot];
+    m_Stats.transientImages = (u32)transients.size();
+    if (set.key != key || set.images.size() != transients.size()) {
+        // Frame shape changed. The slot's previous frame has completed, its images are free to go
+        destroyTransients(set);
+        set.key = key;
+
+        struct Block {
+            VkMemoryRequirements requirements;
+            std::vector<u32> members; // indices into `transients`
+        };
+        std::vector<Block> blocks;
+        std::vector<VkMemoryRequirements> requirements(transients.size());
+        std::vector<u32> placement(transients.size());
+
+        set.images.resize(transients.size());
+        for (u32 t = 0; t < transients.size(); t++) {
+            const Resource& resource = m_Resources[transients[t]];
+            VkImageCreateInfo imageInfo {};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = resource.desc.format;
+            imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = resource.imageUsage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkResult res = vkCreateImage(m_Device, &imageInfo, VKP_ALLOCATION_CALLBACKS, &set.images[t]);
+            VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE TRANSIENT IMAGE");
+            VKP_TRACK_OBJECT(VK_OBJECT_TYPE_IMAGE, set.images[t], resource.name);
+            vkGetImageMemoryRequirements(m_Device, set.images[t], &requirements[t]);
+            m_Stats.unaliasedBytes += requirements[t].size;
+        }
+
+        // Largest first, each image goes into the first block whose members are all dead before
+        // it starts or born after it ends
+        std::vector<u32> bySize(transients.size());
+        for (u32 t = 0; t < bySize.size(); t++) {
+            bySize[t] = t;
+        }
+        std::sort(bySize.begin(), bySize.end(), [&](u32 a, u32 b) { return requirements[a].size > requirements[b].size; });
+
+        for (u32 t : bySize) {
+            const Resource& resource = m_Resources[transients[t]];
+            bool placed = false;
+            for (u32 b = 0; b < blocks.size() && !placed; b++) {
+                Block& block = blocks[b];
+                if (!(block.requirements.memoryTypeBits & requirements[t].memoryTypeBits) || requirements[t].size > block.requirements.size) {
+                    continue;
+                }
+                bool overlaps = false;
+                for (u32 member : block.members) {
+                    const Resource& other = m_Resources[transients[member]];
+                    overlaps |= resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass;
+                }
+                if (!overlaps) {
+                    block.requirements.memoryTypeBits &= requirements[t].memoryTypeBits;
+                    block.requirements.alignment = std::max(block.requirements.alignment, requirements[t].alignment);
+                    block.members.push_back(t);
+                    placement[t] = b;
+                    placed = true;
+                }
+            }
+            if (!placed) {
+                placement[t] = (u32)blocks.size();
+                blocks.push_back({ requirements[t], { t } });
+            }
+        }
+
+        for (Block& block : blocks) {
+            Allocation* allocation = m_Allocator->allocate(block.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal);
+            VKP_ASSERT(allocation != nullptr, "FAILED TO ALLOCATE TRANSIENT MEMORY");
+            for (u32 t : block.members) {
+                vkBindImageMemory(m_Device, set.images[t], allocation->memory, allocation->offset);
+            }
+            set.blocks.push_back(allocation);
+            m_Stats.transientBytes += block.requirements.size;
+        }
+
+        set.views.resize(transients.size());
+        for (u32 t = 0; t < transients.size(); t++) {
+            const Resource& resource = m_Resources[transients[t]];
+            VkImageViewCreateInfo viewInfo {};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = set.images[t];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange = { aspectOf(resource.desc.format), 0, 1, 0, 1 };
+            VkResult res = vkCreateImageView(m_Device, &viewInfo, VKP_ALLOCATION_CALLBACKS, &set.views[t]);
+            VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE TRANSIENT IMAGE VIEW");
+            VKP_TRACK_OBJECT(VK_OBJECT_TYPE_IMAGE_VIEW, set.views[t], resource.name);
+        }
+
+        // The image that used the memory last before this one, its accesses have to finish first
+        set.predecessors.assign(transients.size(), INVALID_PASS);
+        for (const Block& block : blocks) {
+            for (u32 t : block.members) {
+                u32 bestLast = 0;
+                for (u32 other : block.members) {
+                    u32 otherLast = m_Resources[transients[other]].lastPass;
+                    if (otherLast < m_Resources[transients[t]].firstPass && (set.predecessors[t] == INVALID_PASS || otherLast >= bestLast)) {
+                        set.predecessors[t] = other;
+                        bestLast = otherLast;
+                    }
+                }
+            }
+        }
+        set.transientBytes = m_Stats.transientBytes;
+        set.unaliasedBytes = m_Stats.unaliasedBytes;
+    } else {
+        m_Stats.transientBytes = set.transientBytes;
+        m_Stats.unaliasedBytes = set.unaliasedBytes;
+    }
+
+    for (u32 t = 0; t < transients.size(); t++) {
+        Resource& resource = m_Resources[transients[t]];
+        resource.image = set.images[t];
+        resource.view = set.views[t];
+        resource.aliasPredecessor = set.predecessors[t] == INVALID_PASS ? INVALID_PASS : transients[set.predecessors[t]];
+    }
+}
+
+void RenderGraph::synchronize(Pass& pass, Resource& resource, const UsageInfo& usage)
+{
+    ResourceState& state = resource.state;
+    const bool layoutChange = resource.isImage && usage.layout != state.layout;
+
+    VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    bool needed = false;
+
+    if (usage.write || layoutChange) {
+        if (state.readStages != VK_PIPELINE_STAGE_2_NONE && !layoutChange) {
+            // Write after read: the reads already waited for the previous write, so an
+            // execution dependency on them is enough
+            srcStages = state.readStages;
+        } else {
+            srcStages = state.writeStages | state.readStages;
+            srcAccess = state.writeAccess;
+        }
+        needed = srcStages != VK_PIPELINE_STAGE_2_NONE || layoutChange;
+
+        if (usage.write) {
+            state.writeStages = usage.stages;
+            state.writeAccess = usage.access & WRITE_ACCESS;
+            state.readStages = VK_PIPELINE_STAGE_2_NONE;
+            state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+            state.visibleAccess = VK_ACCESS_2_NONE;
+        } else {
+            // A transition for a read: later readers chain onto the stages that waited for it
+            state.writeStages = usage.stages;
+            state.writeAccess = VK_ACCESS_2_NONE;
+            state.readStages = usage.stages;
+            state.visibleStages = usage.stages;
+            state.visibleAccess = usage.access;
+        }
+    } else {
+        // Read after read needs nothing. Read after write only if the write has not been made
+        // visible to this stage and access yet
+        bool covered = (usage.stages & ~state.visibleStages) == 0 && (usage.access & ~state.visibleAccess) == 0;
+        if (!covered && state.writeStages != VK_PIPELINE_STAGE_2_NONE) {
+            srcStages = state.writeStages;
+            srcAccess = state.writeAccess;
+            needed = true;
+        }
+        state.readStages |= usage.stages;
+        state.visibleStages |= usage.stages;
+        state.visibleAccess |= usage.access;
+    }
+
+    if (!needed) {
+        return;
+    }
+
+    if (resource.isImage) {
+        VkImageMemoryBarrier2 barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = srcStages;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = usage.stages;
+        barrier.dstAccessMask = usage.access;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = usage.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resource.image;
+        barrier.subresourceRange = { aspectOf(resource.desc.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        pass.imageBarriers.push_back(barrier);
+        state.layout = usage.layout;
+        m_Stats.imageBarriers++;
+    } else {
+        // Buffer hazards of a pass collapse into one global barrier
+        pass.memoryBarrier.srcStageMask |= srcStages;
+        pass.memoryBarrier.srcAccessMask |= srcAccess;
+        pass.memoryBarrier.dstStageMask |= usage.stages;
+        pass.memoryBarrier.dstAccessMask |= usage.access;
+    }
+}
+
+void RenderGraph::compile()
+{
+    VKP_PROFILE_FUNCTION();
+    VKP_ASSERT(!m_Compiled, "RENDER GRAPH COMPILED TWICE");
+
+    cullPasses();
+    computeLifetimes();
+    buildTransients();
+
+    for (Resource& resource : m_Resources) {
+        resource.state = {};
+        if (resource.imported) {
+            resource.state.writeStages = resource.initial.stages;
+            resource.state.writeAccess = resource.initial.access;
+            resource.state.layout = resource.initial.layout;
+        }
+    }
+
+    u32 order = 0;
+    for (u32 p = 0; p < m_PassCount; p++) {
+        Pass& pass = m_Passes[p];
+        pass.imageBarriers.clear();
+        pass.memoryBarrier = {};
+        pass.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        if (pass.culled) {
+            continue;
+        }
+
+        for (const Access& access : pass.accesses) {
+            Resource& resource = m_Resources[access.resource];
+            // First use of memory another transient had earlier in the frame
+            if (resource.firstPass == order && resource.aliasPredecessor != INVALID_PASS) {
+                const ResourceState& previous = m_Resources[resource.aliasPredecessor].state;
+                resource.state.writeStages = previous.writeStages | previous.readStages;
+                resource.state.writeAccess = previous.writeAccess;
+            }
+            synchronize(pass, resource, access.usage);
+        }
+        if (pass.memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE) {
+            m_Stats.memoryBarriers++;
+        }
+        order++;
+    }
+
+    // Hand exported images over in the layout their consumer expects (present, readback)
+    m_FinalBarriers.clear();
+    for (Resource& resource : m_Resources) {
+        if (!resource.isImage || !resource.exported || resource.state.layout == resource.finalLayout) {
+            continue;
+        }
+        VkImageMemoryBarrier2 barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = resource.state.writeStages | resource.state.readStages;
+        barrier.srcAccessMask = resource.state.writeAccess;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstAccessMask = VK_ACCESS_2_NONE;
+        barrier.oldLayout = resource.state.layout;
+        barrier.newLayout = resource.finalLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resource.image;
+        barrier.subresourceRange = { aspectOf(resource.desc.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        m_FinalBarriers.push_back(barrier);
+        m_Stats.imageBarriers++;
+    }
+    m_Compiled = true;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    VKP_ASSERT(m_Compiled, "RENDER GRAPH EXECUTED WITHOUT COMPILE");
+
+    u32 order = 0;
+    for (u32 p = 0; p < m_PassCount; p++) {
+        Pass& pass = m_Passes[p];
+        if (pass.culled) {
+            continue;
+        }
+        VKP_PROFILE_GPU_SCOPE(commandBuffer, pass.name);
+
+        bool hasMemoryBarrier = pass.memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+        if (hasMemoryBarrier || !pass.imageBarriers.empty()) {
+            VkDependencyInfo dependency {};
+            dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency.memoryBarrierCount = hasMemoryBarrier ? 1 : 0;
+            dependency.pMemoryBarriers = &pass.memoryBarrier;
+            dependency.imageMemoryBarrierCount = (u32)pass.imageBarriers.size();
+            dependency.pImageMemoryBarriers = pass.imageBarriers.data();
+            vkCmdPipelineBarrier2(commandBuffer, &dependency);
+        }
+
+        RGPassContext context;
+        context.commandBuffer = commandBuffer;
+        context.graph = this;
+
+        const bool hasDepth = pass.depthAttachment.resource != INVALID_PASS;
+        if (pass.colorAttachments.empty() && !hasDepth) {
+            if (pass.fn) {
+                pass.fn(context);
+            }
+            order++;
+            continue;
+        }
+
+        // Attachments nothing reads later are not written back to memory
+        auto storeOp = [&](RGResource handle) {
+            const Resource& resource = m_Resources[handle];
+            return resource.exported || resource.lastPass > order ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        };
+
+        m_ColorInfos.clear();
+        m_InheritedColorFormats.clear();
+        for (const Attachment& attachment : pass.colorAttachments) {
+            VkRenderingAttachmentInfo info {};
+            info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+            info.imageView = m_Resources[attachment.resource].view;
+            info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            info.loadOp = attachment.loadOp;
+            info.storeOp = storeOp(attachment.resource);
+            info.clearValue = attachment.clear;
+            m_ColorInfos.push_back(info);
+            m_InheritedColorFormats.push_back(m_Resources[attachment.resource].desc.format);
+        }
+
+        VkRenderingAttachmentInfo depthInfo {};
+        depthInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        if (hasDepth) {
+            depthInfo.imageView = m_Resources[pass.depthAttachment.resource].view;
+            depthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+            depthInfo.loadOp = pass.depthAttachment.loadOp;
+            depthInfo.storeOp = storeOp(pass.depthAttachment.resource);
+            depthInfo.clearValue = pass.depthAttachment.clear;
+        }
+
+        const RGResource first = pass.colorAttachments.empty() ? pass.depthAttachment.resource : pass.colorAttachments[0].resource;
+        context.renderArea = m_Resources[first].desc.extent;
+
+        VkRenderingInfo renderingInfo {};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.flags = pass.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+        renderingInfo.renderArea = { { 0, 0 }, context.renderArea };
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = (u32)m_ColorInfos.size();
+        renderingInfo.pColorAttachments = m_ColorInfos.data();
+        renderingInfo.pDepthAttachment = hasDepth ? &depthInfo : nullptr;
+
+        if (pass.secondary) {
+            m_InheritanceRendering = {};
+            m_InheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+            m_InheritanceRendering.colorAttachmentCount = (u32)m_InheritedColorFormats.size();
+            m_InheritanceRendering.pColorAttachmentFormats = m_InheritedColorFormats.data();
+            m_InheritanceRendering.depthAttachmentFormat = hasDepth ? m_Resources[pass.depthAttachment.resource].desc.format : VK_FORMAT_UNDEFINED;
+            m_InheritanceRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+            m_Inheritance = {};
+            m_Inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            m_Inheritance.pNext = &m_InheritanceRendering;
+            m_Inheritance.pipelineStatistics = VKP_PROFILE_INHERITED_STATISTICS();
+            context.inheritance = &m_Inheritance;
+        }
+
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+        if (pass.fn) {
+            pass.fn(context);
+        }
+        vkCmdEndRendering(commandBuffer);
+        order++;
+    }
+
+    if (!m_FinalBarriers.empty()) {
+        VkDependencyInfo dependency {};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.imageMemoryBarrierCount = (u32)m_FinalBarriers.size();
+        dependency.pImageMemoryBarriers = m_FinalBarriers.data();
+        vkCmdPipelineBarrier2(commandBuffer, &dependency);
+    }
+}
+
+}
@@ -0,0 +1,239 @@
+#ifndef VKP_RENDERGRAPH
+#define VKP_RENDERGRAPH
+
+#include "Renderer/DeviceAllocator.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Handle to a graph resource, valid until the next reset()
+using RGResource = u32;
+
+// How a pass touches a resource. Determines the pipeline stages, access mask and image layout
+// the graph synchronizes against
+enum class RGUsage : u8 {
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,
+    SampledFragment,
+    SampledCompute,
+    StorageReadGraphics,
+    StorageReadCompute,
+    StorageWriteCompute,
+    IndirectRead,
+    TransferSrc,
+    TransferDst,
+};
+
+struct RGImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent {};
+};
+
+// Where an imported resource is when the frame starts, e.g. a swapchain image whose acquire
+// semaphore is waited at the color attachment stage
+struct RGImportState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+};
+
+class RenderGraph;
+
+// Handed to a pass's execute callback
+struct RGPassContext {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    // Graphics passes using secondary command buffers: inheritance for ParallelRecorder::record
+    const VkCommandBufferInheritanceInfo* inheritance = nullptr;
+    VkExtent2D renderArea {};
+    const RenderGraph* graph = nullptr;
+};
+
+using RGExecuteFn = std::function<void(const RGPassContext& context)>;
+
+// Declares what a pass reads and writes. Returned by RenderGraph::addPass
+class RGPassBuilder {
+public:
+    RGPassBuilder& read(RGResource resource, RGUsage usage);
+    RGPassBuilder& write(RGResource resource, RGUsage usage);
+    // Rendered with dynamic rendering, the attachment order is the shader output order
+    RGPassBuilder& color(RGResource resource, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue clear = {});
+    RGPassBuilder& depth(RGResource resource, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, f32 clearDepth = 1.0f);
+    // Draws are recorded into secondary command buffers, see RGPassContext::inheritance
+    RGPassBuilder& secondaryCommandBuffers();
+    // Never culled, for passes whose results leave the graph in ways it cannot see
+    RGPassBuilder& sideEffects();
+    RGPassBuilder& execute(RGExecuteFn fn);
+
+private:
+    friend class RenderGraph;
+    RGPassBuilder(RenderGraph& graph, u32 pass)
+        : m_Graph(graph)
+        , m_Pass(pass)
+    {
+    }
+
+    RenderGraph& m_Graph;
+    u32 m_Pass;
+};
+
+// Per-frame render graph. Every frame the renderer declares its passes and the resources they use,
+// then compile():
+//  - culls passes whose outputs nothing consumes (exported resources and side effects are roots),
+//  - derives the synchronization2 barriers and layout transitions between the surviving passes,
+//    merging buffer hazards of a pass into one global memory barrier,
+//  - places transient images into shared memory blocks when their lifetimes do not overlap.
+// execute() records everything, graphics passes through vkCmdBeginRendering.
+// Transient images live per frame slot and are only rebuilt when the frame's shape changes
+class RenderGraph {
+public:
+    void init(VkDevice device, DeviceAllocator& allocator, u32 framesInFlight);
+    void destroy();
+
+    // Starts declaring a new frame for `frameSlot`. The slot's previous submission must have completed
+    void reset(u32 frameSlot);
+
+    // `finalLayout` is what the image is transitioned to after its last use, UNDEFINED leaves it.
+    // Images with a final layout count as graph outputs
+    RGResource importImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc, const RGImportState& initial,
+        VkImageLayout finalLayout);
+    // `exported` buffers are read after the frame (by the host or a later submission) and count as outputs
+    RGResource importBuffer(const char* name, VkBuffer buffer, bool exported);
+    // Memory is owned by the graph and may be shared with other transients, contents do not survive the frame
+    RGResource createImage(const char* name, const RGImageDesc& desc);
+
+    RGPassBuilder addPass(const char* name);
+
+    void compile();
+    void execute(VkCommandBuffer commandBuffer);
+
+    VkImage getImage(RGResource resource) const { return m_Resources[resource].image; }
+    VkImageView getImageView(RGResource resource) const { return m_Resources[resource].view; }
+    VkBuffer getBuffer(RGResource resource) const { return m_Resources[resource].buffer; }
+
+    struct Stats {
+        u32 passes = 0;
+        u32 culledPasses = 0;
+        u32 imageBarriers = 0;
+        u32 memoryBarriers = 0;
+        u32 transientImages = 0;
+        // Memory actually allocated for transients, and what they would take without aliasing
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize unaliasedBytes = 0;
+    };
+    const Stats& getStats() const { return m_Stats; }
+
+private:
+    friend class RGPassBuilder;
+
+    struct UsageInfo {
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageUsageFlags imageUsage = 0;
+        bool write = false;
+    };
+
+    struct ResourceState {
+        // Last write, or layout transition, later accesses have to wait for
+        VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        // Reads since then, a following write has to wait for them
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+        // Reader stages/accesses the last write has already been made visible to
+        VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    struct Resource {
+        const char* name = nullptr;
+        bool isImage = false;
+        bool imported = false;
+        bool exported = false;
+        RGImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        RGImportState initial;
+
+        // Filled by compile()
+        VkImageUsageFlags imageUsage = 0;
+        u32 firstPass = ~0u;
+        u32 lastPass = 0;
+        // Transient placed in the same memory right before this one, if any
+        u32 aliasPredecessor = ~0u;
+        ResourceState state;
+    };
+
+    struct Access {
+        RGResource resource;
+        UsageInfo usage;
+    };
+
+    struct Attachment {
+        RGResource resource;
+        VkAttachmentLoadOp loadOp;
+        VkClearValue clear;
+    };
+
+    struct Pass {
+        const char* name = nullptr;
+        std::vector<Access> accesses;
+        std::vector<Attachment> colorAttachments;
+        Attachment depthAttachment { ~0u, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {} };
+        bool secondary = false;
+        bool sideEffects = false;
+        bool culled = false;
+        RGExecuteFn fn;
+
+        // Filled by compile()
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        VkMemoryBarrier2 memoryBarrier {};
+    };
+
+    // Transient images and their memory for one frame slot
+    struct TransientSet {
+        Hash key = 0;
+        std::vector<VkImage> images;
+        std::vector<VkImageView> views;
+        std::vector<Allocation*> blocks;
+        // Per image, the image that used its memory before it within the frame
+        std::vector<u32> predecessors;
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize unaliasedBytes = 0;
+    };
+
+    static UsageInfo describeUsage(RGUsage usage, bool write);
+
+    void addAccess(u32 pass, RGResource resource, RGUsage usage, bool write);
+    void cullPasses();
+    void computeLifetimes();
+    void buildTransients();
+    void destroyTransients(TransientSet& set);
+    void synchronize(Pass& pass, Resource& resource, const UsageInfo& usage);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+    u32 m_FrameSlot = 0;
+
+    std::vector<Resource> m_Resources;
+    std::vector<Pass> m_Passes;
+    u32 m_PassCount = 0;
+    std::vector<TransientSet> m_Transients;
+    std::vector<VkImageMemoryBarrier2> m_FinalBarriers;
+    bool m_Compiled = false;
+    Stats m_Stats;
+
+    // Storage for the pass being executed, referenced by RGPassContext
+    std::vector<VkFormat> m_InheritedColorFormats;
+    VkCommandBufferInheritanceRenderingInfo m_InheritanceRendering {};
+    VkCommandBufferInheritanceInfo m_Inheritance {};
+    std::vector<VkRenderingAttachmentInfo> m_ColorInfos;
+};
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "Renderer/ShaderCompiler.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#if defined(VKP_SHADERC)
+#include <shaderc/shaderc.h>
+#endif
+
+namespace VulkanProj {
+
+#if defined(VKP_SHADERC)
+
+static shaderc_shader_kind toShaderKind(VkShaderStageFlagBits stage)
+{
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+        return shaderc_vertex_shader;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+        return shaderc_fragment_shader;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+        return shaderc_compute_shader;
+    default:
+        return shaderc_glsl_infer_from_source;
+    }
+}
+
+bool compileGlsl(const std::string& path, VkShaderStageFlagBits stage, std::vector<u32>& spirv)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        VKP_ERROR("Failed to open shader {}", path);
+        return false;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    const std::string text = source.str();
+
+    // Compilers are cheap next to a compile and are not safe to share between threads
+    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+    shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(compiler, text.data(), text.size(), toShaderKind(stage), path.c_str(),
+        "main", options);
+    const bool ok = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+    if (ok) {
+        const size_t size = shaderc_result_get_length(result);
+        spirv.resize(size / sizeof(u32));
+        memcpy(spirv.data(), shaderc_result_get_bytes(result), size);
+    } else {
+        VKP_ERROR("Failed to compile {}:\n{}", path, shaderc_result_get_error_message(result));
+    }
+
+    shaderc_result_release(result);
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+    return ok;
+}
+
+const char* getShaderCompilerName()
+{
+    return "shaderc";
+}
+
+#else
+
+#if defined(VKP_WINDOWS)
+#define popen _popen
+#define pclose _pclose
+#endif
+
+static const char* toGlslcStage(VkShaderStageFlagBits stage)
+{
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+        return "vert";
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+        return "frag";
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+        return "comp";
+    default:
+        return nullptr;
+    }
+}
+
+static std::string findGlslc()
+{
+    if (const char* sdk = std::getenv("VULKAN_SDK")) {
+        std::filesystem::path candidate = std::filesystem::path(sdk) / "bin" / "glslc";
+        if (std::filesystem::exists(candidate)) {
+            return candidate.string();
+        }
+    }
+    return "glslc";
+}
+
+bool compileGlsl(const std::string& path, VkShaderStageFlagBits stage, std::vector<u32>& spirv)
+{
+    static std::atomic<u32> s_Counter { 0 };
+    const char* stageName = toGlslcStage(stage);
+    if (stageName == nullptr) {
+        VKP_ERROR("No glslc stage for shader {}", path);
+        return false;
+    }
+
+    const std::filesystem::path output = std::filesystem::temp_directory_path()
+        / fmt::format("vkp_shader_{}_{}.spv", hashBytes(path.data(), path.size()), s_Counter.fetch_add(1));
+    const std::string command = fmt::format("\"{}\" --target-env=vulkan1.3 -O -fshader-stage={} \"{}\" -o \"{}\" 2>&1", findGlslc(), stageName,
+        path, output.string());
+
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        VKP_ERROR("Failed to run glslc for {}", path);
+        return false;
+    }
+    std::string messages;
+    std::array<char, 512> buffer;
+    while (fgets(buffer.data(), (int)buffer.size(), pipe) != nullptr) {
+        messages += buffer.data();
+    }
+    const int status = pclose(pipe);
+
+    bool ok = status == 0;
+    if (ok) {
+        std::ifstream file(output, std::ios::binary | std::ios::ate);
+        const size_t size = file ? (size_t)file.tellg() : 0;
+        ok = size > 0 && size % sizeof(u32) == 0;
+        if (ok) {
+            spirv.resize(size / sizeof(u32));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(spirv.data()), (std::streamsize)size);
+        }
+    }
+    if (!ok) {
+        VKP_ERROR("Failed to compile {}:\n{}", path, messages);
+    }
+
+    std::error_code error;
+    std::filesystem::remove(output, error);
+    return ok;
+}
+
+const char* getShaderCompilerName()
+{
+    return "glslc";
+}
+
+#endif
+
+}
@@ -0,0 +1,19 @@
+#ifndef VKP_SHADERCOMPILER
+#define VKP_SHADERCOMPILER
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// GLSL to SPIR-V for Vulkan 1.3. In-process through shaderc when the build found it
+// (VKP_SHADERC), otherwise by running glslc from the Vulkan SDK like glsl_complile.sh does.
+// Blocks for the whole compile, keep it off the render thread. Thread safe
+bool compileGlsl(const std::string& path, VkShaderStageFlagBits stage, std::vector<u32>& spirv);
+
+// "shaderc" or "glslc"
+const char* getShaderCompilerName();
+
+}
+
+#endif
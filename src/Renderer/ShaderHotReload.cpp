@@ -0,0 +1,231 @@
+#include "Renderer/ShaderHotReload.hpp"
+#include "Bench/Bench.hpp"
+#include "Profiler/ResourceTracker.hpp"
+#include "Renderer/ShaderCompiler.hpp"
+
+#include <cstring>
+
+#if defined(VKP_LINUX)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanProj {
+
+// How often the watcher checks for changes and for shutdown
+static constexpr i32 WATCH_INTERVAL_MS = 100;
+// Editors often save in several writes (or write, then rename), so a change only counts once
+// the directory has been quiet for this long
+static constexpr std::chrono::milliseconds CHANGE_SETTLE_TIME(50);
+
+void ShaderHotReload::init(VkDevice device, const std::string& directory)
+{
+    m_Device = device;
+    m_Directory = directory;
+    m_Quit = false;
+
+#if defined(VKP_LINUX)
+    m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Saves land as a finished write or as a rename over the old file
+    if (m_Inotify < 0 || inotify_add_watch(m_Inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        VKP_WARN("Shader hot reload disabled: cannot watch {} ({})", directory, strerror(errno));
+        if (m_Inotify >= 0) {
+            close(m_Inotify);
+            m_Inotify = -1;
+        }
+        return;
+    }
+#endif
+
+    m_Thread = std::thread([this]() { watchLoop(); });
+    VKP_INFO("Shader hot reload watching {} (compiling with {})", directory, getShaderCompilerName());
+}
+
+void ShaderHotReload::destroy()
+{
+    m_Quit = true;
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+#if defined(VKP_LINUX)
+    if (m_Inotify >= 0) {
+        close(m_Inotify);
+        m_Inotify = -1;
+    }
+#endif
+
+    for (const ReadyPipeline& ready : m_Ready) {
+        VKP_UNTRACK(ready.pipeline);
+        vkDestroyPipeline(m_Device, ready.pipeline, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_Ready.clear();
+    m_Targets.clear();
+}
+
+void ShaderHotReload::watchPipeline(const std::string& name, std::vector<Stage> stages, BuildFn build, ApplyFn apply)
+{
+    Scope<Target> target = CreateScope<Target>();
+    target->name = name;
+    target->stages = std::move(stages);
+    target->build = std::move(build);
+    target->apply = std::move(apply);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Targets.push_back(std::move(target));
+}
+
+u32 ShaderHotReload::poll()
+{
+    std::vector<ReadyPipeline> ready;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex, std::try_to_lock);
+        if (!lock.owns_lock() || m_Ready.empty()) {
+            return 0;
+        }
+        ready.swap(m_Ready);
+    }
+    // Targets are never removed, the index stays valid without the lock
+    for (const ReadyPipeline& pipeline : ready) {
+        m_Targets[pipeline.target]->apply(pipeline.pipeline);
+    }
+    return (u32)ready.size();
+}
+
+std::vector<std::string> ShaderHotReload::waitForChanges()
+{
+    std::vector<std::string> changed;
+#if defined(VKP_LINUX)
+    pollfd descriptor { m_Inotify, POLLIN, 0 };
+    if (::poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) {
+        return changed;
+    }
+    alignas(inotify_event) std::array<char, 4096> buffer;
+    while (true) {
+        ssize_t length = read(m_Inotify, buffer.data(), buffer.size());
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            if (event->len > 0) {
+                changed.emplace_back(event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(m_Directory, error)) {
+        const std::string name = entry.path().filename().string();
+        const std::filesystem::file_time_type time = entry.last_write_time(error);
+        auto [it, inserted] = m_WriteTimes.try_emplace(name, time);
+        if (!inserted && it->second != time) {
+            it->second = time;
+            changed.push_back(name);
+        }
+    }
+#endif
+    return changed;
+}
+
+void ShaderHotReload::watchLoop()
+{
+    using Clock = std::chrono::steady_clock;
+    std::set<std::string> pending;
+    Clock::time_point lastChange;
+
+    while (!m_Quit) {
+        std::vector<std::string> changed = waitForChanges();
+        if (!changed.empty()) {
+            pending.insert(changed.begin(), changed.end());
+            lastChange = Clock::now();
+        }
+        if (pending.empty() || Clock::now() - lastChange < CHANGE_SETTLE_TIME) {
+            continue;
+        }
+
+        std::vector<u32> affected;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (u32 i = 0; i < m_Targets.size(); i++) {
+                for (const Stage& stage : m_Targets[i]->stages) {
+                    if (pending.count(std::filesystem::path(stage.sourcePath).filename().string()) > 0) {
+                        affected.push_back(i);
+                        break;
+                    }
+                }
+            }
+        }
+        pending.clear();
+        for (u32 target : affected) {
+            if (m_Quit) {
+                break;
+            }
+            rebuild(target);
+        }
+    }
+}
+
+void ShaderHotReload::rebuild(u32 targetIndex)
+{
+    // Registered targets never change, only the vector holding them may grow
+    Target* target;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        target = m_Targets[targetIndex].get();
+    }
+
+    BenchTimer timer;
+    std::vector<std::vector<u32>> spirv(target->stages.size());
+    std::vector<VkShaderModule> modules;
+    bool ok = true;
+    for (size_t i = 0; i < target->stages.size(); i++) {
+        const Stage& stage = target->stages[i];
+        if (!compileGlsl(stage.sourcePath, stage.stage, spirv[i])) {
+            ok = false;
+            break;
+        }
+        VkShaderModuleCreateInfo moduleInfo {};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = spirv[i].size() * sizeof(u32);
+        moduleInfo.pCode = spirv[i].data();
+        VkShaderModule module;
+        if (vkCreateShaderModule(m_Device, &moduleInfo, VKP_ALLOCATION_CALLBACKS, &module) != VK_SUCCESS) {
+            VKP_ERROR("Failed to create a shader module for {}", stage.sourcePath);
+            ok = false;
+            break;
+        }
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SHADER_MODULE, module, stage.sourcePath.c_str());
+        modules.push_back(module);
+    }
+
+    // Pipelines keep what they need from their modules, these are not kept around
+    VkPipeline pipeline = ok ? target->build(modules) : VK_NULL_HANDLE;
+    for (VkShaderModule module : modules) {
+        VKP_UNTRACK(module);
+        vkDestroyShaderModule(m_Device, module, VKP_ALLOCATION_CALLBACKS);
+    }
+    if (pipeline == VK_NULL_HANDLE) {
+        VKP_WARN("Hot reload of pipeline '{}' failed, keeping the current one", target->name);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (ReadyPipeline& ready : m_Ready) {
+        if (ready.target == targetIndex) {
+            // Superseded before the render thread picked it up, it was never bound
+            VKP_UNTRACK(ready.pipeline);
+            vkDestroyPipeline(m_Device, ready.pipeline, VKP_ALLOCATION_CALLBACKS);
+            ready.pipeline = pipeline;
+            pipeline = VK_NULL_HANDLE;
+        }
+    }
+    if (pipeline != VK_NULL_HANDLE) {
+        m_Ready.push_back({ targetIndex, pipeline });
+    }
+    VKP_INFO("Hot reloaded pipeline '{}' in {:.1f}ms", target->name, timer.elapsedMs());
+}
+
+}
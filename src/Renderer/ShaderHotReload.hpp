@@ -0,0 +1,80 @@
+#ifndef VKP_SHADERHOTRELOAD
+#define VKP_SHADERHOTRELOAD
+
+#include "core.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Rebuilds pipelines while the app runs when their GLSL sources change. A watcher thread
+// (inotify on Linux, modification times elsewhere) notices saves, recompiles the affected
+// sources and builds the new pipeline itself; the render thread only picks finished pipelines
+// up in poll(), so a slow or broken compile never stalls a frame. A failed compile logs the
+// errors and keeps the pipeline that is in use
+class ShaderHotReload {
+public:
+    struct Stage {
+        std::string sourcePath;
+        VkShaderStageFlagBits stage;
+    };
+    // Builds a pipeline from one module per Stage, in registration order. Runs on the watcher
+    // thread, so it may only touch state the render thread leaves alone. VK_NULL_HANDLE on failure
+    using BuildFn = std::function<VkPipeline(const std::vector<VkShaderModule>& modules)>;
+    // Takes ownership of a new pipeline. Runs on the render thread inside poll()
+    using ApplyFn = std::function<void(VkPipeline pipeline)>;
+
+    // Watches `directory`, where every registered source must live
+    void init(VkDevice device, const std::string& directory);
+    // Stops the watcher. Pipelines that were built but never applied are destroyed
+    void destroy();
+
+    void watchPipeline(const std::string& name, std::vector<Stage> stages, BuildFn build, ApplyFn apply);
+
+    // Between frames on the render thread: hands every finished pipeline to its ApplyFn.
+    // Never waits for the watcher, a rebuild finishing meanwhile is picked up next frame
+    u32 poll();
+
+    bool isActive() const { return m_Thread.joinable(); }
+
+private:
+    struct Target {
+        std::string name;
+        std::vector<Stage> stages;
+        BuildFn build;
+        ApplyFn apply;
+    };
+
+    struct ReadyPipeline {
+        u32 target;
+        VkPipeline pipeline;
+    };
+
+    void watchLoop();
+    // Returns the file names in the watched directory that changed since the last call
+    std::vector<std::string> waitForChanges();
+    void rebuild(u32 targetIndex);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    std::filesystem::path m_Directory;
+
+    std::thread m_Thread;
+    std::atomic<bool> m_Quit { false };
+#if defined(VKP_LINUX)
+    int m_Inotify = -1;
+#else
+    // Modification time fallback, indexed by file name
+    UMap<std::string, std::filesystem::file_time_type> m_WriteTimes;
+#endif
+
+    // Guards m_Targets and m_Ready
+    std::mutex m_Mutex;
+    std::vector<Scope<Target>> m_Targets;
+    std::vector<ReadyPipeline> m_Ready;
+};
+
+}
+
+#endif
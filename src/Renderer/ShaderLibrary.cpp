@@ -0,0 +1,75 @@
+#include "Renderer/ShaderLibrary.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+static constexpr u32 SPIRV_MAGIC = 0x07230203;
+// magic, version, generator, bound, schema
+static constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+static bool validateSpirv(const void* code, size_t sizeInBytes, const std::string& name)
+{
+    if ((reinterpret_cast<uintptr_t>(code) & 3) != 0) {
+        VKP_ERROR("Shader {} is not 4-byte aligned", name);
+        return false;
+    }
+    if (sizeInBytes % 4 != 0 || sizeInBytes < SPIRV_HEADER_WORDS * 4) {
+        VKP_ERROR("Shader {} has invalid SPIR-V size {}", name, sizeInBytes);
+        return false;
+    }
+    if (static_cast<const u32*>(code)[0] != SPIRV_MAGIC) {
+        VKP_ERROR("Shader {} is not SPIR-V (bad magic)", name);
+        return false;
+    }
+    return true;
+}
+
+void ShaderLibrary::init(VkDevice device)
+{
+    m_Device = device;
+}
+
+void ShaderLibrary::destroy()
+{
+    for (auto& [hash, module] : m_Modules) {
+        VKP_UNTRACK(module);
+        vkDestroyShaderModule(m_Device, module, VKP_ALLOCATION_CALLBACKS);
+    }
+    m_Modules.clear();
+}
+
+VkShaderModule ShaderLibrary::load(const EmbeddedShader& shader)
+{
+    return loadFromMemory(shader.code, shader.codeSize, shader.name);
+}
+
+VkShaderModule ShaderLibrary::loadFromMemory(const u32* code, size_t sizeInBytes, const std::string& name)
+{
+    bool valid = validateSpirv(code, sizeInBytes, name);
+    VKP_ASSERT(valid, "INVALID SPIR-V " + name);
+    if (!valid) {
+        return VK_NULL_HANDLE;
+    }
+
+    Hash hash = hashBytes(code, sizeInBytes);
+    auto it = m_Modules.find(hash);
+    if (it != m_Modules.end()) {
+        m_CacheHits++;
+        return it->second;
+    }
+
+    VkShaderModuleCreateInfo createInfo {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = sizeInBytes;
+    createInfo.pCode = code;
+
+    VkShaderModule shaderModule;
+    VkResult res = vkCreateShaderModule(m_Device, &createInfo, VKP_ALLOCATION_CALLBACKS, &shaderModule);
+    VKP_ASSERT(res == VK_SUCCESS, "UNABLE TO CREATE SHADER MODULE " + name);
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SHADER_MODULE, shaderModule, name.c_str());
+
+    m_Modules[hash] = shaderModule;
+    return shaderModule;
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef VKP_SHADERLIBRARY
+#define VKP_SHADERLIBRARY
+
+#include "Renderer/EmbeddedShader.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Owns every VkShaderModule. Modules are keyed by a hash of their SPIR-V, so the same
+// code loaded through different paths or by different pipelines is only created once
+class ShaderLibrary {
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    // SPIR-V the build embedded in the executable, no file is read
+    VkShaderModule load(const EmbeddedShader& shader);
+    // For SPIR-V that already lives in memory. `code` must be 4-byte aligned
+    VkShaderModule loadFromMemory(const u32* code, size_t sizeInBytes, const std::string& name);
+
+    u32 getModuleCount() const { return (u32)m_Modules.size(); }
+    u32 getCacheHits() const { return m_CacheHits; }
+
+private:
+    VkDevice m_Device = VK_NULL_HANDLE;
+    UMap<Hash, VkShaderModule> m_Modules;
+    u32 m_CacheHits = 0;
+};
+
+}
+
+#endif
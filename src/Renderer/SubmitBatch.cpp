@@ -0,0 +1,64 @@
+#include "Renderer/SubmitBatch.hpp"
+
+namespace VulkanProj {
+
+SubmitBatch& SubmitBatch::wait(VkSemaphore semaphore, VkPipelineStageFlags stage, u64 value)
+{
+    VKP_ASSERT(m_WaitCount < MAX_SEMAPHORES, "TOO MANY WAIT SEMAPHORES IN ONE SUBMIT");
+    m_WaitSemaphores[m_WaitCount] = semaphore;
+    m_WaitStages[m_WaitCount] = stage;
+    m_WaitValues[m_WaitCount++] = value;
+    return *this;
+}
+
+SubmitBatch& SubmitBatch::signal(VkSemaphore semaphore, u64 value)
+{
+    VKP_ASSERT(m_SignalCount < MAX_SEMAPHORES, "TOO MANY SIGNAL SEMAPHORES IN ONE SUBMIT");
+    m_SignalSemaphores[m_SignalCount] = semaphore;
+    m_SignalValues[m_SignalCount++] = value;
+    return *this;
+}
+
+SubmitBatch& SubmitBatch::commandBuffer(VkCommandBuffer commandBuffer)
+{
+    VKP_ASSERT(m_CommandBufferCount < MAX_COMMAND_BUFFERS, "TOO MANY COMMAND BUFFERS IN ONE SUBMIT");
+    m_CommandBuffers[m_CommandBufferCount++] = commandBuffer;
+    return *this;
+}
+
+const VkSubmitInfo& SubmitBatch::build()
+{
+    // Binary semaphores ignore their values, so the timeline struct can always be chained
+    m_TimelineInfo = {};
+    m_TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    m_TimelineInfo.waitSemaphoreValueCount = m_WaitCount;
+    m_TimelineInfo.pWaitSemaphoreValues = m_WaitValues.data();
+    m_TimelineInfo.signalSemaphoreValueCount = m_SignalCount;
+    m_TimelineInfo.pSignalSemaphoreValues = m_SignalValues.data();
+
+    m_SubmitInfo = {};
+    m_SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    m_SubmitInfo.pNext = &m_TimelineInfo;
+    m_SubmitInfo.waitSemaphoreCount = m_WaitCount;
+    m_SubmitInfo.pWaitSemaphores = m_WaitSemaphores.data();
+    m_SubmitInfo.pWaitDstStageMask = m_WaitStages.data();
+    m_SubmitInfo.commandBufferCount = m_CommandBufferCount;
+    m_SubmitInfo.pCommandBuffers = m_CommandBuffers.data();
+    m_SubmitInfo.signalSemaphoreCount = m_SignalCount;
+    m_SubmitInfo.pSignalSemaphores = m_SignalSemaphores.data();
+    return m_SubmitInfo;
+}
+
+VkResult SubmitBatch::submit(VkQueue queue, VkFence fence)
+{
+    return vkQueueSubmit(queue, 1, &build(), fence);
+}
+
+void SubmitBatch::clear()
+{
+    m_WaitCount = 0;
+    m_SignalCount = 0;
+    m_CommandBufferCount = 0;
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef VKP_SUBMITBATCH
+#define VKP_SUBMITBATCH
+
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Waits, signals and command buffers of one vkQueueSubmit, with the timeline values chained in.
+// Fixed storage, so building a frame's submit never allocates. Binary semaphores take value 0
+class SubmitBatch {
+public:
+    static constexpr u32 MAX_SEMAPHORES = 4;
+    static constexpr u32 MAX_COMMAND_BUFFERS = 4;
+
+    SubmitBatch& wait(VkSemaphore semaphore, VkPipelineStageFlags stage, u64 value = 0);
+    SubmitBatch& signal(VkSemaphore semaphore, u64 value = 0);
+    SubmitBatch& commandBuffer(VkCommandBuffer commandBuffer);
+
+    // Points into the batch, which must stay where it is and unchanged until the submit
+    const VkSubmitInfo& build();
+    VkResult submit(VkQueue queue, VkFence fence = VK_NULL_HANDLE);
+
+    void clear();
+
+private:
+    std::array<VkSemaphore, MAX_SEMAPHORES> m_WaitSemaphores;
+    std::array<VkPipelineStageFlags, MAX_SEMAPHORES> m_WaitStages;
+    std::array<u64, MAX_SEMAPHORES> m_WaitValues;
+    std::array<VkSemaphore, MAX_SEMAPHORES> m_SignalSemaphores;
+    std::array<u64, MAX_SEMAPHORES> m_SignalValues;
+    std::array<VkCommandBuffer, MAX_COMMAND_BUFFERS> m_CommandBuffers;
+    u32 m_WaitCount = 0;
+    u32 m_SignalCount = 0;
+    u32 m_CommandBufferCount = 0;
+
+    VkTimelineSemaphoreSubmitInfo m_TimelineInfo {};
+    VkSubmitInfo m_SubmitInfo {};
+};
+
+}
+
+#endif
@@ -0,0 +1,438 @@
+#include "Renderer/TextureStreamer.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+// A demand that is not renewed for this many frames no longer pulls finer mips in
+static constexpr u64 DEMAND_LAPSE_FRAMES = 30;
+// Textures nobody asked for in this long drop back to their tail even without memory pressure
+static constexpr u64 IDLE_EVICT_FRAMES = 600;
+
+VkImageView createImageView2D(VkDevice device, VkImage image, VkFormat format, u32 levelCount, const char* name)
+{
+    VkImageViewCreateInfo createInfo {};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image = image;
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = format;
+
+    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    createInfo.subresourceRange.baseMipLevel = 0;
+    createInfo.subresourceRange.levelCount = levelCount;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    VkResult res = vkCreateImageView(device, &createInfo, VKP_ALLOCATION_CALLBACKS, &view);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE IMAGE VIEW");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_IMAGE_VIEW, view, name);
+    return view;
+}
+
+// Image holding mips [firstMip, levelCount) of `ktx`
+static VkImageCreateInfo makeImageInfo(const Ktx2Image& ktx, u32 firstMip)
+{
+    const Ktx2Level& top = ktx.levels[firstMip];
+    VkImageCreateInfo imageInfo {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = ktx.format;
+    imageInfo.extent = { top.width, top.height, 1 };
+    imageInfo.mipLevels = (u32)ktx.levels.size() - firstMip;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return imageInfo;
+}
+
+void TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceAllocator& allocator, UploadQueue& uploads,
+    BindlessTable& bindless, DeletionQueue& deletion, GpuTimeline& timeline, const Spec& spec)
+{
+    m_Spec = spec;
+    m_PhysicalDevice = physicalDevice;
+    m_Device = device;
+    m_Allocator = &allocator;
+    m_Uploads = &uploads;
+    m_Bindless = &bindless;
+    m_Deletion = &deletion;
+    m_Timeline = &timeline;
+
+    VkPhysicalDeviceMemoryProperties memory;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memory);
+    for (u32 i = 0; i < memory.memoryHeapCount; i++) {
+        const VkMemoryHeap& heap = memory.memoryHeaps[i];
+        const VkMemoryHeap& best = memory.memoryHeaps[m_TextureHeap];
+        if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && (!(best.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) || heap.size > best.size)) {
+            m_TextureHeap = i;
+        }
+    }
+
+    // Every texture image starts at the finest resident mip, so the full LOD range is always valid
+    VkSamplerCreateInfo samplerInfo {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VkResult res = vkCreateSampler(device, &samplerInfo, VKP_ALLOCATION_CALLBACKS, &m_Sampler);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE TEXTURE SAMPLER");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SAMPLER, m_Sampler, "Texture sampler");
+
+    VKP_INFO("Texture streaming: heap {}, budget {}, tail {} texels", m_TextureHeap,
+        m_Spec.memoryBudget ? "from VK_EXT_memory_budget" : "from heap size", m_Spec.tailSize);
+}
+
+void TextureStreamer::destroy()
+{
+    for (Scope<Texture>& texture : m_Textures) {
+        if (texture) {
+            destroyNow(texture->resident);
+            destroyNow(texture->pending);
+        }
+    }
+    m_Textures.clear();
+    m_FreeHandles.clear();
+    m_ResidentBytes = 0;
+    m_PendingBytes = 0;
+    VKP_UNTRACK(m_Sampler);
+    vkDestroySampler(m_Device, m_Sampler, VKP_ALLOCATION_CALLBACKS);
+    m_Sampler = VK_NULL_HANDLE;
+}
+
+TextureHandle TextureStreamer::load(const std::string& path)
+{
+    Scope<Texture> texture = CreateScope<Texture>();
+    texture->path = path;
+    if (!texture->file.open(path)) {
+        VKP_ERROR("Unable to open texture {}", path);
+        return INVALID_TEXTURE;
+    }
+    if (!parseKtx2(path, texture->file.data(), texture->file.size(), texture->ktx)) {
+        return INVALID_TEXTURE;
+    }
+    const Ktx2Image& ktx = texture->ktx;
+    const u32 levelCount = (u32)ktx.levels.size();
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, ktx.format, &formatProperties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & required) != required) {
+        VKP_ERROR("Texture {}: the device cannot sample format {}", path, (u32)ktx.format);
+        return INVALID_TEXTURE;
+    }
+
+    texture->tailMip = levelCount - 1;
+    while (texture->tailMip > 0 && std::max(ktx.levels[texture->tailMip - 1].width, ktx.levels[texture->tailMip - 1].height) <= m_Spec.tailSize) {
+        texture->tailMip--;
+    }
+    // A level larger than the staging ring can never be uploaded in one request
+    while (texture->finestMip < texture->tailMip && ktx.levels[texture->finestMip].size > m_Uploads->getRingSize()) {
+        texture->finestMip++;
+    }
+
+    texture->chainBytes.resize(levelCount);
+    for (u32 mip = 0; mip < levelCount; mip++) {
+        VkImageCreateInfo imageInfo = makeImageInfo(ktx, mip);
+        VkDeviceImageMemoryRequirements query {};
+        query.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+        query.pCreateInfo = &imageInfo;
+        VkMemoryRequirements2 requirements {};
+        requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        vkGetDeviceImageMemoryRequirements(m_Device, &query, &requirements);
+        texture->chainBytes[mip] = requirements.memoryRequirements.size;
+    }
+
+    // Low mips first: only the tail is queued now, finer mips follow demand
+    if (!beginTransition(*texture, texture->tailMip)) {
+        return INVALID_TEXTURE;
+    }
+
+    TextureHandle handle;
+    if (!m_FreeHandles.empty()) {
+        handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+        m_Textures[handle] = std::move(texture);
+    } else {
+        handle = (TextureHandle)m_Textures.size();
+        m_Textures.push_back(std::move(texture));
+    }
+    const Texture& loaded = *m_Textures[handle];
+    VKP_INFO("Texture {}: {}x{}, {} mips, tail from mip {} ({} KiB), full chain {} KiB", path, ktx.width, ktx.height, levelCount,
+        loaded.tailMip, loaded.chainBytes[loaded.tailMip] >> 10, loaded.chainBytes[loaded.finestMip] >> 10);
+    return handle;
+}
+
+void TextureStreamer::unload(TextureHandle handle)
+{
+    VKP_ASSERT(handle < m_Textures.size() && m_Textures[handle] && m_Textures[handle]->live, "UNLOADING AN INVALID TEXTURE");
+    Texture& texture = *m_Textures[handle];
+    if (texture.resident.image != VK_NULL_HANDLE) {
+        m_ResidentBytes -= texture.chainBytes[texture.resident.firstMip];
+        retire(texture.resident);
+    }
+    texture.live = false;
+    // The transfer queue may still be writing the pending image, update() retires it once it is done
+    if (texture.pending.image == VK_NULL_HANDLE) {
+        m_Textures[handle].reset();
+        m_FreeHandles.push_back(handle);
+    }
+}
+
+void TextureStreamer::requestResolution(TextureHandle handle, u32 pixels)
+{
+    Texture& texture = *m_Textures[handle];
+    if (texture.lastRequestFrame != m_Frame) {
+        texture.lastRequestFrame = m_Frame;
+        texture.requestedPixels = 0;
+    }
+    texture.requestedPixels = std::max(texture.requestedPixels, pixels);
+}
+
+u32 TextureStreamer::mipForPixels(const Texture& texture, u32 pixels) const
+{
+    // Coarsest mip that still has at least one texel per covered pixel
+    u32 mip = texture.finestMip;
+    const u32 size = std::max(texture.ktx.width, texture.ktx.height);
+    while (mip < texture.tailMip && (size >> (mip + 1)) >= std::max(1u, pixels)) {
+        mip++;
+    }
+    return mip;
+}
+
+void TextureStreamer::update()
+{
+    VKP_PROFILE_FUNCTION();
+
+    // Finished uploads replace what was resident
+    for (TextureHandle handle = 0; handle < m_Textures.size(); handle++) {
+        Scope<Texture>& slot = m_Textures[handle];
+        if (!slot || slot->pending.image == VK_NULL_HANDLE || !m_Uploads->isComplete(slot->pendingToken)) {
+            continue;
+        }
+        Texture& texture = *slot;
+        m_PendingBytes -= texture.chainBytes[texture.pending.firstMip];
+        if (!texture.live) {
+            retire(texture.pending);
+            slot.reset();
+            m_FreeHandles.push_back(handle);
+            continue;
+        }
+
+        if (texture.resident.image != VK_NULL_HANDLE) {
+            if (texture.pending.firstMip < texture.resident.firstMip) {
+                m_StreamedIn++;
+            } else {
+                m_Evicted++;
+            }
+            m_ResidentBytes -= texture.chainBytes[texture.resident.firstMip];
+            retire(texture.resident);
+        }
+        // A fresh index rather than repointing the old one, frames in flight keep sampling the old image
+        texture.resident = std::exchange(texture.pending, {});
+        texture.resident.bindlessIndex = m_Bindless->registerTexture(texture.resident.view, m_Sampler);
+        m_ResidentBytes += texture.chainBytes[texture.resident.firstMip];
+    }
+
+    // Every tail is committed up front, the rest of the budget goes to the most demanded textures
+    const VkDeviceSize budget = queryBudget();
+    m_LastBudget = budget;
+
+    struct Plan {
+        Texture* texture;
+        u32 wanted;
+        u32 priority;
+    };
+    std::vector<Plan> plans;
+    VkDeviceSize committed = 0;
+    for (Scope<Texture>& slot : m_Textures) {
+        if (!slot || !slot->live) {
+            continue;
+        }
+        Texture& texture = *slot;
+        committed += texture.chainBytes[texture.tailMip];
+
+        const u64 idleFrames = m_Frame - texture.lastRequestFrame;
+        const u32 heading = texture.pending.image != VK_NULL_HANDLE ? texture.pending.firstMip : texture.resident.firstMip;
+        Plan plan { &texture, heading, 0 };
+        if (texture.lastRequestFrame > 0 && idleFrames <= DEMAND_LAPSE_FRAMES) {
+            plan.wanted = mipForPixels(texture, texture.requestedPixels);
+            plan.priority = std::max(1u, texture.requestedPixels);
+        } else if (idleFrames > IDLE_EVICT_FRAMES) {
+            plan.wanted = texture.tailMip;
+        }
+        plans.push_back(plan);
+    }
+    std::stable_sort(plans.begin(), plans.end(), [](const Plan& a, const Plan& b) { return a.priority > b.priority; });
+
+    for (Plan& plan : plans) {
+        const Texture& texture = *plan.texture;
+        const VkDeviceSize tailBytes = texture.chainBytes[texture.tailMip];
+        while (plan.wanted < texture.tailMip && committed + texture.chainBytes[plan.wanted] - tailBytes > budget) {
+            plan.wanted++;
+        }
+        committed += texture.chainBytes[plan.wanted] - tailBytes;
+    }
+
+    // Evictions first, they free memory and cost little bandwidth. Stream-ins then share the
+    // per-frame upload allowance in priority order, at least one always goes
+    VkDeviceSize uploadBytes = 0;
+    for (bool evicting : { true, false }) {
+        for (const Plan& plan : plans) {
+            Texture& texture = *plan.texture;
+            if (texture.pending.image != VK_NULL_HANDLE || plan.wanted == texture.resident.firstMip
+                || (plan.wanted > texture.resident.firstMip) != evicting) {
+                continue;
+            }
+            VkDeviceSize bytes = 0;
+            for (u32 mip = plan.wanted; mip < texture.ktx.levels.size(); mip++) {
+                bytes += texture.ktx.levels[mip].size;
+            }
+            if (!evicting && uploadBytes > 0 && uploadBytes + bytes > m_Spec.maxUploadBytesPerFrame) {
+                continue;
+            }
+            if (beginTransition(texture, plan.wanted)) {
+                uploadBytes += bytes;
+            }
+        }
+    }
+
+    m_Frame++;
+}
+
+bool TextureStreamer::beginTransition(Texture& texture, u32 firstMip)
+{
+    const Ktx2Image& ktx = texture.ktx;
+    VkImageCreateInfo imageInfo = makeImageInfo(ktx, firstMip);
+
+    Residency residency;
+    residency.firstMip = firstMip;
+    VkResult res = vkCreateImage(m_Device, &imageInfo, VKP_ALLOCATION_CALLBACKS, &residency.image);
+    if (res != VK_SUCCESS) {
+        VKP_WARN("Texture {}: unable to create image for mip {}", texture.path, firstMip);
+        return false;
+    }
+    residency.memory = m_Allocator->allocateForImage(residency.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (residency.memory == nullptr) {
+        VKP_WARN("Texture {}: out of device memory for mip {}", texture.path, firstMip);
+        vkDestroyImage(m_Device, residency.image, VKP_ALLOCATION_CALLBACKS);
+        return false;
+    }
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_IMAGE, residency.image, texture.path.c_str());
+    residency.view = createImageView2D(m_Device, residency.image, ktx.format, imageInfo.mipLevels, texture.path.c_str());
+
+    // Tokens complete in order, the last one covers the whole chain
+    for (u32 mip = firstMip; mip < ktx.levels.size(); mip++) {
+        const Ktx2Level& level = ktx.levels[mip];
+        VkImageSubresourceLayers subresource { VK_IMAGE_ASPECT_COLOR_BIT, mip - firstMip, 0, 1 };
+        texture.pendingToken = m_Uploads->uploadImage(residency.image, subresource, { level.width, level.height, 1 },
+            texture.file.data() + level.offset, level.size, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    texture.pending = residency;
+    m_PendingBytes += texture.chainBytes[firstMip];
+    return true;
+}
+
+void TextureStreamer::retire(Residency& residency)
+{
+    const u64 lastUse = m_Timeline->getLastSubmitted();
+    if (residency.bindlessIndex != BindlessTable::INVALID_INDEX) {
+        m_Bindless->releaseTexture(residency.bindlessIndex);
+    }
+    m_Deletion->retireImageView(residency.view, lastUse);
+    m_Deletion->retireImage(residency.image, residency.memory, lastUse);
+    residency = {};
+}
+
+void TextureStreamer::destroyNow(Residency& residency)
+{
+    if (residency.image == VK_NULL_HANDLE) {
+        return;
+    }
+    VKP_UNTRACK(residency.view);
+    vkDestroyImageView(m_Device, residency.view, VKP_ALLOCATION_CALLBACKS);
+    VKP_UNTRACK(residency.image);
+    vkDestroyImage(m_Device, residency.image, VKP_ALLOCATION_CALLBACKS);
+    m_Allocator->free(residency.memory);
+    residency = {};
+}
+
+VkDeviceSize TextureStreamer::queryBudget() const
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = m_Spec.memoryBudget ? &budgetProperties : nullptr;
+    vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, &properties);
+
+    // Without the extension only our own allocations are known, other processes are invisible
+    VkDeviceSize heapBudget = properties.memoryProperties.memoryHeaps[m_TextureHeap].size;
+    VkDeviceSize heapUsage = m_Allocator->getHeapStats()[m_TextureHeap].usedBytes;
+    if (m_Spec.memoryBudget) {
+        heapBudget = budgetProperties.heapBudget[m_TextureHeap];
+        heapUsage = budgetProperties.heapUsage[m_TextureHeap];
+    }
+
+    // Retired images still count against the heap until the deletion queue gets to them, which
+    // only makes the budget briefly conservative
+    const VkDeviceSize ours = m_ResidentBytes + m_PendingBytes;
+    const VkDeviceSize others = heapUsage > ours ? heapUsage - ours : 0;
+    const VkDeviceSize usable = (VkDeviceSize)((f64)heapBudget * m_Spec.heapFraction);
+    VkDeviceSize budget = usable > others ? usable - others : 0;
+    if (m_Spec.budgetBytes > 0) {
+        budget = std::min(budget, m_Spec.budgetBytes);
+    }
+    return budget;
+}
+
+u32 TextureStreamer::getBindlessIndex(TextureHandle handle) const
+{
+    return m_Textures[handle]->resident.bindlessIndex;
+}
+
+u32 TextureStreamer::getResidentMip(TextureHandle handle) const
+{
+    const Texture& texture = *m_Textures[handle];
+    return texture.resident.image != VK_NULL_HANDLE ? texture.resident.firstMip : (u32)texture.ktx.levels.size();
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+    Stats stats;
+    for (const Scope<Texture>& texture : m_Textures) {
+        if (texture && texture->live) {
+            stats.textureCount++;
+        }
+        if (texture && texture->pending.image != VK_NULL_HANDLE) {
+            stats.pendingTransitions++;
+        }
+    }
+    stats.residentBytes = m_ResidentBytes;
+    stats.budgetBytes = m_LastBudget;
+    stats.streamedIn = m_StreamedIn;
+    stats.evicted = m_Evicted;
+    return stats;
+}
+
+void TextureStreamer::logStats() const
+{
+    Stats stats = getStats();
+    VKP_INFO("Texture streaming: {} textures, {:.1f}/{:.1f} MiB resident/budget, {} pending, {} streamed in, {} evicted", stats.textureCount,
+        stats.residentBytes / (1024.0 * 1024.0), stats.budgetBytes / (1024.0 * 1024.0), stats.pendingTransitions, stats.streamedIn,
+        stats.evicted);
+}
+
+}
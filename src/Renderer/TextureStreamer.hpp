@@ -0,0 +1,141 @@
+#ifndef VKP_TEXTURESTREAMER
+#define VKP_TEXTURESTREAMER
+
+#include "Core/MappedFile.hpp"
+#include "Renderer/BindlessTable.hpp"
+#include "Renderer/DeletionQueue.hpp"
+#include "Renderer/DeviceAllocator.hpp"
+#include "Renderer/GpuTimeline.hpp"
+#include "Renderer/Ktx2.hpp"
+#include "Renderer/UploadQueue.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// 2D color view over `levelCount` mips starting at 0, the same shape createImageViews uses
+VkImageView createImageView2D(VkDevice device, VkImage image, VkFormat format, u32 levelCount = 1, const char* name = nullptr);
+
+using TextureHandle = u32;
+static constexpr TextureHandle INVALID_TEXTURE = ~0u;
+
+// Streams block-compressed KTX2 textures. A texture's image only ever holds a contiguous tail of
+// its mip chain: the small mips are uploaded at load and never leave, finer mips are added as
+// on-screen demand asks for them and dropped again under memory pressure. Changing the resident
+// range builds a new image, re-uploads the kept mips from the mapped file and retires the old
+// image through the deletion queue, so frames in flight never see a half updated texture.
+// Not thread safe, drive it from the frame loop
+class TextureStreamer {
+public:
+    struct Spec {
+        // Hard cap for texture memory, 0 leaves it to the device budget alone
+        VkDeviceSize budgetBytes = 0;
+        // Share of the device-local heap budget textures may use, minus what everything else uses
+        f32 heapFraction = 0.8f;
+        // Mips up to this size (largest dimension, in texels) are resident from load until unload
+        u32 tailSize = 64;
+        // Staging bytes streaming may queue per frame, the rest waits for later frames
+        VkDeviceSize maxUploadBytesPerFrame = 16ull * 1024 * 1024;
+        // VK_EXT_memory_budget is enabled on the device
+        bool memoryBudget = false;
+    };
+
+    struct Stats {
+        u32 textureCount = 0;
+        VkDeviceSize residentBytes = 0;
+        VkDeviceSize budgetBytes = 0;
+        u32 pendingTransitions = 0;
+        u64 streamedIn = 0;
+        u64 evicted = 0;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceAllocator& allocator, UploadQueue& uploads,
+        BindlessTable& bindless, DeletionQueue& deletion, GpuTimeline& timeline, const Spec& spec);
+    // The device must be idle
+    void destroy();
+
+    // Maps the file and queues its mip tail. INVALID_TEXTURE when the file is missing, malformed
+    // or in a format the device cannot sample
+    TextureHandle load(const std::string& path);
+    void unload(TextureHandle texture);
+
+    // Screen-space demand: the largest extent, in pixels, the texture covers on screen this frame.
+    // Requests within a frame combine to the largest, and lapse when they are not renewed
+    void requestResolution(TextureHandle texture, u32 pixels);
+
+    // Promotes finished uploads, re-plans residency against the budget and queues the resulting
+    // uploads. Once per frame, before UploadQueue::flush
+    void update();
+
+    // Bindless index of the resident mips, BindlessTable::INVALID_INDEX until the tail is resident.
+    // Changes whenever the resident range does, so read it every frame
+    u32 getBindlessIndex(TextureHandle texture) const;
+    // Finest resident mip, the level count when nothing is resident yet
+    u32 getResidentMip(TextureHandle texture) const;
+
+    Stats getStats() const;
+    void logStats() const;
+
+private:
+    // One image holding mips [firstMip, levelCount)
+    struct Residency {
+        VkImage image = VK_NULL_HANDLE;
+        Allocation* memory = nullptr;
+        VkImageView view = VK_NULL_HANDLE;
+        u32 firstMip = 0;
+        u32 bindlessIndex = BindlessTable::INVALID_INDEX;
+    };
+
+    struct Texture {
+        std::string path;
+        MappedFile file;
+        Ktx2Image ktx;
+        // Allocation size of the image for each possible first mip
+        std::vector<VkDeviceSize> chainBytes;
+        // Coarsest first mip, i.e. where the always resident tail starts
+        u32 tailMip = 0;
+        // Finest first mip whose levels each fit the staging ring
+        u32 finestMip = 0;
+
+        Residency resident;
+        Residency pending;
+        UploadToken pendingToken = 0;
+
+        u32 requestedPixels = 0;
+        u64 lastRequestFrame = 0;
+        bool live = true;
+    };
+
+    bool beginTransition(Texture& texture, u32 firstMip);
+    void retire(Residency& residency);
+    void destroyNow(Residency& residency);
+    VkDeviceSize queryBudget() const;
+    u32 mipForPixels(const Texture& texture, u32 pixels) const;
+
+    Spec m_Spec;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+    UploadQueue* m_Uploads = nullptr;
+    BindlessTable* m_Bindless = nullptr;
+    DeletionQueue* m_Deletion = nullptr;
+    GpuTimeline* m_Timeline = nullptr;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    // Largest device-local heap, the one textures land in
+    u32 m_TextureHeap = 0;
+
+    std::vector<Scope<Texture>> m_Textures;
+    std::vector<TextureHandle> m_FreeHandles;
+    // Starts at 1, a lastRequestFrame of 0 means never requested
+    u64 m_Frame = 1;
+
+    VkDeviceSize m_ResidentBytes = 0;
+    VkDeviceSize m_PendingBytes = 0;
+    VkDeviceSize m_LastBudget = 0;
+    u64 m_StreamedIn = 0;
+    u64 m_Evicted = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#include "Renderer/UploadQueue.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+namespace VulkanProj {
+
+// Satisfies copy offset rules for every texel block size we upload
+static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void UploadQueue::init(VkDevice device, DeviceAllocator& allocator, VkQueue transferQueue, u32 transferFamily, u32 graphicsFamily,
+    VkDeviceSize ringSize)
+{
+    m_Device = device;
+    m_Allocator = &allocator;
+    m_TransferQueue = transferQueue;
+    m_TransferFamily = transferFamily;
+    m_GraphicsFamily = graphicsFamily;
+    m_RingSize = ringSize;
+
+    VkBufferCreateInfo ringInfo {};
+    ringInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    ringInfo.size = ringSize;
+    ringInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    ringInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    m_Ring = allocator.createBuffer(ringInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "Upload ring");
+    VKP_ASSERT(m_Ring != nullptr && m_Ring->mapped != nullptr, "FAILED TO CREATE STAGING RING");
+
+    VkSemaphoreTypeCreateInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+    VkResult res = vkCreateSemaphore(m_Device, &semaphoreInfo, VKP_ALLOCATION_CALLBACKS, &m_Timeline);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE UPLOAD TIMELINE SEMAPHORE");
+    VKP_TRACK_OBJECT(VK_OBJECT_TYPE_SEMAPHORE, m_Timeline, "Upload timeline");
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_TransferFamily;
+    for (Batch& batch : m_Batches) {
+        res = vkCreateCommandPool(m_Device, &poolInfo, VKP_ALLOCATION_CALLBACKS, &batch.commandPool);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE UPLOAD COMMAND POOL");
+        VKP_TRACK_OBJECT(VK_OBJECT_TYPE_COMMAND_POOL, batch.commandPool, "Upload command pool");
+
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = batch.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        res = vkAllocateCommandBuffers(m_Device, &allocInfo, &batch.commandBuffer);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO ALLOCATE UPLOAD COMMAND BUFFER");
+    }
+
+    VKP_INFO("UploadQueue: {:.0f} MiB staging ring on {} queue family {}", ringSize / (1024.0 * 1024.0),
+        hasDedicatedQueue() ? "dedicated transfer" : "graphics", m_TransferFamily);
+}
+
+void UploadQueue::destroy()
+{
+    for (Batch& batch : m_Batches) {
+        VKP_UNTRACK(batch.commandPool);
+        vkDestroyCommandPool(m_Device, batch.commandPool, VKP_ALLOCATION_CALLBACKS);
+        batch = {};
+    }
+    VKP_UNTRACK(m_Timeline);
+    vkDestroySemaphore(m_Device, m_Timeline, VKP_ALLOCATION_CALLBACKS);
+    m_Allocator->destroyBuffer(m_Ring);
+    m_Ring = nullptr;
+    m_Deferred.clear();
+}
+
+u64 UploadQueue::getCompletedValue() const
+{
+    u64 value = 0;
+    vkGetSemaphoreCounterValue(m_Device, m_Timeline, &value);
+    return value;
+}
+
+VkDeviceSize UploadQueue::reserveRing(VkDeviceSize size)
+{
+    // Nothing in flight, so the whole ring is free: start at 0 instead of wrapping around the
+    // stale head and failing sizes that would fit
+    if (m_RingUsed == 0) {
+        m_RingHead = 0;
+    }
+
+    VkDeviceSize offset = (m_RingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    VkDeviceSize padding = offset - m_RingHead;
+    if (offset + size > m_RingSize) {
+        // Skip the tail end of the ring and start over at 0
+        padding = m_RingSize - m_RingHead;
+        offset = 0;
+    }
+    if (m_RingUsed + padding + size > m_RingSize) {
+        return INVALID_RING_OFFSET;
+    }
+
+    m_RingHead = offset + size;
+    m_RingUsed += padding + size;
+    m_PendingRingBytes += padding + size;
+    return offset;
+}
+
+void UploadQueue::reclaimRing()
+{
+    u64 completed = getCompletedValue();
+    for (Batch& batch : m_Batches) {
+        if (batch.ringBytes > 0 && batch.value <= completed) {
+            m_RingUsed -= batch.ringBytes;
+            batch.ringBytes = 0;
+        }
+    }
+}
+
+bool UploadQueue::stageBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    VkDeviceSize offset = reserveRing(size);
+    if (offset == INVALID_RING_OFFSET) {
+        return false;
+    }
+    memcpy(static_cast<u8*>(m_Ring->mapped) + offset, data, size);
+
+    BufferCopy copy;
+    copy.dst = dst;
+    copy.region.srcOffset = offset;
+    copy.region.dstOffset = dstOffset;
+    copy.region.size = size;
+    m_BufferCopies.push_back(copy);
+    return true;
+}
+
+bool UploadQueue::stageImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data,
+    VkDeviceSize size, VkImageLayout finalLayout)
+{
+    VkDeviceSize offset = reserveRing(size);
+    if (offset == INVALID_RING_OFFSET) {
+        return false;
+    }
+    memcpy(static_cast<u8*>(m_Ring->mapped) + offset, data, size);
+
+    ImageCopy copy {};
+    copy.dst = dst;
+    copy.region.bufferOffset = offset;
+    copy.region.imageSubresource = subresource;
+    copy.region.imageOffset = { 0, 0, 0 };
+    copy.region.imageExtent = extent;
+    copy.finalLayout = finalLayout;
+    m_ImageCopies.push_back(copy);
+    return true;
+}
+
+UploadToken UploadQueue::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    VKP_ASSERT(size <= m_RingSize, "UPLOAD LARGER THAN STAGING RING");
+    UploadToken token = m_NextToken++;
+
+    // Once anything is deferred, later requests queue behind it so tokens complete in order
+    if (m_Deferred.empty() && stageBuffer(dst, dstOffset, data, size)) {
+        m_StagedToken = token;
+        return token;
+    }
+
+    DeferredUpload deferred;
+    deferred.data.assign(static_cast<const u8*>(data), static_cast<const u8*>(data) + size);
+    deferred.buffer = dst;
+    deferred.dstOffset = dstOffset;
+    deferred.token = token;
+    m_Deferred.push_back(std::move(deferred));
+    return token;
+}
+
+UploadToken UploadQueue::uploadImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data,
+    VkDeviceSize size, VkImageLayout finalLayout)
+{
+    VKP_ASSERT(size <= m_RingSize, "UPLOAD LARGER THAN STAGING RING");
+    UploadToken token = m_NextToken++;
+
+    if (m_Deferred.empty() && stageImage(dst, subresource, extent, data, size, finalLayout)) {
+        m_StagedToken = token;
+        return token;
+    }
+
+    DeferredUpload deferred;
+    deferred.data.assign(static_cast<const u8*>(data), static_cast<const u8*>(data) + size);
+    deferred.image = dst;
+    deferred.subresource = subresource;
+    deferred.extent = extent;
+    deferred.finalLayout = finalLayout;
+    deferred.token = token;
+    m_Deferred.push_back(std::move(deferred));
+    return token;
+}
+
+void UploadQueue::retryDeferred()
+{
+    while (!m_Deferred.empty()) {
+        DeferredUpload& upload = m_Deferred.front();
+        bool staged = upload.image != VK_NULL_HANDLE
+            ? stageImage(upload.image, upload.subresource, upload.extent, upload.data.data(), upload.data.size(), upload.finalLayout)
+            : stageBuffer(upload.buffer, upload.dstOffset, upload.data.data(), upload.data.size());
+        if (!staged) {
+            return;
+        }
+        m_StagedToken = upload.token;
+        m_Deferred.pop_front();
+    }
+}
+
+void UploadQueue::flush()
+{
+    reclaimRing();
+
+    // Never wait for a slot, the copies stay queued until a batch frees up
+    u64 completed = getCompletedValue();
+    Batch* batch = nullptr;
+    for (Batch& candidate : m_Batches) {
+        if (candidate.value <= completed && candidate.acquired) {
+            batch = &candidate;
+            break;
+        }
+    }
+    if (batch == nullptr) {
+        return;
+    }
+
+    retryDeferred();
+    if (m_BufferCopies.empty() && m_ImageCopies.empty()) {
+        return;
+    }
+
+    vkResetCommandPool(m_Device, batch->commandPool, 0);
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch->commandBuffer, &beginInfo);
+
+    const bool transferOwnership = hasDedicatedQueue();
+    std::vector<VkImageMemoryBarrier> toTransfer;
+    std::vector<VkImageMemoryBarrier> release;
+    std::vector<VkBufferMemoryBarrier> releaseBuffers;
+    batch->acquireBuffers.clear();
+    batch->acquireImages.clear();
+
+    for (const ImageCopy& copy : m_ImageCopies) {
+        VkImageMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.dst;
+        barrier.subresourceRange = { copy.region.imageSubresource.aspectMask, copy.region.imageSubresource.mipLevel, 1,
+            copy.region.imageSubresource.baseArrayLayer, copy.region.imageSubresource.layerCount };
+        toTransfer.push_back(barrier);
+
+        // Release half on this queue, the graphics queue replays the acquire half
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = transferOwnership ? 0 : VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = copy.finalLayout;
+        barrier.srcQueueFamilyIndex = transferOwnership ? m_TransferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = transferOwnership ? m_GraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        release.push_back(barrier);
+
+        if (transferOwnership) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            batch->acquireImages.push_back(barrier);
+        }
+    }
+    if (!toTransfer.empty()) {
+        vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, (u32)toTransfer.size(), toTransfer.data());
+    }
+
+    // One vkCmdCopyBuffer per destination with all of its regions
+    std::sort(m_BufferCopies.begin(), m_BufferCopies.end());
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < m_BufferCopies.size();) {
+        VkBuffer dst = m_BufferCopies[i].dst;
+        regions.clear();
+        for (; i < m_BufferCopies.size() && m_BufferCopies[i].dst == dst; i++) {
+            regions.push_back(m_BufferCopies[i].region);
+        }
+        vkCmdCopyBuffer(batch->commandBuffer, m_Ring->buffer, dst, (u32)regions.size(), regions.data());
+
+        VkBufferMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = transferOwnership ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+        barrier.srcQueueFamilyIndex = transferOwnership ? m_TransferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = transferOwnership ? m_GraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = dst;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        releaseBuffers.push_back(barrier);
+
+        if (transferOwnership) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            batch->acquireBuffers.push_back(barrier);
+        }
+    }
+    for (const ImageCopy& copy : m_ImageCopies) {
+        vkCmdCopyBufferToImage(batch->commandBuffer, m_Ring->buffer, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+    }
+
+    vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        transferOwnership ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+        0, nullptr, (u32)releaseBuffers.size(), releaseBuffers.data(), (u32)release.size(), release.data());
+
+    vkEndCommandBuffer(batch->commandBuffer);
+
+    batch->value = m_NextValue++;
+    batch->lastToken = m_StagedToken;
+    batch->ringBytes = m_PendingRingBytes;
+    batch->acquired = false;
+    m_PendingRingBytes = 0;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &batch->value;
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch->commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_Timeline;
+
+    VkResult res = vkQueueSubmit(m_TransferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO SUBMIT UPLOAD BATCH");
+
+    m_BufferCopies.clear();
+    m_ImageCopies.clear();
+}
+
+void UploadQueue::waitIdle()
+{
+    flush();
+
+    u64 value = m_NextValue - 1;
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Timeline;
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX);
+}
+
+u64 UploadQueue::recordAcquires(VkCommandBuffer graphicsCommandBuffer)
+{
+    u64 completed = getCompletedValue();
+
+    // Acquire in submission order so tokens become complete in order
+    std::array<Batch*, MAX_BATCHES_IN_FLIGHT> ready;
+    u32 readyCount = 0;
+    for (Batch& batch : m_Batches) {
+        if (!batch.acquired && batch.value <= completed) {
+            ready[readyCount++] = &batch;
+        }
+    }
+    std::sort(ready.begin(), ready.begin() + readyCount, [](const Batch* a, const Batch* b) { return a->value < b->value; });
+
+    u64 waitValue = 0;
+    for (u32 i = 0; i < readyCount; i++) {
+        Batch& batch = *ready[i];
+        if (!batch.acquireBuffers.empty() || !batch.acquireImages.empty()) {
+            vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                0, nullptr, (u32)batch.acquireBuffers.size(), batch.acquireBuffers.data(),
+                (u32)batch.acquireImages.size(), batch.acquireImages.data());
+        }
+        batch.acquired = true;
+        m_AcquiredToken = std::max(m_AcquiredToken, batch.lastToken);
+        waitValue = batch.value;
+    }
+    return waitValue;
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef VKP_UPLOADQUEUE
+#define VKP_UPLOADQUEUE
+
+#include "Renderer/DeviceAllocator.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Monotonic id of an upload request. 0 is never issued
+using UploadToken = u64;
+
+// Streams data into device-local resources from a persistently mapped staging ring.
+// Requests made during a frame are batched into one submission on the transfer queue
+// (a dedicated transfer family when the device has one) and handed over to the graphics
+// family with queue-family ownership transfers. Nothing here ever waits on the GPU
+class UploadQueue {
+public:
+    static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+    static constexpr u32 MAX_BATCHES_IN_FLIGHT = 8;
+
+    void init(VkDevice device, DeviceAllocator& allocator, VkQueue transferQueue, u32 transferFamily, u32 graphicsFamily,
+        VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+    void destroy();
+
+    UploadToken uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+    // Uploads mip/layer `subresource` and leaves the image in `finalLayout` on the graphics queue
+    UploadToken uploadImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data,
+        VkDeviceSize size, VkImageLayout finalLayout);
+
+    // Submit everything requested since the last flush as one batch. Call once per frame
+    void flush();
+    // Flush and block until the transfer queue is done with it. For load time only, never
+    // from the frame loop. The graphics side still has to recordAcquires() before use
+    void waitIdle();
+
+    // Record ownership acquires for every batch the transfer queue has finished. Returns the
+    // timeline value the graphics submission must wait on, or 0 when nothing was acquired
+    u64 recordAcquires(VkCommandBuffer graphicsCommandBuffer);
+
+    // Completed means transferred and acquired by a recorded graphics command buffer,
+    // the resource can be used by anything recorded after that point
+    bool isComplete(UploadToken token) const { return token <= m_AcquiredToken; }
+    u64 getCompletedValue() const;
+
+    VkSemaphore getTimelineSemaphore() const { return m_Timeline; }
+    // Upper bound for the size of a single request
+    VkDeviceSize getRingSize() const { return m_RingSize; }
+    bool hasDedicatedQueue() const { return m_TransferFamily != m_GraphicsFamily; }
+
+private:
+    struct BufferCopy {
+        VkBuffer dst;
+        VkBufferCopy region;
+
+        bool operator<(const BufferCopy& other) const { return dst < other.dst; }
+    };
+    struct ImageCopy {
+        VkImage dst;
+        VkBufferImageCopy region;
+        VkImageLayout finalLayout;
+    };
+    // A request that did not fit the ring, retried on the next flush
+    struct DeferredUpload {
+        std::vector<u8> data;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize dstOffset = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageSubresourceLayers subresource {};
+        VkExtent3D extent {};
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        UploadToken token = 0;
+    };
+    struct Batch {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        u64 value = 0;
+        UploadToken lastToken = 0;
+        VkDeviceSize ringBytes = 0;
+        std::vector<VkBufferMemoryBarrier> acquireBuffers;
+        std::vector<VkImageMemoryBarrier> acquireImages;
+        bool acquired = true;
+    };
+
+    // Reserve `size` bytes of staging memory, INVALID_RING_OFFSET when the ring is full
+    VkDeviceSize reserveRing(VkDeviceSize size);
+    bool stageBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+    bool stageImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data,
+        VkDeviceSize size, VkImageLayout finalLayout);
+    void reclaimRing();
+    void retryDeferred();
+
+    static constexpr VkDeviceSize INVALID_RING_OFFSET = ~0ull;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    DeviceAllocator* m_Allocator = nullptr;
+    VkQueue m_TransferQueue = VK_NULL_HANDLE;
+    u32 m_TransferFamily = 0;
+    u32 m_GraphicsFamily = 0;
+
+    // Consumed strictly FIFO, so a byte count is enough to know where the in-flight data starts
+    Allocation* m_Ring = nullptr;
+    VkDeviceSize m_RingSize = 0;
+    VkDeviceSize m_RingHead = 0;
+    VkDeviceSize m_RingUsed = 0;
+    VkDeviceSize m_PendingRingBytes = 0;
+
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    u64 m_NextValue = 1; // value the next batch will signal
+    UploadToken m_NextToken = 1;
+    UploadToken m_StagedToken = 0; // newest request recorded into the batch being built
+    UploadToken m_AcquiredToken = 0;
+
+    std::array<Batch, MAX_BATCHES_IN_FLIGHT> m_Batches;
+    std::vector<BufferCopy> m_BufferCopies;
+    std::vector<ImageCopy> m_ImageCopies;
+    std::deque<DeferredUpload> m_Deferred;
+};
+
+}
+
+#endif
@@ -27,6 +27,18 @@
 
 using Hash = u64;
 
+// 64-bit FNV-1a. Stable across runs and platforms, so it is safe to persist
+inline Hash hashBytes(const void* data, size_t size, Hash seed = 0xcbf29ce484222325ull)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    Hash hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
 namespace VulkanProj {
 
 template <typename T, typename Y>
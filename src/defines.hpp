@@ -3,6 +3,8 @@
 
 // Core Defines
 
+#include <cstdint>
+
 //----TYPES----
 
 typedef unsigned char u8;
@@ -11,7 +13,7 @@ typedef unsigned short u16;
 
 typedef unsigned int u32;
 
-typedef unsigned long long u64;
+typedef uint64_t u64;
 
 // Signed int types.
 
@@ -21,7 +23,7 @@ typedef signed short i16;
 
 typedef signed int i32;
 
-typedef signed long long i64;
+typedef int64_t i64;
 
 // Floating point types
 
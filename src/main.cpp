@@ -3,18 +3,177 @@
 #include <vulkan/vulkan.h>
 
 #include <Application/Application.hpp>
+#include <Core/JobSystem.hpp>
 
-int main()
+struct LaunchOptions {
+    VulkanProj::ApplicationSpec spec;
+    // Job system threads including the main thread (0 = hardware threads)
+    u32 threads = 0;
+    // Re-run the benchmark once per frames-in-flight depth and compare against a serial ring
+    bool benchmarkSweep = false;
+    VulkanProj::LogSpec log;
+    // Parsed before the logger exists, reported once it does
+    std::vector<std::string> unknownArgs;
+    // --pacing given, benchmarks otherwise run uncapped
+    bool pacingSet = false;
+    u32 captureFrames = 0;
+    std::string capturePath;
+};
+
+static LaunchOptions parseArgs(int argc, char** argv)
 {
-    VulkanProj::Log::Init();
+    LaunchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
 
-    VulkanProj::Application app;
-    try {
+        if (arg == "--frames-in-flight" && hasValue) {
+            options.spec.framesInFlight = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--bench-frames" && hasValue) {
+            options.spec.benchmarkFrames = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--bench-sweep") {
+            options.benchmarkSweep = true;
+        } else if (arg == "--no-pipeline-cache") {
+            options.spec.pipelineCachePath.clear();
+        } else if (arg == "--resize-stress" && hasValue) {
+            options.spec.resizeStressFrames = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--instances" && hasValue) {
+            options.spec.instanceCount = std::max(1u, (u32)std::stoul(argv[++i]));
+        } else if (arg == "--scene-extent" && hasValue) {
+            options.spec.sceneExtent = std::stof(argv[++i]);
+        } else if (arg == "--gpu-cull") {
+            options.spec.gpuCulling = true;
+        } else if (arg == "--cull-stats") {
+            options.spec.gpuCulling = true;
+            options.spec.cullStats = true;
+        } else if (arg == "--instances-per-chunk" && hasValue) {
+            options.spec.instancesPerChunk = std::max(1u, (u32)std::stoul(argv[++i]));
+        } else if (arg == "--bench" && hasValue) {
+            options.spec.microBenchmark = argv[++i];
+        } else if (arg == "--device" && hasValue) {
+            options.spec.preferredDevice = argv[++i];
+        } else if (arg == "--pacing" && hasValue) {
+            std::string mode = argv[++i];
+            if (VulkanProj::parsePacingMode(mode, options.spec.pacing)) {
+                options.pacingSet = true;
+            } else {
+                options.unknownArgs.push_back(arg + " " + mode);
+            }
+        } else if (arg == "--fps-limit" && hasValue) {
+            options.spec.targetFps = std::max(1u, (u32)std::stoul(argv[++i]));
+            options.spec.pacing = VulkanProj::PacingMode::Limited;
+            options.pacingSet = true;
+        } else if (arg == "--pacing-stats") {
+            options.spec.pacingStats = true;
+        } else if (arg == "--texture" && hasValue) {
+            options.spec.texturePaths.push_back(argv[++i]);
+        } else if (arg == "--texture-budget" && hasValue) {
+            options.spec.textureBudgetMiB = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--mesh" && hasValue) {
+            options.spec.meshPackPath = argv[++i];
+        } else if (arg == "--mesh-name" && hasValue) {
+            options.spec.meshName = argv[++i];
+        } else if (arg == "--hot-reload") {
+            options.spec.shaderHotReload = true;
+        } else if (arg == "--no-pipeline-library") {
+            options.spec.pipelineLibrary = false;
+        } else if (arg == "--headless") {
+            options.spec.headless = true;
+        } else if (arg == "--frames" && hasValue) {
+            options.spec.frameLimit = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--readback" && hasValue) {
+            options.spec.readbackPath = argv[++i];
+        } else if (arg == "--resource-snapshot" && hasValue) {
+            options.spec.resourceSnapshotPath = argv[++i];
+        } else if (arg == "--profile-capture" && i + 2 < argc) {
+            options.captureFrames = (u32)std::stoul(argv[++i]);
+            options.capturePath = argv[++i];
+        } else if (arg == "--sync-log") {
+            options.log.async = false;
+        } else if (arg == "--log-overflow" && hasValue) {
+            std::string policy = argv[++i];
+            if (policy == "block") {
+                options.log.overflow = VulkanProj::LogOverflowPolicy::Block;
+            } else if (policy == "drop") {
+                options.log.overflow = VulkanProj::LogOverflowPolicy::Drop;
+            } else {
+                options.unknownArgs.push_back(arg + " " + policy);
+            }
+        } else {
+            options.unknownArgs.push_back(arg);
+        }
+    }
+
+    if (options.benchmarkSweep && options.spec.benchmarkFrames == 0) {
+        options.spec.benchmarkFrames = 1000;
+    }
+    // Otherwise every frames-in-flight depth would measure the refresh rate
+    if (options.spec.benchmarkFrames > 0 && !options.pacingSet) {
+        options.spec.pacing = VulkanProj::PacingMode::Uncapped;
+    }
+    return options;
+}
+
+static void runFramesInFlightSweep(VulkanProj::ApplicationSpec spec)
+{
+    std::vector<std::pair<u32, VulkanProj::BenchSummary>> results;
+    for (u32 depth = VulkanProj::MIN_FRAMES_IN_FLIGHT; depth <= VulkanProj::MAX_FRAMES_IN_FLIGHT; depth++) {
+        spec.framesInFlight = depth;
+        VulkanProj::Application app(spec);
         app.run();
+        results.emplace_back(depth, app.getFrameTimeSummary());
+    }
+
+    const f64 serialAvg = results.front().second.avg;
+    VKP_INFO("[BENCH] frames-in-flight sweep ({} frames each)", spec.benchmarkFrames);
+    for (const auto& [depth, summary] : results) {
+        VKP_INFO("[BENCH]   depth {}: avg {:.3f}ms  p99 {:.3f}ms  {:.1f} fps  x{:.2f} vs serial",
+            depth, summary.avg, summary.p99, summary.avg > 0.0 ? 1000.0 / summary.avg : 0.0,
+            summary.avg > 0.0 ? serialAvg / summary.avg : 0.0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    LaunchOptions options;
+    std::string argError;
+    try {
+        options = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        argError = e.what();
+    }
+
+    VulkanProj::Log::Init(options.log);
+    if (!argError.empty()) {
+        VKP_ERROR("Invalid arguments: {}", argError);
+        VulkanProj::Log::Shutdown();
+        return EXIT_FAILURE;
+    }
+    for (const std::string& arg : options.unknownArgs) {
+        VKP_WARN("Ignoring unknown argument '{}'", arg);
+    }
+    if (options.captureFrames > 0) {
+        VKP_PROFILE_CAPTURE(options.captureFrames, options.capturePath);
+    }
+
+    try {
+        VulkanProj::JobSystem::init(options.threads);
+        if (options.benchmarkSweep) {
+            runFramesInFlightSweep(options.spec);
+        } else {
+            VulkanProj::Application app(options.spec);
+            app.run();
+        }
     } catch (const std::exception& e) {
         VKP_ERROR("{}", e.what());
+        VulkanProj::JobSystem::shutdown();
+        VulkanProj::Log::Shutdown();
         return EXIT_FAILURE;
     }
 
+    VulkanProj::JobSystem::shutdown();
+    VulkanProj::Log::Shutdown();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,399 @@
+#include "Cooker/GltfImporter.hpp"
+#include "Core/Json.hpp"
+#include "Core/MappedFile.hpp"
+
+#include <cstring>
+
+namespace VulkanProj {
+
+static constexpr u32 GLB_MAGIC = 0x46546C67; // "glTF"
+static constexpr u32 GLB_CHUNK_JSON = 0x4E4F534A;
+static constexpr u32 GLB_CHUNK_BIN = 0x004E4942;
+static constexpr u32 GLTF_MODE_TRIANGLES = 4;
+
+enum GltfComponentType : u32 {
+    GLTF_BYTE = 5120,
+    GLTF_UNSIGNED_BYTE = 5121,
+    GLTF_SHORT = 5122,
+    GLTF_UNSIGNED_SHORT = 5123,
+    GLTF_UNSIGNED_INT = 5125,
+    GLTF_FLOAT = 5126,
+};
+
+// A buffer's bytes, either inside a mapped file or decoded from a data URI
+struct GltfBuffer {
+    const u8* data = nullptr;
+    size_t size = 0;
+};
+
+struct GltfDocument {
+    std::string path;
+    JsonValue json;
+    std::vector<MappedFile> files;
+    std::vector<std::vector<u8>> decoded;
+    std::vector<GltfBuffer> buffers;
+};
+
+static u32 readU32(const u8* data)
+{
+    u32 value;
+    memcpy(&value, data, sizeof(u32));
+    return value;
+}
+
+static bool decodeBase64(std::string_view text, std::vector<u8>& out)
+{
+    auto decodeChar = [](char c) -> i32 {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        return c == '+' ? 62 : c == '/' ? 63 : -1;
+    };
+
+    out.reserve(text.size() / 4 * 3);
+    u32 accumulator = 0;
+    u32 bits = 0;
+    for (char c : text) {
+        if (c == '=') {
+            break;
+        }
+        i32 value = decodeChar(c);
+        if (value < 0) {
+            return false;
+        }
+        accumulator = (accumulator << 6) | (u32)value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((u8)(accumulator >> bits));
+        }
+    }
+    return true;
+}
+
+static u32 componentSize(u32 componentType)
+{
+    switch (componentType) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static u32 componentCount(const std::string& type)
+{
+    static const std::array<const char*, 4> TYPES = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+    for (u32 i = 0; i < TYPES.size(); i++) {
+        if (type == TYPES[i]) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Normalized integers map to [0, 1] or [-1, 1] as the spec defines
+static f64 readComponent(const u8* data, u32 componentType, bool normalized)
+{
+    switch (componentType) {
+    case GLTF_BYTE: {
+        i8 value;
+        memcpy(&value, data, 1);
+        return normalized ? std::max(value / 127.0, -1.0) : value;
+    }
+    case GLTF_UNSIGNED_BYTE:
+        return normalized ? data[0] / 255.0 : data[0];
+    case GLTF_SHORT: {
+        i16 value;
+        memcpy(&value, data, 2);
+        return normalized ? std::max(value / 32767.0, -1.0) : value;
+    }
+    case GLTF_UNSIGNED_SHORT: {
+        u16 value;
+        memcpy(&value, data, 2);
+        return normalized ? value / 65535.0 : value;
+    }
+    case GLTF_UNSIGNED_INT:
+        return readU32(data);
+    case GLTF_FLOAT: {
+        f32 value;
+        memcpy(&value, data, 4);
+        return value;
+    }
+    default:
+        return 0.0;
+    }
+}
+
+// Reads accessor `index` as `count` elements of up to 4 components each, missing ones stay 0
+static bool readAccessor(const GltfDocument& document, u32 index, std::vector<glm::dvec4>& out, u32& components)
+{
+    const JsonValue* accessors = document.json.find("accessors");
+    if (accessors == nullptr || index >= accessors->size()) {
+        VKP_ERROR("{}: accessor {} does not exist", document.path, index);
+        return false;
+    }
+    const JsonValue& accessor = (*accessors)[index];
+    if (accessor.find("sparse") != nullptr) {
+        VKP_ERROR("{}: accessor {} is sparse, which is not supported", document.path, index);
+        return false;
+    }
+
+    const u32 componentType = (u32)accessor.getNumber("componentType", 0);
+    const u32 size = componentSize(componentType);
+    components = componentCount(accessor.getString("type"));
+    const u64 count = (u64)accessor.getNumber("count", 0);
+    const bool normalized = accessor.find("normalized") != nullptr && accessor.find("normalized")->asBool();
+    if (size == 0 || components == 0) {
+        VKP_ERROR("{}: accessor {} has an unsupported component type or shape", document.path, index);
+        return false;
+    }
+
+    out.assign(count, glm::dvec4(0.0));
+    const JsonValue* viewIndex = accessor.find("bufferView");
+    if (viewIndex == nullptr) {
+        // No view means all zeros
+        return true;
+    }
+
+    const JsonValue* views = document.json.find("bufferViews");
+    const u32 viewId = (u32)viewIndex->asNumber();
+    if (views == nullptr || viewId >= views->size()) {
+        VKP_ERROR("{}: accessor {} references missing buffer view {}", document.path, index, viewId);
+        return false;
+    }
+    const JsonValue& view = (*views)[viewId];
+    const u32 bufferId = (u32)view.getNumber("buffer", 0);
+    if (bufferId >= document.buffers.size()) {
+        VKP_ERROR("{}: buffer view {} references missing buffer {}", document.path, viewId, bufferId);
+        return false;
+    }
+
+    const GltfBuffer& buffer = document.buffers[bufferId];
+    const u64 viewOffset = (u64)view.getNumber("byteOffset", 0);
+    const u64 viewLength = (u64)view.getNumber("byteLength", 0);
+    const u64 elementSize = (u64)size * components;
+    const u64 stride = std::max((u64)view.getNumber("byteStride", 0), elementSize);
+    const u64 accessorOffset = (u64)accessor.getNumber("byteOffset", 0);
+    if (viewOffset + viewLength > buffer.size
+        || (count > 0 && accessorOffset + (count - 1) * stride + elementSize > viewLength)) {
+        VKP_ERROR("{}: accessor {} reads past the end of its buffer", document.path, index);
+        return false;
+    }
+
+    const u8* base = buffer.data + viewOffset + accessorOffset;
+    for (u64 i = 0; i < count; i++) {
+        const u8* element = base + i * stride;
+        for (u32 c = 0; c < components; c++) {
+            out[i][c] = readComponent(element + c * size, componentType, normalized);
+        }
+    }
+    return true;
+}
+
+static bool loadBuffers(GltfDocument& document, const u8* glbBin, size_t glbBinSize)
+{
+    const JsonValue* buffers = document.json.find("buffers");
+    if (buffers == nullptr) {
+        return true;
+    }
+    const std::filesystem::path directory = std::filesystem::path(document.path).parent_path();
+
+    document.decoded.reserve(buffers->size());
+    document.files.reserve(buffers->size());
+    for (size_t i = 0; i < buffers->size(); i++) {
+        const JsonValue& buffer = (*buffers)[i];
+        const size_t byteLength = (size_t)buffer.getNumber("byteLength", 0);
+        const std::string uri = buffer.getString("uri");
+        GltfBuffer view;
+
+        if (uri.empty()) {
+            // GLB: the first buffer without a uri is the binary chunk
+            if (i != 0 || glbBin == nullptr) {
+                VKP_ERROR("{}: buffer {} has no uri", document.path, i);
+                return false;
+            }
+            view = { glbBin, glbBinSize };
+        } else if (uri.rfind("data:", 0) == 0) {
+            size_t comma = uri.find(";base64,");
+            std::vector<u8>& bytes = document.decoded.emplace_back();
+            if (comma == std::string::npos || !decodeBase64(std::string_view(uri).substr(comma + 8), bytes)) {
+                VKP_ERROR("{}: buffer {} has a data uri that is not base64", document.path, i);
+                return false;
+            }
+            view = { bytes.data(), bytes.size() };
+        } else {
+            // Percent-encoded uris are left alone, exporters rarely write them for buffers
+            std::string file = (directory / uri).string();
+            MappedFile& mapped = document.files.emplace_back();
+            if (!mapped.open(file)) {
+                VKP_ERROR("{}: failed to open buffer {}", document.path, file);
+                return false;
+            }
+            view = { mapped.data(), mapped.size() };
+        }
+
+        if (view.size < byteLength) {
+            VKP_ERROR("{}: buffer {} is {} bytes, expected {}", document.path, i, view.size, byteLength);
+            return false;
+        }
+        document.buffers.push_back(view);
+    }
+    return true;
+}
+
+static bool importPrimitive(const GltfDocument& document, const JsonValue& primitive, const std::string& name, SourceMesh& mesh)
+{
+    const JsonValue* attributes = primitive.find("attributes");
+    const JsonValue* position = attributes != nullptr ? attributes->find("POSITION") : nullptr;
+    if (position == nullptr) {
+        VKP_ERROR("{}: {} has no POSITION", document.path, name);
+        return false;
+    }
+    mesh.name = name;
+
+    std::vector<glm::dvec4> values;
+    u32 components;
+    if (!readAccessor(document, (u32)position->asNumber(), values, components)) {
+        return false;
+    }
+    mesh.positions.reserve(values.size());
+    for (const glm::dvec4& value : values) {
+        mesh.positions.push_back(glm::vec3(value));
+    }
+    const size_t vertexCount = mesh.positions.size();
+
+    if (const JsonValue* normal = attributes->find("NORMAL")) {
+        if (!readAccessor(document, (u32)normal->asNumber(), values, components) || values.size() != vertexCount) {
+            VKP_ERROR("{}: {} has an unusable NORMAL", document.path, name);
+            return false;
+        }
+        mesh.normals.reserve(vertexCount);
+        for (const glm::dvec4& value : values) {
+            mesh.normals.push_back(glm::vec3(value));
+        }
+    }
+
+    if (const JsonValue* color = attributes->find("COLOR_0")) {
+        if (!readAccessor(document, (u32)color->asNumber(), values, components) || values.size() != vertexCount) {
+            VKP_ERROR("{}: {} has an unusable COLOR_0", document.path, name);
+            return false;
+        }
+        mesh.colors.reserve(vertexCount);
+        for (const glm::dvec4& value : values) {
+            // VEC3 colors are opaque
+            mesh.colors.push_back(glm::vec4(glm::vec3(value), components == 4 ? (f32)value.w : 1.0f));
+        }
+    }
+
+    if (const JsonValue* indices = primitive.find("indices")) {
+        if (!readAccessor(document, (u32)indices->asNumber(), values, components)) {
+            return false;
+        }
+        mesh.indices.reserve(values.size());
+        for (const glm::dvec4& value : values) {
+            mesh.indices.push_back((u32)value.x);
+        }
+    } else {
+        mesh.indices.resize(vertexCount);
+        for (u32 i = 0; i < (u32)vertexCount; i++) {
+            mesh.indices[i] = i;
+        }
+    }
+    return true;
+}
+
+bool importGltf(const std::string& path, std::vector<SourceMesh>& meshes)
+{
+    GltfDocument document;
+    document.path = path;
+
+    MappedFile file;
+    if (!file.open(path)) {
+        VKP_ERROR("Failed to open {}", path);
+        return false;
+    }
+
+    const u8* jsonText = file.data();
+    size_t jsonSize = file.size();
+    const u8* binChunk = nullptr;
+    size_t binSize = 0;
+
+    if (file.size() >= 12 && readU32(file.data()) == GLB_MAGIC) {
+        // 12 byte header, then chunks of { length, type, data }. JSON comes first
+        const u32 totalLength = std::min<u32>(readU32(file.data() + 8), (u32)file.size());
+        jsonText = nullptr;
+        for (u32 offset = 12; offset + 8 <= totalLength;) {
+            const u32 chunkLength = readU32(file.data() + offset);
+            const u32 chunkType = readU32(file.data() + offset + 4);
+            if (chunkLength > totalLength - offset - 8) {
+                break;
+            }
+            if (chunkType == GLB_CHUNK_JSON && jsonText == nullptr) {
+                jsonText = file.data() + offset + 8;
+                jsonSize = chunkLength;
+            } else if (chunkType == GLB_CHUNK_BIN && binChunk == nullptr) {
+                binChunk = file.data() + offset + 8;
+                binSize = chunkLength;
+            }
+            offset += 8 + chunkLength;
+        }
+        if (jsonText == nullptr) {
+            VKP_ERROR("{} is a GLB without a JSON chunk", path);
+            return false;
+        }
+    }
+
+    std::string error;
+    if (!parseJson(reinterpret_cast<const char*>(jsonText), jsonSize, document.json, error)) {
+        VKP_ERROR("{}: invalid JSON, {}", path, error);
+        return false;
+    }
+    if (!loadBuffers(document, binChunk, binSize)) {
+        return false;
+    }
+
+    const JsonValue* gltfMeshes = document.json.find("meshes");
+    if (gltfMeshes == nullptr || gltfMeshes->size() == 0) {
+        VKP_ERROR("{} has no meshes", path);
+        return false;
+    }
+
+    const std::string stem = std::filesystem::path(path).stem().string();
+    for (size_t m = 0; m < gltfMeshes->size(); m++) {
+        const JsonValue& gltfMesh = (*gltfMeshes)[m];
+        const std::string meshName = stem + ":" + gltfMesh.getString("name", std::to_string(m));
+        const JsonValue* primitives = gltfMesh.find("primitives");
+        const size_t primitiveCount = primitives != nullptr ? primitives->size() : 0;
+
+        for (size_t p = 0; p < primitiveCount; p++) {
+            const JsonValue& primitive = (*primitives)[p];
+            const std::string name = primitiveCount > 1 ? meshName + "#" + std::to_string(p) : meshName;
+            if ((u32)primitive.getNumber("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES) {
+                VKP_WARN("{}: skipping {}, only triangle lists are supported", path, name);
+                continue;
+            }
+            SourceMesh mesh;
+            if (!importPrimitive(document, primitive, name, mesh)) {
+                return false;
+            }
+            meshes.push_back(std::move(mesh));
+        }
+    }
+    return true;
+}
+
+}
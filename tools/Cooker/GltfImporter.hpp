@@ -0,0 +1,16 @@
+#ifndef VKP_COOKER_GLTFIMPORTER
+#define VKP_COOKER_GLTFIMPORTER
+
+#include "Cooker/SourceMesh.hpp"
+
+namespace VulkanProj {
+
+// glTF 2.0, as .gltf (external or base64 embedded buffers) or .glb. Every triangle primitive
+// becomes its own mesh with POSITION, NORMAL and COLOR_0. Meshes are taken as they are in the
+// buffers, node transforms are not applied. Sparse accessors are not supported. Logs why and
+// returns false on failure
+bool importGltf(const std::string& path, std::vector<SourceMesh>& meshes);
+
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "Cooker/MeshOptimizer.hpp"
+
+namespace VulkanProj {
+
+// Forsyth's scoring: the last triangle's vertices get a fixed score so strips don't just
+// follow the most recent edge, then the score decays with cache position. Vertices with
+// few triangles left score higher so they get finished off instead of left as stragglers
+static constexpr u32 FORSYTH_CACHE_SIZE = 32;
+static constexpr f32 FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr f32 FORSYTH_DECAY_POWER = 1.5f;
+static constexpr f32 FORSYTH_VALENCE_SCALE = 2.0f;
+static constexpr f32 FORSYTH_VALENCE_POWER = -0.5f;
+// Valences beyond this share a score
+static constexpr u32 FORSYTH_MAX_VALENCE = 32;
+
+f32 computeAcmr(const std::vector<u32>& indices, u32 vertexCount, u32 cacheSize)
+{
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+    // Timestamp FIFO: a vertex is cached while fewer than cacheSize misses happened since its own
+    std::vector<u32> missedAt(vertexCount, 0);
+    u32 misses = 0;
+    for (u32 index : indices) {
+        if (missedAt[index] == 0 || misses - missedAt[index] >= cacheSize) {
+            misses++;
+            missedAt[index] = misses;
+        }
+    }
+    return (f32)misses / (f32)(indices.size() / 3);
+}
+
+struct ForsythTables {
+    std::array<f32, FORSYTH_CACHE_SIZE> cacheScores;
+    std::array<f32, FORSYTH_MAX_VALENCE + 1> valenceScores;
+
+    ForsythTables()
+    {
+        for (u32 i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+            if (i < 3) {
+                cacheScores[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+            } else {
+                f32 scaled = 1.0f - (f32)(i - 3) / (f32)(FORSYTH_CACHE_SIZE - 3);
+                cacheScores[i] = std::pow(scaled, FORSYTH_DECAY_POWER);
+            }
+        }
+        valenceScores[0] = 0.0f;
+        for (u32 i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+            valenceScores[i] = FORSYTH_VALENCE_SCALE * std::pow((f32)i, FORSYTH_VALENCE_POWER);
+        }
+    }
+
+    // cachePosition -1 is not cached
+    f32 score(i32 cachePosition, u32 valence) const
+    {
+        if (valence == 0) {
+            // No triangles left, never pulls anything in
+            return -1.0f;
+        }
+        f32 result = valenceScores[std::min(valence, FORSYTH_MAX_VALENCE)];
+        if (cachePosition >= 0) {
+            result += cacheScores[cachePosition];
+        }
+        return result;
+    }
+};
+
+void optimizeVertexCache(std::vector<u32>& indices, u32 vertexCount)
+{
+    static const ForsythTables tables;
+    const u32 triangleCount = (u32)(indices.size() / 3);
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles using each vertex, as a CSR adjacency list. valence counts the unemitted ones
+    // and the vertex's live triangles are kept at the front of its range
+    std::vector<u32> valence(vertexCount, 0);
+    for (u32 index : indices) {
+        valence[index]++;
+    }
+    std::vector<u32> adjacencyOffset(vertexCount + 1, 0);
+    for (u32 v = 0; v < vertexCount; v++) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+    }
+    std::vector<u32> adjacency(indices.size());
+    {
+        std::vector<u32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (u32 t = 0; t < triangleCount; t++) {
+            for (u32 k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = t;
+            }
+        }
+    }
+
+    std::vector<i32> cachePosition(vertexCount, -1);
+    std::vector<f32> vertexScore(vertexCount);
+    for (u32 v = 0; v < vertexCount; v++) {
+        vertexScore[v] = tables.score(-1, valence[v]);
+    }
+    std::vector<f32> triangleScore(triangleCount);
+    for (u32 t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+    std::vector<bool> emitted(triangleCount, false);
+
+    // LRU, most recent first. Holds up to 3 entries past the modelled size while updating
+    std::vector<u32> cache;
+    std::vector<u32> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<u32> result;
+    result.reserve(indices.size());
+    u32 scanCursor = 0;
+    u32 best = 0;
+    f32 bestScore = triangleScore[0];
+    for (u32 t = 1; t < triangleCount; t++) {
+        if (triangleScore[t] > bestScore) {
+            best = t;
+            bestScore = triangleScore[t];
+        }
+    }
+
+    for (u32 emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (bestScore < 0.0f) {
+            // Nothing in the cache has triangles left: continue with the next unemitted one
+            while (emitted[scanCursor]) {
+                scanCursor++;
+            }
+            best = scanCursor;
+        }
+
+        const u32* triangle = &indices[best * 3];
+        emitted[best] = true;
+        nextCache.clear();
+        for (u32 k = 0; k < 3; k++) {
+            u32 v = triangle[k];
+            result.push_back(v);
+            nextCache.push_back(v);
+
+            // Drop the triangle from the vertex's live range
+            u32* begin = &adjacency[adjacencyOffset[v]];
+            u32* end = begin + valence[v];
+            u32* found = std::find(begin, end, best);
+            std::swap(*found, *(end - 1));
+            valence[v]--;
+        }
+        for (u32 v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        std::swap(cache, nextCache);
+
+        // Rescore everything that was or is in the cache, then pick the best triangle among
+        // the ones they touch. Evicted vertices get their uncached score back
+        for (size_t i = 0; i < cache.size(); i++) {
+            u32 v = cache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (i32)i : -1;
+            f32 score = tables.score(cachePosition[v], valence[v]);
+            f32 delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (u32 a = 0; a < valence[v]; a++) {
+                triangleScore[adjacency[adjacencyOffset[v] + a]] += delta;
+            }
+        }
+        if (cache.size() > FORSYTH_CACHE_SIZE) {
+            cache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        bestScore = -1.0f;
+        for (u32 v : cache) {
+            for (u32 a = 0; a < valence[v]; a++) {
+                u32 t = adjacency[adjacencyOffset[v] + a];
+                if (triangleScore[t] > bestScore) {
+                    best = t;
+                    bestScore = triangleScore[t];
+                }
+            }
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void optimizeOverdraw(std::vector<u32>& indices, const std::vector<glm::vec3>& positions, f32 threshold)
+{
+    const u32 triangleCount = (u32)(indices.size() / 3);
+    const u32 vertexCount = (u32)positions.size();
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Cache misses of every triangle in the current order
+    std::vector<u8> triangleMisses(triangleCount, 0);
+    {
+        std::vector<u32> missedAt(vertexCount, 0);
+        u32 misses = 0;
+        for (u32 t = 0; t < triangleCount; t++) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 index = indices[t * 3 + k];
+                if (missedAt[index] == 0 || misses - missedAt[index] >= ACMR_CACHE_SIZE) {
+                    misses++;
+                    missedAt[index] = misses;
+                    triangleMisses[t]++;
+                }
+            }
+        }
+    }
+
+    // Hard boundaries: triangles where all three vertices miss, i.e. the cache optimizer
+    // started over. Reordering between those costs no cache efficiency
+    std::vector<u32> hardBoundaries;
+    for (u32 t = 0; t < triangleCount; t++) {
+        if (t == 0 || triangleMisses[t] == 3) {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // Soft boundaries inside each hard cluster: end a cluster as soon as its own ACMR, counted
+    // from a cold cache since the cluster may end up anywhere, is within `threshold` of the hard
+    // cluster's. More clusters give the sort more freedom
+    std::vector<u32> clusterStarts;
+    std::vector<u32> missedAt(vertexCount, 0);
+    u32 misses = 0;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+        const u32 begin = hardBoundaries[h];
+        const u32 end = hardBoundaries[h + 1];
+        u32 hardMisses = 0;
+        for (u32 t = begin; t < end; t++) {
+            hardMisses += triangleMisses[t];
+        }
+        const f32 limit = (f32)hardMisses / (f32)(end - begin) * threshold;
+
+        clusterStarts.push_back(begin);
+        u32 clusterStart = begin;
+        u32 clusterMisses = 0;
+        // Everything cached so far counts as evicted
+        misses += ACMR_CACHE_SIZE;
+        for (u32 t = begin; t + 1 < end; t++) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 index = indices[t * 3 + k];
+                if (missedAt[index] == 0 || misses - missedAt[index] >= ACMR_CACHE_SIZE) {
+                    misses++;
+                    missedAt[index] = misses;
+                    clusterMisses++;
+                }
+            }
+            if ((f32)clusterMisses / (f32)(t + 1 - clusterStart) <= limit) {
+                clusterStarts.push_back(t + 1);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                misses += ACMR_CACHE_SIZE;
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    const u32 clusterCount = (u32)clusterStarts.size() - 1;
+
+    // Area weighted mesh centroid
+    glm::vec3 meshCentroid(0.0f);
+    f32 meshArea = 0.0f;
+    for (u32 t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = positions[indices[t * 3]];
+        const glm::vec3& b = positions[indices[t * 3 + 1]];
+        const glm::vec3& c = positions[indices[t * 3 + 2]];
+        f32 area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Clusters facing away from the center are occluders from most viewpoints, draw them first
+    std::vector<f32> sortKey(clusterCount);
+    for (u32 cluster = 0; cluster < clusterCount; cluster++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        f32 area = 0.0f;
+        for (u32 t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++) {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& c = positions[indices[t * 3 + 2]];
+            glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+            f32 triangleArea = glm::length(triangleNormal);
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        centroid = area > 0.0f ? centroid / area : centroid;
+        f32 normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : normal;
+        sortKey[cluster] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<u32> order(clusterCount);
+    for (u32 cluster = 0; cluster < clusterCount; cluster++) {
+        order[cluster] = cluster;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<u32> result;
+    result.reserve(indices.size());
+    for (u32 cluster : order) {
+        result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+    indices = std::move(result);
+}
+
+void optimizeVertexFetch(SourceMesh& mesh)
+{
+    static constexpr u32 UNUSED = ~0u;
+    const u32 vertexCount = (u32)mesh.positions.size();
+    std::vector<u32> remap(vertexCount, UNUSED);
+    u32 next = 0;
+    for (u32& index : mesh.indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    auto reorder = [&](auto& attribute) {
+        if (attribute.empty()) {
+            return;
+        }
+        std::remove_reference_t<decltype(attribute)> reordered(next);
+        for (u32 v = 0; v < vertexCount; v++) {
+            if (remap[v] != UNUSED) {
+                reordered[remap[v]] = attribute[v];
+            }
+        }
+        attribute = std::move(reordered);
+    };
+    reorder(mesh.positions);
+    reorder(mesh.normals);
+    reorder(mesh.colors);
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef VKP_COOKER_MESHOPTIMIZER
+#define VKP_COOKER_MESHOPTIMIZER
+
+#include "Cooker/SourceMesh.hpp"
+
+namespace VulkanProj {
+
+// FIFO size the post-transform cache is modelled with when reporting ACMR
+static constexpr u32 ACMR_CACHE_SIZE = 16;
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO cache of
+// `cacheSize`. 0.5 is the ideal for a large regular grid, 3 means no reuse at all
+f32 computeAcmr(const std::vector<u32>& indices, u32 vertexCount, u32 cacheSize = ACMR_CACHE_SIZE);
+
+// Reorders triangles for post-transform cache reuse. Forsyth's linear-speed greedy
+// optimizer, tuned for no particular cache size
+void optimizeVertexCache(std::vector<u32>& indices, u32 vertexCount);
+
+// Reorders triangles to draw outward facing parts first, so later fragments fail the depth
+// test from most viewpoints (Sander et al., "Fast triangle reordering for vertex locality and
+// reduced overdraw"). Expects cache optimized input and splits it into clusters whose ACMR
+// stays within `threshold` of the whole mesh, so cache efficiency is mostly kept
+void optimizeOverdraw(std::vector<u32>& indices, const std::vector<glm::vec3>& positions, f32 threshold = 1.05f);
+
+// Renumbers vertices in order of first use and drops unreferenced ones, so the vertex fetch
+// walks memory forward. Call after the triangle order is final
+void optimizeVertexFetch(SourceMesh& mesh);
+
+}
+
+#endif
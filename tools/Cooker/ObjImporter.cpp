@@ -0,0 +1,205 @@
+#include "Cooker/ObjImporter.hpp"
+#include "Core/MappedFile.hpp"
+
+#include <charconv>
+
+namespace VulkanProj {
+
+// Cursor over the mapped file. Never reads past `end`, the mapping is not null terminated
+struct ObjReader {
+    const char* cursor;
+    const char* end;
+
+    void skipSpaces()
+    {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+            cursor++;
+        }
+    }
+
+    void skipLine()
+    {
+        while (cursor < end && *cursor != '\n') {
+            cursor++;
+        }
+        if (cursor < end) {
+            cursor++;
+        }
+    }
+
+    bool atLineEnd() const { return cursor >= end || *cursor == '\n' || *cursor == '#'; }
+
+    std::string_view token()
+    {
+        skipSpaces();
+        const char* start = cursor;
+        while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n') {
+            cursor++;
+        }
+        return std::string_view(start, cursor - start);
+    }
+
+    // The rest of the line with surrounding whitespace removed
+    std::string_view rest()
+    {
+        skipSpaces();
+        const char* start = cursor;
+        while (cursor < end && *cursor != '\n' && *cursor != '#') {
+            cursor++;
+        }
+        const char* last = cursor;
+        while (last > start && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) {
+            last--;
+        }
+        return std::string_view(start, last - start);
+    }
+
+    bool readFloat(f32& value)
+    {
+        skipSpaces();
+        // from_chars rejects a leading '+', OBJ exporters occasionally write one
+        if (cursor < end && *cursor == '+') {
+            cursor++;
+        }
+        auto result = std::from_chars(cursor, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        cursor = result.ptr;
+        return true;
+    }
+};
+
+// 1-based, negative counts back from the latest element. INVALID_REFERENCE when out of range
+static constexpr u32 INVALID_REFERENCE = ~0u;
+
+static u32 resolveReference(std::string_view text, size_t count)
+{
+    i64 value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || value == 0) {
+        return INVALID_REFERENCE;
+    }
+    i64 index = value > 0 ? value - 1 : (i64)count + value;
+    return index >= 0 && index < (i64)count ? (u32)index : INVALID_REFERENCE;
+}
+
+bool importObj(const std::string& path, std::vector<SourceMesh>& meshes)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        VKP_ERROR("Failed to open {}", path);
+        return false;
+    }
+
+    const std::string stem = std::filesystem::path(path).stem().string();
+    const size_t firstMesh = meshes.size();
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<glm::vec3> normals;
+    bool hasColors = false;
+
+    SourceMesh mesh;
+    mesh.name = stem;
+    // (position, normal + 1) -> mesh vertex, OBJ indexes attributes separately
+    UMap<u64, u32> vertexMap;
+    bool meshHasNormals = true;
+    std::vector<u32> polygon;
+    u32 lineNumber = 0;
+
+    auto finishMesh = [&]() {
+        if (!mesh.indices.empty()) {
+            if (!meshHasNormals) {
+                mesh.normals.clear();
+            }
+            if (!hasColors) {
+                mesh.colors.clear();
+            }
+            meshes.push_back(std::move(mesh));
+        }
+        mesh = SourceMesh();
+        vertexMap.clear();
+        meshHasNormals = true;
+    };
+
+    ObjReader reader { reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size() };
+    while (reader.cursor < reader.end) {
+        lineNumber++;
+        std::string_view keyword = reader.token();
+
+        if (keyword == "v") {
+            glm::vec3 position;
+            if (!reader.readFloat(position.x) || !reader.readFloat(position.y) || !reader.readFloat(position.z)) {
+                VKP_ERROR("{}:{}: malformed vertex", path, lineNumber);
+                return false;
+            }
+            glm::vec3 color(1.0f);
+            reader.skipSpaces();
+            if (!reader.atLineEnd()) {
+                if (!reader.readFloat(color.r) || !reader.readFloat(color.g) || !reader.readFloat(color.b)) {
+                    VKP_ERROR("{}:{}: malformed vertex color", path, lineNumber);
+                    return false;
+                }
+                hasColors = true;
+            }
+            positions.push_back(position);
+            colors.push_back(color);
+        } else if (keyword == "vn") {
+            glm::vec3 normal;
+            if (!reader.readFloat(normal.x) || !reader.readFloat(normal.y) || !reader.readFloat(normal.z)) {
+                VKP_ERROR("{}:{}: malformed normal", path, lineNumber);
+                return false;
+            }
+            normals.push_back(normal);
+        } else if (keyword == "f") {
+            polygon.clear();
+            for (std::string_view corner = reader.token(); !corner.empty(); corner = reader.token()) {
+                // v, v/vt, v//vn or v/vt/vn
+                size_t firstSlash = corner.find('/');
+                size_t secondSlash = firstSlash == std::string_view::npos ? std::string_view::npos : corner.find('/', firstSlash + 1);
+                u32 position = resolveReference(corner.substr(0, firstSlash), positions.size());
+                u32 normal = INVALID_REFERENCE;
+                if (secondSlash != std::string_view::npos) {
+                    normal = resolveReference(corner.substr(secondSlash + 1), normals.size());
+                    if (normal == INVALID_REFERENCE) {
+                        VKP_ERROR("{}:{}: face references a missing normal", path, lineNumber);
+                        return false;
+                    }
+                }
+                if (position == INVALID_REFERENCE) {
+                    VKP_ERROR("{}:{}: face references a missing vertex", path, lineNumber);
+                    return false;
+                }
+                meshHasNormals &= normal != INVALID_REFERENCE;
+
+                u64 key = ((u64)position << 32) | (u32)(normal + 1);
+                auto [it, inserted] = vertexMap.try_emplace(key, (u32)mesh.positions.size());
+                if (inserted) {
+                    mesh.positions.push_back(positions[position]);
+                    mesh.colors.push_back(glm::vec4(colors[position], 1.0f));
+                    mesh.normals.push_back(normal != INVALID_REFERENCE ? normals[normal] : glm::vec3(0.0f));
+                }
+                polygon.push_back(it->second);
+            }
+            for (size_t i = 2; i < polygon.size(); i++) {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i - 1]);
+                mesh.indices.push_back(polygon[i]);
+            }
+        } else if (keyword == "o" || keyword == "g") {
+            std::string_view name = reader.rest();
+            finishMesh();
+            mesh.name = name.empty() ? stem : stem + ":" + std::string(name);
+        }
+        reader.skipLine();
+    }
+    finishMesh();
+
+    if (meshes.size() == firstMesh) {
+        VKP_ERROR("{} has no faces", path);
+        return false;
+    }
+    return true;
+}
+
+}
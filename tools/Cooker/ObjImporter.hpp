@@ -0,0 +1,15 @@
+#ifndef VKP_COOKER_OBJIMPORTER
+#define VKP_COOKER_OBJIMPORTER
+
+#include "Cooker/SourceMesh.hpp"
+
+namespace VulkanProj {
+
+// Wavefront OBJ. Every `o`/`g` starts a new mesh, polygons are fan triangulated and the
+// common "v x y z r g b" vertex color extension is read. Texture coordinates and materials
+// are ignored. Logs why and returns false on failure
+bool importObj(const std::string& path, std::vector<SourceMesh>& meshes);
+
+}
+
+#endif
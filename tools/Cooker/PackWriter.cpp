@@ -0,0 +1,99 @@
+#include "Cooker/PackWriter.hpp"
+
+#include <cstring>
+
+namespace VulkanProj {
+
+static u64 alignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+u64 writeMeshPack(const std::string& path, const std::vector<CookedMesh>& meshes)
+{
+    MeshPackHeader header {};
+    header.magic = MESH_PACK_MAGIC;
+    header.version = MESH_PACK_VERSION;
+    header.meshCount = (u32)meshes.size();
+    header.vertexStride = sizeof(PackedVertex);
+
+    std::vector<MeshPackEntry> entries(meshes.size());
+    u64 vertexCount = 0;
+    u64 indexCount = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const CookedMesh& mesh = meshes[i];
+        MeshPackEntry& entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        if (mesh.name.size() >= MESH_PACK_NAME_SIZE) {
+            VKP_WARN("Mesh name '{}' is cut to {} characters", mesh.name, MESH_PACK_NAME_SIZE - 1);
+        }
+        memcpy(entry.name, mesh.name.data(), std::min<size_t>(mesh.name.size(), MESH_PACK_NAME_SIZE - 1));
+        entry.firstVertex = (u32)vertexCount;
+        entry.vertexCount = (u32)mesh.vertices.size();
+        entry.firstIndex = (u32)indexCount;
+        entry.indexCount = (u32)mesh.indices.size();
+        for (u32 c = 0; c < 3; c++) {
+            entry.positionOffset[c] = mesh.quantization.offset[c];
+            entry.positionScale[c] = mesh.quantization.scale[c];
+        }
+        for (u32 c = 0; c < 4; c++) {
+            entry.boundingSphere[c] = mesh.boundingSphere[c];
+        }
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
+    if (vertexCount > std::numeric_limits<u32>::max() || indexCount > std::numeric_limits<u32>::max()) {
+        VKP_ERROR("{} would hold {} vertices and {} indices, a pack is limited to 2^32 of each", path, vertexCount, indexCount);
+        return 0;
+    }
+
+    header.meshTableOffset = sizeof(MeshPackHeader);
+    header.vertexDataOffset = alignUp(header.meshTableOffset + entries.size() * sizeof(MeshPackEntry), MESH_PACK_ALIGNMENT);
+    header.vertexDataSize = vertexCount * sizeof(PackedVertex);
+    header.indexDataOffset = alignUp(header.vertexDataOffset + header.vertexDataSize, MESH_PACK_ALIGNMENT);
+    header.indexDataSize = indexCount * sizeof(u32);
+    const u64 fileSize = header.indexDataOffset + header.indexDataSize;
+
+    const std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        VKP_ERROR("Failed to create {}", temporary);
+        return 0;
+    }
+
+    auto padTo = [&](u64 offset) {
+        static const std::array<char, 4096> zeros {};
+        for (u64 position = (u64)out.tellp(); position < offset;) {
+            u64 count = std::min<u64>(offset - position, zeros.size());
+            out.write(zeros.data(), (std::streamsize)count);
+            position += count;
+        }
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), (std::streamsize)(entries.size() * sizeof(MeshPackEntry)));
+    padTo(header.vertexDataOffset);
+    for (const CookedMesh& mesh : meshes) {
+        out.write(reinterpret_cast<const char*>(mesh.vertices.data()), (std::streamsize)(mesh.vertices.size() * sizeof(PackedVertex)));
+    }
+    padTo(header.indexDataOffset);
+    for (const CookedMesh& mesh : meshes) {
+        out.write(reinterpret_cast<const char*>(mesh.indices.data()), (std::streamsize)(mesh.indices.size() * sizeof(u32)));
+    }
+    out.close();
+
+    std::error_code error;
+    bool written = !out.fail();
+    if (written) {
+        std::filesystem::rename(temporary, path, error);
+        written = !error;
+    }
+    if (!written) {
+        VKP_ERROR("Failed to write {}{}", path, error ? ": " + error.message() : std::string());
+        std::filesystem::remove(temporary, error);
+        return 0;
+    }
+    return fileSize;
+}
+
+}
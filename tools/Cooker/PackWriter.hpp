@@ -0,0 +1,24 @@
+#ifndef VKP_COOKER_PACKWRITER
+#define VKP_COOKER_PACKWRITER
+
+#include "Renderer/MeshFormat.hpp"
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// A mesh in its final GPU form, ready to be written into a pack
+struct CookedMesh {
+    std::string name;
+    std::vector<PackedVertex> vertices;
+    std::vector<u32> indices;
+    MeshQuantization quantization;
+    glm::vec4 boundingSphere { 0.0f };
+};
+
+// Writes a .vkpm pack (Renderer/MeshFormat.hpp). Goes through a temporary file that is renamed
+// into place, so a failed cook never leaves a truncated pack behind. Returns the pack size, 0 on failure
+u64 writeMeshPack(const std::string& path, const std::vector<CookedMesh>& meshes);
+
+}
+
+#endif
@@ -0,0 +1,44 @@
+#include "Cooker/SourceMesh.hpp"
+
+namespace VulkanProj {
+
+void generateNormals(SourceMesh& mesh)
+{
+    mesh.normals.assign(mesh.positions.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        u32 a = mesh.indices[i];
+        u32 b = mesh.indices[i + 1];
+        u32 c = mesh.indices[i + 2];
+        // Unnormalized, so larger triangles weigh more
+        glm::vec3 normal = glm::cross(mesh.positions[b] - mesh.positions[a], mesh.positions[c] - mesh.positions[a]);
+        mesh.normals[a] += normal;
+        mesh.normals[b] += normal;
+        mesh.normals[c] += normal;
+    }
+    for (glm::vec3& normal : mesh.normals) {
+        f32 length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+}
+
+u32 removeInvalidTriangles(SourceMesh& mesh)
+{
+    const u32 vertexCount = (u32)mesh.positions.size();
+    size_t kept = 0;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        u32 a = mesh.indices[i];
+        u32 b = mesh.indices[i + 1];
+        u32 c = mesh.indices[i + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c) {
+            continue;
+        }
+        mesh.indices[kept++] = a;
+        mesh.indices[kept++] = b;
+        mesh.indices[kept++] = c;
+    }
+    u32 dropped = (u32)(mesh.indices.size() / 3 - kept / 3);
+    mesh.indices.resize(kept);
+    return dropped;
+}
+
+}
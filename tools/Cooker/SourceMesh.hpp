@@ -0,0 +1,27 @@
+#ifndef VKP_COOKER_SOURCEMESH
+#define VKP_COOKER_SOURCEMESH
+
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// Full precision triangle list as an importer produces it, one vertex per unique attribute set
+struct SourceMesh {
+    std::string name;
+    std::vector<glm::vec3> positions;
+    // Empty when the source has none, generateNormals fills them in
+    std::vector<glm::vec3> normals;
+    // Empty means white
+    std::vector<glm::vec4> colors;
+    std::vector<u32> indices;
+};
+
+// Area weighted vertex normals. Only vertices that share an index share a normal
+void generateNormals(SourceMesh& mesh);
+
+// Drops degenerate triangles and indices past the vertex count. Returns how many were dropped
+u32 removeInvalidTriangles(SourceMesh& mesh);
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "Cooker/GltfImporter.hpp"
+#include "Cooker/MeshOptimizer.hpp"
+#include "Cooker/ObjImporter.hpp"
+#include "Cooker/PackWriter.hpp"
+#include "Core/JobSystem.hpp"
+#include "core.hpp"
+
+#include <chrono>
+
+// Offline mesh cooker: imports OBJ/glTF files in parallel, optimizes the triangle and vertex
+// order, quantizes to PackedVertex and writes one .vkpm pack for `VulkanProject --mesh`
+
+struct CookerOptions {
+    std::string outputPath;
+    std::vector<std::string> inputs;
+    u32 threads = 0;
+    bool optimize = true;
+};
+
+struct CookStats {
+    u32 droppedTriangles = 0;
+    f32 acmrBefore = 0.0f;
+    f32 acmrAfter = 0.0f;
+};
+
+static void printUsage()
+{
+    VKP_INFO("Usage: VulkanCooker -o <pack.vkpm> [--threads N] [--no-optimize] <mesh.obj|mesh.gltf|mesh.glb>...");
+}
+
+static bool parseArgs(int argc, char** argv, CookerOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ((arg == "-o" || arg == "--output") && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--no-optimize") {
+            options.optimize = false;
+        } else if (!arg.empty() && arg[0] == '-') {
+            VKP_ERROR("Unknown argument '{}'", arg);
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.outputPath.empty() && !options.inputs.empty();
+}
+
+static bool importFile(const std::string& path, std::vector<VulkanProj::SourceMesh>& meshes)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (extension == ".obj") {
+        return VulkanProj::importObj(path, meshes);
+    }
+    if (extension == ".gltf" || extension == ".glb") {
+        return VulkanProj::importGltf(path, meshes);
+    }
+    VKP_ERROR("{}: unsupported format, expected .obj, .gltf or .glb", path);
+    return false;
+}
+
+static void cookMesh(VulkanProj::SourceMesh& source, bool optimize, VulkanProj::CookedMesh& cooked, CookStats& stats)
+{
+    using namespace VulkanProj;
+
+    stats.droppedTriangles = removeInvalidTriangles(source);
+    if (source.normals.empty()) {
+        generateNormals(source);
+    }
+
+    const u32 vertexCount = (u32)source.positions.size();
+    stats.acmrBefore = computeAcmr(source.indices, vertexCount);
+    if (optimize) {
+        optimizeVertexCache(source.indices, vertexCount);
+        optimizeOverdraw(source.indices, source.positions);
+    }
+    // Also drops vertices no triangle uses, so it runs without --optimize too
+    optimizeVertexFetch(source);
+    stats.acmrAfter = computeAcmr(source.indices, (u32)source.positions.size());
+
+    glm::vec3 minimum(std::numeric_limits<f32>::max());
+    glm::vec3 maximum(std::numeric_limits<f32>::lowest());
+    for (const glm::vec3& position : source.positions) {
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    cooked.name = source.name;
+    cooked.quantization = computeQuantization(minimum, maximum);
+    cooked.boundingSphere = computeBoundingSphere(source.positions.data(), source.positions.size());
+    cooked.vertices.resize(source.positions.size());
+    for (size_t v = 0; v < source.positions.size(); v++) {
+        glm::vec4 color = source.colors.empty() ? glm::vec4(1.0f) : source.colors[v];
+        cooked.vertices[v] = packVertex(source.positions[v], source.normals[v], color, cooked.quantization);
+    }
+    cooked.indices = std::move(source.indices);
+}
+
+static int cook(const CookerOptions& options)
+{
+    using namespace VulkanProj;
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+
+    // One job per file, files are independent until the pack is written
+    std::vector<std::vector<SourceMesh>> imported(options.inputs.size());
+    std::vector<u8> importOk(options.inputs.size(), 0);
+    JobSystem::parallelFor((u32)options.inputs.size(), 1, [&](u32 first, u32 count) {
+        for (u32 i = first; i < first + count; i++) {
+            importOk[i] = importFile(options.inputs[i], imported[i]);
+        }
+    });
+    if (std::find(importOk.begin(), importOk.end(), 0) != importOk.end()) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<SourceMesh> sources;
+    for (std::vector<SourceMesh>& meshes : imported) {
+        for (SourceMesh& mesh : meshes) {
+            sources.push_back(std::move(mesh));
+        }
+    }
+    const Clock::time_point importedAt = Clock::now();
+
+    std::vector<CookedMesh> cooked(sources.size());
+    std::vector<CookStats> stats(sources.size());
+    JobSystem::parallelFor((u32)sources.size(), 1, [&](u32 first, u32 count) {
+        for (u32 i = first; i < first + count; i++) {
+            cookMesh(sources[i], options.optimize, cooked[i], stats[i]);
+        }
+    });
+
+    u64 vertexCount = 0;
+    u64 triangleCount = 0;
+    for (size_t i = 0; i < cooked.size(); i++) {
+        const CookedMesh& mesh = cooked[i];
+        if (mesh.indices.empty()) {
+            VKP_WARN("Skipping '{}', it has no valid triangles", mesh.name);
+            continue;
+        }
+        if (stats[i].droppedTriangles > 0) {
+            VKP_WARN("'{}': dropped {} degenerate or out of range triangles", mesh.name, stats[i].droppedTriangles);
+        }
+        VKP_INFO("'{}': {} vertices, {} triangles, ACMR {:.3f} -> {:.3f}", mesh.name, mesh.vertices.size(), mesh.indices.size() / 3,
+            stats[i].acmrBefore, stats[i].acmrAfter);
+        vertexCount += mesh.vertices.size();
+        triangleCount += mesh.indices.size() / 3;
+    }
+    cooked.erase(std::remove_if(cooked.begin(), cooked.end(), [](const CookedMesh& mesh) { return mesh.indices.empty(); }), cooked.end());
+    if (cooked.empty()) {
+        VKP_ERROR("Nothing to write");
+        return EXIT_FAILURE;
+    }
+    const Clock::time_point cookedAt = Clock::now();
+
+    u64 packSize = writeMeshPack(options.outputPath, cooked);
+    if (packSize == 0) {
+        return EXIT_FAILURE;
+    }
+    const Clock::time_point end = Clock::now();
+
+    auto ms = [](Clock::duration duration) { return std::chrono::duration<f64, std::milli>(duration).count(); };
+    // Position, normal and color as floats, what the runtime would otherwise upload
+    const u64 floatVertexBytes = vertexCount * sizeof(f32) * 10;
+    VKP_INFO("Wrote {}: {} meshes, {} vertices, {} triangles, {:.2f} MiB (vertices {:.2f} MiB vs {:.2f} MiB as floats)", options.outputPath,
+        cooked.size(), vertexCount, triangleCount, packSize / (1024.0 * 1024.0), vertexCount * sizeof(PackedVertex) / (1024.0 * 1024.0),
+        floatVertexBytes / (1024.0 * 1024.0));
+    VKP_INFO("Import {:.1f}ms, optimize {:.1f}ms, write {:.1f}ms on {} threads", ms(importedAt - start), ms(cookedAt - importedAt),
+        ms(end - cookedAt), JobSystem::getThreadCount());
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    VulkanProj::Log::Init();
+
+    CookerOptions options;
+    bool valid = false;
+    try {
+        valid = parseArgs(argc, argv, options);
+    } catch (const std::exception& e) {
+        VKP_ERROR("Invalid arguments: {}", e.what());
+    }
+    if (!valid) {
+        printUsage();
+        VulkanProj::Log::Shutdown();
+        return EXIT_FAILURE;
+    }
+
+    VulkanProj::JobSystem::init(options.threads);
+    int result = cook(options);
+    VulkanProj::JobSystem::shutdown();
+    VulkanProj::Log::Shutdown();
+    return result;
+}
@@ -0,0 +1,328 @@
+#include "CpuBench/Benchmarks.hpp"
+#include "Renderer/BindlessTable.hpp"
+#include "Renderer/BuddyAllocator.hpp"
+#include "Renderer/DescriptorAllocator.hpp"
+#include "Renderer/DeviceAllocator.hpp"
+
+#include <bit>
+#include <random>
+
+namespace VulkanProj {
+
+static constexpr u64 MAX_SETS_PER_SAMPLE = 16384;
+static constexpr u64 MAX_WRITES_PER_SAMPLE = 4096;
+static constexpr u32 BINDLESS_BUFFERS = 4096;
+static constexpr u64 MAX_ALLOCATIONS_PER_SAMPLE = 4096;
+// vkAllocateMemory for comparison. Drivers cap live allocations (maxMemoryAllocationCount may be
+// as low as 4096), stay well below
+static constexpr u64 MAX_RAW_ALLOCATIONS_PER_SAMPLE = 256;
+// Defragmentation fragments two blocks of these, every other one freed
+static constexpr VkDeviceSize DEFRAG_BUFFER_SIZE = 1024 * 1024;
+static constexpr u32 TEST_BINDINGS = 3;
+// Sizes and free order come from a fixed seed, every run sees the same sequence
+static constexpr u32 SEED = 1234;
+
+struct AllocationState {
+    DeviceAllocator allocator;
+    DescriptorLayoutCache layouts;
+    DescriptorAllocator descriptors;
+    // Sets the write benchmark targets, allocated once and never reset
+    DescriptorAllocator writeTargets;
+    DescriptorWriter writer;
+    BindlessTable bindless;
+    BuddyAllocator buddy;
+
+    std::array<VkDescriptorSetLayoutBinding, TEST_BINDINGS> bindings;
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> sets;
+    Allocation* buffer = nullptr;
+    VkMemoryRequirements requirements {};
+    u32 memoryType = 0;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+    std::vector<u64> sizes;
+    std::vector<u32> freeOrder;
+    std::vector<u64> offsets;
+    std::vector<Allocation*> allocations;
+    std::vector<VkDeviceMemory> memories;
+    std::vector<u32> indices;
+};
+
+static void createAllocationState(AllocationState& state, const BenchDevice& device)
+{
+    state.allocator.init(device.physicalDevice, device.device);
+    state.layouts.init(device.device);
+    state.descriptors.init(device.device, 1);
+    state.writeTargets.init(device.device, 1);
+    state.bindless.init(device.physicalDevice, device.device, state.layouts, 1, BINDLESS_BUFFERS, 1);
+    state.buddy = BuddyAllocator(1ull << 30, 256);
+
+    // Three storage buffers, like a compute pass's transient set
+    for (u32 i = 0; i < TEST_BINDINGS; i++) {
+        state.bindings[i] = {};
+        state.bindings[i].binding = i;
+        state.bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        state.bindings[i].descriptorCount = 1;
+        state.bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    state.layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    state.layoutInfo.bindingCount = TEST_BINDINGS;
+    state.layoutInfo.pBindings = state.bindings.data();
+    state.setLayout = state.layouts.get(state.layoutInfo);
+
+    state.writeTargets.beginFrame(0);
+    state.sets.resize(MAX_WRITES_PER_SAMPLE);
+    for (VkDescriptorSet& set : state.sets) {
+        set = state.writeTargets.allocate(state.setLayout);
+    }
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = 4096;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    state.buffer = state.allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // Memory type bits from a real buffer, so requests look like what the driver returns
+    vkGetBufferMemoryRequirements(device.device, state.buffer->buffer, &state.requirements);
+    state.memoryType = (u32)std::countr_zero(state.requirements.memoryTypeBits);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = device.queues.graphicsFamily;
+    vkCreateCommandPool(device.device, &poolInfo, nullptr, &state.commandPool);
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = state.commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(device.device, &allocInfo, &state.commandBuffer);
+
+    std::mt19937 rng(SEED);
+    state.sizes.resize(MAX_ALLOCATIONS_PER_SAMPLE);
+    for (u64& size : state.sizes) {
+        size = 256 + rng() % 65536;
+    }
+    state.freeOrder.resize(MAX_ALLOCATIONS_PER_SAMPLE);
+    for (u32 i = 0; i < state.freeOrder.size(); i++) {
+        state.freeOrder[i] = i;
+    }
+    std::shuffle(state.freeOrder.begin(), state.freeOrder.end(), rng);
+    state.offsets.resize(MAX_ALLOCATIONS_PER_SAMPLE);
+    state.allocations.resize(MAX_ALLOCATIONS_PER_SAMPLE);
+    state.memories.resize(MAX_RAW_ALLOCATIONS_PER_SAMPLE);
+    state.indices.resize(BINDLESS_BUFFERS);
+}
+
+static void destroyAllocationState(AllocationState& state, VkDevice device)
+{
+    vkDestroyCommandPool(device, state.commandPool, nullptr);
+    state.allocator.destroyBuffer(state.buffer);
+    state.bindless.destroy();
+    state.writeTargets.destroy();
+    state.descriptors.destroy();
+    state.layouts.destroy();
+    state.allocator.destroy();
+}
+
+static f64 allocateSets(AllocationState& state, u64 count)
+{
+    state.descriptors.beginFrame(0);
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        state.descriptors.allocate(state.setLayout);
+    }
+    return timer.elapsedMs();
+}
+
+// Every binding of every set, one vkUpdateDescriptorSets for all of them
+static f64 writeSets(AllocationState& state, VkDevice device, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        for (u32 binding = 0; binding < TEST_BINDINGS; binding++) {
+            state.writer.writeBuffer(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.buffer->buffer, 0, 256);
+        }
+        state.writer.stage(state.sets[i]);
+    }
+    state.writer.flush(device);
+    return timer.elapsedMs();
+}
+
+// The writes of writeSets, one vkUpdateDescriptorSets per set
+static f64 updateSets(AllocationState& state, VkDevice device, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        for (u32 binding = 0; binding < TEST_BINDINGS; binding++) {
+            state.writer.writeBuffer(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, state.buffer->buffer, 0, 256);
+        }
+        state.writer.update(device, state.sets[i]);
+    }
+    return timer.elapsedMs();
+}
+
+static f64 lookupLayouts(AllocationState& state, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        state.layouts.get(state.layoutInfo);
+    }
+    return timer.elapsedMs();
+}
+
+// What a layout cache hit saves
+static f64 createLayouts(AllocationState& state, VkDevice device, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        VkDescriptorSetLayout layout;
+        vkCreateDescriptorSetLayout(device, &state.layoutInfo, nullptr, &layout);
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+    return timer.elapsedMs();
+}
+
+// One operation is a register and its release
+static f64 registerBindless(AllocationState& state, u64 count)
+{
+    // Takes back the indices released by the previous sample
+    state.bindless.beginFrame(0);
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        state.indices[i] = state.bindless.registerBuffer(state.buffer->buffer, 0, 256);
+    }
+    for (u64 i = 0; i < count; i++) {
+        state.bindless.releaseBuffer(state.indices[i]);
+    }
+    return timer.elapsedMs();
+}
+
+// One operation is an allocation and its free, freed in a shuffled order. Calibration usually
+// ends at the cap, smaller samples skip the indices they did not allocate
+static f64 allocateBuddy(AllocationState& state, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        state.offsets[i] = state.buddy.allocate(state.sizes[i], 256);
+    }
+    for (u32 index : state.freeOrder) {
+        if (index < count && state.offsets[index] != BuddyAllocator::INVALID_OFFSET) {
+            state.buddy.free(state.offsets[index]);
+        }
+    }
+    return timer.elapsedMs();
+}
+
+static f64 allocateDeviceMemory(AllocationState& state, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        VkMemoryRequirements requirements = state.requirements;
+        requirements.size = state.sizes[i];
+        state.allocations[i] = state.allocator.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Linear);
+    }
+    for (u32 index : state.freeOrder) {
+        if (index < count) {
+            state.allocator.free(state.allocations[index]);
+        }
+    }
+    return timer.elapsedMs();
+}
+
+// The sizes allocateDeviceMemory suballocates, straight from the driver
+static f64 allocateRawMemory(AllocationState& state, VkDevice device, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        VkMemoryAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = state.sizes[i];
+        allocInfo.memoryTypeIndex = state.memoryType;
+        vkAllocateMemory(device, &allocInfo, nullptr, &state.memories[i]);
+    }
+    for (u64 i = 0; i < count; i++) {
+        vkFreeMemory(device, state.memories[i], nullptr);
+    }
+    return timer.elapsedMs();
+}
+
+// One operation is recording the moves that compact two half-empty blocks. A fresh allocator is
+// fragmented per pass, and the copies run and are committed outside the timer
+static f64 defragment(AllocationState& state, const BenchDevice& device, u64 count)
+{
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = DEFRAG_BUFFER_SIZE;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    f64 ms = 0.0;
+    for (u64 pass = 0; pass < count; pass++) {
+        DeviceAllocator allocator;
+        allocator.init(device.physicalDevice, device.device);
+        std::vector<Allocation*> buffers((allocator.getBlockSize() / DEFRAG_BUFFER_SIZE) * 2);
+        for (Allocation*& buffer : buffers) {
+            buffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        for (size_t i = 0; i < buffers.size(); i += 2) {
+            allocator.destroyBuffer(buffers[i]);
+            buffers[i] = nullptr;
+        }
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(state.commandBuffer, &beginInfo);
+        BenchTimer timer;
+        allocator.beginDefragmentation(state.commandBuffer, ~0ull);
+        ms += timer.elapsedMs();
+        vkEndCommandBuffer(state.commandBuffer);
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &state.commandBuffer;
+        vkQueueSubmit(device.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(device.graphicsQueue);
+        allocator.endDefragmentation();
+
+        for (Allocation* buffer : buffers) {
+            if (buffer != nullptr) {
+                allocator.destroyBuffer(buffer);
+            }
+        }
+        allocator.destroy();
+    }
+    return ms;
+}
+
+void addAllocationBenchmarks(BenchSuite& suite, const BenchDevice& device)
+{
+    Ref<AllocationState> state = CreateRef<AllocationState>();
+    createAllocationState(*state, device);
+    VkDevice vkDevice = device.device;
+    suite.addCleanup([state, vkDevice]() { destroyAllocationState(*state, vkDevice); });
+
+    suite.add("descriptors/allocate transient set", [state](u64 iterations) { return allocateSets(*state, iterations); }, MAX_SETS_PER_SAMPLE);
+    suite.add("descriptors/write set, batched", [state, vkDevice](u64 iterations) { return writeSets(*state, vkDevice, iterations); },
+        MAX_WRITES_PER_SAMPLE);
+    suite.add("descriptors/write set, per set", [state, vkDevice](u64 iterations) { return updateSets(*state, vkDevice, iterations); },
+        MAX_WRITES_PER_SAMPLE);
+    suite.add("descriptors/layout cache hit", [state](u64 iterations) { return lookupLayouts(*state, iterations); });
+    suite.add("descriptors/layout create+destroy", [state, vkDevice](u64 iterations) { return createLayouts(*state, vkDevice, iterations); });
+    suite.add("descriptors/bindless register+release", [state](u64 iterations) { return registerBindless(*state, iterations); },
+        BINDLESS_BUFFERS);
+    suite.add("memory/buddy allocate+free", [state](u64 iterations) { return allocateBuddy(*state, iterations); }, MAX_ALLOCATIONS_PER_SAMPLE);
+    suite.add("memory/device allocate+free", [state](u64 iterations) { return allocateDeviceMemory(*state, iterations); },
+        MAX_ALLOCATIONS_PER_SAMPLE);
+    suite.add("memory/vkAllocateMemory+vkFreeMemory", [state, vkDevice](u64 iterations) { return allocateRawMemory(*state, vkDevice, iterations); },
+        MAX_RAW_ALLOCATIONS_PER_SAMPLE);
+    // A pass builds and fills two blocks outside the timer, one per sample is plenty
+    suite.add("memory/defragment two blocks", [state, &device](u64 iterations) { return defragment(*state, device, iterations); }, 1);
+}
+
+}
@@ -0,0 +1,145 @@
+#include "CpuBench/BenchDevice.hpp"
+#include "Profiler/ResourceTracker.hpp"
+
+#include <cstring>
+
+namespace VulkanProj {
+
+static bool hasInstanceExtension(const char* name)
+{
+    u32 count = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateInstanceExtensionProperties(nullptr, &count, extensions.data());
+    for (const VkExtensionProperties& extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BenchDevice::init(const std::string& preferredDevice)
+{
+    const bool headlessSurface = hasInstanceExtension(VK_KHR_SURFACE_EXTENSION_NAME) && hasInstanceExtension(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    std::vector<const char*> instanceExtensions;
+    if (headlessSurface) {
+        instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        instanceExtensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    }
+
+    VkApplicationInfo appInfo {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "VulkanBench";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    // No validation layers, they would dominate every number measured here
+    VkInstanceCreateInfo instanceInfo {};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledExtensionCount = (u32)instanceExtensions.size();
+    instanceInfo.ppEnabledExtensionNames = instanceExtensions.data();
+    if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+        VKP_ERROR("Unable to create a Vulkan instance");
+        return false;
+    }
+
+    if (headlessSurface) {
+        auto createHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+        VkHeadlessSurfaceCreateInfoEXT surfaceInfo {};
+        surfaceInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+        if (createHeadlessSurface == nullptr || createHeadlessSurface(instance, &surfaceInfo, nullptr, &surface) != VK_SUCCESS) {
+            surface = VK_NULL_HANDLE;
+        }
+    }
+    if (surface == VK_NULL_HANDLE) {
+        VKP_WARN("No VK_EXT_headless_surface, the swapchain query benchmarks are skipped");
+    }
+
+    // Nothing is presented, so the surface is left out of the requirements
+    DeviceRequirements requirements;
+    requirements.preferred = preferredDevice;
+    std::vector<DeviceCandidate> candidates = rankPhysicalDevices(instance, requirements);
+    logDeviceSelection(candidates, requirements);
+    if (candidates.empty() || !candidates.front().rejection.empty()) {
+        VKP_ERROR("No Vulkan device can run the engine");
+        return false;
+    }
+    physicalDevice = candidates.front().device;
+    properties = candidates.front().properties;
+    queues = discoverQueueTopology(physicalDevice, surface);
+
+    VkPhysicalDeviceVulkan12Properties properties12 {};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2 {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    driverName = properties12.driverName;
+    driverInfo = properties12.driverInfo;
+
+    // What Application::setupLogicalDevice enables unconditionally. rankPhysicalDevices already
+    // rejected devices without it
+    VkPhysicalDeviceVulkan13Features features13 {};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features13;
+    features12.timelineSemaphore = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+    VkPhysicalDeviceFeatures deviceFeatures {};
+    deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo {};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = queues.graphicsFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceInfo {};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &features12;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.pEnabledFeatures = &deviceFeatures;
+    if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+        VKP_ERROR("Unable to create a logical device on {}", properties.deviceName);
+        return false;
+    }
+    vkGetDeviceQueue(device, queues.graphicsFamily, 0, &graphicsQueue);
+    // The engine code under test tracks its objects and memory, which needs a device to attribute them to
+    VKP_TRACK_INIT(instance, physicalDevice, device, false, false);
+    return true;
+}
+
+void BenchDevice::destroy()
+{
+    if (device != VK_NULL_HANDLE) {
+        VKP_TRACK_SHUTDOWN();
+        vkDestroyDevice(device, nullptr);
+        device = VK_NULL_HANDLE;
+    }
+    if (surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+        surface = VK_NULL_HANDLE;
+    }
+    if (instance != VK_NULL_HANDLE) {
+        vkDestroyInstance(instance, nullptr);
+        instance = VK_NULL_HANDLE;
+    }
+}
+
+}
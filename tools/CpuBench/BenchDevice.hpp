@@ -0,0 +1,32 @@
+#ifndef VKP_CPUBENCH_DEVICE
+#define VKP_CPUBENCH_DEVICE
+
+#include "Renderer/DeviceSelector.hpp"
+#include "core.hpp"
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+// Instance and device the CPU benchmarks record against, without a window. The device gets the
+// features the engine requires and a single graphics queue. When the loader offers
+// VK_EXT_headless_surface there is also a surface, so the swapchain queries have something to ask about
+struct BenchDevice {
+    VkInstance instance = VK_NULL_HANDLE;
+    // VK_NULL_HANDLE without VK_EXT_headless_surface
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties {};
+    std::string driverName;
+    std::string driverInfo;
+    QueueTopology queues;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+
+    // `preferredDevice` as for DeviceRequirements::preferred
+    bool init(const std::string& preferredDevice);
+    void destroy();
+};
+
+}
+
+#endif
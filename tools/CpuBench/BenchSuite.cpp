@@ -0,0 +1,175 @@
+#include "CpuBench/BenchSuite.hpp"
+#include "Core/Json.hpp"
+#include "Core/MappedFile.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace VulkanProj {
+
+static constexpr u32 REPORT_VERSION = 1;
+// Calibration aims past the minimum so the final count is not right at the edge, and grows by
+// at most this much per step so one fast outlier cannot overshoot far
+static constexpr f64 CALIBRATION_MARGIN = 1.2;
+static constexpr f64 CALIBRATION_MAX_GROWTH = 10.0;
+
+void BenchSuite::add(const std::string& name, std::function<f64(u64 iterations)> run, u64 maxIterations)
+{
+    m_Cases.push_back({ name, std::move(run), maxIterations });
+}
+
+void BenchSuite::addCleanup(std::function<void()> cleanup)
+{
+    m_Cleanups.push_back(std::move(cleanup));
+}
+
+void BenchSuite::destroy()
+{
+    for (auto it = m_Cleanups.rbegin(); it != m_Cleanups.rend(); it++) {
+        (*it)();
+    }
+    m_Cleanups.clear();
+    m_Cases.clear();
+}
+
+static u64 calibrateIterations(const BenchCase& bench, f64 minSampleMs)
+{
+    u64 iterations = 1;
+    while (bench.maxIterations == 0 || iterations < bench.maxIterations) {
+        f64 ms = bench.run(iterations);
+        if (ms >= minSampleMs) {
+            break;
+        }
+        f64 growth = ms > 0.0 ? std::clamp(minSampleMs * CALIBRATION_MARGIN / ms, 1.5, CALIBRATION_MAX_GROWTH) : CALIBRATION_MAX_GROWTH;
+        iterations = std::max(iterations + 1, (u64)((f64)iterations * growth));
+        if (bench.maxIterations > 0) {
+            iterations = std::min(iterations, bench.maxIterations);
+        }
+    }
+    return iterations;
+}
+
+std::vector<BenchResult> BenchSuite::run(const BenchOptions& options) const
+{
+    std::vector<BenchResult> results;
+    for (const BenchCase& bench : m_Cases) {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        // Same iteration count for every sample, so the samples are comparable with each other
+        const u64 iterations = calibrateIterations(bench, options.minSampleMs);
+        for (u32 i = 0; i < options.warmupSamples; i++) {
+            bench.run(iterations);
+        }
+
+        std::vector<f64> samples;
+        samples.reserve(options.samples);
+        for (u32 i = 0; i < options.samples; i++) {
+            samples.push_back(bench.run(iterations) * 1e6 / (f64)iterations);
+        }
+
+        BenchResult& result = results.emplace_back();
+        result.name = bench.name;
+        result.iterations = iterations;
+        result.nsPerOp = summarizeSamples(std::move(samples));
+        logBenchSummary(fmt::format("{} ({} ops/sample)", bench.name, iterations), result.nsPerOp, "ns");
+    }
+    return results;
+}
+
+void BenchSuite::logCases() const
+{
+    for (const BenchCase& bench : m_Cases) {
+        VKP_INFO("  {}", bench.name);
+    }
+}
+
+bool writeBenchReport(const std::string& path, const BenchEnvironment& environment, const BenchOptions& options,
+    const std::vector<BenchResult>& results)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        VKP_ERROR("Unable to open benchmark report {}", path);
+        return false;
+    }
+
+#ifdef VKP_PROFILE
+    const bool profiler = true;
+#else
+    const bool profiler = false;
+#endif
+#ifdef NDEBUG
+    const bool assertions = false;
+#else
+    const bool assertions = true;
+#endif
+
+    file << "{\n  \"version\": " << REPORT_VERSION << ",\n";
+    file << fmt::format("  \"environment\": {{\"device\": \"{}\", \"deviceType\": \"{}\", \"driver\": \"{}\", \"driverInfo\": \"{}\", "
+                        "\"apiVersion\": \"{}.{}.{}\", \"driverVersion\": {}, \"vendorId\": {}, \"deviceId\": {}, \"threads\": {}}},\n",
+        escapeJson(environment.deviceName), environment.deviceType, escapeJson(environment.driverName), escapeJson(environment.driverInfo),
+        VK_API_VERSION_MAJOR(environment.apiVersion), VK_API_VERSION_MINOR(environment.apiVersion), VK_API_VERSION_PATCH(environment.apiVersion),
+        environment.driverVersion, environment.vendorId, environment.deviceId, environment.threads);
+    file << fmt::format("  \"build\": {{\"profiler\": {}, \"assertions\": {}, \"logLevel\": {}}},\n", profiler, assertions, VKP_LOG_ACTIVE_LEVEL);
+    file << fmt::format("  \"options\": {{\"samples\": {}, \"warmupSamples\": {}, \"minSampleMs\": {}}},\n", options.samples,
+        options.warmupSamples, options.minSampleMs);
+
+    file << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        const BenchSummary& s = result.nsPerOp;
+        file << (i == 0 ? "\n" : ",\n");
+        file << fmt::format("    {{\"name\": \"{}\", \"unit\": \"ns/op\", \"iterations\": {}, \"samples\": {}, \"min\": {:.3f}, "
+                            "\"p50\": {:.3f}, \"avg\": {:.3f}, \"p99\": {:.3f}, \"max\": {:.3f}, \"stddev\": {:.3f}}}",
+            escapeJson(result.name), result.iterations, s.count, s.min, s.p50, s.avg, s.p99, s.max, s.stddev);
+    }
+    file << "\n  ]\n}\n";
+
+    VKP_INFO("Wrote {} benchmark results to {}", results.size(), path);
+    return true;
+}
+
+i32 compareWithBaseline(const std::string& path, const std::vector<BenchResult>& results, f64 threshold)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        VKP_ERROR("Unable to open benchmark baseline {}", path);
+        return -1;
+    }
+    JsonValue root;
+    std::string error;
+    if (!parseJson(reinterpret_cast<const char*>(file.data()), file.size(), root, error)) {
+        VKP_ERROR("Benchmark baseline {}: {}", path, error);
+        return -1;
+    }
+    const JsonValue* benchmarks = root.find("benchmarks");
+    if (benchmarks == nullptr || !benchmarks->isArray()) {
+        VKP_ERROR("Benchmark baseline {} has no benchmarks array", path);
+        return -1;
+    }
+
+    UMap<std::string, f64> baseline;
+    for (size_t i = 0; i < benchmarks->size(); i++) {
+        const JsonValue& entry = (*benchmarks)[i];
+        baseline[entry.getString("name")] = entry.getNumber("p50", 0.0);
+    }
+
+    // Medians, the one statistic a single slow sample cannot move
+    i32 regressions = 0;
+    for (const BenchResult& result : results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            continue;
+        }
+        f64 change = result.nsPerOp.p50 / it->second - 1.0;
+        if (change > threshold) {
+            VKP_WARN("[BENCH] REGRESSION {}: {:.1f}ns -> {:.1f}ns ({:+.1f}%)", result.name, it->second, result.nsPerOp.p50, change * 100.0);
+            regressions++;
+        } else {
+            VKP_INFO("[BENCH] {}: {:.1f}ns -> {:.1f}ns ({:+.1f}%)", result.name, it->second, result.nsPerOp.p50, change * 100.0);
+        }
+    }
+    return regressions;
+}
+
+}
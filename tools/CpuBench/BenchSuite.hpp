@@ -0,0 +1,77 @@
+#ifndef VKP_CPUBENCH_SUITE
+#define VKP_CPUBENCH_SUITE
+
+#include "Bench/Bench.hpp"
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// One operation the suite times. `run` performs `iterations` operations and returns the
+// milliseconds they took. Per-sample setup that should not count (pool resets, waits, log
+// flushes) happens inside `run` but outside its timer
+struct BenchCase {
+    // "<group>/<operation>", what --filter matches
+    std::string name;
+    std::function<f64(u64 iterations)> run;
+    // Caps the calibrated iteration count, for cases that fill a fixed-size resource. 0 = no cap
+    u64 maxIterations = 0;
+};
+
+struct BenchOptions {
+    u32 samples = 30;
+    // Run and thrown away before the samples, warms caches, pools and driver allocations
+    u32 warmupSamples = 3;
+    // Iterations per sample are calibrated once per case so a sample takes at least this long,
+    // then stay fixed for every sample
+    f64 minSampleMs = 10.0;
+    // Substring of the case name, empty runs everything
+    std::string filter;
+};
+
+struct BenchResult {
+    std::string name;
+    u64 iterations = 0;
+    // Nanoseconds per operation, one value per sample
+    BenchSummary nsPerOp;
+};
+
+// What the numbers were measured on, written next to them so reports from different machines
+// or drivers are not compared by accident
+struct BenchEnvironment {
+    std::string deviceName;
+    std::string deviceType;
+    std::string driverName;
+    std::string driverInfo;
+    u32 apiVersion = 0;
+    u32 driverVersion = 0;
+    u32 vendorId = 0;
+    u32 deviceId = 0;
+    u32 threads = 0;
+};
+
+class BenchSuite {
+public:
+    void add(const std::string& name, std::function<f64(u64 iterations)> run, u64 maxIterations = 0);
+    // Runs from destroy(), in reverse order of registration
+    void addCleanup(std::function<void()> cleanup);
+
+    std::vector<BenchResult> run(const BenchOptions& options) const;
+    void logCases() const;
+
+    void destroy();
+
+private:
+    std::vector<BenchCase> m_Cases;
+    std::vector<std::function<void()>> m_Cleanups;
+};
+
+bool writeBenchReport(const std::string& path, const BenchEnvironment& environment, const BenchOptions& options,
+    const std::vector<BenchResult>& results);
+
+// Compares medians against a report from writeBenchReport. Logs every case more than `threshold`
+// slower (0.1 = 10%) and returns how many there were, -1 when the baseline cannot be read
+i32 compareWithBaseline(const std::string& path, const std::vector<BenchResult>& results, f64 threshold);
+
+}
+
+#endif
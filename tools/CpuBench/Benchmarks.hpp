@@ -0,0 +1,26 @@
+#ifndef VKP_CPUBENCH_BENCHMARKS
+#define VKP_CPUBENCH_BENCHMARKS
+
+#include "CpuBench/BenchDevice.hpp"
+#include "CpuBench/BenchSuite.hpp"
+
+namespace VulkanProj {
+
+// Each group adds its cases to the suite and registers a cleanup for the objects they share
+
+// Draws through the render graph into a primary command buffer or parallel secondaries, and the
+// graph's own per-frame cost
+void addRecordingBenchmarks(BenchSuite& suite, const BenchDevice& device);
+// Transient descriptor sets, descriptor writes, layout cache, bindless slots, buddy and device memory,
+// raw vkAllocateMemory and defragmentation
+void addAllocationBenchmarks(BenchSuite& suite, const BenchDevice& device);
+// Building the frame's SubmitBatch, and vkQueueSubmit of an empty batch
+void addSubmitBenchmarks(BenchSuite& suite, const BenchDevice& device);
+// What a VKP_* call costs the calling thread
+void addLogBenchmarks(BenchSuite& suite);
+// Device selection and swapchain support queries
+void addQueryBenchmarks(BenchSuite& suite, const BenchDevice& device);
+
+}
+
+#endif
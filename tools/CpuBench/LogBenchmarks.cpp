@@ -0,0 +1,75 @@
+#include "CpuBench/Benchmarks.hpp"
+
+#include <spdlog/sinks/null_sink.h>
+
+namespace VulkanProj {
+
+// Half the default queue, so a sample never runs into the overflow policy
+static constexpr u64 MAX_MESSAGES_PER_SAMPLE = 4096;
+
+// Runs `loop` with the logger at `level` writing into a null sink and returns its time. Only the
+// calling thread's cost is measured, the writer thread formats in the background as it would in a
+// frame. The queue is drained before the sinks are swapped, the writer must not be using them
+template <typename Fn>
+static f64 timeSilenced(Fn&& loop, spdlog::level::level_enum level = spdlog::level::trace)
+{
+    static const spdlog::sink_ptr nullSink = std::make_shared<spdlog::sinks::null_sink_mt>();
+    std::shared_ptr<spdlog::logger>& logger = Log::GetCoreLogger();
+
+    Log::Flush();
+    std::vector<spdlog::sink_ptr> saved = logger->sinks();
+    spdlog::level::level_enum savedLevel = logger->level();
+    logger->sinks() = { nullSink };
+    logger->set_level(level);
+
+    BenchTimer timer;
+    loop();
+    f64 ms = timer.elapsedMs();
+
+    Log::Flush();
+    logger->set_level(savedLevel);
+    logger->sinks() = saved;
+    return ms;
+}
+
+void addLogBenchmarks(BenchSuite& suite)
+{
+    // Plain values are copied into the queue and formatted by the writer
+    suite.add("log/VKP_INFO deferred", [](u64 iterations) {
+        return timeSilenced([=]() {
+            for (u64 i = 0; i < iterations; i++) {
+                VKP_INFO("Frame {} took {:.3f}ms", i, 16.6);
+            }
+        });
+    }, MAX_MESSAGES_PER_SAMPLE);
+
+    // Strings are formatted on the calling thread
+    suite.add("log/VKP_INFO inline string", [](u64 iterations) {
+        const std::string name = "Draws";
+        return timeSilenced([&]() {
+            for (u64 i = 0; i < iterations; i++) {
+                VKP_INFO("Pass {} recorded {} draws", name, i);
+            }
+        });
+    }, MAX_MESSAGES_PER_SAMPLE);
+
+    // Below the logger's runtime level, only the level check runs
+    suite.add("log/VKP_INFO filtered at runtime", [](u64 iterations) {
+        return timeSilenced([=]() {
+            for (u64 i = 0; i < iterations; i++) {
+                VKP_INFO("Frame {} took {:.3f}ms", i, 16.6);
+            }
+        }, spdlog::level::warn);
+    });
+
+    // Compiled out when VKP_LOG_ACTIVE_LEVEL is above trace (Release), then this measures an empty loop
+    suite.add("log/VKP_TRACE", [](u64 iterations) {
+        return timeSilenced([=]() {
+            for (u64 i = 0; i < iterations; i++) {
+                VKP_TRACE("Frame {} took {:.3f}ms", i, 16.6);
+            }
+        });
+    }, MAX_MESSAGES_PER_SAMPLE);
+}
+
+}
@@ -0,0 +1,46 @@
+#include "CpuBench/Benchmarks.hpp"
+
+namespace VulkanProj {
+
+// Written after every loop so the queries cannot be optimized away
+static volatile size_t s_Sink = 0;
+
+template <typename Fn>
+static f64 timeQueries(u64 count, Fn&& query)
+{
+    size_t sink = 0;
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        sink += query();
+    }
+    f64 ms = timer.elapsedMs();
+    s_Sink = sink;
+    return ms;
+}
+
+// Every one of these runs on startup and again whenever the swapchain is recreated
+void addQueryBenchmarks(BenchSuite& suite, const BenchDevice& device)
+{
+    VkInstance instance = device.instance;
+    VkPhysicalDevice physicalDevice = device.physicalDevice;
+    VkSurfaceKHR surface = device.surface;
+
+    suite.add("query/rankPhysicalDevices", [instance](u64 iterations) {
+        return timeQueries(iterations, [&]() { return rankPhysicalDevices(instance, {}).size(); });
+    });
+    suite.add("query/discoverQueueTopology", [physicalDevice, surface](u64 iterations) {
+        return timeQueries(iterations, [&]() { return (size_t)discoverQueueTopology(physicalDevice, surface).graphicsFamily; });
+    });
+    suite.add("query/hasDeviceExtension", [physicalDevice](u64 iterations) {
+        return timeQueries(iterations, [&]() { return (size_t)hasDeviceExtension(physicalDevice, VK_KHR_SWAPCHAIN_EXTENSION_NAME); });
+    });
+
+    if (surface == VK_NULL_HANDLE) {
+        return;
+    }
+    suite.add("query/querySwapChainSupport", [physicalDevice, surface](u64 iterations) {
+        return timeQueries(iterations, [&]() { return querySwapChainSupport(physicalDevice, surface).formats.size(); });
+    });
+}
+
+}
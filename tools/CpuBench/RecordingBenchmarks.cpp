@@ -0,0 +1,205 @@
+#include "CpuBench/Benchmarks.hpp"
+#include "Renderer/BindlessTable.hpp"
+#include "Renderer/DescriptorAllocator.hpp"
+#include "Renderer/Mesh.hpp"
+#include "Renderer/ParallelRecorder.hpp"
+#include "Renderer/PipelineRegistry.hpp"
+#include "Renderer/RenderGraph.hpp"
+#include "Renderer/ShaderLibrary.hpp"
+
+#include <Shaders/shaderFrag.hpp>
+#include <Shaders/shaderVert.hpp>
+
+namespace VulkanProj {
+
+static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+static constexpr VkExtent2D EXTENT = { 1280, 720 };
+static constexpr u32 CUBE_INDEX_COUNT = 36;
+// Command buffer memory grows with every draw and is never submitted, keep a sample bounded
+static constexpr u64 MAX_DRAWS_PER_SAMPLE = 1 << 16;
+// Draws per secondary command buffer when recording in parallel
+static constexpr u32 DRAWS_PER_CHUNK = 512;
+
+struct RecordingState {
+    DeviceAllocator allocator;
+    DescriptorLayoutCache layouts;
+    BindlessTable bindless;
+    ShaderLibrary shaders;
+    PipelineRegistry pipelines;
+    RenderGraph graph;
+    ParallelRecorder recorder;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    Allocation* geometry = nullptr;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+};
+
+static void createRecordingState(RecordingState& state, const BenchDevice& device)
+{
+    state.allocator.init(device.physicalDevice, device.device);
+    state.layouts.init(device.device);
+    state.bindless.init(device.physicalDevice, device.device, state.layouts, 1, 64, 64);
+    state.shaders.init(device.device);
+    state.graph.init(device.device, state.allocator, 1);
+    // Sized for the job system as main configured it (--threads)
+    state.recorder.init(device.device, device.queues.graphicsFamily, 1);
+
+    // The main pass layout, as Application::createGraphicsPipeline builds it
+    VkDescriptorSetLayout setLayout = state.bindless.getSetLayout();
+    VkPushConstantRange pushRange = Shaders::shaderVert.pushConstants;
+    VkPipelineLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VkResult res = vkCreatePipelineLayout(device.device, &layoutInfo, nullptr, &state.pipelineLayout);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE THE BENCHMARK PIPELINE LAYOUT");
+
+    state.pipelines.init(device.device, VK_NULL_HANDLE, false);
+    PipelineKey key;
+    key.program = state.pipelines.registerProgram(state.shaders.load(Shaders::shaderVert), state.shaders.load(Shaders::shaderFrag),
+        state.pipelineLayout);
+    key.colorFormat = COLOR_FORMAT;
+    state.pipeline = state.pipelines.get(key);
+    VKP_ASSERT(state.pipeline != VK_NULL_HANDLE, "FAILED TO CREATE THE BENCHMARK PIPELINE");
+
+    // Never submitted, the contents do not matter
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = 64 * 1024;
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    state.geometry = state.allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // Beginning a command buffer resets it, like a frame slot's pool reset would
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = device.queues.graphicsFamily;
+    vkCreateCommandPool(device.device, &poolInfo, nullptr, &state.commandPool);
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = state.commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(device.device, &allocInfo, &state.commandBuffer);
+}
+
+static void destroyRecordingState(RecordingState& state, const BenchDevice& device)
+{
+    vkDestroyCommandPool(device.device, state.commandPool, nullptr);
+    state.allocator.destroyBuffer(state.geometry);
+    state.pipelines.destroy();
+    vkDestroyPipelineLayout(device.device, state.pipelineLayout, nullptr);
+    state.recorder.destroy();
+    state.graph.destroy();
+    state.shaders.destroy();
+    state.bindless.destroy();
+    state.layouts.destroy();
+    state.allocator.destroy();
+}
+
+static void beginCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+}
+
+// Draws [first, first + count) with the per-draw work of the main pass: scissor, mesh buffers and
+// mesh push constants
+static void recordDrawRange(const RecordingState& state, VkCommandBuffer commandBuffer, u64 first, u64 count)
+{
+    const MeshConstants constants { glm::vec4(1.0f), glm::vec4(0.0f) };
+    const VkViewport viewport { 0.0f, 0.0f, (f32)EXTENT.width, (f32)EXTENT.height, 0.0f, 1.0f };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    state.bindless.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipelineLayout);
+    VkDeviceSize offset = 0;
+    for (u64 i = first; i < first + count; i++) {
+        VkRect2D scissor { { (i32)(i % 64), (i32)(i % 32) }, EXTENT };
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &state.geometry->buffer, &offset);
+        vkCmdBindIndexBuffer(commandBuffer, state.geometry->buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdPushConstants(commandBuffer, state.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, MESH_CONSTANTS_OFFSET, sizeof(MeshConstants),
+            &constants);
+        vkCmdDrawIndexed(commandBuffer, CUBE_INDEX_COUNT, 1, 0, 0, (u32)i);
+    }
+}
+
+// One pass with `drawCount` draws, recorded into the primary command buffer
+static f64 recordDraws(RecordingState& state, u64 drawCount)
+{
+    BenchTimer timer;
+    beginCommandBuffer(state.commandBuffer);
+    state.graph.reset(0);
+    RGResource color = state.graph.createImage("Color", { COLOR_FORMAT, EXTENT });
+    state.graph.addPass("Draws")
+        .color(color, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+        .sideEffects()
+        .execute([&](const RGPassContext& ctx) { recordDrawRange(state, ctx.commandBuffer, 0, drawCount); });
+    state.graph.compile();
+    state.graph.execute(state.commandBuffer);
+    vkEndCommandBuffer(state.commandBuffer);
+    return timer.elapsedMs();
+}
+
+// The same pass split into secondary command buffers recorded on the job system, as the main
+// pass records its instances. Compare runs with different --threads for the scaling
+static f64 recordParallelDraws(RecordingState& state, u64 drawCount)
+{
+    BenchTimer timer;
+    state.recorder.beginFrame(0);
+    beginCommandBuffer(state.commandBuffer);
+    state.graph.reset(0);
+    RGResource color = state.graph.createImage("Color", { COLOR_FORMAT, EXTENT });
+    state.graph.addPass("Draws")
+        .color(color, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+        .secondaryCommandBuffers()
+        .sideEffects()
+        .execute([&](const RGPassContext& ctx) {
+            state.recorder.record(ctx.commandBuffer, *ctx.inheritance, (u32)drawCount, DRAWS_PER_CHUNK,
+                [&](VkCommandBuffer secondary, u32 first, u32 count) { recordDrawRange(state, secondary, first, count); });
+        });
+    state.graph.compile();
+    state.graph.execute(state.commandBuffer);
+    vkEndCommandBuffer(state.commandBuffer);
+    return timer.elapsedMs();
+}
+
+// Declare, compile and record a three pass frame with empty passes: what the graph itself costs
+static f64 recordGraphFrames(RecordingState& state, u64 frameCount)
+{
+    BenchTimer timer;
+    for (u64 frame = 0; frame < frameCount; frame++) {
+        beginCommandBuffer(state.commandBuffer);
+        state.graph.reset(0);
+        RGResource scene = state.graph.createImage("Scene", { COLOR_FORMAT, EXTENT });
+        RGResource post = state.graph.createImage("Post", { COLOR_FORMAT, EXTENT });
+        state.graph.addPass("Scene").color(scene).execute([](const RGPassContext&) {});
+        state.graph.addPass("Post").read(scene, RGUsage::SampledFragment).color(post).execute([](const RGPassContext&) {});
+        state.graph.addPass("Readback").read(post, RGUsage::TransferSrc).sideEffects().execute([](const RGPassContext&) {});
+        state.graph.compile();
+        state.graph.execute(state.commandBuffer);
+        vkEndCommandBuffer(state.commandBuffer);
+    }
+    return timer.elapsedMs();
+}
+
+void addRecordingBenchmarks(BenchSuite& suite, const BenchDevice& device)
+{
+    Ref<RecordingState> state = CreateRef<RecordingState>();
+    createRecordingState(*state, device);
+    suite.addCleanup([state, &device]() { destroyRecordingState(*state, device); });
+
+    suite.add("record/draw", [state](u64 iterations) { return recordDraws(*state, iterations); }, MAX_DRAWS_PER_SAMPLE);
+    suite.add("record/draw, parallel secondaries", [state](u64 iterations) { return recordParallelDraws(*state, iterations); },
+        MAX_DRAWS_PER_SAMPLE);
+    suite.add("record/render graph frame", [state](u64 iterations) { return recordGraphFrames(*state, iterations); });
+}
+
+}
@@ -0,0 +1,125 @@
+#include "CpuBench/Benchmarks.hpp"
+#include "Renderer/SubmitBatch.hpp"
+
+namespace VulkanProj {
+
+// Submits queue up on the device, wait for them after every sample
+static constexpr u64 MAX_SUBMITS_PER_SAMPLE = 1024;
+
+struct SubmitState {
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    VkSemaphore acquired = VK_NULL_HANDLE;
+    VkSemaphore renderFinished = VK_NULL_HANDLE;
+    u64 timelineValue = 0;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+};
+
+// Written after every loop so the batches cannot be optimized away
+static volatile u32 s_Sink = 0;
+
+static VkSemaphore createSemaphore(VkDevice device, VkSemaphoreType type)
+{
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = type;
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    VkSemaphore semaphore;
+    VkResult res = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore);
+    VKP_ASSERT(res == VK_SUCCESS, "FAILED TO CREATE A BENCHMARK SEMAPHORE");
+    return semaphore;
+}
+
+static void createSubmitState(SubmitState& state, const BenchDevice& device)
+{
+    state.device = device.device;
+    state.queue = device.graphicsQueue;
+    state.timeline = createSemaphore(device.device, VK_SEMAPHORE_TYPE_TIMELINE);
+    state.acquired = createSemaphore(device.device, VK_SEMAPHORE_TYPE_BINARY);
+    state.renderFinished = createSemaphore(device.device, VK_SEMAPHORE_TYPE_BINARY);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = device.queues.graphicsFamily;
+    vkCreateCommandPool(device.device, &poolInfo, nullptr, &state.commandPool);
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = state.commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(device.device, &allocInfo, &state.commandBuffer);
+
+    // Empty and submitted again while still pending, so the submit benchmark measures the submit alone
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    vkBeginCommandBuffer(state.commandBuffer, &beginInfo);
+    vkEndCommandBuffer(state.commandBuffer);
+}
+
+static void destroySubmitState(SubmitState& state)
+{
+    vkQueueWaitIdle(state.queue);
+    vkDestroyCommandPool(state.device, state.commandPool, nullptr);
+    vkDestroySemaphore(state.device, state.renderFinished, nullptr);
+    vkDestroySemaphore(state.device, state.acquired, nullptr);
+    vkDestroySemaphore(state.device, state.timeline, nullptr);
+}
+
+// The batch Application::drawFrame builds with a window and pending uploads
+static f64 buildFrameSubmits(SubmitState& state, u64 count)
+{
+    u32 sink = 0;
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        SubmitBatch batch;
+        batch.wait(state.acquired, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT)
+            .wait(state.timeline, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, i)
+            .signal(state.timeline, i + 1)
+            .signal(state.renderFinished)
+            .commandBuffer(state.commandBuffer);
+        const VkSubmitInfo& info = batch.build();
+        sink += info.waitSemaphoreCount + info.signalSemaphoreCount;
+    }
+    f64 ms = timer.elapsedMs();
+    s_Sink = sink;
+    return ms;
+}
+
+// Driver cost of vkQueueSubmit for an empty command buffer that signals the timeline
+static f64 submitEmpty(SubmitState& state, u64 count)
+{
+    BenchTimer timer;
+    for (u64 i = 0; i < count; i++) {
+        SubmitBatch batch;
+        batch.signal(state.timeline, ++state.timelineValue).commandBuffer(state.commandBuffer);
+        VkResult res = batch.submit(state.queue);
+        VKP_ASSERT(res == VK_SUCCESS, "FAILED TO SUBMIT QUEUE");
+    }
+    f64 ms = timer.elapsedMs();
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &state.timeline;
+    waitInfo.pValues = &state.timelineValue;
+    vkWaitSemaphores(state.device, &waitInfo, UINT64_MAX);
+    return ms;
+}
+
+void addSubmitBenchmarks(BenchSuite& suite, const BenchDevice& device)
+{
+    Ref<SubmitState> state = CreateRef<SubmitState>();
+    createSubmitState(*state, device);
+    suite.addCleanup([state]() { destroySubmitState(*state); });
+
+    suite.add("submit/build frame batch", [state](u64 iterations) { return buildFrameSubmits(*state, iterations); });
+    suite.add("submit/vkQueueSubmit empty", [state](u64 iterations) { return submitEmpty(*state, iterations); }, MAX_SUBMITS_PER_SAMPLE);
+}
+
+}
@@ -0,0 +1,144 @@
+#include "Core/JobSystem.hpp"
+#include "CpuBench/BenchDevice.hpp"
+#include "CpuBench/BenchSuite.hpp"
+#include "CpuBench/Benchmarks.hpp"
+#include "core.hpp"
+
+// CPU benchmark suite: times the engine's per-frame CPU paths against a real Vulkan device without
+// a window, so it runs on software drivers in CI. Every case calibrates a fixed iteration count,
+// then reports nanoseconds per operation over many samples, optionally as JSON and compared with
+// a previous report
+
+struct BenchArgs {
+    VulkanProj::BenchOptions options;
+    std::string jsonPath;
+    std::string baselinePath;
+    // Slowdown of a case's median that counts as a regression
+    f64 threshold = 0.10;
+    std::string device;
+    // One thread by default, fewer threads means less noise. Only the parallel recording case uses
+    // the job system, compare reports taken with different counts for its scaling
+    u32 threads = 1;
+    bool list = false;
+};
+
+static void printUsage()
+{
+    VKP_INFO("Usage: VulkanBench [--filter <text>] [--samples N] [--warmup N] [--min-sample-ms MS] [--json <report.json>]");
+    VKP_INFO("                   [--baseline <report.json>] [--threshold <percent>] [--device <name|uuid|index>] [--threads N] [--list]");
+}
+
+static bool parseArgs(int argc, char** argv, BenchArgs& args)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--filter" && hasValue) {
+            args.options.filter = argv[++i];
+        } else if (arg == "--samples" && hasValue) {
+            args.options.samples = std::max(1u, (u32)std::stoul(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            args.options.warmupSamples = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--min-sample-ms" && hasValue) {
+            args.options.minSampleMs = std::stod(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            args.jsonPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            args.baselinePath = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            args.threshold = std::stod(argv[++i]) / 100.0;
+        } else if (arg == "--device" && hasValue) {
+            args.device = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            args.threads = (u32)std::stoul(argv[++i]);
+        } else if (arg == "--list") {
+            args.list = true;
+        } else {
+            VKP_ERROR("Unknown argument '{}'", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int runBenchmarks(const BenchArgs& args)
+{
+    using namespace VulkanProj;
+
+    BenchDevice device;
+    if (!device.init(args.device)) {
+        device.destroy();
+        return EXIT_FAILURE;
+    }
+
+    BenchSuite suite;
+    addRecordingBenchmarks(suite, device);
+    addAllocationBenchmarks(suite, device);
+    addSubmitBenchmarks(suite, device);
+    addLogBenchmarks(suite);
+    addQueryBenchmarks(suite, device);
+
+    int result = EXIT_SUCCESS;
+    if (args.list) {
+        suite.logCases();
+    } else {
+        VKP_INFO("[BENCH] {} ({}), {} samples per case of at least {:.1f}ms", device.properties.deviceName, device.driverName,
+            args.options.samples, args.options.minSampleMs);
+        std::vector<BenchResult> results = suite.run(args.options);
+
+        if (!args.jsonPath.empty()) {
+            BenchEnvironment environment;
+            environment.deviceName = device.properties.deviceName;
+            environment.deviceType = deviceTypeName(device.properties.deviceType);
+            environment.driverName = device.driverName;
+            environment.driverInfo = device.driverInfo;
+            environment.apiVersion = device.properties.apiVersion;
+            environment.driverVersion = device.properties.driverVersion;
+            environment.vendorId = device.properties.vendorID;
+            environment.deviceId = device.properties.deviceID;
+            environment.threads = JobSystem::getThreadCount();
+            if (!writeBenchReport(args.jsonPath, environment, args.options, results)) {
+                result = EXIT_FAILURE;
+            }
+        }
+
+        if (!args.baselinePath.empty()) {
+            i32 regressions = compareWithBaseline(args.baselinePath, results, args.threshold);
+            if (regressions != 0) {
+                if (regressions > 0) {
+                    VKP_ERROR("[BENCH] {} cases regressed by more than {:.0f}%", regressions, args.threshold * 100.0);
+                }
+                result = EXIT_FAILURE;
+            }
+        }
+    }
+
+    suite.destroy();
+    device.destroy();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    VulkanProj::Log::Init();
+
+    BenchArgs args;
+    bool valid = false;
+    try {
+        valid = parseArgs(argc, argv, args);
+    } catch (const std::exception& e) {
+        VKP_ERROR("Invalid arguments: {}", e.what());
+    }
+    if (!valid) {
+        printUsage();
+        VulkanProj::Log::Shutdown();
+        return EXIT_FAILURE;
+    }
+
+    VulkanProj::JobSystem::init(args.threads);
+    int result = runBenchmarks(args);
+    VulkanProj::JobSystem::shutdown();
+    VulkanProj::Log::Shutdown();
+    return result;
+}
@@ -0,0 +1,341 @@
+#include "ShaderEmbed/SpirvReflect.hpp"
+
+namespace VulkanProj {
+
+static constexpr u32 SPIRV_MAGIC = 0x07230203;
+static constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+// The few opcodes, decorations and enumerants reflection looks at, from the SPIR-V spec
+static constexpr u32 OP_ENTRY_POINT = 15;
+static constexpr u32 OP_TYPE_BOOL = 20;
+static constexpr u32 OP_TYPE_INT = 21;
+static constexpr u32 OP_TYPE_FLOAT = 22;
+static constexpr u32 OP_TYPE_VECTOR = 23;
+static constexpr u32 OP_TYPE_MATRIX = 24;
+static constexpr u32 OP_TYPE_IMAGE = 25;
+static constexpr u32 OP_TYPE_SAMPLER = 26;
+static constexpr u32 OP_TYPE_SAMPLED_IMAGE = 27;
+static constexpr u32 OP_TYPE_ARRAY = 28;
+static constexpr u32 OP_TYPE_RUNTIME_ARRAY = 29;
+static constexpr u32 OP_TYPE_STRUCT = 30;
+static constexpr u32 OP_TYPE_POINTER = 32;
+static constexpr u32 OP_CONSTANT = 43;
+static constexpr u32 OP_VARIABLE = 59;
+static constexpr u32 OP_DECORATE = 71;
+static constexpr u32 OP_MEMBER_DECORATE = 72;
+static constexpr u32 OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+static constexpr u32 DECORATION_BUFFER_BLOCK = 3;
+static constexpr u32 DECORATION_ARRAY_STRIDE = 6;
+static constexpr u32 DECORATION_MATRIX_STRIDE = 7;
+static constexpr u32 DECORATION_BINDING = 33;
+static constexpr u32 DECORATION_DESCRIPTOR_SET = 34;
+static constexpr u32 DECORATION_OFFSET = 35;
+
+static constexpr u32 STORAGE_UNIFORM_CONSTANT = 0;
+static constexpr u32 STORAGE_UNIFORM = 2;
+static constexpr u32 STORAGE_PUSH_CONSTANT = 9;
+static constexpr u32 STORAGE_STORAGE_BUFFER = 12;
+
+static constexpr u32 DIM_BUFFER = 5;
+static constexpr u32 DIM_SUBPASS_DATA = 6;
+
+static constexpr u32 NO_VALUE = ~0u;
+
+struct Decorations {
+    u32 set = NO_VALUE;
+    u32 binding = NO_VALUE;
+    u32 arrayStride = 0;
+    bool bufferBlock = false;
+};
+
+struct MemberDecorations {
+    u32 offset = 0;
+    u32 matrixStride = 0;
+};
+
+// Everything reflection needs from the module, indexed by result id
+struct Module {
+    // Operands after the opcode word, result id first for types
+    UMap<u32, std::vector<u32>> types;
+    UMap<u32, u32> typeOpcodes;
+    UMap<u32, u32> constants;
+    UMap<u32, Decorations> decorations;
+    UMap<u32, std::vector<MemberDecorations>> members;
+};
+
+static const char* stageName(u32 executionModel)
+{
+    switch (executionModel) {
+    case 0:
+        return "VK_SHADER_STAGE_VERTEX_BIT";
+    case 1:
+        return "VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT";
+    case 2:
+        return "VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT";
+    case 3:
+        return "VK_SHADER_STAGE_GEOMETRY_BIT";
+    case 4:
+        return "VK_SHADER_STAGE_FRAGMENT_BIT";
+    case 5:
+        return "VK_SHADER_STAGE_COMPUTE_BIT";
+    default:
+        return nullptr;
+    }
+}
+
+// Byte size of a type inside an explicitly laid out block. `matrixStride` comes from the member
+// that holds the matrix, arrays carry their own stride
+static u32 typeSize(const Module& module, u32 type, u32 matrixStride = 0)
+{
+    auto it = module.types.find(type);
+    if (it == module.types.end()) {
+        return 0;
+    }
+    const std::vector<u32>& operands = it->second;
+    switch (module.typeOpcodes.at(type)) {
+    case OP_TYPE_BOOL:
+        return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+        return operands[1] / 8;
+    case OP_TYPE_VECTOR:
+        return operands[2] * typeSize(module, operands[1]);
+    case OP_TYPE_MATRIX:
+        return operands[2] * (matrixStride != 0 ? matrixStride : typeSize(module, operands[1]));
+    case OP_TYPE_ARRAY: {
+        auto length = module.constants.find(operands[2]);
+        auto decorations = module.decorations.find(type);
+        u32 stride = decorations != module.decorations.end() ? decorations->second.arrayStride : 0;
+        if (stride == 0) {
+            stride = typeSize(module, operands[1], matrixStride);
+        }
+        return length != module.constants.end() ? length->second * stride : 0;
+    }
+    case OP_TYPE_STRUCT: {
+        auto members = module.members.find(type);
+        u32 end = 0;
+        for (size_t i = 1; i < operands.size(); i++) {
+            MemberDecorations member {};
+            if (members != module.members.end() && i - 1 < members->second.size()) {
+                member = members->second[i - 1];
+            }
+            end = std::max(end, member.offset + typeSize(module, operands[i], member.matrixStride));
+        }
+        return end;
+    }
+    default:
+        // Runtime arrays and opaque types take no space in a block
+        return 0;
+    }
+}
+
+static const char* descriptorType(const Module& module, u32 storageClass, u32 type)
+{
+    const std::vector<u32>& operands = module.types.at(type);
+    switch (storageClass) {
+    case STORAGE_STORAGE_BUFFER:
+        return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+    case STORAGE_UNIFORM: {
+        // Pre SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+        auto decorations = module.decorations.find(type);
+        bool bufferBlock = decorations != module.decorations.end() && decorations->second.bufferBlock;
+        return bufferBlock ? "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER" : "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+    }
+    case STORAGE_UNIFORM_CONSTANT:
+        switch (module.typeOpcodes.at(type)) {
+        case OP_TYPE_SAMPLER:
+            return "VK_DESCRIPTOR_TYPE_SAMPLER";
+        case OP_TYPE_SAMPLED_IMAGE:
+            return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+        case OP_TYPE_ACCELERATION_STRUCTURE:
+            return "VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR";
+        case OP_TYPE_IMAGE: {
+            // result, sampled type, dim, depth, arrayed, ms, sampled (1 with a sampler, 2 storage)
+            const u32 dim = operands[2];
+            const bool storage = operands[6] == 2;
+            if (dim == DIM_SUBPASS_DATA) {
+                return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
+            }
+            if (dim == DIM_BUFFER) {
+                return storage ? "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER" : "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+            }
+            return storage ? "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE" : "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+        }
+        default:
+            return nullptr;
+        }
+    default:
+        return nullptr;
+    }
+}
+
+bool reflectSpirv(const std::string& name, const std::vector<u32>& words, SpirvReflection& reflection)
+{
+    if (words.size() < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC) {
+        VKP_ERROR("{} is not SPIR-V", name);
+        return false;
+    }
+
+    Module module;
+    // result id, pointer type, storage class
+    std::vector<std::array<u32, 3>> variables;
+    u32 entryPoints = 0;
+
+    size_t cursor = SPIRV_HEADER_WORDS;
+    while (cursor < words.size()) {
+        const u32 opcode = words[cursor] & 0xFFFF;
+        const u32 wordCount = words[cursor] >> 16;
+        if (wordCount == 0 || cursor + wordCount > words.size()) {
+            VKP_ERROR("{} is truncated at word {}", name, cursor);
+            return false;
+        }
+        const u32* operands = words.data() + cursor + 1;
+        const u32 operandCount = wordCount - 1;
+        cursor += wordCount;
+
+        switch (opcode) {
+        case OP_ENTRY_POINT:
+            if (operandCount >= 1) {
+                entryPoints++;
+                const char* stage = stageName(operands[0]);
+                if (stage == nullptr) {
+                    VKP_ERROR("{} has unsupported execution model {}", name, operands[0]);
+                    return false;
+                }
+                reflection.stage = stage;
+            }
+            break;
+        case OP_TYPE_BOOL:
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT:
+        case OP_TYPE_VECTOR:
+        case OP_TYPE_MATRIX:
+        case OP_TYPE_IMAGE:
+        case OP_TYPE_SAMPLER:
+        case OP_TYPE_SAMPLED_IMAGE:
+        case OP_TYPE_ARRAY:
+        case OP_TYPE_RUNTIME_ARRAY:
+        case OP_TYPE_STRUCT:
+        case OP_TYPE_POINTER:
+        case OP_TYPE_ACCELERATION_STRUCTURE:
+            if (operandCount >= 1) {
+                module.types[operands[0]].assign(operands, operands + operandCount);
+                module.typeOpcodes[operands[0]] = opcode;
+            }
+            break;
+        case OP_CONSTANT:
+            // Only array lengths are read, those are 32-bit integers
+            if (operandCount >= 3) {
+                module.constants[operands[1]] = operands[2];
+            }
+            break;
+        case OP_VARIABLE:
+            if (operandCount >= 3) {
+                variables.push_back({ operands[1], operands[0], operands[2] });
+            }
+            break;
+        case OP_DECORATE:
+            if (operandCount >= 2) {
+                Decorations& decorations = module.decorations[operands[0]];
+                const u32 literal = operandCount >= 3 ? operands[2] : 0;
+                if (operands[1] == DECORATION_DESCRIPTOR_SET) {
+                    decorations.set = literal;
+                } else if (operands[1] == DECORATION_BINDING) {
+                    decorations.binding = literal;
+                } else if (operands[1] == DECORATION_ARRAY_STRIDE) {
+                    decorations.arrayStride = literal;
+                } else if (operands[1] == DECORATION_BUFFER_BLOCK) {
+                    decorations.bufferBlock = true;
+                }
+            }
+            break;
+        case OP_MEMBER_DECORATE:
+            if (operandCount >= 4) {
+                std::vector<MemberDecorations>& members = module.members[operands[0]];
+                if (members.size() <= operands[1]) {
+                    members.resize(operands[1] + 1);
+                }
+                if (operands[2] == DECORATION_OFFSET) {
+                    members[operands[1]].offset = operands[3];
+                } else if (operands[2] == DECORATION_MATRIX_STRIDE) {
+                    members[operands[1]].matrixStride = operands[3];
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (entryPoints != 1) {
+        VKP_ERROR("{} has {} entry points, expected exactly one", name, entryPoints);
+        return false;
+    }
+
+    for (const auto& [id, pointerType, storageClass] : variables) {
+        auto pointer = module.types.find(pointerType);
+        if (pointer == module.types.end() || pointer->second.size() < 3) {
+            continue;
+        }
+        u32 type = pointer->second[2];
+
+        if (storageClass == STORAGE_PUSH_CONSTANT) {
+            auto members = module.members.find(type);
+            u32 begin = 0;
+            if (members != module.members.end() && !members->second.empty()) {
+                begin = members->second[0].offset;
+                for (const MemberDecorations& member : members->second) {
+                    begin = std::min(begin, member.offset);
+                }
+            }
+            const u32 end = typeSize(module, type);
+            reflection.pushConstantOffset = begin;
+            reflection.pushConstantSize = end > begin ? end - begin : 0;
+            continue;
+        }
+        if (storageClass != STORAGE_UNIFORM_CONSTANT && storageClass != STORAGE_UNIFORM && storageClass != STORAGE_STORAGE_BUFFER) {
+            continue;
+        }
+
+        auto decorations = module.decorations.find(id);
+        if (decorations == module.decorations.end() || decorations->second.binding == NO_VALUE) {
+            continue;
+        }
+
+        ReflectedBinding binding;
+        // A missing DescriptorSet decoration means set 0
+        binding.set = decorations->second.set != NO_VALUE ? decorations->second.set : 0;
+        binding.binding = decorations->second.binding;
+        while (module.typeOpcodes.count(type) > 0
+            && (module.typeOpcodes.at(type) == OP_TYPE_ARRAY || module.typeOpcodes.at(type) == OP_TYPE_RUNTIME_ARRAY)) {
+            const std::vector<u32>& array = module.types.at(type);
+            if (module.typeOpcodes.at(type) == OP_TYPE_RUNTIME_ARRAY) {
+                binding.count = 0;
+            } else {
+                auto length = module.constants.find(array[2]);
+                binding.count *= length != module.constants.end() ? length->second : 1;
+            }
+            type = array[1];
+        }
+        if (module.types.count(type) == 0) {
+            VKP_ERROR("{} binds set {} binding {} to an undeclared type", name, binding.set, binding.binding);
+            return false;
+        }
+
+        const char* descriptor = descriptorType(module, storageClass, type);
+        if (descriptor == nullptr) {
+            VKP_ERROR("{} has a resource at set {} binding {} with no matching descriptor type", name, binding.set, binding.binding);
+            return false;
+        }
+        binding.type = descriptor;
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    return true;
+}
+
+}
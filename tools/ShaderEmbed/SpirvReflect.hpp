@@ -0,0 +1,32 @@
+#ifndef VKP_SPIRVREFLECT
+#define VKP_SPIRVREFLECT
+
+#include "core.hpp"
+
+namespace VulkanProj {
+
+// What the runtime needs to know about a module to build its layouts. Stage and descriptor
+// types are kept as Vulkan enumerant names, they only ever end up in generated C++
+struct ReflectedBinding {
+    u32 set = 0;
+    u32 binding = 0;
+    std::string type;
+    // Array size, 0 for runtime sized arrays
+    u32 count = 1;
+};
+
+struct SpirvReflection {
+    std::string stage;
+    std::vector<ReflectedBinding> bindings;
+    // Byte range of the push constant block, size 0 without one
+    u32 pushConstantOffset = 0;
+    u32 pushConstantSize = 0;
+};
+
+// Reads the descriptor bindings and push constant block of a single entry point module.
+// Logs and returns false on malformed SPIR-V or resources it does not know how to bind
+bool reflectSpirv(const std::string& name, const std::vector<u32>& words, SpirvReflection& reflection);
+
+}
+
+#endif
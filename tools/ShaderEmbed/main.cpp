@@ -0,0 +1,101 @@
+#include "ShaderEmbed/SpirvReflect.hpp"
+#include "core.hpp"
+
+// Build step behind vkp_add_shader (CMakeLists.txt): reflects a compiled SPIR-V module and writes
+// it out as a header holding the code as a constexpr u32 array plus its EmbeddedShader
+// description, so the runtime creates shader modules without touching the filesystem
+
+static constexpr u32 WORDS_PER_LINE = 8;
+
+static bool readSpirv(const std::string& path, std::vector<u32>& words)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        VKP_ERROR("Unable to open {}", path);
+        return false;
+    }
+    const std::streamsize size = file.tellg();
+    if (size <= 0 || size % 4 != 0) {
+        VKP_ERROR("{} has invalid SPIR-V size {}", path, (i64)size);
+        return false;
+    }
+    words.resize((size_t)size / 4);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(words.data()), size);
+    return (bool)file;
+}
+
+static std::string generateHeader(const std::string& name, const std::vector<u32>& words, const VulkanProj::SpirvReflection& reflection)
+{
+    std::string guard = "VKP_SHADER_" + name;
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c) { return std::isalnum(c) ? (char)std::toupper(c) : '_'; });
+
+    std::ostringstream out;
+    out << "// Generated by VulkanShaderEmbed from " << name << ".spv, do not edit\n";
+    out << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    out << "#include \"Renderer/EmbeddedShader.hpp\"\n\n";
+    out << "namespace VulkanProj::Shaders {\n\n";
+
+    out << "alignas(4) inline constexpr u32 " << name << "Code[] = {";
+    for (size_t i = 0; i < words.size(); i++) {
+        out << (i % WORDS_PER_LINE == 0 ? "\n    " : " ") << fmt::format("0x{:08x},", words[i]);
+    }
+    out << "\n};\n\n";
+
+    std::string bindings = "nullptr";
+    if (!reflection.bindings.empty()) {
+        bindings = name + "Bindings";
+        out << "inline constexpr ShaderBinding " << bindings << "[] = {\n";
+        for (const VulkanProj::ReflectedBinding& binding : reflection.bindings) {
+            out << "    { " << binding.set << ", " << binding.binding << ", " << binding.type << ", " << binding.count << " },\n";
+        }
+        out << "};\n\n";
+    }
+
+    out << "inline constexpr EmbeddedShader " << name << " = {\n";
+    out << "    \"" << name << "\",\n";
+    out << "    " << reflection.stage << ",\n";
+    out << "    " << name << "Code,\n";
+    out << "    sizeof(" << name << "Code),\n";
+    out << "    " << bindings << ",\n";
+    out << "    " << reflection.bindings.size() << ",\n";
+    out << "    { " << (reflection.pushConstantSize > 0 ? reflection.stage : "0") << ", " << reflection.pushConstantOffset << ", "
+        << reflection.pushConstantSize << " },\n";
+    out << "};\n\n";
+
+    out << "}\n\n#endif\n";
+    return out.str();
+}
+
+int main(int argc, char** argv)
+{
+    VulkanProj::Log::Init();
+
+    if (argc != 4) {
+        VKP_INFO("Usage: VulkanShaderEmbed <shader.spv> <output.hpp> <name>");
+        VulkanProj::Log::Shutdown();
+        return 1;
+    }
+    const std::string input = argv[1];
+    const std::string output = argv[2];
+    const std::string name = argv[3];
+
+    std::vector<u32> words;
+    VulkanProj::SpirvReflection reflection;
+    if (!readSpirv(input, words) || !VulkanProj::reflectSpirv(input, words, reflection)) {
+        VulkanProj::Log::Shutdown();
+        return 1;
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    out << generateHeader(name, words, reflection);
+    out.close();
+    if (out.fail()) {
+        VKP_ERROR("Unable to write {}", output);
+        VulkanProj::Log::Shutdown();
+        return 1;
+    }
+
+    VulkanProj::Log::Shutdown();
+    return 0;
+}